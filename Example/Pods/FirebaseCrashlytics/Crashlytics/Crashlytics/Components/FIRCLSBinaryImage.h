@@ -38,6 +38,7 @@ typedef struct {
 #endif
 #if CLS_COMPACT_UNWINDING_SUPPORTED
   const void* unwindInfo;
+  uint64_t unwindInfoSize;
 #endif
   const void* crashInfo;
 #if CLS_BINARY_IMAGE_RUNTIME_NODE_RECORD_NAME
@@ -74,6 +75,12 @@ bool FIRCLSBinaryImageSafeHasUnwindInfo(FIRCLSBinaryImageRuntimeNode* image);
 
 bool FIRCLSBinaryImageFindImageForUUID(const char* uuidString,
                                        FIRCLSBinaryImageDetails* imageDetails);
+// Looks up several images in a single pass over the loaded images.  imageDetails and found must
+// both have room for count entries.  Returns the number of images found.
+uint32_t FIRCLSBinaryImageFindImagesForUUIDs(const char* const* uuidStrings,
+                                             uint32_t count,
+                                             FIRCLSBinaryImageDetails* imageDetails,
+                                             bool* found);
 
 bool FIRCLSBinaryImageRecordMainExecutable(FIRCLSFile* file);
 
@@ -21,6 +21,7 @@
 
 #include <stdatomic.h>
 
+#include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImagePendingLoads.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSGlobals.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSHost.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSDefines.h"
@@ -48,8 +49,15 @@ static void FIRCLSBinaryImageChanged(bool added,
                                      intptr_t vmaddr_slide);
 static bool FIRCLSBinaryImageFillInImageDetails(FIRCLSBinaryImageDetails* details);
 
+static void FIRCLSBinaryImageProcessPendingLoads(void* context);
+
 static void FIRCLSBinaryImageStoreNode(bool added, FIRCLSBinaryImageDetails imageDetails);
-static void FIRCLSBinaryImageRecordSlice(bool added, const FIRCLSBinaryImageDetails imageDetails);
+static void FIRCLSBinaryImageRecordSlice(FIRCLSFile* file,
+                                         bool added,
+                                         const FIRCLSBinaryImageDetails imageDetails);
+static void FIRCLSBinaryImageRecordChanges(bool added,
+                                           const FIRCLSBinaryImageDetails* imageDetails,
+                                           uint32_t count);
 
 #pragma mark - Core API
 void FIRCLSBinaryImageInit(void) {
@@ -57,6 +65,8 @@ void FIRCLSBinaryImageInit(void) {
   memset(&_firclsContext.writable->binaryImage, 0, sizeof(_firclsContext.writable->binaryImage));
   _firclsContext.writable->binaryImage.file.fd = -1;
 
+  FIRCLSBinaryImagePendingLoadsInit();
+
   dispatch_async(FIRCLSGetBinaryImageQueue(), ^{
     if (!FIRCLSUnlinkIfExists(_firclsContext.readonly->binaryimage.path)) {
       FIRCLSSDKLog("Unable to reset the binary image log file %s\n", strerror(errno));
@@ -95,8 +105,9 @@ static bool FIRCLSBinaryImageOpenIfNeeded(bool* needsClosing) {
     return true;
   }
 
+  // Writes are buffered, and flushed once per batch of images.
   if (!FIRCLSFileInitWithPath(&_firclsContext.writable->binaryImage.file,
-                              _firclsContext.readonly->binaryimage.path, false)) {
+                              _firclsContext.readonly->binaryimage.path, true)) {
     FIRCLSSDKLog("Error: unable to open binary image log file\n");
     return false;
   }
@@ -146,20 +157,42 @@ bool FIRCLSBinaryImageSafeFindImageForAddress(uintptr_t address,
 }
 
 bool FIRCLSBinaryImageSafeHasUnwindInfo(FIRCLSBinaryImageRuntimeNode* image) {
-  return FIRCLSIsValidPointer(image->unwindInfo);
+  return FIRCLSIsValidPointer(image->unwindInfo) && image->unwindInfoSize > 0;
 }
 #endif
 
 bool FIRCLSBinaryImageFindImageForUUID(const char* uuidString,
                                        FIRCLSBinaryImageDetails* imageDetails) {
+  bool found = false;
+
   if (!imageDetails || !uuidString) {
     FIRCLSSDKLog("null input\n");
     return false;
   }
 
+  FIRCLSBinaryImageFindImagesForUUIDs(&uuidString, 1, imageDetails, &found);
+
+  return found;
+}
+
+uint32_t FIRCLSBinaryImageFindImagesForUUIDs(const char* const* uuidStrings,
+                                             uint32_t count,
+                                             FIRCLSBinaryImageDetails* imageDetails,
+                                             bool* found) {
+  uint32_t foundCount = 0;
+
+  if (!uuidStrings || !imageDetails || !found) {
+    FIRCLSSDKLog("null input\n");
+    return 0;
+  }
+
+  memset(found, 0, sizeof(bool) * count);
+
+  // Walk the loaded images once, filling in every requested UUID as it is seen, instead of walking
+  // them all again for each one.
   uint32_t imageCount = _dyld_image_count();
 
-  for (uint32_t i = 0; i < imageCount; ++i) {
+  for (uint32_t i = 0; i < imageCount && foundCount < count; ++i) {
     const struct mach_header* mh = _dyld_get_image_header(i);
 
     FIRCLSBinaryImageDetails image;
@@ -167,13 +200,20 @@ bool FIRCLSBinaryImageFindImageForUUID(const char* uuidString,
     image.slice = FIRCLSMachOSliceWithHeader((void*)mh);
     FIRCLSBinaryImageFillInImageDetails(&image);
 
-    if (strncmp(uuidString, image.uuidString, FIRCLSUUIDStringLength) == 0) {
-      *imageDetails = image;
-      return true;
+    for (uint32_t j = 0; j < count; ++j) {
+      if (found[j] || !uuidStrings[j]) {
+        continue;
+      }
+
+      if (strncmp(uuidStrings[j], image.uuidString, FIRCLSUUIDStringLength) == 0) {
+        imageDetails[j] = image;
+        found[j] = true;
+        foundCount++;
+      }
     }
   }
 
-  return false;
+  return foundCount;
 }
 
 #pragma mark - DYLD callback handlers
@@ -349,11 +389,13 @@ static bool FIRCLSBinaryImageFillInImageDetails(FIRCLSBinaryImageDetails* detail
   if (FIRCLSBinaryImageMachOSliceInitSectionByName(&details->slice, SEG_TEXT, "__unwind_info",
                                                    &section)) {
     details->node.unwindInfo = (void*)(section.addr + details->vmaddr_slide);
+    details->node.unwindInfoSize = section.size;
   }
 #else
   unsigned long unwindInfoSize;
   details->node.unwindInfo = (void*)getsectiondata(details->slice.startAddress, "__TEXT",
                                                    "__unwind_info", &unwindInfoSize);
+  details->node.unwindInfoSize = unwindInfoSize;
 #endif
 #endif
 
@@ -393,14 +435,79 @@ static void FIRCLSProcessBinaryImageChange(void* context) {
   FIRCLSImageChange* imageChange = context;
   // this is an atomic operation
   FIRCLSBinaryImageStoreNode(imageChange->added, imageChange->details);
-  FIRCLSBinaryImageRecordSlice(imageChange->added, imageChange->details);
+  FIRCLSBinaryImageRecordChanges(imageChange->added, &imageChange->details, 1);
   free(context);
 }
 
+static void FIRCLSBinaryImageProcessPendingLoads(void* context) {
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+
+  FIRCLSBinaryImagePendingLoad batchLoads[FIRCLSBinaryImagePendingLoadBatchSize];
+  FIRCLSBinaryImagePendingLoad* loads = batchLoads;
+  FIRCLSBinaryImageDetails batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  FIRCLSBinaryImageDetails* details = batch;
+  bool batchKept[FIRCLSBinaryImagePendingLoadBatchSize];
+  bool* kept = batchKept;
+
+  for (;;) {
+    uint32_t count = 0;
+
+    if (FIRCLSBinaryImagePendingLoadsClaim(loads, &count) == 0) {
+      break;
+    }
+
+    // Parsing only reads the mapped headers, so it can run concurrently. Storing and recording
+    // stays serial, in load order. An image unloaded in the meantime stays mapped until its
+    // parse finishes, and is then dropped.
+    dispatch_apply(count, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t i) {
+      memset(&details[i], 0, sizeof(FIRCLSBinaryImageDetails));
+      details[i].slice = FIRCLSMachOSliceWithHeader((void*)loads[i].header);
+      details[i].vmaddr_slide = loads[i].vmaddr_slide;
+      FIRCLSBinaryImageFillInImageDetails(&details[i]);
+
+      kept[i] = FIRCLSBinaryImagePendingLoadsFinish((uint32_t)i);
+    });
+
+    uint32_t keptCount = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (kept[i]) {
+        details[keptCount++] = details[i];
+      }
+    }
+
+    for (uint32_t i = 0; i < keptCount; ++i) {
+      FIRCLSBinaryImageStoreNode(true, details[i]);
+    }
+
+    FIRCLSBinaryImageRecordChanges(true, details, keptCount);
+  }
+}
+
 static void FIRCLSBinaryImageChanged(bool added,
                                      const struct mach_header* mh,
                                      intptr_t vmaddr_slide) {
   //    FIRCLSSDKLog("Binary image %s %p\n", added ? "loaded" : "unloaded", mh);
+#if !CLS_BINARY_IMAGE_RUNTIME_NODE_RECORD_NAME
+  // Recording names uses dladdr, which takes the dyld lock that an unload holds while it waits
+  // for a parse, so loads are only deferred without it.
+  if (added) {
+    bool scheduleProcessing = false;
+
+    if (FIRCLSBinaryImagePendingLoadsEnqueue(mh, vmaddr_slide, &scheduleProcessing)) {
+      if (scheduleProcessing) {
+        dispatch_async_f(FIRCLSGetBinaryImageQueue(), NULL, FIRCLSBinaryImageProcessPendingLoads);
+      }
+      return;
+    }
+
+    // The queue is full, so fall back to parsing here.
+  } else if (FIRCLSBinaryImagePendingLoadsCancel(mh)) {
+    return;
+  }
+#endif
+
+  // An unloading image is only guaranteed to be mapped for the duration of this callback, so it is
+  // always parsed here.
   FIRCLSBinaryImageDetails imageDetails;
   memset(&imageDetails, 0, sizeof(FIRCLSBinaryImageDetails));
 
@@ -546,15 +653,9 @@ static void FIRCLSBinaryImageRecordLibraryFrameworkInfo(FIRCLSFile* file, const
       file, "display_version", [bundle objectForInfoDictionaryKey:@"CFBundleShortVersionString"]);
 }
 
-static void FIRCLSBinaryImageRecordSlice(bool added, const FIRCLSBinaryImageDetails imageDetails) {
-  bool needsClosing = false;
-  if (!FIRCLSBinaryImageOpenIfNeeded(&needsClosing)) {
-    FIRCLSSDKLog("Error: unable to open binary image log file\n");
-    return;
-  }
-
-  FIRCLSFile* file = &_firclsContext.writable->binaryImage.file;
-
+static void FIRCLSBinaryImageRecordSlice(FIRCLSFile* file,
+                                         bool added,
+                                         const FIRCLSBinaryImageDetails imageDetails) {
   FIRCLSFileWriteSectionStart(file, added ? "load" : "unload");
 
   FIRCLSFileWriteHashStart(file);
@@ -573,9 +674,34 @@ static void FIRCLSBinaryImageRecordSlice(bool added, const FIRCLSBinaryImageDeta
   FIRCLSFileWriteHashEnd(file);
 
   FIRCLSFileWriteSectionEnd(file);
+}
+
+// Appends a whole batch with a single open, and as few writes as the buffer allows, instead of an
+// open/write/close cycle per image.
+static void FIRCLSBinaryImageRecordChanges(bool added,
+                                           const FIRCLSBinaryImageDetails* imageDetails,
+                                           uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  bool needsClosing = false;
+  if (!FIRCLSBinaryImageOpenIfNeeded(&needsClosing)) {
+    FIRCLSSDKLog("Error: unable to open binary image log file\n");
+    return;
+  }
+
+  FIRCLSFile* file = &_firclsContext.writable->binaryImage.file;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    FIRCLSBinaryImageRecordSlice(file, added, imageDetails[i]);
+  }
 
   if (needsClosing) {
     FIRCLSFileClose(file);
+  } else {
+    // The file stays open during init, but each batch should still be on disk once recorded.
+    FIRCLSFileFlushWriteBuffer(file);
   }
 }
 
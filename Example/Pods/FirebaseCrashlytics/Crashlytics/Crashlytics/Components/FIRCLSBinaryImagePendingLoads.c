@@ -0,0 +1,195 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImagePendingLoads.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A cell whose sequence equals a position is free for the producer claiming that position, and
+// one whose sequence is the position + 1 has been published to the consumer.
+typedef struct {
+  _Atomic(uint64_t) sequence;
+  // Cleared by the consumer when it claims the load, or by an unload that gets there first.
+  _Atomic(const void*) header;
+  intptr_t vmaddr_slide;
+} FIRCLSBinaryImagePendingLoadCell;
+
+// Headers are at least 4-byte aligned, which leaves the low bit of a parsing slot free to mark
+// a load that was unloaded while it was being parsed.
+#define FIRCLSBinaryImagePendingLoadUnloaded ((uintptr_t)1)
+
+static struct {
+  FIRCLSBinaryImagePendingLoadCell cells[FIRCLSBinaryImagePendingLoadCapacity];
+  _Atomic(uint64_t) tail;
+  // only touched by the consumer
+  uint64_t head;
+  _Atomic(bool) processingScheduled;
+
+  // The headers of the batch being parsed, cleared by the consumer as each one is done. Each is
+  // published before its header leaves the cell, so an unload always finds it in one of the two.
+  _Atomic(uintptr_t) parsing[FIRCLSBinaryImagePendingLoadBatchSize];
+  // An unload that finds its image being parsed waits on this, until the slot is cleared.
+  pthread_mutex_t parsedLock;
+  pthread_cond_t parsed;
+} _firclsPendingLoads = {
+    .parsedLock = PTHREAD_MUTEX_INITIALIZER,
+    .parsed = PTHREAD_COND_INITIALIZER,
+};
+
+void FIRCLSBinaryImagePendingLoadsInit(void) {
+  for (uint64_t i = 0; i < FIRCLSBinaryImagePendingLoadCapacity; ++i) {
+    atomic_store(&_firclsPendingLoads.cells[i].sequence, i);
+    atomic_store(&_firclsPendingLoads.cells[i].header, NULL);
+  }
+
+  atomic_store(&_firclsPendingLoads.tail, 0);
+  _firclsPendingLoads.head = 0;
+  atomic_store(&_firclsPendingLoads.processingScheduled, false);
+  for (uint32_t i = 0; i < FIRCLSBinaryImagePendingLoadBatchSize; ++i) {
+    atomic_store(&_firclsPendingLoads.parsing[i], 0);
+  }
+}
+
+bool FIRCLSBinaryImagePendingLoadsEnqueue(const void* header,
+                                          intptr_t vmaddr_slide,
+                                          bool* scheduleProcessing) {
+  uint64_t position = atomic_load_explicit(&_firclsPendingLoads.tail, memory_order_relaxed);
+  FIRCLSBinaryImagePendingLoadCell* cell;
+
+  for (;;) {
+    cell = &_firclsPendingLoads.cells[position % FIRCLSBinaryImagePendingLoadCapacity];
+
+    const uint64_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const int64_t difference = (int64_t)(sequence - position);
+
+    if (difference == 0) {
+      if (atomic_compare_exchange_weak_explicit(&_firclsPendingLoads.tail, &position, position + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // full
+      return false;
+    } else {
+      position = atomic_load_explicit(&_firclsPendingLoads.tail, memory_order_relaxed);
+    }
+  }
+
+  atomic_store_explicit(&cell->header, header, memory_order_relaxed);
+  cell->vmaddr_slide = vmaddr_slide;
+  atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+
+  // One pass drains everything published before it starts, so only schedule one at a time.
+  *scheduleProcessing = !atomic_exchange(&_firclsPendingLoads.processingScheduled, true);
+
+  return true;
+}
+
+bool FIRCLSBinaryImagePendingLoadsCancel(const void* header) {
+  // Unloads are rare, so scanning every cell is fine.
+  for (uint32_t i = 0; i < FIRCLSBinaryImagePendingLoadCapacity; ++i) {
+    const void* expected = header;
+
+    if (atomic_compare_exchange_strong(&_firclsPendingLoads.cells[i].header, &expected, NULL)) {
+      return true;
+    }
+  }
+
+  const uintptr_t unloaded = (uintptr_t)header | FIRCLSBinaryImagePendingLoadUnloaded;
+
+  for (uint32_t i = 0; i < FIRCLSBinaryImagePendingLoadBatchSize; ++i) {
+    uintptr_t expected = (uintptr_t)header;
+
+    if (!atomic_compare_exchange_strong(&_firclsPendingLoads.parsing[i], &expected, unloaded)) {
+      continue;
+    }
+
+    // The consumer is still reading the header. Parsing one image takes microseconds, and the
+    // consumer always signals once it sees the mark.
+    pthread_mutex_lock(&_firclsPendingLoads.parsedLock);
+    while (atomic_load(&_firclsPendingLoads.parsing[i]) == unloaded) {
+      pthread_cond_wait(&_firclsPendingLoads.parsed, &_firclsPendingLoads.parsedLock);
+    }
+    pthread_mutex_unlock(&_firclsPendingLoads.parsedLock);
+
+    return true;
+  }
+
+  // Not found, so it has already been parsed. Its removal is recorded after the load.
+  return false;
+}
+
+void FIRCLSBinaryImagePendingLoadsBeginPass(void) {
+  atomic_store(&_firclsPendingLoads.processingScheduled, false);
+}
+
+uint32_t FIRCLSBinaryImagePendingLoadsClaim(FIRCLSBinaryImagePendingLoad* batch, uint32_t* count) {
+  uint32_t claimedCount = 0;
+
+  *count = 0;
+
+  while (claimedCount < FIRCLSBinaryImagePendingLoadBatchSize) {
+    const uint64_t position = _firclsPendingLoads.head;
+    FIRCLSBinaryImagePendingLoadCell* cell =
+        &_firclsPendingLoads.cells[position % FIRCLSBinaryImagePendingLoadCapacity];
+
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + 1) {
+      // empty, or the producer has not yet published this cell
+      break;
+    }
+
+    const void* header = atomic_load(&cell->header);
+    const intptr_t vmaddr_slide = cell->vmaddr_slide;
+
+    if (header) {
+      atomic_store(&_firclsPendingLoads.parsing[*count], (uintptr_t)header);
+
+      const void* expected = header;
+      if (!atomic_compare_exchange_strong(&cell->header, &expected, NULL)) {
+        // cancelled by an unload, which returned without looking at parsing
+        atomic_store(&_firclsPendingLoads.parsing[*count], 0);
+        header = NULL;
+      }
+    }
+
+    atomic_store_explicit(&cell->sequence, position + FIRCLSBinaryImagePendingLoadCapacity,
+                          memory_order_release);
+    _firclsPendingLoads.head = position + 1;
+    claimedCount++;
+
+    if (header) {
+      batch[*count].header = header;
+      batch[*count].vmaddr_slide = vmaddr_slide;
+      (*count)++;
+    }
+  }
+
+  return claimedCount;
+}
+
+bool FIRCLSBinaryImagePendingLoadsFinish(uint32_t index) {
+  const uintptr_t header = atomic_exchange(&_firclsPendingLoads.parsing[index], 0);
+
+  if ((header & FIRCLSBinaryImagePendingLoadUnloaded) == 0) {
+    return true;
+  }
+
+  // Taking the lock orders this after the unload's check, so it can't miss the wakeup.
+  pthread_mutex_lock(&_firclsPendingLoads.parsedLock);
+  pthread_cond_broadcast(&_firclsPendingLoads.parsed);
+  pthread_mutex_unlock(&_firclsPendingLoads.parsedLock);
+
+  return false;
+}
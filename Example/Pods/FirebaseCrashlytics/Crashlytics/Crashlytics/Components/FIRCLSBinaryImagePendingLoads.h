@@ -0,0 +1,65 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// Typically several hundred images are loaded before Crashlytics starts, and dyld reports all of
+// them from inside _dyld_register_func_for_add_image. So, the add callback only records the header
+// and slide here, and the details are parsed later in batches, on the binary image queue.
+//
+// This is a bounded multi-producer, single-consumer ring. Only plain C and pthreads are used, so
+// that it can be exercised off-device.
+
+__BEGIN_DECLS
+
+// One for every runtime node, since there can't be more images than that to record.
+#define FIRCLSBinaryImagePendingLoadCapacity (1024)
+#define FIRCLSBinaryImagePendingLoadBatchSize (64)
+
+typedef struct {
+  const void* header;
+  intptr_t vmaddr_slide;
+} FIRCLSBinaryImagePendingLoad;
+
+void FIRCLSBinaryImagePendingLoadsInit(void);
+
+// Returns false if the ring is full, in which case the caller has to parse the image itself.
+// scheduleProcessing is set when no pass is scheduled to pick the load up yet.
+bool FIRCLSBinaryImagePendingLoadsEnqueue(const void* header,
+                                          intptr_t vmaddr_slide,
+                                          bool* scheduleProcessing);
+
+// Called when an image is unloaded. Returns true if its load was still queued, and so never needs
+// to be recorded. A load that is being parsed is waited for, so that the header stays mapped
+// until the consumer is done with it. That wait happens with dyld's lock held, so parsing must
+// never take it.
+bool FIRCLSBinaryImagePendingLoadsCancel(const void* header);
+
+// The consumer's side, which must only be used from one thread at a time. Each pass starts with
+// BeginPass, so that loads enqueued from then on schedule another one.
+void FIRCLSBinaryImagePendingLoadsBeginPass(void);
+
+// Claims up to a batch of loads, and returns how many cells were consumed, which is zero once the
+// ring is empty. Cancelled loads are skipped, so count can be smaller.
+uint32_t FIRCLSBinaryImagePendingLoadsClaim(FIRCLSBinaryImagePendingLoad* batch, uint32_t* count);
+
+// Called once batch[index] has been parsed, possibly concurrently with other indexes. Returns
+// false if the image was unloaded in the meantime, in which case its details must be dropped.
+bool FIRCLSBinaryImagePendingLoadsFinish(uint32_t index);
+
+__END_DECLS
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImage.h"
+#include "Crashlytics/Crashlytics/Components/FIRCLSCrashTimings.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSHost.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSUserLogging.h"
 #include "Crashlytics/Crashlytics/Handlers/FIRCLSException.h"
@@ -59,6 +60,7 @@ typedef struct {
   FIRCLSBinaryImageReadOnlyContext binaryimage;
   FIRCLSExceptionReadOnlyContext exception;
   FIRCLSHostReadOnlyContext host;
+  FIRCLSCrashTimingsReadOnlyContext timings;
 #if CLS_SIGNAL_SUPPORTED
   FIRCLSSignalReadContext signal;
 #endif
@@ -74,6 +76,7 @@ typedef struct {
   FIRCLSBinaryImageReadWriteContext binaryImage;
   FIRCLSUserLoggingWritableContext logging;
   FIRCLSExceptionWritableContext exception;
+  FIRCLSCrashTimingsWritableContext timings;
 } FIRCLSReadWriteContext;
 
 typedef struct {
@@ -90,7 +93,7 @@ FIRCLSContextInitData* FIRCLSContextBuildInitData(FIRCLSInternalReport* report,
 bool FIRCLSContextRecordMetadata(NSString* rootPath, FIRCLSContextInitData* initData);
 #endif
 
-void FIRCLSContextBaseInit(void);
+bool FIRCLSContextBaseInit(void);
 void FIRCLSContextBaseDeinit(void);
 
 bool FIRCLSContextIsInitialized(void);
@@ -49,7 +49,8 @@
 static const int64_t FIRCLSContextInitWaitTime = 5LL * NSEC_PER_SEC;
 
 static const char* FIRCLSContextAppendToRoot(NSString* root, NSString* component);
-static void FIRCLSContextAllocate(FIRCLSContext* context);
+static bool FIRCLSContextAllocate(FIRCLSContext* context);
+static bool FIRCLSContextAllocationFailed(FIRCLSContext* context, const char* what);
 
 FIRCLSContextInitData* FIRCLSContextBuildInitData(FIRCLSInternalReport* report,
                                                   FIRCLSSettings* settings,
@@ -71,6 +72,7 @@ FIRCLSContextInitData* FIRCLSContextBuildInitData(FIRCLSInternalReport* report,
   initData.maxErrorLogSize = [settings errorLogBufferSize];
   initData.maxLogSize = [settings logBufferSize];
   initData.maxKeyValues = [settings maxCustomKeys];
+  initData.crashTimingsEnabled = [settings crashTimingsEnabled];
   initData.betaToken = @"";
 
   return initData;
@@ -81,7 +83,9 @@ bool FIRCLSContextInitialize(FIRCLSContextInitData* initData, FIRCLSFileManager*
     return false;
   }
 
-  FIRCLSContextBaseInit();
+  if (!FIRCLSContextBaseInit()) {
+    return false;
+  }
 
   dispatch_group_t group = dispatch_group_create();
   dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
@@ -98,6 +102,7 @@ bool FIRCLSContextInitialize(FIRCLSContextInitData* initData, FIRCLSFileManager*
   if (!FIRCLSUnlinkIfExists(_firclsContext.readonly->logPath)) {
     FIRCLSErrorLog(@"Unable to write initialize SDK write paths %s", strerror(errno));
   }
+  FIRCLSSDKFileLogInitialize();
 
   // some values that aren't tied to particular subsystem
   _firclsContext.readonly->debuggerAttached = FIRCLSProcessDebuggerAttached();
@@ -106,6 +111,11 @@ bool FIRCLSContextInitialize(FIRCLSContextInitData* initData, FIRCLSFileManager*
     FIRCLSHostInitialize(&_firclsContext.readonly->host);
   });
 
+  dispatch_group_async(group, queue, ^{
+    FIRCLSCrashTimingsInit(&_firclsContext.readonly->timings, &_firclsContext.writable->timings,
+                           initData.crashTimingsEnabled);
+  });
+
   dispatch_group_async(group, queue, ^{
     _firclsContext.readonly->logging.errorStorage.maxSize = 0;
     _firclsContext.readonly->logging.errorStorage.maxEntries =
@@ -230,7 +240,7 @@ bool FIRCLSContextInitialize(FIRCLSContextInitData* initData, FIRCLSFileManager*
   return true;
 }
 
-void FIRCLSContextBaseInit(void) {
+bool FIRCLSContextBaseInit(void) {
   NSString* sdkBundleID = FIRCLSApplicationGetSDKBundleID();
 
   NSString* loggingQueueName = [sdkBundleID stringByAppendingString:@".logging"];
@@ -243,7 +253,10 @@ void FIRCLSContextBaseInit(void) {
   _firclsExceptionQueue =
       dispatch_queue_create([exceptionQueueName UTF8String], DISPATCH_QUEUE_SERIAL);
 
-  FIRCLSContextAllocate(&_firclsContext);
+  if (!FIRCLSContextAllocate(&_firclsContext)) {
+    __sync_synchronize();
+    return false;
+  }
 
   _firclsContext.writable->internalLogging.logFd = -1;
   _firclsContext.writable->internalLogging.logLevel = FIRCLSInternalLogLevelDebug;
@@ -252,18 +265,26 @@ void FIRCLSContextBaseInit(void) {
   _firclsContext.readonly->initialized = false;
 
   __sync_synchronize();
+
+  return true;
 }
 
-static void FIRCLSContextAllocate(FIRCLSContext* context) {
+static bool FIRCLSContextAllocate(FIRCLSContext* context) {
   // create the allocator, and the contexts
   // The ordering here is really important, because the "stack" variable must be
   // page-aligned.  There's no mechanism to ask the allocator to do alignment, but we
   // do know the very first allocation in a region is aligned to a page boundary.
 
   context->allocator = FIRCLSAllocatorCreate(CLS_MINIMUM_READWRITE_SIZE, CLS_MINIMUM_READABLE_SIZE);
+  if (!context->allocator) {
+    return FIRCLSContextAllocationFailed(context, "allocator");
+  }
 
   context->readonly =
       FIRCLSAllocatorSafeAllocate(context->allocator, sizeof(FIRCLSReadOnlyContext), CLS_READONLY);
+  if (!context->readonly) {
+    return FIRCLSContextAllocationFailed(context, "readonly context");
+  }
   memset(context->readonly, 0, sizeof(FIRCLSReadOnlyContext));
 
 #if CLS_MEMORY_PROTECTION_ENABLED
@@ -285,21 +306,59 @@ static void FIRCLSContextAllocate(FIRCLSContext* context) {
 #endif
 
 #if CLS_MACH_EXCEPTION_SUPPORTED
-  memset(_firclsContext.readonly->machStack, 0, CLS_MACH_EXCEPTION_HANDLER_STACK_SIZE);
+  if (!context->readonly->machStack) {
+    return FIRCLSContextAllocationFailed(context, "mach exception handler stack");
+  }
+  memset(context->readonly->machStack, 0, CLS_MACH_EXCEPTION_HANDLER_STACK_SIZE);
 #endif
 #if CLS_USE_SIGALTSTACK
-  memset(_firclsContext.readonly->signalStack, 0, CLS_SIGNAL_HANDLER_STACK_SIZE);
+  if (!context->readonly->signalStack) {
+    return FIRCLSContextAllocationFailed(context, "signal handler stack");
+  }
+  memset(context->readonly->signalStack, 0, CLS_SIGNAL_HANDLER_STACK_SIZE);
 #endif
 
   context->writable = FIRCLSAllocatorSafeAllocate(context->allocator,
                                                   sizeof(FIRCLSReadWriteContext), CLS_READWRITE);
+  if (!context->writable) {
+    return FIRCLSContextAllocationFailed(context, "writable context");
+  }
   memset(context->writable, 0, sizeof(FIRCLSReadWriteContext));
+
+  return true;
+}
+
+// Undoes a partial FIRCLSContextAllocate, so the context reads as uninitialized, and every handler
+// that checks it stays out of the way.
+static bool FIRCLSContextAllocationFailed(FIRCLSContext* context, const char* what) {
+  FIRCLSErrorLog(@"Unable to allocate the %s, Crashlytics will not be initialized", what);
+
+#if !CLS_MEMORY_PROTECTION_ENABLED
+  if (context->readonly) {
+#if CLS_MACH_EXCEPTION_SUPPORTED
+    free(context->readonly->machStack);
+#endif
+#if CLS_USE_SIGALTSTACK
+    free(context->readonly->signalStack);
+#endif
+  }
+#endif
+
+  FIRCLSAllocatorDestroy(context->allocator);
+  context->allocator = NULL;
+  context->readonly = NULL;
+  context->writable = NULL;
+
+  return false;
 }
 
 void FIRCLSContextBaseDeinit(void) {
   _firclsContext.readonly->initialized = false;
 
   FIRCLSAllocatorDestroy(_firclsContext.allocator);
+  _firclsContext.allocator = NULL;
+  _firclsContext.readonly = NULL;
+  _firclsContext.writable = NULL;
 }
 
 bool FIRCLSContextIsInitialized(void) {
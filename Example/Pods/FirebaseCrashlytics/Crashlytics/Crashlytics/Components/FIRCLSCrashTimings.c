@@ -0,0 +1,147 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSCrashTimings.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
+
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <string.h>
+
+static const char* const FIRCLSCrashTimingCheckpointNames[FIRCLSCrashTimingCheckpointCount] = {
+    [FIRCLSCrashTimingCheckpointStart] = "start",
+    [FIRCLSCrashTimingCheckpointThreadsSuspended] = "suspend_threads",
+    [FIRCLSCrashTimingCheckpointThreadsRecorded] = "record_threads",
+    [FIRCLSCrashTimingCheckpointRuntimeRecorded] = "record_runtime",
+    [FIRCLSCrashTimingCheckpointNamesRecorded] = "record_names",
+    [FIRCLSCrashTimingCheckpointStatsRecorded] = "record_stats",
+    [FIRCLSCrashTimingCheckpointMarkerCreated] = "create_marker",
+    [FIRCLSCrashTimingCheckpointLogFlushed] = "flush_log",
+};
+
+void FIRCLSCrashTimingsInit(FIRCLSCrashTimingsReadOnlyContext* roContext,
+                            FIRCLSCrashTimingsWritableContext* rwContext,
+                            bool enabled) {
+  mach_timebase_info_data_t timebase;
+
+  if (mach_timebase_info(&timebase) != KERN_SUCCESS || timebase.denom == 0) {
+    FIRCLSSDKLog("Unable to get timebase, timings will be in ticks\n");
+    timebase.numer = 1;
+    timebase.denom = 1;
+  }
+
+  roContext->enabled = enabled;
+  roContext->timebaseNumer = timebase.numer;
+  roContext->timebaseDenom = timebase.denom;
+
+  memset(rwContext, 0, sizeof(FIRCLSCrashTimingsWritableContext));
+}
+
+uint64_t FIRCLSCrashTimingsNow(void) {
+  return mach_absolute_time();
+}
+
+void FIRCLSCrashTimingsStart(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                             FIRCLSCrashTimingsWritableContext* rwContext) {
+  if (!roContext->enabled) {
+    return;
+  }
+
+  memset(rwContext, 0, sizeof(FIRCLSCrashTimingsWritableContext));
+  rwContext->checkpoints[FIRCLSCrashTimingCheckpointStart] = FIRCLSCrashTimingsNow();
+}
+
+void FIRCLSCrashTimingsCheckpoint(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                  FIRCLSCrashTimingsWritableContext* rwContext,
+                                  FIRCLSCrashTimingCheckpoint checkpoint) {
+  if (!roContext->enabled || checkpoint >= FIRCLSCrashTimingCheckpointCount) {
+    return;
+  }
+
+  rwContext->checkpoints[checkpoint] = FIRCLSCrashTimingsNow();
+}
+
+void FIRCLSCrashTimingsRecordThread(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                    FIRCLSCrashTimingsWritableContext* rwContext,
+                                    uint32_t index,
+                                    uint64_t startTicks) {
+  if (!roContext->enabled) {
+    return;
+  }
+
+  const uint64_t ticks = FIRCLSCrashTimingsNow() - startTicks;
+
+  rwContext->threadCount += 1;
+  if (ticks > rwContext->slowestThreadTicks) {
+    rwContext->slowestThreadTicks = ticks;
+    rwContext->slowestThreadIndex = index;
+  }
+}
+
+static uint64_t FIRCLSCrashTimingsNanoseconds(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                              uint64_t ticks) {
+  if (roContext->timebaseDenom == 0) {
+    return ticks;
+  }
+
+  // Handler stages are short enough that this can't overflow.
+  return ticks * roContext->timebaseNumer / roContext->timebaseDenom;
+}
+
+void FIRCLSCrashTimingsWrite(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                             const FIRCLSCrashTimingsWritableContext* rwContext,
+                             FIRCLSFile* file) {
+  if (!roContext->enabled) {
+    return;
+  }
+
+  const uint64_t start = rwContext->checkpoints[FIRCLSCrashTimingCheckpointStart];
+
+  if (start == 0) {
+    return;
+  }
+
+  FIRCLSFileWriteSectionStart(file, "timings");
+
+  FIRCLSFileWriteHashStart(file);
+
+  // Each stage is measured from the last checkpoint that was reached before it.
+  uint64_t previous = start;
+  for (uint32_t i = FIRCLSCrashTimingCheckpointStart + 1; i < FIRCLSCrashTimingCheckpointCount;
+       ++i) {
+    const uint64_t checkpoint = rwContext->checkpoints[i];
+    if (checkpoint == 0) {
+      continue;
+    }
+
+    FIRCLSFileWriteHashEntryUint64(file, FIRCLSCrashTimingCheckpointNames[i],
+                                   FIRCLSCrashTimingsNanoseconds(roContext, checkpoint - previous));
+    previous = checkpoint;
+  }
+
+  FIRCLSFileWriteHashEntryUint64(file, "total",
+                                 FIRCLSCrashTimingsNanoseconds(roContext, previous - start));
+
+  FIRCLSFileWriteHashEntryUint64(file, "thread_count", rwContext->threadCount);
+  if (rwContext->threadCount > 0) {
+    FIRCLSFileWriteHashEntryUint64(file, "slowest_thread", rwContext->slowestThreadIndex);
+    FIRCLSFileWriteHashEntryUint64(
+        file, "slowest_thread_time",
+        FIRCLSCrashTimingsNanoseconds(roContext, rwContext->slowestThreadTicks));
+  }
+
+  FIRCLSFileWriteHashEnd(file);
+
+  FIRCLSFileWriteSectionEnd(file);
+}
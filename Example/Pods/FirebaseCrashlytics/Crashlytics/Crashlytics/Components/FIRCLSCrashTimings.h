@@ -0,0 +1,80 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+
+// Monotonic checkpoints taken while a crash is being recorded, so that the time spent in each stage
+// of the handler ends up in the report. Everything here is async-signal safe, and only touches the
+// contexts it is given, so it can also be run off-device.
+
+typedef enum {
+  FIRCLSCrashTimingCheckpointStart = 0,
+  FIRCLSCrashTimingCheckpointThreadsSuspended,
+  FIRCLSCrashTimingCheckpointThreadsRecorded,
+  FIRCLSCrashTimingCheckpointRuntimeRecorded,
+  FIRCLSCrashTimingCheckpointNamesRecorded,
+  FIRCLSCrashTimingCheckpointStatsRecorded,
+  FIRCLSCrashTimingCheckpointMarkerCreated,
+  FIRCLSCrashTimingCheckpointLogFlushed,
+  FIRCLSCrashTimingCheckpointCount
+} FIRCLSCrashTimingCheckpoint;
+
+typedef struct {
+  // Set from settings. When false, nothing is recorded or written.
+  bool enabled;
+  // For converting mach_absolute_time ticks to nanoseconds, looked up ahead of time
+  uint32_t timebaseNumer;
+  uint32_t timebaseDenom;
+} FIRCLSCrashTimingsReadOnlyContext;
+
+typedef struct {
+  // In ticks. Zero means the checkpoint wasn't reached.
+  uint64_t checkpoints[FIRCLSCrashTimingCheckpointCount];
+  uint32_t threadCount;
+  uint64_t slowestThreadTicks;
+  uint32_t slowestThreadIndex;
+} FIRCLSCrashTimingsWritableContext;
+
+__BEGIN_DECLS
+
+void FIRCLSCrashTimingsInit(FIRCLSCrashTimingsReadOnlyContext* roContext,
+                            FIRCLSCrashTimingsWritableContext* rwContext,
+                            bool enabled);
+
+// Clears any previous checkpoints, and records the start.
+void FIRCLSCrashTimingsStart(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                             FIRCLSCrashTimingsWritableContext* rwContext);
+void FIRCLSCrashTimingsCheckpoint(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                  FIRCLSCrashTimingsWritableContext* rwContext,
+                                  FIRCLSCrashTimingCheckpoint checkpoint);
+
+uint64_t FIRCLSCrashTimingsNow(void);
+void FIRCLSCrashTimingsRecordThread(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                    FIRCLSCrashTimingsWritableContext* rwContext,
+                                    uint32_t index,
+                                    uint64_t startTicks);
+
+// Writes a "timings" section with the time between checkpoints, in nanoseconds. Nothing is
+// written unless timings are enabled and were started.
+void FIRCLSCrashTimingsWrite(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                             const FIRCLSCrashTimingsWritableContext* rwContext,
+                             FIRCLSFile* file);
+
+__END_DECLS
@@ -484,6 +484,7 @@ bool FIRCLSProcessRecordAllThreads(FIRCLSProcess *process, FIRCLSFile *file) {
     thread = FIRCLSProcessGetThread(process, i);
 
     FIRCLSSDKLogInfo("recording thread %d data\n", i);
+    const uint64_t startTicks = FIRCLSCrashTimingsNow();
     if (!FIRCLSProcessRecordThread(process, thread, file)) {
       FIRCLSSDKLogError("Failed to record thread state. Closing threads JSON to prevent malformed crash report.\n");
 
@@ -492,6 +493,8 @@ bool FIRCLSProcessRecordAllThreads(FIRCLSProcess *process, FIRCLSFile *file) {
       FIRCLSFileWriteSectionEnd(file);
       return false;
     }
+    FIRCLSCrashTimingsRecordThread(&_firclsContext.readonly->timings,
+                                   &_firclsContext.writable->timings, i, startTicks);
   }
 
   FIRCLSFileWriteArrayEnd(file);
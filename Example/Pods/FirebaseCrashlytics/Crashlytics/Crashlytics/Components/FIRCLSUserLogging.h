@@ -88,6 +88,8 @@ void FIRCLSUserLoggingRecordError(NSError* error,
 NSDictionary* FIRCLSUserLoggingGetCompactedKVEntries(FIRCLSUserLoggingKVStorage* storage,
                                                      bool decodeHex);
 void FIRCLSUserLoggingCompactKVEntries(FIRCLSUserLoggingKVStorage* storage);
+// Drops the in-memory index of a KV store whose files are about to go away.
+void FIRCLSUserLoggingForgetKVStorage(FIRCLSUserLoggingKVStorage* storage);
 
 void FIRCLSUserLoggingRecordKeyValue(NSString* key,
                                      id value,
@@ -45,8 +45,7 @@ const uint32_t FIRCLSUserLoggingMaxKVEntries = 64;
 #pragma mark - Prototypes
 static void FIRCLSUserLoggingWriteKeysAndValues(NSDictionary *keysAndValues,
                                                 FIRCLSUserLoggingKVStorage *storage,
-                                                uint32_t *counter,
-                                                BOOL containsNullValue);
+                                                uint32_t *counter);
 static void FIRCLSUserLoggingCheckAndSwapABFiles(FIRCLSUserLoggingABStorage *storage,
                                                  const char **activePath,
                                                  off_t fileSize);
@@ -54,6 +53,80 @@ void FIRCLSLogInternal(FIRCLSUserLoggingABStorage *storage,
                        const char **activePath,
                        NSString *message);
 
+#pragma mark - KV Index
+
+// The in-memory view of a KV store. The incremental file is an append-only log of sets and
+// tombstones (null values), and the compacted file is a snapshot of this index, so neither file
+// has to be re-read to compact. Sequence numbers record the order in which keys were last set,
+// which makes eviction deterministic: the least recently set keys are dropped first.
+//
+// Unsynchronized - must only be used on the logging queue.
+@interface FIRCLSUserLoggingKVIndex : NSObject
+
+@property(nonatomic, readonly) NSMutableDictionary<NSString *, NSString *> *values;
+@property(nonatomic, readonly) NSMutableDictionary<NSString *, NSNumber *> *sequences;
+@property(nonatomic) uint64_t nextSequence;
+@property(nonatomic) BOOL compactionScheduled;
+
+- (void)recordValue:(NSString *)value forKey:(NSString *)key;
+- (NSArray<NSString *> *)keysByRecency;
+- (NSUInteger)evictToCount:(NSUInteger)count;
+
+@end
+
+@implementation FIRCLSUserLoggingKVIndex
+
+- (instancetype)init {
+  self = [super init];
+  if (!self) {
+    return nil;
+  }
+
+  _values = [NSMutableDictionary new];
+  _sequences = [NSMutableDictionary new];
+
+  return self;
+}
+
+// A nil value is a tombstone, and removes the key.
+- (void)recordValue:(NSString *)value forKey:(NSString *)key {
+  if (!value) {
+    [_values removeObjectForKey:key];
+    [_sequences removeObjectForKey:key];
+    return;
+  }
+
+  _values[key] = value;
+  _sequences[key] = @(_nextSequence++);
+}
+
+// Least recently set first.
+- (NSArray<NSString *> *)keysByRecency {
+  return [_sequences keysSortedByValueUsingSelector:@selector(compare:)];
+}
+
+- (NSUInteger)evictToCount:(NSUInteger)count {
+  if (_values.count <= count) {
+    return 0;
+  }
+
+  NSArray<NSString *> *keys = [self keysByRecency];
+  NSUInteger evictionCount = keys.count - count;
+
+  for (NSUInteger i = 0; i < evictionCount; ++i) {
+    [self recordValue:nil forKey:keys[i]];
+  }
+
+  return evictionCount;
+}
+
+@end
+
+// The indexes of the KV stores in use, by incremental path. They are only a cache of what is on
+// disk, so an index can be dropped at any time, and is rebuilt the next time its store is used.
+// Only touched on the logging queue.
+static NSMutableDictionary<NSString *, FIRCLSUserLoggingKVIndex *> *FIRCLSUserLoggingKVIndexes;
+
 #pragma mark - Setup
 void FIRCLSUserLoggingInit(FIRCLSUserLoggingReadOnlyContext *roContext,
                            FIRCLSUserLoggingWritableContext *rwContext) {
@@ -67,6 +140,12 @@ void FIRCLSUserLoggingInit(FIRCLSUserLoggingReadOnlyContext *roContext,
 
   roContext->userKVStorage.maxIncrementalCount = FIRCLSUserLoggingMaxKVEntries;
   roContext->internalKVStorage.maxIncrementalCount = roContext->userKVStorage.maxIncrementalCount;
+
+  // The stores now live in a new report, so the indexes of the previous one are dropped. This is
+  // queued ahead of any write to the new stores.
+  dispatch_async(FIRCLSGetLoggingQueue(), ^{
+    [FIRCLSUserLoggingKVIndexes removeAllObjects];
+  });
 }
 
 #pragma mark - KV Logging
@@ -80,7 +159,7 @@ void FIRCLSUserLoggingWriteInternalKeyValue(NSString *key, NSString *value) {
   NSDictionary *keysAndValues = key ? @{key : value ?: [NSNull null]} : nil;
   FIRCLSUserLoggingWriteKeysAndValues(keysAndValues,
                                       &_firclsContext.readonly->logging.internalKVStorage,
-                                      &_firclsContext.writable->logging.internalKVCount, NO);
+                                      &_firclsContext.writable->logging.internalKVCount);
 }
 
 void FIRCLSUserLoggingRecordUserKeyValue(NSString *key, id value) {
@@ -158,8 +237,11 @@ NSDictionary *FIRCLSUserLoggingGetCompactedKVEntries(FIRCLSUserLoggingKVStorage
 }
 
 static void FIRCLSUserLoggingWriteKVEntriesToFile(
-    NSDictionary<NSString *, NSString *> *keysAndValues, BOOL shouldHexEncode, FIRCLSFile *file) {
-  for (NSString *key in keysAndValues) {
+    NSArray<NSString *> *keys,
+    NSDictionary<NSString *, NSString *> *keysAndValues,
+    BOOL shouldHexEncode,
+    FIRCLSFile *file) {
+  for (NSString *key in keys) {
     NSString *valueObject = [keysAndValues objectForKey:key];
 
     // map `NSNull` into nil
@@ -181,43 +263,118 @@ static void FIRCLSUserLoggingWriteKVEntriesToFile(
   }
 }
 
+static void FIRCLSUserLoggingKVIndexReplay(FIRCLSUserLoggingKVIndex *kvIndex, NSArray *entries) {
+  for (NSDictionary *entry in entries) {
+    NSString *key = FIRCLSUserLoggingGetKey(entry, true);
+    id value = FIRCLSUserLoggingGetValue(entry, true);
+
+    if (!key || !value) {
+      FIRCLSSDKLogError("stored key/value contains a nil and must be dropped\n");
+      continue;
+    }
+
+    [kvIndex recordValue:(value == [NSNull null] ? nil : value) forKey:key];
+  }
+}
+
+// Unsynchronized - must be run on the logging queue
+static FIRCLSUserLoggingKVIndex *FIRCLSUserLoggingKVIndexForStorage(
+    FIRCLSUserLoggingKVStorage *storage) {
+  if (!storage->incrementalPath || !storage->compactedPath) {
+    return nil;
+  }
+
+  if (!FIRCLSUserLoggingKVIndexes) {
+    FIRCLSUserLoggingKVIndexes = [NSMutableDictionary new];
+  }
+
+  NSString *path = [NSString stringWithUTF8String:storage->incrementalPath];
+  FIRCLSUserLoggingKVIndex *kvIndex = FIRCLSUserLoggingKVIndexes[path];
+  if (kvIndex) {
+    return kvIndex;
+  }
+
+  // Replay whatever is already on disk, in file order, so that recency survives across
+  // processes. For a new report, both files are empty.
+  kvIndex = [FIRCLSUserLoggingKVIndex new];
+  FIRCLSUserLoggingKVIndexReplay(kvIndex, FIRCLSUserLoggingStoredKeyValues(storage->compactedPath));
+  FIRCLSUserLoggingKVIndexReplay(kvIndex,
+                                 FIRCLSUserLoggingStoredKeyValues(storage->incrementalPath));
+
+  FIRCLSUserLoggingKVIndexes[path] = kvIndex;
+
+  return kvIndex;
+}
+
+// Unsynchronized - must be run on the logging queue
+static void FIRCLSUserLoggingKVIndexRemove(const char *incrementalPath) {
+  if (!incrementalPath) {
+    return;
+  }
+
+  [FIRCLSUserLoggingKVIndexes removeObjectForKey:[NSString stringWithUTF8String:incrementalPath]];
+}
+
+void FIRCLSUserLoggingForgetKVStorage(FIRCLSUserLoggingKVStorage *storage) {
+  dispatch_queue_t queue = FIRCLSGetLoggingQueue();
+
+  // Without a logging queue, no index was ever built.
+  if (!queue || !FIRCLSIsValidPointer(storage) || !storage->incrementalPath) {
+    return;
+  }
+
+  // The path is copied now, since the storage may be gone by the time the block runs.
+  NSString *path = [NSString stringWithUTF8String:storage->incrementalPath];
+
+  dispatch_async(queue, ^{
+    [FIRCLSUserLoggingKVIndexes removeObjectForKey:path];
+  });
+}
+
+// Unsynchronized - must be run on the logging queue
 void FIRCLSUserLoggingCompactKVEntries(FIRCLSUserLoggingKVStorage *storage) {
   if (!FIRCLSIsValidPointer(storage)) {
     FIRCLSSDKLogError("Error: storage invalid\n");
     return;
   }
 
-  NSDictionary *finalKVs = FIRCLSUserLoggingGetCompactedKVEntries(storage, false);
+  FIRCLSUserLoggingKVIndex *kvIndex = FIRCLSUserLoggingKVIndexForStorage(storage);
+  if (!kvIndex) {
+    FIRCLSSDKLogError("Error: storage has no paths\n");
+    return;
+  }
 
-  if (unlink(storage->compactedPath) != 0) {
-    FIRCLSSDKLog("Error: Unable to remove compacted KV store before compaction %s\n",
-                 strerror(errno));
+  kvIndex.compactionScheduled = NO;
+
+  uint32_t maxCount = storage->maxCount;
+  NSUInteger evictionCount = [kvIndex evictToCount:maxCount];
+  if (evictionCount > 0) {
+    FIRCLSSDKLogInfo("Evicted %d least recently set keys from KV set, which is above max %d\n",
+                     (uint32_t)evictionCount, maxCount);
   }
 
+  // Write the snapshot beside the compacted file and rename it into place, so that a crash
+  // part-way through leaves the previous snapshot and the log intact.
+  NSString *snapshotPath = [NSString stringWithFormat:@"%s.tmp", storage->compactedPath];
   FIRCLSFile file;
 
-  if (!FIRCLSFileInitWithPath(&file, storage->compactedPath, true)) {
+  if (!FIRCLSFileInitWithPathMode(&file, [snapshotPath fileSystemRepresentation], false, true)) {
     FIRCLSSDKLog("Error: Unable to open compacted k-v file\n");
     return;
   }
 
-  uint32_t maxCount = storage->maxCount;
-  if ([finalKVs count] > maxCount) {
-    // We need to remove keys, to avoid going over the max.
-    // This is just about the worst way to go about doing this. There are lots of smarter ways,
-    // but it's very uncommon to go down this path.
-    NSArray *keys = [finalKVs allKeys];
-
-    FIRCLSSDKLogInfo("Truncating %d keys from KV set, which is above max %d\n",
-                     (uint32_t)(finalKVs.count - maxCount), maxCount);
+  FIRCLSUserLoggingWriteKVEntriesToFile([kvIndex keysByRecency], kvIndex.values, true, &file);
+  FIRCLSFileClose(&file);
 
-    finalKVs =
-        [finalKVs dictionaryWithValuesForKeys:[keys subarrayWithRange:NSMakeRange(0, maxCount)]];
+  if (rename([snapshotPath fileSystemRepresentation], storage->compactedPath) != 0) {
+    FIRCLSSDKLog("Error: Unable to replace compacted KV store %s\n", strerror(errno));
+    // The report was moved or deleted underneath the store
+    if (errno == ENOENT) {
+      FIRCLSUserLoggingKVIndexRemove(storage->incrementalPath);
+    }
+    return;
   }
 
-  FIRCLSUserLoggingWriteKVEntriesToFile(finalKVs, false, &file);
-  FIRCLSFileClose(&file);
-
   if (unlink(storage->incrementalPath) != 0) {
     FIRCLSSDKLog("Error: Unable to remove incremental KV store after compaction %s\n",
                  strerror(errno));
@@ -255,7 +412,6 @@ void FIRCLSUserLoggingRecordKeysAndValues(NSDictionary *keysAndValues,
   }
 
   NSMutableDictionary *sanitizedKeysAndValues = [keysAndValues mutableCopy];
-  BOOL containsNullValue = NO;
 
   for (NSString *key in keysAndValues) {
     if (!FIRCLSIsValidPointer(key)) {
@@ -277,20 +433,17 @@ void FIRCLSUserLoggingRecordKeysAndValues(NSDictionary *keysAndValues,
       // passing nil will result in a JSON null being written, which is deserialized as [NSNull
       // null], signaling to remove the key during compaction
       sanitizedKeysAndValues[key] = [NSNull null];
-      containsNullValue = YES;
     }
   }
 
   dispatch_sync(FIRCLSGetLoggingQueue(), ^{
-    FIRCLSUserLoggingWriteKeysAndValues(sanitizedKeysAndValues, storage, counter,
-                                        containsNullValue);
+    FIRCLSUserLoggingWriteKeysAndValues(sanitizedKeysAndValues, storage, counter);
   });
 }
 
 static void FIRCLSUserLoggingWriteKeysAndValues(NSDictionary *keysAndValues,
                                                 FIRCLSUserLoggingKVStorage *storage,
-                                                uint32_t *counter,
-                                                BOOL containsNullValue) {
+                                                uint32_t *counter) {
   FIRCLSFile file;
 
   if (!FIRCLSIsValidPointer(storage) || !FIRCLSIsValidPointer(counter)) {
@@ -298,16 +451,35 @@ static void FIRCLSUserLoggingWriteKeysAndValues(NSDictionary *keysAndValues,
     return;
   }
 
+  FIRCLSUserLoggingKVIndex *kvIndex = FIRCLSUserLoggingKVIndexForStorage(storage);
+  if (!kvIndex) {
+    FIRCLSSDKLogError("Storage has no paths\n");
+    return;
+  }
+
   if (!FIRCLSFileInitWithPath(&file, storage->incrementalPath, true)) {
     FIRCLSSDKLogError("Unable to open k-v file\n");
+    // Most likely the report was moved or deleted, so its index is no use anymore.
+    FIRCLSUserLoggingKVIndexRemove(storage->incrementalPath);
     return;
   }
 
-  FIRCLSUserLoggingWriteKVEntriesToFile(keysAndValues, true, &file);
+  // Sorting keeps the recency order within a batch independent of dictionary ordering.
+  NSArray<NSString *> *keys =
+      [[keysAndValues allKeys] sortedArrayUsingSelector:@selector(compare:)];
+
+  FIRCLSUserLoggingWriteKVEntriesToFile(keys, keysAndValues, true, &file);
   FIRCLSFileClose(&file);
 
-  *counter += keysAndValues.count;
-  if (*counter >= storage->maxIncrementalCount || containsNullValue) {
+  for (NSString *key in keys) {
+    id value = keysAndValues[key];
+    [kvIndex recordValue:(value == [NSNull null] ? nil : value) forKey:key];
+  }
+
+  // Removals are tombstones in the log, and no longer force a compaction of their own.
+  *counter += keys.count;
+  if (*counter >= storage->maxIncrementalCount && !kvIndex.compactionScheduled) {
+    kvIndex.compactionScheduled = YES;
     dispatch_async(FIRCLSGetLoggingQueue(), ^{
       FIRCLSUserLoggingCompactKVEntries(storage);
       *counter = 0;
@@ -29,6 +29,18 @@
 // This value should stay in sync with the Android SDK
 NSUInteger const FIRCLSMaxUnsentReports = 4;
 
+// Reports left over from previous runs don't depend on one another, so a few of them are
+// symbolicated and handed to GoogleDataTransport at once. The byte limit keeps a backlog of large
+// reports from all being read into memory together. A single report over the limit still goes
+// through, just on its own.
+static NSUInteger const FIRCLSMaxConcurrentBacklogReports = 3;
+static unsigned long long const FIRCLSMaxInFlightBacklogBytes = 4 * 1024 * 1024;
+
+// A backlogged report that hasn't been handed off after this long gives up its share of the
+// limits, so that one stuck report can't hold up the rest of the backlog, or the operation queue
+// behind it. Symbolicating and writing a report to GoogleDataTransport takes seconds at most.
+static int64_t const FIRCLSBacklogReportTimeoutSeconds = 60;
+
 @interface FIRCLSExistingReportManager ()
 
 @property(nonatomic, strong) FIRCLSFileManager *fileManager;
@@ -46,9 +58,16 @@ NSUInteger const FIRCLSMaxUnsentReports = 4;
 
 @property(nonatomic, strong) FIRCLSInternalReport *newestInternalReport;
 
+@property(nonatomic, strong) dispatch_queue_t backlogQueue;
+@property(nonatomic, strong) NSCondition *backlogCondition;
+
 @end
 
-@implementation FIRCLSExistingReportManager
+@implementation FIRCLSExistingReportManager {
+  // Guarded by backlogCondition
+  NSUInteger _inFlightBacklogReports;
+  unsigned long long _inFlightBacklogBytes;
+}
 
 - (instancetype)initWithManagerData:(FIRCLSManagerData *)managerData
                      reportUploader:(FIRCLSReportUploader *)reportUploader {
@@ -64,6 +83,11 @@ NSUInteger const FIRCLSMaxUnsentReports = 4;
   _reportUploader = reportUploader;
   _onDemandModel = managerData.onDemandModel;
 
+  dispatch_queue_attr_t attributes =
+      dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT, QOS_CLASS_UTILITY, 0);
+  _backlogQueue = dispatch_queue_create("com.google.firebase.crashlytics.backlog", attributes);
+  _backlogCondition = [[NSCondition alloc] init];
+
   return self;
 }
 
@@ -178,45 +202,169 @@ NSInteger compareNewer(FIRCLSInternalReport *reportA,
 
 - (void)sendUnsentReportsWithToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                           asUrgent:(BOOL)urgent {
-  for (NSString *path in self.existingUnemptyActiveReportPaths) {
-    [self processExistingActiveReportPath:path
-                      dataCollectionToken:dataCollectionToken
-                                 asUrgent:urgent];
-  }
+  NSMutableArray<NSString *> *activeReportPaths = [NSMutableArray array];
+  [activeReportPaths addObjectsFromArray:self.existingUnemptyActiveReportPaths];
+  [activeReportPaths addObjectsFromArray:self.onDemandModel.storedActiveReportPaths];
+  [self.onDemandModel.storedActiveReportPaths removeAllObjects];
 
-  for (NSString *path in self.onDemandModel.storedActiveReportPaths) {
-    [self processExistingActiveReportPath:path
-                      dataCollectionToken:dataCollectionToken
-                                 asUrgent:urgent];
+  // Urgent reports are sent right away, on this thread, one at a time.
+  if (urgent && [dataCollectionToken isValid]) {
+    for (NSString *path in activeReportPaths) {
+      [self processExistingActiveReportPath:path
+                        dataCollectionToken:dataCollectionToken
+                                   asUrgent:urgent];
+    }
+    [activeReportPaths removeAllObjects];
   }
-  [self.onDemandModel.storedActiveReportPaths removeAllObjects];
 
-  // deal with stuff in processing more carefully - do not process again
+  NSArray<NSString *> *processingReportPaths = self.processingReportPaths;
+  NSArray<NSString *> *preparedReportPaths = self.preparedReportPaths;
+
+  // The rest of the backlog is spread over backlogQueue, but this operation doesn't finish until
+  // all of it has been handed off, so that anything queued after it still runs afterwards.
   [self.operationQueue addOperationWithBlock:^{
-    for (NSString *path in self.processingReportPaths) {
+    dispatch_group_t group = dispatch_group_create();
+
+    // The backlog is prepared concurrently, so the install ID is refreshed here, once, rather
+    // than by each report.
+    if (activeReportPaths.count > 0 || processingReportPaths.count > 0 ||
+        preparedReportPaths.count > 0) {
+      [self.reportUploader refreshInstallID];
+    }
+
+    for (NSString *path in activeReportPaths) {
       FIRCLSInternalReport *report = [FIRCLSInternalReport reportWithPath:path];
-      [self.reportUploader prepareAndSubmitReport:report
-                              dataCollectionToken:dataCollectionToken
-                                         asUrgent:NO
-                                   withProcessing:NO];
+
+      if (![report hasAnyEvents]) {
+        [self.fileManager removeItemAtPath:path];
+        continue;
+      }
+
+      [self submitBacklogReportAtPath:path
+                              toGroup:group
+                            withBlock:^(void (^done)(void)) {
+                              [self.reportUploader prepareAndSubmitBacklogReport:report
+                                                             dataCollectionToken:dataCollectionToken
+                                                                  withProcessing:YES
+                                                                      completion:done];
+                            }];
     }
-  }];
 
-  // Because this could happen quite a bit after the initial set of files was
-  // captured, some could be completed (deleted). So, just double-check to make sure
-  // the file still exists.
-  [self.operationQueue addOperationWithBlock:^{
-    for (NSString *path in self.preparedReportPaths) {
+    // deal with stuff in processing more carefully - do not process again
+    for (NSString *path in processingReportPaths) {
+      FIRCLSInternalReport *report = [FIRCLSInternalReport reportWithPath:path];
+
+      [self submitBacklogReportAtPath:path
+                              toGroup:group
+                            withBlock:^(void (^done)(void)) {
+                              [self.reportUploader prepareAndSubmitBacklogReport:report
+                                                             dataCollectionToken:dataCollectionToken
+                                                                  withProcessing:NO
+                                                                      completion:done];
+                            }];
+    }
+
+    // Because this could happen quite a bit after the initial set of files was
+    // captured, some could be completed (deleted). So, just double-check to make sure
+    // the file still exists.
+    for (NSString *path in preparedReportPaths) {
       if (![self.fileManager fileExistsAtPath:path]) {
         continue;
       }
-      [self.reportUploader uploadPackagedReportAtPath:path
-                                  dataCollectionToken:dataCollectionToken
-                                             asUrgent:NO];
+
+      [self submitBacklogReportAtPath:path
+                              toGroup:group
+                            withBlock:^(void (^done)(void)) {
+                              [self.reportUploader uploadPackagedReportAtPath:path
+                                                          dataCollectionToken:dataCollectionToken
+                                                                     asUrgent:NO
+                                                                   completion:done];
+                            }];
+    }
+
+    // Every report leaves the group within FIRCLSBacklogReportTimeoutSeconds of being submitted,
+    // so this only times out if that guarantee is broken.
+    dispatch_time_t timeout =
+        dispatch_time(DISPATCH_TIME_NOW, FIRCLSBacklogReportTimeoutSeconds * NSEC_PER_SEC);
+    if (dispatch_group_wait(group, timeout) != 0) {
+      FIRCLSErrorLog(@"Timed out waiting for backlogged reports to be handed off");
     }
   }];
 }
 
+/*
+ * Blocks the calling thread until there is room for the report, both in the number of reports
+ * being worked on and in their combined size on disk. The room is held until the block calls
+ * done, once the report has been handed to GoogleDataTransport, since the report stays on disk and
+ * in memory until then. If done isn't called within FIRCLSBacklogReportTimeoutSeconds, the room is
+ * given back anyway. Either way, the group is left exactly once.
+ */
+- (void)submitBacklogReportAtPath:(NSString *)path
+                          toGroup:(dispatch_group_t)group
+                        withBlock:(void (^)(void (^done)(void)))block {
+  unsigned long long bytes = [self sizeOfReportAtPath:path];
+  NSUInteger processorCount = [NSProcessInfo processInfo].activeProcessorCount;
+  NSUInteger maxReports = MAX(1, MIN(FIRCLSMaxConcurrentBacklogReports, processorCount));
+
+  [self.backlogCondition lock];
+  while (_inFlightBacklogReports > 0 &&
+         (_inFlightBacklogReports >= maxReports ||
+          _inFlightBacklogBytes + bytes > FIRCLSMaxInFlightBacklogBytes)) {
+    [self.backlogCondition wait];
+  }
+  _inFlightBacklogReports += 1;
+  _inFlightBacklogBytes += bytes;
+  [self.backlogCondition unlock];
+
+  dispatch_group_enter(group);
+
+  // Guarded by backlogCondition.
+  __block BOOL released = NO;
+  void (^release)(BOOL) = ^(BOOL timedOut) {
+    [self.backlogCondition lock];
+    if (released) {
+      [self.backlogCondition unlock];
+      return;
+    }
+    released = YES;
+    self->_inFlightBacklogReports -= 1;
+    self->_inFlightBacklogBytes -= bytes;
+    [self.backlogCondition signal];
+    [self.backlogCondition unlock];
+
+    if (timedOut) {
+      FIRCLSWarningLog(@"Backlogged report %@ wasn't handed off within %lld seconds, continuing "
+                       @"with the rest of the backlog",
+                       path.lastPathComponent, FIRCLSBacklogReportTimeoutSeconds);
+    }
+
+    dispatch_group_leave(group);
+  };
+
+  // Not on backlogQueue, which may be what the report is stuck behind.
+  dispatch_after(
+      dispatch_time(DISPATCH_TIME_NOW, FIRCLSBacklogReportTimeoutSeconds * NSEC_PER_SEC),
+      dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        release(YES);
+      });
+
+  dispatch_async(self.backlogQueue, ^{
+    block(^{
+      release(NO);
+    });
+  });
+}
+
+- (unsigned long long)sizeOfReportAtPath:(NSString *)path {
+  unsigned long long size = 0;
+
+  for (NSString *filePath in [self.fileManager contentsOfDirectory:path]) {
+    size += [[self.fileManager fileSizeAtPath:filePath] unsignedLongLongValue];
+  }
+
+  return size;
+}
+
 - (void)processExistingActiveReportPath:(NSString *)path
                     dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                                asUrgent:(BOOL)urgent {
@@ -178,27 +178,27 @@
 
   FIRCLSDebugLog(@"File paths for MetricKit report:  %@, %@", metricKitFatalReportFile,
                  metricKitNonfatalReportFile);
-  if (hasCrash && ![_fileManager fileExistsAtPath:metricKitFatalReportFile]) {
-    [_fileManager createFileAtPath:metricKitFatalReportFile contents:nil attributes:nil];
-  }
-  if ((hasHang | hasCPUException | hasDiskWriteException) &&
-      ![_fileManager fileExistsAtPath:metricKitNonfatalReportFile]) {
-    [_fileManager createFileAtPath:metricKitNonfatalReportFile contents:nil attributes:nil];
-  }
-  NSFileHandle *nonfatalFile =
-      [NSFileHandle fileHandleForUpdatingAtPath:metricKitNonfatalReportFile];
-  if ((hasHang | hasCPUException | hasDiskWriteException) && nonfatalFile == nil) {
+  // Each diagnostic is written straight through to the report file, without building up any
+  // objects for its threads.
+  FIRCLSFile nonfatalFile;
+  BOOL hasNonfatal = hasHang || hasCPUException || hasDiskWriteException;
+  if (hasNonfatal &&
+      !FIRCLSFileInitWithPath(&nonfatalFile, [metricKitNonfatalReportFile fileSystemRepresentation],
+                              true)) {
     FIRCLSDebugLog(@"Unable to create or open nonfatal MetricKit file.");
     return false;
   }
-  NSFileHandle *fatalFile = [NSFileHandle fileHandleForUpdatingAtPath:metricKitFatalReportFile];
-  if (hasCrash && fatalFile == nil) {
+  FIRCLSFile fatalFile;
+  if (hasCrash &&
+      !FIRCLSFileInitWithPath(&fatalFile, [metricKitFatalReportFile fileSystemRepresentation],
+                              true)) {
     FIRCLSDebugLog(@"Unable to create or open fatal MetricKit file.");
+    if (hasNonfatal) {
+      FIRCLSFileClose(&nonfatalFile);
+    }
     return false;
   }
 
-  NSData *newLineData = [@"\n" dataUsingEncoding:NSUTF8StringEncoding];
-
   // For each diagnostic type, write out a section in the MetricKit report file. This section will
   // have subsections for threads, metadata, and event specific metadata.
   if (hasCrash && !skipCrashEvent) {
@@ -207,11 +207,6 @@
 
     MXCrashDiagnostic *crashDiagnostic = [diagnosticPayload.crashDiagnostics objectAtIndex:0];
 
-    NSArray *threadArray = [self convertThreadsToArray:crashDiagnostic.callStackTree];
-    NSDictionary *metadataDict = [self convertMetadataToDictionary:crashDiagnostic.metaData];
-
-    NSString *nilString = @"";
-
     // On the backend, we process name, code name, and address into the subtitle of an issue.
     // Mach exception name and code should be preferred over signal name and code if available.
     const char *signalName = NULL;
@@ -237,113 +232,97 @@
       machExceptionCodeName = "";
     }
 
-    NSString *name = machExceptionName != NULL ? [NSString stringWithUTF8String:machExceptionName]
-                                               : [NSString stringWithUTF8String:signalName];
-    NSString *codeName = machExceptionName != NULL
-                             ? [NSString stringWithUTF8String:machExceptionCodeName]
-                             : [NSString stringWithUTF8String:signalCodeName];
-
-    NSDictionary *crashDictionary = @{
-      @"metric_kit_fatal" : @{
-        @"time" : [NSNumber numberWithLong:beginSecondsSince1970],
-        @"end_time" : [NSNumber numberWithLong:endSecondsSince1970],
-        @"metadata" : metadataDict,
-        @"termination_reason" :
-                (crashDiagnostic.terminationReason) ? crashDiagnostic.terminationReason : nilString,
-        @"virtual_memory_region_info" : (crashDiagnostic.virtualMemoryRegionInfo)
-            ? crashDiagnostic.virtualMemoryRegionInfo
-            : nilString,
-        @"exception_type" : crashDiagnostic.exceptionType,
-        @"exception_code" : crashDiagnostic.exceptionCode,
-        @"signal" : crashDiagnostic.signal,
-        @"app_version" : crashDiagnostic.applicationVersion,
-        @"code_name" : codeName,
-        @"name" : name
-      }
-    };
-    writeFailed = ![self writeDictionaryToFile:crashDictionary
-                                          file:fatalFile
-                                   newLineData:newLineData];
-    writeFailed = writeFailed | ![self writeDictionaryToFile:@{@"threads" : threadArray}
-                                                        file:fatalFile
-                                                 newLineData:newLineData];
+    const char *name = machExceptionName != NULL ? machExceptionName : signalName;
+    const char *codeName = machExceptionName != NULL ? machExceptionCodeName : signalCodeName;
+
+    FIRCLSFileWriteSectionStart(&fatalFile, "metric_kit_fatal");
+    FIRCLSFileWriteHashStart(&fatalFile);
+    FIRCLSFileWriteHashEntryInt64(&fatalFile, "time", (long)beginSecondsSince1970);
+    FIRCLSFileWriteHashEntryInt64(&fatalFile, "end_time", (long)endSecondsSince1970);
+    writeFailed |= ![self writeMetadata:crashDiagnostic.metaData toFile:&fatalFile];
+    FIRCLSFileWriteHashEntryEscapedString(
+        &fatalFile, "termination_reason",
+        crashDiagnostic.terminationReason ? [crashDiagnostic.terminationReason UTF8String] : "");
+    FIRCLSFileWriteHashEntryEscapedString(&fatalFile, "virtual_memory_region_info",
+                                          crashDiagnostic.virtualMemoryRegionInfo
+                                              ? [crashDiagnostic.virtualMemoryRegionInfo UTF8String]
+                                              : "");
+    [self writeNumber:crashDiagnostic.exceptionType key:"exception_type" toFile:&fatalFile];
+    [self writeNumber:crashDiagnostic.exceptionCode key:"exception_code" toFile:&fatalFile];
+    [self writeNumber:crashDiagnostic.signal key:"signal" toFile:&fatalFile];
+    FIRCLSFileWriteHashEntryEscapedString(&fatalFile, "app_version",
+                                          [crashDiagnostic.applicationVersion UTF8String]);
+    FIRCLSFileWriteHashEntryEscapedString(&fatalFile, "code_name", codeName);
+    FIRCLSFileWriteHashEntryEscapedString(&fatalFile, "name", name);
+    FIRCLSFileWriteHashEnd(&fatalFile);
+    FIRCLSFileWriteSectionEnd(&fatalFile);
+
+    FIRCLSFileWriteHashStart(&fatalFile);
+    writeFailed |= ![self writeThreads:crashDiagnostic.callStackTree toFile:&fatalFile];
+    FIRCLSFileWriteSectionEnd(&fatalFile);
   }
 
   if (hasHang) {
     MXHangDiagnostic *hangDiagnostic = [diagnosticPayload.hangDiagnostics objectAtIndex:0];
 
-    NSArray *threadArray = [self convertThreadsToArray:hangDiagnostic.callStackTree];
-    NSDictionary *metadataDict = [self convertMetadataToDictionary:hangDiagnostic.metaData];
-
-    NSDictionary *hangDictionary = @{
-      @"exception" : @{
-        @"type" : @"metrickit_nonfatal",
-        @"name" : @"hang_event",
-        @"time" : [NSNumber numberWithLong:beginSecondsSince1970],
-        @"end_time" : [NSNumber numberWithLong:endSecondsSince1970],
-        @"threads" : threadArray,
-        @"metadata" : metadataDict,
-        @"hang_duration" : [NSNumber numberWithDouble:[hangDiagnostic.hangDuration doubleValue]],
-        @"app_version" : hangDiagnostic.applicationVersion
-      }
-    };
-
-    writeFailed = ![self writeDictionaryToFile:hangDictionary
-                                          file:nonfatalFile
-                                   newLineData:newLineData];
+    [self writeNonfatalStartWithName:"hang_event"
+                           beginTime:beginSecondsSince1970
+                             endTime:endSecondsSince1970
+                              toFile:&nonfatalFile];
+    writeFailed |= ![self writeThreads:hangDiagnostic.callStackTree toFile:&nonfatalFile];
+    writeFailed |= ![self writeMetadata:hangDiagnostic.metaData toFile:&nonfatalFile];
+    FIRCLSFileWriteHashEntryDouble(&nonfatalFile, "hang_duration",
+                                   [hangDiagnostic.hangDuration doubleValue]);
+    FIRCLSFileWriteHashEntryEscapedString(&nonfatalFile, "app_version",
+                                          [hangDiagnostic.applicationVersion UTF8String]);
+    FIRCLSFileWriteHashEnd(&nonfatalFile);
+    FIRCLSFileWriteSectionEnd(&nonfatalFile);
   }
 
   if (hasCPUException) {
     MXCPUExceptionDiagnostic *cpuExceptionDiagnostic =
         [diagnosticPayload.cpuExceptionDiagnostics objectAtIndex:0];
 
-    NSArray *threadArray = [self convertThreadsToArray:cpuExceptionDiagnostic.callStackTree];
-    NSDictionary *metadataDict = [self convertMetadataToDictionary:cpuExceptionDiagnostic.metaData];
-
-    NSDictionary *cpuDictionary = @{
-      @"exception" : @{
-        @"type" : @"metrickit_nonfatal",
-        @"name" : @"cpu_exception_event",
-        @"time" : [NSNumber numberWithLong:beginSecondsSince1970],
-        @"end_time" : [NSNumber numberWithLong:endSecondsSince1970],
-        @"threads" : threadArray,
-        @"metadata" : metadataDict,
-        @"total_cpu_time" :
-            [NSNumber numberWithDouble:[cpuExceptionDiagnostic.totalCPUTime doubleValue]],
-        @"total_sampled_time" :
-            [NSNumber numberWithDouble:[cpuExceptionDiagnostic.totalSampledTime doubleValue]],
-        @"app_version" : cpuExceptionDiagnostic.applicationVersion
-      }
-    };
-    writeFailed = ![self writeDictionaryToFile:cpuDictionary
-                                          file:nonfatalFile
-                                   newLineData:newLineData];
+    [self writeNonfatalStartWithName:"cpu_exception_event"
+                           beginTime:beginSecondsSince1970
+                             endTime:endSecondsSince1970
+                              toFile:&nonfatalFile];
+    writeFailed |= ![self writeThreads:cpuExceptionDiagnostic.callStackTree toFile:&nonfatalFile];
+    writeFailed |= ![self writeMetadata:cpuExceptionDiagnostic.metaData toFile:&nonfatalFile];
+    FIRCLSFileWriteHashEntryDouble(&nonfatalFile, "total_cpu_time",
+                                   [cpuExceptionDiagnostic.totalCPUTime doubleValue]);
+    FIRCLSFileWriteHashEntryDouble(&nonfatalFile, "total_sampled_time",
+                                   [cpuExceptionDiagnostic.totalSampledTime doubleValue]);
+    FIRCLSFileWriteHashEntryEscapedString(&nonfatalFile, "app_version",
+                                          [cpuExceptionDiagnostic.applicationVersion UTF8String]);
+    FIRCLSFileWriteHashEnd(&nonfatalFile);
+    FIRCLSFileWriteSectionEnd(&nonfatalFile);
   }
 
   if (hasDiskWriteException) {
     MXDiskWriteExceptionDiagnostic *diskWriteExceptionDiagnostic =
         [diagnosticPayload.diskWriteExceptionDiagnostics objectAtIndex:0];
 
-    NSArray *threadArray = [self convertThreadsToArray:diskWriteExceptionDiagnostic.callStackTree];
-    NSDictionary *metadataDict =
-        [self convertMetadataToDictionary:diskWriteExceptionDiagnostic.metaData];
-
-    NSDictionary *diskWriteDictionary = @{
-      @"exception" : @{
-        @"type" : @"metrickit_nonfatal",
-        @"name" : @"disk_write_exception_event",
-        @"time" : [NSNumber numberWithLong:beginSecondsSince1970],
-        @"end_time" : [NSNumber numberWithLong:endSecondsSince1970],
-        @"threads" : threadArray,
-        @"metadata" : metadataDict,
-        @"app_version" : diskWriteExceptionDiagnostic.applicationVersion,
-        @"total_writes_caused" :
-            [NSNumber numberWithDouble:[diskWriteExceptionDiagnostic.totalWritesCaused doubleValue]]
-      }
-    };
-    writeFailed = ![self writeDictionaryToFile:diskWriteDictionary
-                                          file:nonfatalFile
-                                   newLineData:newLineData];
+    [self writeNonfatalStartWithName:"disk_write_exception_event"
+                           beginTime:beginSecondsSince1970
+                             endTime:endSecondsSince1970
+                              toFile:&nonfatalFile];
+    writeFailed |=
+        ![self writeThreads:diskWriteExceptionDiagnostic.callStackTree toFile:&nonfatalFile];
+    writeFailed |= ![self writeMetadata:diskWriteExceptionDiagnostic.metaData toFile:&nonfatalFile];
+    FIRCLSFileWriteHashEntryEscapedString(
+        &nonfatalFile, "app_version", [diskWriteExceptionDiagnostic.applicationVersion UTF8String]);
+    FIRCLSFileWriteHashEntryDouble(&nonfatalFile, "total_writes_caused",
+                                   [diskWriteExceptionDiagnostic.totalWritesCaused doubleValue]);
+    FIRCLSFileWriteHashEnd(&nonfatalFile);
+    FIRCLSFileWriteSectionEnd(&nonfatalFile);
+  }
+
+  if (hasNonfatal) {
+    writeFailed |= !FIRCLSFileClose(&nonfatalFile);
+  }
+  if (hasCrash) {
+    writeFailed |= !FIRCLSFileClose(&fatalFile);
   }
 
   return !writeFailed;
@@ -364,31 +343,53 @@
 }
 
 /*
- * Helper method to convert threads for a MetricKit fatal diagnostic event to an array of threads.
+ * Helper method to write the threads of a MetricKit diagnostic event as an array, under the
+ * "threads" key. Returns whether the call stack tree could be read.
  */
-- (NSArray *)convertThreadsToArray:(MXCallStackTree *)mxCallStackTree API_AVAILABLE(ios(14)) {
+- (BOOL)writeThreads:(MXCallStackTree *)mxCallStackTree
+              toFile:(FIRCLSFile *)file API_AVAILABLE(ios(14)) {
   FIRCLSCallStackTree *tree = [[FIRCLSCallStackTree alloc] initWithMXCallStackTree:mxCallStackTree];
-  return [tree getArrayRepresentation];
+  if (!tree) {
+    FIRCLSFileWriteHashKey(file, "threads");
+    FIRCLSFileWriteArrayStart(file);
+    FIRCLSFileWriteArrayEnd(file);
+    return NO;
+  }
+
+  return [tree writeThreadsToFile:file key:"threads"];
 }
 
 /*
- * Helper method to convert threads for a MetricKit nonfatal diagnostic event to an array of frames.
+ * Helper method to write the metadata for a MetricKit diagnostic event, under the "metadata" key.
+ * MXMetadata has a dictionaryRepresentation method but it is deprecated, so its JSON is copied.
  */
-- (NSArray *)convertThreadsToArrayForNonfatal:(MXCallStackTree *)mxCallStackTree
-    API_AVAILABLE(ios(14)) {
-  FIRCLSCallStackTree *tree = [[FIRCLSCallStackTree alloc] initWithMXCallStackTree:mxCallStackTree];
-  return [tree getFramesOfBlamedThread];
+- (BOOL)writeMetadata:(MXMetaData *)metadata toFile:(FIRCLSFile *)file API_AVAILABLE(ios(14)) {
+  NSData *json = [metadata JSONRepresentation];
+  return FIRCLSFileWriteHashEntryJSONDocument(file, "metadata", json.bytes, json.length);
 }
 
 /*
- * Helper method to convert metadata for a MetricKit diagnostic event to a dictionary. MXMetadata
- * has a dictionaryRepresentation method but it is deprecated.
+ * Helper method to open the section for a MetricKit nonfatal event, and write its common fields.
+ * The caller writes the rest of the fields, and closes the section.
  */
-- (NSDictionary *)convertMetadataToDictionary:(MXMetaData *)metadata API_AVAILABLE(ios(14)) {
-  NSError *error = nil;
-  NSDictionary *metadataDictionary =
-      [NSJSONSerialization JSONObjectWithData:[metadata JSONRepresentation] options:0 error:&error];
-  return metadataDictionary;
+- (void)writeNonfatalStartWithName:(const char *)name
+                         beginTime:(NSTimeInterval)beginSecondsSince1970
+                           endTime:(NSTimeInterval)endSecondsSince1970
+                            toFile:(FIRCLSFile *)file {
+  FIRCLSFileWriteSectionStart(file, "exception");
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSFileWriteHashEntryString(file, "type", "metrickit_nonfatal");
+  FIRCLSFileWriteHashEntryString(file, "name", name);
+  FIRCLSFileWriteHashEntryInt64(file, "time", (long)beginSecondsSince1970);
+  FIRCLSFileWriteHashEntryInt64(file, "end_time", (long)endSecondsSince1970);
+}
+
+- (void)writeNumber:(NSNumber *)number key:(const char *)key toFile:(FIRCLSFile *)file {
+  if (!number) {
+    return;
+  }
+
+  FIRCLSFileWriteHashEntryInt64(file, key, [number longLongValue]);
 }
 
 /*
@@ -401,26 +402,6 @@
   self.metricKitPromiseFulfilled = YES;
 }
 
-/*
- * Helper method to write a dictionary of event information to file. Returns whether it succeeded.
- */
-- (BOOL)writeDictionaryToFile:(NSDictionary *)dictionary
-                         file:(NSFileHandle *)file
-                  newLineData:(NSData *)newLineData {
-  NSError *dataError = nil;
-  NSData *data = [NSJSONSerialization dataWithJSONObject:dictionary options:0 error:&dataError];
-  if (dataError) {
-    FIRCLSDebugLog(@"Unable to write out dictionary.");
-    return NO;
-  }
-
-  [file seekToEndOfFile];
-  [file writeData:data];
-  [file writeData:newLineData];
-
-  return YES;
-}
-
 - (NSString *)getSignalName:(NSNumber *)signalCode {
   int signal = [signalCode intValue];
   switch (signal) {
@@ -27,16 +27,34 @@
 
 @property(nonatomic, readonly) NSOperationQueue *operationQueue;
 @property(nonatomic, readonly) FIRCLSFileManager *fileManager;
-@property(nonatomic, copy) NSString *fiid;
-@property(nonatomic, copy) NSString *authToken;
+// Backlogged reports are prepared concurrently, after a single refreshInstallID, and read these.
+@property(atomic, copy) NSString *fiid;
+@property(atomic, copy) NSString *authToken;
+
+// Resolves the FIID, rotating the install ID if it changed. Blocks until Installations responds or
+// times out, so it must not be called on the main thread.
+- (void)refreshInstallID;
 
 - (void)prepareAndSubmitReport:(FIRCLSInternalReport *)report
            dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                       asUrgent:(BOOL)urgent
                 withProcessing:(BOOL)shouldProcess;
 
+// Prepares and submits a backlogged report with the install ID from the last refreshInstallID. The
+// completion runs once GoogleDataTransport has finished with the report, or it was given up on.
+- (void)prepareAndSubmitBacklogReport:(FIRCLSInternalReport *)report
+                  dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
+                       withProcessing:(BOOL)shouldProcess
+                           completion:(void (^)(void))completion;
+
 - (void)uploadPackagedReportAtPath:(NSString *)path
                dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                           asUrgent:(BOOL)urgent;
 
+// The completion runs once GoogleDataTransport has finished with the report, or it was given up on.
+- (void)uploadPackagedReportAtPath:(NSString *)path
+               dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
+                          asUrgent:(BOOL)urgent
+                        completion:(void (^)(void))completion;
+
 @end
@@ -66,6 +66,15 @@
 
 #pragma mark - Packaging and Submission
 
+- (void)refreshInstallID {
+  [self.installIDModel
+      regenerateInstallIDIfNeededWithBlock:^(NSString *_Nonnull newFIID,
+                                             NSString *_Nonnull authToken) {
+        self.fiid = [newFIID copy];
+        self.authToken = [authToken copy];
+      }];
+}
+
 /*
  * For a crash report, this is the initial code path for uploading. A report
  * will not repeat this code path after it's happened because this code path
@@ -77,8 +86,37 @@
            dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                       asUrgent:(BOOL)urgent
                 withProcessing:(BOOL)shouldProcess {
+  [self prepareAndSubmitReport:report
+           dataCollectionToken:dataCollectionToken
+                      asUrgent:urgent
+                withProcessing:shouldProcess
+              refreshInstallID:YES
+                    completion:nil];
+}
+
+- (void)prepareAndSubmitBacklogReport:(FIRCLSInternalReport *)report
+                  dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
+                       withProcessing:(BOOL)shouldProcess
+                           completion:(void (^)(void))completion {
+  [self prepareAndSubmitReport:report
+           dataCollectionToken:dataCollectionToken
+                      asUrgent:NO
+                withProcessing:shouldProcess
+              refreshInstallID:NO
+                    completion:completion];
+}
+
+- (void)prepareAndSubmitReport:(FIRCLSInternalReport *)report
+           dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
+                      asUrgent:(BOOL)urgent
+                withProcessing:(BOOL)shouldProcess
+              refreshInstallID:(BOOL)shouldRefreshInstallID
+                    completion:(void (^)(void))completion {
   if (![dataCollectionToken isValid]) {
     FIRCLSErrorLog(@"Data collection disabled and report will not be submitted");
+    if (completion) {
+      completion();
+    }
     return;
   }
 
@@ -93,12 +131,12 @@
         // the FIID callback is run on the main thread, this call can deadlock in
         // urgent mode. Since urgent mode happens when the app is in a crash loop,
         // we can safely assume users aren't rotating their FIID, so this can be skipped.
+        //
+        // Backlogged reports skip it too, since it was done once before they were fanned out.
         if (!urgent) {
-          [self.installIDModel regenerateInstallIDIfNeededWithBlock:^(
-                                   NSString *_Nonnull newFIID, NSString *_Nonnull authToken) {
-            self.fiid = [newFIID copy];
-            self.authToken = [authToken copy];
-          }];
+          if (shouldRefreshInstallID) {
+            [self refreshInstallID];
+          }
         } else {
           FIRCLSWarningLog(
               @"Crashlytics skipped rotating the Install ID during urgent mode because it is run "
@@ -111,6 +149,9 @@
           if (![self.fileManager moveItemAtPath:report.path
                                     toDirectory:self.fileManager.processingPath]) {
             FIRCLSErrorLog(@"Unable to move report for processing");
+            if (completion) {
+              completion();
+            }
             return;
           }
 
@@ -136,6 +177,9 @@
         if (![self.fileManager moveItemAtPath:report.path
                                   toDirectory:self.fileManager.preparedPath]) {
           FIRCLSErrorLog(@"Unable to move report to prepared");
+          if (completion) {
+            completion();
+          }
           return;
         }
 
@@ -147,7 +191,8 @@
 
         [self uploadPackagedReportAtPath:packagedPath
                      dataCollectionToken:dataCollectionToken
-                                asUrgent:urgent];
+                                asUrgent:urgent
+                              completion:completion];
 
         // We don't check for success here for 2 reasons:
         //   1) If we can't upload a crash for whatever reason, but we can upload analytics
@@ -177,10 +222,23 @@
 - (void)uploadPackagedReportAtPath:(NSString *)path
                dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
                           asUrgent:(BOOL)urgent {
+  [self uploadPackagedReportAtPath:path
+               dataCollectionToken:dataCollectionToken
+                          asUrgent:urgent
+                        completion:nil];
+}
+
+- (void)uploadPackagedReportAtPath:(NSString *)path
+               dataCollectionToken:(FIRCLSDataCollectionToken *)dataCollectionToken
+                          asUrgent:(BOOL)urgent
+                        completion:(void (^)(void))completion {
   FIRCLSDebugLog(@"Submitting report %@", urgent ? @"urgently" : @"async");
 
   if (![dataCollectionToken isValid]) {
     FIRCLSErrorLog(@"A report upload was requested with an invalid data collection token.");
+    if (completion) {
+      completion();
+    }
     return;
   }
 
@@ -191,6 +249,15 @@
                                                                  authToken:self.authToken];
 
   GDTCOREvent *event = [self.googleTransport eventForTransport];
+  if (!event) {
+    // sendDataEvent would never call back, leaving the completion and any urgent wait hanging.
+    FIRCLSErrorLog(@"Failed to send crash report because GoogleDataTransport isn't available");
+    if (completion) {
+      completion();
+    }
+    return;
+  }
+
   event.dataObject = adapter;
   event.qosTier = GDTCOREventQoSFast;  // Bypass batching, send immediately
 
@@ -203,6 +270,9 @@
              FIRCLSErrorLog(
                  @"Failed to send crash report due to failure writing GoogleDataTransport event");
              dispatch_semaphore_signal(semaphore);
+             if (completion) {
+               completion();
+             }
              return;
            }
 
@@ -210,6 +280,9 @@
              FIRCLSErrorLog(@"Failed to send crash report due to GoogleDataTransport error: %@",
                             error.localizedDescription);
              dispatch_semaphore_signal(semaphore);
+             if (completion) {
+               completion();
+             }
              return;
            }
 
@@ -220,6 +293,9 @@
            }
 
            [self cleanUpSubmittedReportAtPath:path];
+           if (completion) {
+             completion();
+           }
          }];
 
   if (urgent) {
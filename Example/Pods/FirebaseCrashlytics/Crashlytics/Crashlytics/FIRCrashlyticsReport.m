@@ -93,6 +93,12 @@
   return self;
 }
 
+- (void)dealloc {
+  // Keys set on this report were indexed in memory, which is no longer needed.
+  FIRCLSUserLoggingForgetKVStorage(&_userKVStorage);
+  FIRCLSUserLoggingForgetKVStorage(&_internalKVStorage);
+}
+
 + (const char *)filesystemPathForContentFile:(NSString *)contentFile
                             inInternalReport:(FIRCLSInternalReport *)internalReport {
   if (!internalReport) {
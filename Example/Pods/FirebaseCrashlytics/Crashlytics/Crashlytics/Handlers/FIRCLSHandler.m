@@ -14,36 +14,54 @@
 
 #include "Crashlytics/Crashlytics/Handlers/FIRCLSHandler.h"
 
+#include "Crashlytics/Crashlytics/Components/FIRCLSCrashTimings.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSCrashedMarkerFile.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSGlobals.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSHost.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSProcess.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSInternalLogging.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 
 #import "Crashlytics/Crashlytics/Controllers/FIRCLSReportManager_Private.h"
 
 void FIRCLSHandler(FIRCLSFile* file, thread_t crashedThread, void* uapVoid) {
   FIRCLSProcess process;
+  const FIRCLSCrashTimingsReadOnlyContext* timingsRO = &_firclsContext.readonly->timings;
+  FIRCLSCrashTimingsWritableContext* timings = &_firclsContext.writable->timings;
+
+  FIRCLSCrashTimingsStart(timingsRO, timings);
 
   FIRCLSProcessInit(&process, crashedThread, uapVoid);
 
   FIRCLSProcessSuspendAllOtherThreads(&process);
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointThreadsSuspended);
 
   FIRCLSProcessRecordAllThreads(&process, file);
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointThreadsRecorded);
 
   FIRCLSProcessRecordRuntimeInfo(&process, file);
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointRuntimeRecorded);
   // Get dispatch queue and thread names. Note that getting the thread names
   // can hang, so let's do that last
   FIRCLSProcessRecordDispatchQueueNames(&process, file);
   FIRCLSProcessRecordThreadNames(&process, file);
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointNamesRecorded);
 
   // this stuff isn't super important, but we can try
   FIRCLSProcessRecordStats(&process, file);
   FIRCLSHostWriteDiskUsage(file);
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointStatsRecorded);
 
   // This is the first common point where various crash handlers call into
   // Store a crash file marker to indicate that a crash has occurred
   FIRCLSCreateCrashedMarkerFile();
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointMarkerCreated);
+
+  // Internal logging is only buffered up to this point
+  FIRCLSSDKFileLogFlush();
+  FIRCLSCrashTimingsCheckpoint(timingsRO, timings, FIRCLSCrashTimingCheckpointLogFlushed);
+
+  FIRCLSCrashTimingsWrite(timingsRO, timings, file);
 
   FIRCLSProcessResumeAllOtherThreads(&process);
 }
@@ -24,42 +24,64 @@
 #include <mach/vm_param.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 
-void* FIRCLSAllocatorSafeAllocateFromRegion(FIRCLSAllocationRegion* region, size_t size);
+typedef struct {
+  uint32_t sizeClass;
+  _Atomic(uint32_t) magic;
+  _Atomic(uint32_t) next;
+  uint32_t reserved;
+} FIRCLSAllocationBlockHeader;
+
+#define FIRCLSAllocationBlockAllocatedMagic (0xC1A55A11)
+#define FIRCLSAllocationBlockFreeMagic (0xC1A5F2EE)
+
+// Offsets stored in cursors and free lists are relative to the region start.  Free list heads
+// hold offset + 1, so that zero can mean "empty".
+#define FIRCLSAllocationPack(high, low) (((uint64_t)(high) << 32) | (uint32_t)(low))
+#define FIRCLSAllocationHigh(value) ((uint32_t)((value) >> 32))
+#define FIRCLSAllocationLow(value) ((uint32_t)(value))
+
+static void* FIRCLSAllocatorSafeAllocateFromRegion(FIRCLSAllocationRegion* region, size_t size);
+static void* FIRCLSAllocatorAllocateBlockFromRegion(FIRCLSAllocationRegion* region, size_t size);
+static void FIRCLSAllocatorRegionInit(FIRCLSAllocationRegion* region, void* start, size_t size);
+static void FIRCLSAllocatorRegionExhausted(FIRCLSAllocationRegion* region, size_t size);
+static void FIRCLSAllocatorUnmap(void* buffer, size_t size);
 
 FIRCLSAllocatorRef FIRCLSAllocatorCreate(size_t writableSpace, size_t readableSpace) {
   FIRCLSAllocatorRef allocator;
-  FIRCLSAllocationRegion writableRegion;
-  FIRCLSAllocationRegion readableRegion;
+  FIRCLSAllocationRegion* regions;
+  size_t writableSize;
+  size_t readableSize;
   size_t allocationSize;
   vm_size_t pageSize;
   void* buffer;
+  void* writableStart;
+  void* readableStart;
 
-  // | GUARD | WRITABLE_REGION | GUARD | READABLE_REGION | GUARD |
+  // | GUARD | WRITABLE_REGION | REGIONS | GUARD | READABLE_REGION | GUARD |
 
   pageSize = FIRCLSHostGetPageSize();
 
+  writableSpace += sizeof(FIRCLSAllocationRegion) * 2;  // add the space for the region descriptors
   readableSpace += sizeof(FIRCLSAllocator);  // add the space for our allocator itself
 
   // we can only protect at the page level, so we need all of our regions to be
   // exact multiples of pages.  But, we don't need anything in the special-case of zero.
 
-  writableRegion.size = 0;
-  if (writableSpace > 0) {
-    writableRegion.size = ((writableSpace / pageSize) + 1) * pageSize;
-  }
+  writableSize = ((writableSpace / pageSize) + 1) * pageSize;
 
-  readableRegion.size = 0;
+  readableSize = 0;
   if (readableSpace > 0) {
-    readableRegion.size = ((readableSpace / pageSize) + 1) * pageSize;
+    readableSize = ((readableSpace / pageSize) + 1) * pageSize;
   }
 
   // Make one big, continuous allocation, adding additional pages for our guards.  Note
   // that we cannot use malloc, calloc (or valloc) in this case, because we need to assert full
   // ownership over these allocations.  mmap is a much better choice.  We also mark these
   // pages as MAP_NOCACHE.
-  allocationSize = writableRegion.size + readableRegion.size + pageSize * 3;
+  allocationSize = writableSize + readableSize + pageSize * 3;
   buffer =
       mmap(0, allocationSize, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_NOCACHE, -1, 0);
   if (buffer == MAP_FAILED) {
@@ -67,53 +89,85 @@ FIRCLSAllocatorRef FIRCLSAllocatorCreate(size_t writableSpace, size_t readableSp
     return NULL;
   }
 
-  // move our cursors into position
-  writableRegion.cursor = (void*)((uintptr_t)buffer + pageSize);
-  readableRegion.cursor = (void*)((uintptr_t)buffer + pageSize + writableRegion.size + pageSize);
-  writableRegion.start = writableRegion.cursor;
-  readableRegion.start = readableRegion.cursor;
+  writableStart = (void*)((uintptr_t)buffer + pageSize);
+  readableStart = (void*)((uintptr_t)buffer + pageSize + writableSize + pageSize);
+
+  // The region descriptors sit at the very end of the writable region, and are excluded from it.
+  regions = (FIRCLSAllocationRegion*)((uintptr_t)writableStart + writableSize -
+                                      sizeof(FIRCLSAllocationRegion) * 2);
+  FIRCLSAllocatorRegionInit(&regions[0], writableStart,
+                            writableSize - sizeof(FIRCLSAllocationRegion) * 2);
+  FIRCLSAllocatorRegionInit(&regions[1], readableStart, readableSize);
 
-  FIRCLSSDKLogInfo("Mapping: %p %p %p, total: %zu K\n", buffer, writableRegion.start,
-                   readableRegion.start, allocationSize / 1024);
+  FIRCLSSDKLogInfo("Mapping: %p %p %p, total: %u K\n", buffer, writableStart, readableStart,
+                   (uint32_t)(allocationSize / 1024));
 
   // protect first guard page
   if (mprotect(buffer, pageSize, PROT_NONE) != 0) {
     FIRCLSSDKLogError("First guard protection failed %s\n", strerror(errno));
+    FIRCLSAllocatorUnmap(buffer, allocationSize);
     return NULL;
   }
 
   // middle guard
-  if (mprotect((void*)((uintptr_t)buffer + pageSize + writableRegion.size), pageSize, PROT_NONE) !=
-      0) {
+  if (mprotect((void*)((uintptr_t)buffer + pageSize + writableSize), pageSize, PROT_NONE) != 0) {
     FIRCLSSDKLogError("Middle guard protection failed %s\n", strerror(errno));
+    FIRCLSAllocatorUnmap(buffer, allocationSize);
     return NULL;
   }
 
   // end guard
-  if (mprotect((void*)((uintptr_t)buffer + pageSize + writableRegion.size + pageSize +
-                       readableRegion.size),
+  if (mprotect((void*)((uintptr_t)buffer + pageSize + writableSize + pageSize + readableSize),
                pageSize, PROT_NONE) != 0) {
     FIRCLSSDKLogError("Last guard protection failed %s\n", strerror(errno));
+    FIRCLSAllocatorUnmap(buffer, allocationSize);
     return NULL;
   }
 
   // now, perform our first "allocation", which is to place our allocator into the read-only region
-  allocator = FIRCLSAllocatorSafeAllocateFromRegion(&readableRegion, sizeof(FIRCLSAllocator));
+  allocator = FIRCLSAllocatorSafeAllocateFromRegion(&regions[1], sizeof(FIRCLSAllocator));
+  if (!allocator) {
+    FIRCLSSDKLogError("Unable to place allocator\n");
+    FIRCLSAllocatorUnmap(buffer, allocationSize);
+    return NULL;
+  }
 
   // set up its data structure
   allocator->buffer = buffer;
+  allocator->bufferSize = allocationSize;
   allocator->protectionEnabled = false;
-  allocator->readableRegion = readableRegion;
-  allocator->writeableRegion = writableRegion;
+  allocator->writeableRegion = &regions[0];
+  allocator->readableRegion = &regions[1];
 
   FIRCLSSDKLogDebug("Allocator successfully created %p", allocator);
 
   return allocator;
 }
 
+static void FIRCLSAllocatorRegionInit(FIRCLSAllocationRegion* region, void* start, size_t size) {
+  region->start = start;
+  region->size = size;
+
+  atomic_init(&region->cursors, FIRCLSAllocationPack(size, 0));
+  for (uint32_t i = 0; i < FIRCLSAllocatorSizeClassCount; ++i) {
+    atomic_init(&region->freeLists[i], 0);
+  }
+  atomic_init(&region->exhaustionCount, 0);
+}
+
+static void FIRCLSAllocatorUnmap(void* buffer, size_t size) {
+  if (munmap(buffer, size) != 0) {
+    FIRCLSSDKLogError("Unmapping failed %s\n", strerror(errno));
+  }
+}
+
 void FIRCLSAllocatorDestroy(FIRCLSAllocatorRef allocator) {
-  if (allocator) {
+  if (!allocator) {
+    return;
   }
+
+  // The allocator lives inside the mapping, guard pages and all, so unmapping it frees everything.
+  FIRCLSAllocatorUnmap(allocator->buffer, allocator->bufferSize);
 }
 
 bool FIRCLSAllocatorProtect(FIRCLSAllocatorRef allocator) {
@@ -132,61 +186,119 @@ bool FIRCLSAllocatorProtect(FIRCLSAllocatorRef allocator) {
   // This has to be done first
   allocator->protectionEnabled = true;
 
-  vm_size_t pageSize = FIRCLSHostGetPageSize();
-
   // readable region
-  address =
-      (void*)((uintptr_t)allocator->buffer + pageSize + allocator->writeableRegion.size + pageSize);
+  address = allocator->readableRegion->start;
 
-  return mprotect(address, allocator->readableRegion.size, PROT_READ) == 0;
+  return mprotect(address, allocator->readableRegion->size, PROT_READ) == 0;
 }
 
 bool FIRCLSAllocatorUnprotect(FIRCLSAllocatorRef allocator) {
-  size_t bufferSize;
-
   if (!allocator) {
     return false;
   }
 
-  vm_size_t pageSize = FIRCLSHostGetPageSize();
-
-  bufferSize = (uintptr_t)allocator->buffer + pageSize + allocator->writeableRegion.size +
-               pageSize + allocator->readableRegion.size + pageSize;
-
+  // The guard pages stay in place, only the readable region needs to be opened up again.
   allocator->protectionEnabled =
-      !(mprotect(allocator->buffer, bufferSize, PROT_READ | PROT_WRITE) == 0);
+      !(mprotect(allocator->readableRegion->start, allocator->readableRegion->size,
+                 PROT_READ | PROT_WRITE) == 0);
 
   return allocator->protectionEnabled;
 }
 
-void* FIRCLSAllocatorSafeAllocateFromRegion(FIRCLSAllocationRegion* region, size_t size) {
-  void* newCursor;
-  void* originalCursor;
+static void FIRCLSAllocatorRegionExhausted(FIRCLSAllocationRegion* region, size_t size) {
+  // Only log the first failure, the counter tells the rest of the story
+  if (atomic_fetch_add(&region->exhaustionCount, 1) == 0) {
+    FIRCLSSDKLogError("Unable to allocate %u bytes, region %p is exhausted\n", (uint32_t)size,
+                      region->start);
+  }
+}
+
+static void* FIRCLSAllocatorSafeAllocateFromRegion(FIRCLSAllocationRegion* region, size_t size) {
+  uint64_t originalCursors;
+  uint64_t newCursors;
+  uint32_t low;
+  uint32_t high;
 
   // Here's the idea
-  // - read the current cursor
-  // - compute what our new cursor should be
+  // - read the current cursors
+  // - compute what our new low cursor should be
   // - attempt a swap
   // if the swap fails, some other thread has modified stuff, and we have to start again
   // if the swap works, everything has been updated correctly and we are done
+  originalCursors = atomic_load(&region->cursors);
   do {
-    originalCursor = region->cursor;
-
-    // this shouldn't happen unless we make a mistake with our size pre-computations
-    if ((uintptr_t)originalCursor - (uintptr_t)region->start + size > region->size) {
-      FIRCLSSDKLog("Unable to allocate sufficient memory, falling back to calloc\n");
-      void* ptr = calloc(1, size);
-      if (!ptr) {
-        FIRCLSSDKLog("Unable to calloc in FIRCLSAllocatorSafeAllocateFromRegion\n");
-        return NULL;
-      }
-      return ptr;
+    low = FIRCLSAllocationLow(originalCursors);
+    high = FIRCLSAllocationHigh(originalCursors);
+
+    if (size > high - low) {
+      FIRCLSAllocatorRegionExhausted(region, size);
+      return NULL;
     }
 
-    newCursor = (void*)((uintptr_t)originalCursor + size);
-  } while (!atomic_compare_exchange_strong(&region->cursor, &originalCursor, newCursor));
+    newCursors = FIRCLSAllocationPack(high, low + size);
+  } while (!atomic_compare_exchange_weak(&region->cursors, &originalCursors, newCursors));
+
+  return (void*)((uintptr_t)region->start + low);
+}
+
+static uint32_t FIRCLSAllocatorSizeClassForSize(size_t size) {
+  uint32_t sizeClass = 0;
+
+  while ((size_t)(FIRCLSAllocatorMinimumSizeClass << sizeClass) < size) {
+    sizeClass++;
+  }
 
-  return originalCursor;
+  return sizeClass;
+}
+
+static void* FIRCLSAllocatorAllocateBlockFromRegion(FIRCLSAllocationRegion* region, size_t size) {
+  const uint32_t sizeClass = FIRCLSAllocatorSizeClassForSize(size);
+  const size_t classSize = FIRCLSAllocatorMinimumSizeClass << sizeClass;
+  _Atomic(uint64_t)* freeList = &region->freeLists[sizeClass];
+  FIRCLSAllocationBlockHeader* header;
+  uint64_t originalHead;
+  uint64_t originalCursors;
+  uint64_t newCursors;
+  uint32_t blockOffset;
+
+  // First, try to pop a previously-freed block.  Blocks are never returned to the region, so
+  // reading the next offset of a block that another thread just popped is harmless.  The
+  // generation tag makes the swap fail in that case.
+  originalHead = atomic_load(freeList);
+  while (FIRCLSAllocationLow(originalHead) != 0) {
+    header = (FIRCLSAllocationBlockHeader*)((uintptr_t)region->start +
+                                            FIRCLSAllocationLow(originalHead) - 1);
+    const uint64_t newHead = FIRCLSAllocationPack(FIRCLSAllocationHigh(originalHead) + 1,
+                                                  atomic_load(&header->next));
+
+    if (atomic_compare_exchange_weak(freeList, &originalHead, newHead)) {
+      atomic_store(&header->magic, FIRCLSAllocationBlockAllocatedMagic);
+      memset(header + 1, 0, classSize);
+      return header + 1;
+    }
+  }
+
+  // Nothing to reuse, so carve a new block off the high end
+  originalCursors = atomic_load(&region->cursors);
+  do {
+    const uint32_t low = FIRCLSAllocationLow(originalCursors);
+    const uint32_t high = FIRCLSAllocationHigh(originalCursors);
+
+    if (sizeof(FIRCLSAllocationBlockHeader) + classSize > high - low) {
+      FIRCLSAllocatorRegionExhausted(region, size);
+      return NULL;
+    }
+
+    blockOffset = high - (uint32_t)(sizeof(FIRCLSAllocationBlockHeader) + classSize);
+    newCursors = FIRCLSAllocationPack(blockOffset, low);
+  } while (!atomic_compare_exchange_weak(&region->cursors, &originalCursors, newCursors));
+
+  header = (FIRCLSAllocationBlockHeader*)((uintptr_t)region->start + blockOffset);
+  header->sizeClass = sizeClass;
+  atomic_store(&header->next, 0);
+  atomic_store(&header->magic, FIRCLSAllocationBlockAllocatedMagic);
+
+  return header + 1;
 }
 
 void* FIRCLSAllocatorSafeAllocate(FIRCLSAllocatorRef allocator,
@@ -205,7 +317,19 @@ void* FIRCLSAllocatorSafeAllocate(FIRCLSAllocatorRef allocator,
     return ptr;
   }
 
-  if (allocator->protectionEnabled) {
+  switch (type) {
+    case CLS_READONLY:
+      region = allocator->readableRegion;
+      break;
+    case CLS_READWRITE:
+      region = allocator->writeableRegion;
+      break;
+    default:
+      return NULL;
+  }
+
+  // The writable region stays writable, so it can keep serving allocations after protection.
+  if (allocator->protectionEnabled && region == allocator->readableRegion) {
     FIRCLSSDKLog("Allocator already protected, falling back to calloc\n");
     void* ptr = calloc(1, size);
     if (!ptr) {
@@ -215,24 +339,74 @@ void* FIRCLSAllocatorSafeAllocate(FIRCLSAllocatorRef allocator,
     return ptr;
   }
 
-  switch (type) {
-    case CLS_READONLY:
-      region = &allocator->readableRegion;
-      break;
-    case CLS_READWRITE:
-      region = &allocator->writeableRegion;
-      break;
-    default:
-      return NULL;
+  if (size == 0 || size > FIRCLSAllocatorMaximumSizeClass) {
+    return FIRCLSAllocatorSafeAllocateFromRegion(region, size);
   }
 
-  return FIRCLSAllocatorSafeAllocateFromRegion(region, size);
+  return FIRCLSAllocatorAllocateBlockFromRegion(region, size);
 }
 
 void FIRCLSAllocatorFree(FIRCLSAllocatorRef allocator, void* ptr) {
-  if (!allocator) {
+  FIRCLSAllocationRegion* region;
+  FIRCLSAllocationBlockHeader* header;
+  uint32_t headerOffset;
+  uint32_t expectedMagic;
+  uint64_t originalHead;
+  uint64_t newHead;
+
+  if (!ptr) {
+    return;
+  }
+
+  // Anything outside of our mapping came from one of the calloc fallbacks
+  if (!allocator || (uintptr_t)ptr < (uintptr_t)allocator->buffer ||
+      (uintptr_t)ptr >= (uintptr_t)allocator->buffer + allocator->bufferSize) {
     free(ptr);
+    return;
+  }
+
+  region = allocator->writeableRegion;
+  if ((uintptr_t)ptr >= (uintptr_t)allocator->readableRegion->start) {
+    // We cannot touch block headers once the readable region is protected
+    if (allocator->protectionEnabled) {
+      return;
+    }
+
+    region = allocator->readableRegion;
+  }
+
+  // Raw allocations live below the high cursor, and cannot be reused
+  if ((uintptr_t)ptr - (uintptr_t)region->start <
+      FIRCLSAllocationHigh(atomic_load(&region->cursors)) + sizeof(FIRCLSAllocationBlockHeader)) {
+    return;
+  }
+
+  header = (FIRCLSAllocationBlockHeader*)ptr - 1;
+
+  expectedMagic = FIRCLSAllocationBlockAllocatedMagic;
+  if (header->sizeClass >= FIRCLSAllocatorSizeClassCount ||
+      !atomic_compare_exchange_strong(&header->magic, &expectedMagic,
+                                      FIRCLSAllocationBlockFreeMagic)) {
+    FIRCLSSDKLogError("Invalid or double free of %p\n", ptr);
+    return;
+  }
+
+  headerOffset = (uint32_t)((uintptr_t)header - (uintptr_t)region->start);
+
+  _Atomic(uint64_t)* freeList = &region->freeLists[header->sizeClass];
+
+  originalHead = atomic_load(freeList);
+  do {
+    atomic_store(&header->next, FIRCLSAllocationLow(originalHead));
+    newHead = FIRCLSAllocationPack(FIRCLSAllocationHigh(originalHead) + 1, headerOffset + 1);
+  } while (!atomic_compare_exchange_weak(freeList, &originalHead, newHead));
+}
+
+uint32_t FIRCLSAllocatorExhaustionCount(FIRCLSAllocatorRef allocator) {
+  if (!allocator) {
+    return 0;
   }
 
-  // how do we do deallocations?
+  return atomic_load(&allocator->writeableRegion->exhaustionCount) +
+         atomic_load(&allocator->readableRegion->exhaustionCount);
 }
@@ -17,32 +17,57 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 typedef enum { CLS_READONLY = 0, CLS_READWRITE = 1 } FIRCLSAllocationType;
 
+// Small allocations are rounded up to one of these power-of-two size classes, starting at
+// FIRCLSAllocatorMinimumSizeClass, so that freed blocks can be handed out again.  Anything bigger
+// than the largest class is bump-allocated and never reused.
+#define FIRCLSAllocatorSizeClassCount (8)
+#define FIRCLSAllocatorMinimumSizeClass (16)
+#define FIRCLSAllocatorMaximumSizeClass \
+  (FIRCLSAllocatorMinimumSizeClass << (FIRCLSAllocatorSizeClassCount - 1))
+
+// Each region is carved from both ends.  Large, raw allocations grow up from the start of the
+// region, which keeps the very first allocation page-aligned.  Size-class blocks grow down from
+// the end.  Both offsets are packed into a single word, so that the two ends can never cross.
+// Free list heads pack a generation tag with a block offset to avoid ABA problems.
 typedef struct {
   size_t size;
   void* start;
-  _Atomic(void*) volatile cursor;
+  _Atomic(uint64_t) cursors;
+  _Atomic(uint64_t) freeLists[FIRCLSAllocatorSizeClassCount];
+  _Atomic(uint32_t) exhaustionCount;
 } FIRCLSAllocationRegion;
 
+// The region descriptors live at the end of the writable region, so that blocks can still be
+// allocated and freed there after the readable region has been protected.
 typedef struct {
   void* buffer;
+  size_t bufferSize;
   bool protectionEnabled;
-  FIRCLSAllocationRegion writeableRegion;
-  FIRCLSAllocationRegion readableRegion;
+  FIRCLSAllocationRegion* writeableRegion;
+  FIRCLSAllocationRegion* readableRegion;
 } FIRCLSAllocator;
 typedef FIRCLSAllocator* FIRCLSAllocatorRef;
 
 FIRCLSAllocatorRef FIRCLSAllocatorCreate(size_t writableSpace, size_t readableSpace);
+// Unmaps both regions, and the allocator itself, so nothing allocated from it may be used after.
 void FIRCLSAllocatorDestroy(FIRCLSAllocatorRef allocator);
 
 bool FIRCLSAllocatorProtect(FIRCLSAllocatorRef allocator);
 bool FIRCLSAllocatorUnprotect(FIRCLSAllocatorRef allocator);
 
+// Returns NULL, and bumps the exhaustion count, if the region has no space left.  These functions
+// do not take locks or call malloc when the allocator is valid, so they are safe to use at
+// crash time.
 void* FIRCLSAllocatorSafeAllocate(FIRCLSAllocatorRef allocator,
                                   size_t size,
                                   FIRCLSAllocationType type);
 const char* FIRCLSAllocatorSafeStrdup(FIRCLSAllocatorRef allocator, const char* string);
 void FIRCLSAllocatorFree(FIRCLSAllocatorRef allocator, void* ptr);
+
+// The number of allocations, across both regions, that failed because a region was full.
+uint32_t FIRCLSAllocatorExhaustionCount(FIRCLSAllocatorRef allocator);
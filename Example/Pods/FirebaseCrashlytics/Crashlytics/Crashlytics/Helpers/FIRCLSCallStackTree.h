@@ -22,16 +22,23 @@
 #if CLS_METRICKIT_SUPPORTED
 #import <MetricKit/MetricKit.h>
 
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+
 /*
- * Helper class for parsing the `MXCallStackTree` that we receive from MetricKit. Flattens the
- * nested structure into a structure similar to what is used in Crashlytics.
+ * Helper class for converting the `MXCallStackTree` that we receive from MetricKit. Walks the
+ * tree's JSON representation once, flattening the nested structure into a structure similar to
+ * what is used in Crashlytics, and writes it straight out without building any objects for it.
  */
 @interface FIRCLSCallStackTree : NSObject
 
 - (instancetype)initWithMXCallStackTree:(MXCallStackTree *)callStackTree API_AVAILABLE(ios(14.0));
-- (NSArray *)getArrayRepresentation;
-- (NSArray *)getFramesOfBlamedThread;
 - (instancetype)init NS_UNAVAILABLE;
 
+/*
+ * Writes the threads as an array, as the value for key. Returns NO if the tree couldn't be read,
+ * in which case the array holds only the threads that were read before the error.
+ */
+- (BOOL)writeThreadsToFile:(FIRCLSFile *)file key:(const char *)key;
+
 @end
 #endif
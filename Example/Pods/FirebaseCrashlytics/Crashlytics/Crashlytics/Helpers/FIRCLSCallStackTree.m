@@ -15,131 +15,298 @@
 #import <Foundation/Foundation.h>
 
 #import "Crashlytics/Crashlytics/Helpers/FIRCLSCallStackTree.h"
+#import "Crashlytics/Crashlytics/Helpers/FIRCLSLogger.h"
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSSectionReader.h"
+
+#include <stdlib.h>
+#include <string.h>
 
 #if CLS_METRICKIT_SUPPORTED
 
-@interface FIRCLSFrame : NSObject
-@property long address;
-@property long sampleCount;
-@property long offsetIntoBinaryTextSegment;
-@property NSString *binaryName;
-@property NSUUID *binaryUUID;
-@end
+// The JSON representation looks like:
+//
+//   {"callStacks": [{"threadAttributed": true,
+//                    "callStackRootFrames": [{"address": 1, "subFrames": [{"address": 2, ...}]}]}]}
+//
+// Each thread is flattened by following the first frame at each level, which is the path that the
+// stack trace took. Keys within a frame can come in any order, and a frame's address often comes
+// after its subFrames, so the addresses along the path are collected before the thread is written.
 
-@implementation FIRCLSFrame
-@end
+// Nesting depths within the document, counting the root object as 1
+#define CLS_CALL_STACK_TREE_CALL_STACKS_DEPTH (2)
+#define CLS_CALL_STACK_TREE_THREAD_DEPTH (3)
+#define CLS_CALL_STACK_TREE_ROOT_FRAMES_DEPTH (4)
 
-@interface FIRCLSThread : NSObject
-@property NSString *threadName;
-@property BOOL threadBlamed;
-@property NSArray<FIRCLSFrame *> *frames;
-@end
+typedef enum {
+  FIRCLSCallStackTreeKeyOther,
+  FIRCLSCallStackTreeKeyCallStacks,
+  FIRCLSCallStackTreeKeyThreadAttributed,
+  FIRCLSCallStackTreeKeyRootFrames,
+  FIRCLSCallStackTreeKeySubFrames,
+  FIRCLSCallStackTreeKeyAddress,
+} FIRCLSCallStackTreeKey;
 
-@implementation FIRCLSThread
-@end
+typedef struct {
+  FIRCLSFile *file;
 
-@interface FIRCLSCallStackTree ()
-@property NSArray<FIRCLSThread *> *threads;
-@property(nonatomic) BOOL callStackPerThread;
+  uint32_t depth;
+  FIRCLSCallStackTreeKey key;
+  bool inCallStacks;
+  bool inThread;
+  bool threadBlamed;
 
-@end
+  // The deepest open container on the path of first frames, or zero if there isn't one. It's an
+  // array of frames, or a frame, depending on pathEndsInArray.
+  uint32_t pathDepth;
+  bool pathEndsInArray;
+  bool pathArrayHasFrame;
 
-@implementation FIRCLSCallStackTree
+  // addresses[0..frameCount) are the frames along the path, root first
+  uint64_t *addresses;
+  uint32_t addressCapacity;
+  uint32_t frameCount;
 
-- (instancetype)initWithMXCallStackTree:(MXCallStackTree *)callStackTree {
-  NSData *jsonCallStackTree = callStackTree.JSONRepresentation;
-  if ([jsonCallStackTree length] == 0) return nil;
+  // Set when a frame couldn't be recorded. The path no longer matches the document, so nothing
+  // more is written.
+  bool failed;
+} FIRCLSCallStackTreeWriter;
 
-  NSError *error = nil;
-  NSDictionary *jsonDictionary = [NSJSONSerialization JSONObjectWithData:jsonCallStackTree
-                                                                 options:0
-                                                                   error:&error];
-  if (error) {
-    NSLog(@"Crashlytics: error creating json");
-    return nil;
-  }
-  self = [super init];
-  if (!self) {
-    return nil;
+static FIRCLSCallStackTreeKey FIRCLSCallStackTreeTakeKey(FIRCLSCallStackTreeWriter *writer) {
+  FIRCLSCallStackTreeKey key = writer->key;
+
+  writer->key = FIRCLSCallStackTreeKeyOther;
+  return key;
+}
+
+static bool FIRCLSCallStackTreeIsInFrame(FIRCLSCallStackTreeWriter *writer) {
+  return writer->pathDepth != 0 && writer->pathDepth == writer->depth && !writer->pathEndsInArray;
+}
+
+static void FIRCLSCallStackTreeKeyFound(void *context, const char *key, size_t length) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+#define CLS_KEY_EQUALS(literal) \
+  (length == sizeof(literal) - 1 && memcmp(key, literal, sizeof(literal) - 1) == 0)
+
+  writer->key = FIRCLSCallStackTreeKeyOther;
+  if (writer->depth == 1 && CLS_KEY_EQUALS("callStacks")) {
+    writer->key = FIRCLSCallStackTreeKeyCallStacks;
+  } else if (writer->inThread && writer->depth == CLS_CALL_STACK_TREE_THREAD_DEPTH) {
+    if (CLS_KEY_EQUALS("threadAttributed")) {
+      writer->key = FIRCLSCallStackTreeKeyThreadAttributed;
+    } else if (CLS_KEY_EQUALS("callStackRootFrames")) {
+      writer->key = FIRCLSCallStackTreeKeyRootFrames;
+    }
+  } else if (FIRCLSCallStackTreeIsInFrame(writer)) {
+    if (CLS_KEY_EQUALS("address")) {
+      writer->key = FIRCLSCallStackTreeKeyAddress;
+    } else if (CLS_KEY_EQUALS("subFrames")) {
+      writer->key = FIRCLSCallStackTreeKeySubFrames;
+    }
   }
-  _callStackPerThread = [[jsonDictionary objectForKey:@"callStackPerThread"] boolValue];
-
-  // Recurse through the frames in the callStackTree and add them all to an array
-  NSMutableArray<FIRCLSThread *> *threads = [[NSMutableArray alloc] init];
-  NSArray *callStacks = jsonDictionary[@"callStacks"];
-  for (id object in callStacks) {
-    NSMutableArray<FIRCLSFrame *> *frames = [[NSMutableArray alloc] init];
-    [self flattenSubFrames:object[@"callStackRootFrames"] intoFrames:frames];
-    FIRCLSThread *thread = [[FIRCLSThread alloc] init];
-    thread.threadBlamed = [[object objectForKey:@"threadAttributed"] boolValue];
-    thread.frames = frames;
-    [threads addObject:thread];
+
+#undef CLS_KEY_EQUALS
+}
+
+static void FIRCLSCallStackTreeBeginArray(void *context) {
+  FIRCLSCallStackTreeWriter *writer = context;
+  const FIRCLSCallStackTreeKey key = FIRCLSCallStackTreeTakeKey(writer);
+  const bool inFrame = FIRCLSCallStackTreeIsInFrame(writer);
+
+  writer->depth++;
+
+  if (key == FIRCLSCallStackTreeKeyCallStacks) {
+    writer->inCallStacks = true;
+  } else if ((key == FIRCLSCallStackTreeKeyRootFrames && writer->pathDepth == 0) ||
+             (key == FIRCLSCallStackTreeKeySubFrames && inFrame)) {
+    writer->pathDepth = writer->depth;
+    writer->pathEndsInArray = true;
+    writer->pathArrayHasFrame = false;
   }
-  _threads = threads;
-  return self;
 }
 
-// Flattens the nested structure we receive from MetricKit into an array of frames.
-- (void)flattenSubFrames:(NSArray *)callStacks intoFrames:(NSMutableArray *)frames {
-  NSDictionary *rootFrames = [callStacks firstObject];
-  FIRCLSFrame *frame = [[FIRCLSFrame alloc] init];
-  frame.offsetIntoBinaryTextSegment =
-      [[rootFrames valueForKey:@"offsetIntoBinaryTextSegment"] longValue];
-  frame.address = [[rootFrames valueForKey:@"address"] longValue];
-  frame.sampleCount = [[rootFrames valueForKey:@"sampleCount"] longValue];
-  frame.binaryUUID = [rootFrames valueForKey:@"binaryUUID"];
-  frame.binaryName = [rootFrames valueForKey:@"binaryName"];
-
-  [frames addObject:frame];
-
-  // Recurse through any subframes and add them to the array.
-  if ([rootFrames objectForKey:@"subFrames"]) {
-    [self flattenSubFrames:[rootFrames objectForKey:@"subFrames"] intoFrames:frames];
+static void FIRCLSCallStackTreeBeginObject(void *context) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+  FIRCLSCallStackTreeTakeKey(writer);
+
+  writer->depth++;
+
+  if (writer->inCallStacks && writer->depth == CLS_CALL_STACK_TREE_THREAD_DEPTH) {
+    writer->inThread = true;
+    writer->threadBlamed = false;
+    writer->frameCount = 0;
+    return;
+  }
+
+  // Only the first frame in each array is on the path
+  if (writer->pathDepth + 1 != writer->depth || !writer->pathEndsInArray ||
+      writer->pathArrayHasFrame) {
+    return;
   }
+
+  if (writer->frameCount == writer->addressCapacity) {
+    const uint32_t capacity = writer->addressCapacity == 0 ? 64 : writer->addressCapacity * 2;
+    uint64_t *addresses = realloc(writer->addresses, capacity * sizeof(uint64_t));
+    if (!addresses) {
+      writer->failed = true;
+      return;
+    }
+
+    writer->addresses = addresses;
+    writer->addressCapacity = capacity;
+  }
+
+  writer->pathArrayHasFrame = true;
+  writer->pathDepth = writer->depth;
+  writer->pathEndsInArray = false;
+  writer->addresses[writer->frameCount++] = 0;
 }
 
-- (NSArray *)getArrayRepresentation {
-  NSMutableArray *threadArray = [[NSMutableArray alloc] init];
-  for (FIRCLSThread *thread in self.threads) {
-    [threadArray addObject:[self getDictionaryRepresentation:thread]];
+static void FIRCLSCallStackTreeWriteThread(FIRCLSCallStackTreeWriter *writer) {
+  FIRCLSFile *file = writer->file;
+
+  FIRCLSFileWriteHashStart(file);
+
+  FIRCLSFileWriteHashKey(file, "registers");
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSFileWriteHashEnd(file);
+
+  FIRCLSFileWriteHashKey(file, "stacktrace");
+  FIRCLSFileWriteArrayStart(file);
+  for (uint32_t i = 0; i < writer->frameCount; ++i) {
+    FIRCLSFileWriteArrayEntryUint64(file, writer->addresses[i]);
   }
-  return threadArray;
+  FIRCLSFileWriteArrayEnd(file);
+
+  FIRCLSFileWriteHashEntryBoolean(file, "crashed", writer->threadBlamed);
+
+  FIRCLSFileWriteHashEnd(file);
 }
 
-- (NSDictionary *)getDictionaryRepresentation:(FIRCLSThread *)thread {
-  NSMutableDictionary *dictionary = [[NSMutableDictionary alloc] init];
-  [dictionary setObject:@{} forKey:@"registers"];
-  NSMutableArray *frameArray = [[NSMutableArray alloc] init];
-  for (FIRCLSFrame *frame in thread.frames) {
-    [frameArray addObject:[NSNumber numberWithLong:frame.address]];
+static void FIRCLSCallStackTreeEndObject(void *context) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+  if (FIRCLSCallStackTreeIsInFrame(writer)) {
+    // back to the frame's array, which has now had its one frame
+    writer->pathDepth--;
+    writer->pathEndsInArray = true;
+    writer->pathArrayHasFrame = true;
+  } else if (writer->inThread && writer->depth == CLS_CALL_STACK_TREE_THREAD_DEPTH) {
+    if (!writer->failed) {
+      FIRCLSCallStackTreeWriteThread(writer);
+    }
+    writer->inThread = false;
   }
-  [dictionary setObject:frameArray forKey:@"stacktrace"];
-  [dictionary setObject:[NSNumber numberWithBool:thread.threadBlamed] forKey:@"crashed"];
-  return dictionary;
+
+  writer->depth--;
 }
 
-- (NSArray *)getFramesOfBlamedThread {
-  for (FIRCLSThread *thread in self.threads) {
-    if (thread.threadBlamed) {
-      return [self convertFramesFor:thread];
+static void FIRCLSCallStackTreeEndArray(void *context) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+  if (writer->pathDepth != 0 && writer->pathDepth == writer->depth && writer->pathEndsInArray) {
+    // back to the frame that holds these subFrames, or off of the path for the root frames
+    if (writer->depth == CLS_CALL_STACK_TREE_ROOT_FRAMES_DEPTH) {
+      writer->pathDepth = 0;
+    } else {
+      writer->pathDepth--;
+      writer->pathEndsInArray = false;
     }
+  } else if (writer->inCallStacks && writer->depth == CLS_CALL_STACK_TREE_CALL_STACKS_DEPTH) {
+    writer->inCallStacks = false;
   }
-  if ([self.threads count] > 0) {
-    return [self convertFramesFor:self.threads.firstObject];
+
+  writer->depth--;
+}
+
+static void FIRCLSCallStackTreeNumber(void *context, const FIRCLSSectionReaderNumber *number) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+  switch (FIRCLSCallStackTreeTakeKey(writer)) {
+    case FIRCLSCallStackTreeKeyAddress: {
+      // frames and their subFrames arrays alternate below the root frames
+      const uint32_t index = (writer->pathDepth - CLS_CALL_STACK_TREE_ROOT_FRAMES_DEPTH - 1) / 2;
+      if (index < writer->frameCount) {
+        writer->addresses[index] = number->isInteger ? number->magnitude : (uint64_t)number->value;
+      }
+    } break;
+    case FIRCLSCallStackTreeKeyThreadAttributed:
+      writer->threadBlamed = number->value != 0;
+      break;
+    default:
+      break;
   }
-  return [NSArray array];
 }
 
-- (NSArray *)convertFramesFor:(FIRCLSThread *)thread {
-  NSMutableArray *frames = [[NSMutableArray alloc] init];
-  for (FIRCLSFrame *frame in thread.frames) {
-    [frames addObject:@{
-      @"pc" : [NSNumber numberWithLong:frame.address],
-      @"offset" : [NSNumber numberWithLong:frame.offsetIntoBinaryTextSegment],
-      @"line" : @0
-    }];
+static void FIRCLSCallStackTreeBoolean(void *context, bool value) {
+  FIRCLSCallStackTreeWriter *writer = context;
+
+  if (FIRCLSCallStackTreeTakeKey(writer) == FIRCLSCallStackTreeKeyThreadAttributed) {
+    writer->threadBlamed = value;
   }
-  return frames;
+}
+
+static void FIRCLSCallStackTreeString(void *context, const char *value, size_t length) {
+  FIRCLSCallStackTreeTakeKey(context);
+}
+
+static void FIRCLSCallStackTreeNull(void *context) {
+  FIRCLSCallStackTreeTakeKey(context);
+}
+
+@interface FIRCLSCallStackTree ()
+@property(nonatomic) NSData *jsonCallStackTree;
+@end
+
+@implementation FIRCLSCallStackTree
+
+- (instancetype)initWithMXCallStackTree:(MXCallStackTree *)callStackTree {
+  NSData *jsonCallStackTree = callStackTree.JSONRepresentation;
+  if ([jsonCallStackTree length] == 0) return nil;
+
+  self = [super init];
+  if (!self) {
+    return nil;
+  }
+  _jsonCallStackTree = jsonCallStackTree;
+  return self;
+}
+
+- (BOOL)writeThreadsToFile:(FIRCLSFile *)file key:(const char *)key {
+  static const FIRCLSSectionReaderCallbacks callbacks = {
+      .beginObject = FIRCLSCallStackTreeBeginObject,
+      .endObject = FIRCLSCallStackTreeEndObject,
+      .beginArray = FIRCLSCallStackTreeBeginArray,
+      .endArray = FIRCLSCallStackTreeEndArray,
+      .key = FIRCLSCallStackTreeKeyFound,
+      .string = FIRCLSCallStackTreeString,
+      .number = FIRCLSCallStackTreeNumber,
+      .boolean = FIRCLSCallStackTreeBoolean,
+      .null = FIRCLSCallStackTreeNull,
+  };
+  FIRCLSCallStackTreeWriter writer = {.file = file};
+
+  FIRCLSFileWriteHashKey(file, key);
+  FIRCLSFileWriteArrayStart(file);
+
+  // Threads are only written once they've been read completely, so the array is always
+  // well-formed, even if the JSON isn't.
+  const bool valid = FIRCLSSectionReaderReadDocument(self.jsonCallStackTree.bytes,
+                                                     self.jsonCallStackTree.length, &callbacks,
+                                                     &writer) &&
+                     !writer.failed;
+
+  FIRCLSFileWriteArrayEnd(file);
+
+  free(writer.addresses);
+
+  if (!valid) {
+    FIRCLSDebugLog(@"Crashlytics: error reading call stack tree json");
+  }
+
+  return valid;
 }
 
 @end
@@ -32,6 +32,7 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic) uint32_t maxErrorLogSize;
 @property(nonatomic) uint32_t maxLogSize;
 @property(nonatomic) uint32_t maxKeyValues;
+@property(nonatomic) BOOL crashTimingsEnabled;
 
 @end
 
@@ -87,6 +87,19 @@ void FIRCLSFileWriteHashEntryNSStringUnlessNilOrEmpty(FIRCLSFile* file,
 #endif
 void FIRCLSFileWriteHashEntryHexEncodedString(FIRCLSFile* file, const char* key, const char* value);
 void FIRCLSFileWriteHashEntryBoolean(FIRCLSFile* file, const char* key, bool value);
+void FIRCLSFileWriteHashEntryDouble(FIRCLSFile* file, const char* key, double value);
+
+// Unlike the other string writers, these escape the string as JSON requires, so they are the ones
+// to use for strings that come from outside of the SDK.
+void FIRCLSFileWriteHashEntryEscapedString(FIRCLSFile* file, const char* key, const char* value);
+
+// Copies a JSON document, which may span lines, in as the value for key. If the document turns out
+// to be invalid part way through, the copy is closed off so that the file stays well-formed, and
+// false is returned.
+bool FIRCLSFileWriteHashEntryJSONDocument(FIRCLSFile* file,
+                                          const char* key,
+                                          const char* json,
+                                          size_t length);
 
 void FIRCLSFileWriteArrayStart(FIRCLSFile* file);
 void FIRCLSFileWriteArrayEnd(FIRCLSFile* file);
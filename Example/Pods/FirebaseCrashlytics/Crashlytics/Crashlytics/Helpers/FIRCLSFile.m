@@ -14,6 +14,7 @@
 
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
 
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSSectionReader.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 #include "Crashlytics/Shared/FIRCLSByteUtility.h"
 
@@ -23,6 +24,7 @@
 
 #include <sys/stat.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -47,6 +49,8 @@ short FIRCLSFilePrepareUInt64(char* buffer, uint64_t number, bool hex);
 static void FIRCLSFileWriteString(FIRCLSFile* file, const char* string);
 static void FIRCLSFileWriteHexEncodedString(FIRCLSFile* file, const char* string);
 static void FIRCLSFileWriteBool(FIRCLSFile* file, bool value);
+static void FIRCLSFileWriteDouble(FIRCLSFile* file, double value);
+static void FIRCLSFileWriteEscapedString(FIRCLSFile* file, const char* string, size_t length);
 
 static void FIRCLSFileWriteCollectionStart(FIRCLSFile* file, const char openingChar);
 static void FIRCLSFileWriteCollectionEnd(FIRCLSFile* file, const char closingChar);
@@ -468,6 +472,77 @@ void FIRCLSFileWriteBool(FIRCLSFile* file, bool value) {
   }
 }
 
+void FIRCLSFileWriteDouble(FIRCLSFile* file, double value) {
+  char buffer[32];
+
+  // JSON has no representation for these
+  if (!isfinite(value)) {
+    value = 0;
+  }
+
+  const int length = snprintf(buffer, sizeof(buffer), "%.17g", value);
+  if (length <= 0 || (size_t)length >= sizeof(buffer)) {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, "0", 1);
+    return;
+  }
+
+  FIRCLSFileWriteToFileDescriptorOrBuffer(file, buffer, (size_t)length);
+}
+
+void FIRCLSFileWriteEscapedString(FIRCLSFile* file, const char* string, size_t length) {
+  static const char hexDigits[] = "0123456789abcdef";
+  size_t runStart = 0;
+
+  FIRCLSFileWriteToFileDescriptorOrBuffer(file, "\"", 1);
+
+  for (size_t i = 0; i < length; ++i) {
+    const unsigned char c = (unsigned char)string[i];
+    char escape[6] = {'\\', 0, 0, 0, 0, 0};
+    size_t escapeLength = 2;
+
+    switch (c) {
+      case '"':
+      case '\\':
+        escape[1] = (char)c;
+        break;
+      case '\n':
+        escape[1] = 'n';
+        break;
+      case '\r':
+        escape[1] = 'r';
+        break;
+      case '\t':
+        escape[1] = 't';
+        break;
+      default:
+        if (c >= 0x20) {
+          continue;
+        }
+
+        escape[1] = 'u';
+        escape[2] = '0';
+        escape[3] = '0';
+        escape[4] = hexDigits[c >> 4];
+        escape[5] = hexDigits[c & 0xf];
+        escapeLength = 6;
+        break;
+    }
+
+    // write out runs of characters that don't need escaping at once
+    if (i > runStart) {
+      FIRCLSFileWriteToFileDescriptorOrBuffer(file, string + runStart, i - runStart);
+    }
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, escape, escapeLength);
+    runStart = i + 1;
+  }
+
+  if (length > runStart) {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, string + runStart, length - runStart);
+  }
+
+  FIRCLSFileWriteToFileDescriptorOrBuffer(file, "\"", 1);
+}
+
 void FIRCLSFileWriteSectionStart(FIRCLSFile* file, const char* name) {
   FIRCLSFileWriteHashStart(file);
   FIRCLSFileWriteHashKey(file, name);
@@ -586,6 +661,24 @@ void FIRCLSFileWriteHashEntryBoolean(FIRCLSFile* file, const char* key, bool val
   FIRCLSFileWriteCollectionEntryEpilog(file);
 }
 
+void FIRCLSFileWriteHashEntryDouble(FIRCLSFile* file, const char* key, double value) {
+  FIRCLSFileWriteHashKey(file, key);
+  FIRCLSFileWriteDouble(file, value);
+
+  FIRCLSFileWriteCollectionEntryEpilog(file);
+}
+
+void FIRCLSFileWriteHashEntryEscapedString(FIRCLSFile* file, const char* key, const char* value) {
+  FIRCLSFileWriteHashKey(file, key);
+  if (value) {
+    FIRCLSFileWriteEscapedString(file, value, strlen(value));
+  } else {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, "null", 4);
+  }
+
+  FIRCLSFileWriteCollectionEntryEpilog(file);
+}
+
 void FIRCLSFileWriteArrayStart(FIRCLSFile* file) {
   FIRCLSFileWriteCollectionStart(file, '[');
 }
@@ -618,52 +711,303 @@ void FIRCLSFileWriteArrayEntryHexEncodedString(FIRCLSFile* file, const char* val
   FIRCLSFileWriteCollectionEntryEpilog(file);
 }
 
-NSArray* FIRCLSFileReadSections(const char* path,
-                                bool deleteOnFailure,
-                                NSObject* (^transformer)(id obj)) {
-  if (!FIRCLSIsValidPointer(path)) {
-    FIRCLSSDKLogError("Error: input path is invalid\n");
-    return nil;
+#pragma mark - Copying
+
+typedef struct {
+  FIRCLSFile* file;
+  // a key has been written, but not its value
+  bool keyPending;
+  uint32_t depth;
+  char closers[FIRCLSSectionReaderMaximumDocumentDepth];
+} FIRCLSFileJSONCopier;
+
+static void FIRCLSFileJSONCopierValueProlog(FIRCLSFileJSONCopier* copier) {
+  // a key already wrote the separator
+  if (!copier->keyPending) {
+    FIRCLSFileWriteCollectionEntryProlog(copier->file);
   }
 
-  NSString* pathString = [NSString stringWithUTF8String:path];
-  NSString* contents = [NSString stringWithContentsOfFile:pathString
-                                                 encoding:NSUTF8StringEncoding
-                                                    error:nil];
-  NSArray* components = [contents componentsSeparatedByString:@"\n"];
+  copier->keyPending = false;
+}
+
+static void FIRCLSFileJSONCopierBeginContainer(FIRCLSFileJSONCopier* copier, char closer) {
+  // The reader enforces the same depth limit, so this can't overflow.
+  copier->closers[copier->depth++] = closer;
+  copier->keyPending = false;
+}
 
-  if (!components) {
-    if (deleteOnFailure) {
-      unlink(path);
+static void FIRCLSFileJSONCopierBeginObject(void* context) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileWriteHashStart(copier->file);
+  FIRCLSFileJSONCopierBeginContainer(copier, '}');
+}
+
+static void FIRCLSFileJSONCopierBeginArray(void* context) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileWriteArrayStart(copier->file);
+  FIRCLSFileJSONCopierBeginContainer(copier, ']');
+}
+
+static void FIRCLSFileJSONCopierEndContainer(void* context) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  copier->depth--;
+  FIRCLSFileWriteCollectionEnd(copier->file, copier->closers[copier->depth]);
+}
+
+static void FIRCLSFileJSONCopierKey(void* context, const char* key, size_t length) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileWriteCollectionEntryProlog(copier->file);
+  FIRCLSFileWriteEscapedString(copier->file, key, length);
+  FIRCLSFileWriteToFileDescriptorOrBuffer(copier->file, ":", 1);
+
+  copier->file->needComma = false;
+  copier->keyPending = true;
+}
+
+static void FIRCLSFileJSONCopierString(void* context, const char* value, size_t length) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileJSONCopierValueProlog(copier);
+  FIRCLSFileWriteEscapedString(copier->file, value, length);
+  FIRCLSFileWriteCollectionEntryEpilog(copier->file);
+}
+
+static void FIRCLSFileJSONCopierNumber(void* context, const FIRCLSSectionReaderNumber* number) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileJSONCopierValueProlog(copier);
+  if (!number->isInteger) {
+    FIRCLSFileWriteDouble(copier->file, number->value);
+  } else {
+    if (number->isNegative) {
+      FIRCLSFileWriteToFileDescriptorOrBuffer(copier->file, "-", 1);
     }
+    FIRCLSFileWriteUInt64(copier->file, number->magnitude, false);
+  }
+  FIRCLSFileWriteCollectionEntryEpilog(copier->file);
+}
 
-    FIRCLSSDKLog("Unable to read file %s\n", path);
-    return nil;
+static void FIRCLSFileJSONCopierBoolean(void* context, bool value) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileJSONCopierValueProlog(copier);
+  FIRCLSFileWriteBool(copier->file, value);
+  FIRCLSFileWriteCollectionEntryEpilog(copier->file);
+}
+
+static void FIRCLSFileJSONCopierNull(void* context) {
+  FIRCLSFileJSONCopier* copier = context;
+
+  FIRCLSFileJSONCopierValueProlog(copier);
+  FIRCLSFileWriteToFileDescriptorOrBuffer(copier->file, "null", 4);
+  FIRCLSFileWriteCollectionEntryEpilog(copier->file);
+}
+
+bool FIRCLSFileWriteHashEntryJSONDocument(FIRCLSFile* file,
+                                          const char* key,
+                                          const char* json,
+                                          size_t length) {
+  static const FIRCLSSectionReaderCallbacks callbacks = {
+      .beginObject = FIRCLSFileJSONCopierBeginObject,
+      .endObject = FIRCLSFileJSONCopierEndContainer,
+      .beginArray = FIRCLSFileJSONCopierBeginArray,
+      .endArray = FIRCLSFileJSONCopierEndContainer,
+      .key = FIRCLSFileJSONCopierKey,
+      .string = FIRCLSFileJSONCopierString,
+      .number = FIRCLSFileJSONCopierNumber,
+      .boolean = FIRCLSFileJSONCopierBoolean,
+      .null = FIRCLSFileJSONCopierNull,
+  };
+  FIRCLSFileJSONCopier copier = {.file = file};
+
+  FIRCLSFileWriteHashKey(file, key);
+  // the document's value follows this key, just like any value inside of it would
+  copier.keyPending = true;
+
+  const bool valid = FIRCLSSectionReaderReadDocument(json, length, &callbacks, &copier);
+
+  // Close off anything left open by an error, giving a dangling key a null value.
+  if (copier.keyPending) {
+    FIRCLSFileWriteToFileDescriptorOrBuffer(file, "null", 4);
+  }
+
+  while (copier.depth > 0) {
+    FIRCLSFileJSONCopierEndContainer(&copier);
+  }
+
+  FIRCLSFileWriteCollectionEntryEpilog(file);
+
+  return valid;
+}
+
+#pragma mark - Reading
+
+// Builds Foundation objects for each section straight from the section reader callbacks, so that
+// the file never has to be loaded into an NSString and split up, and no per-line NSData is needed.
+@interface FIRCLSFileSectionBuilder : NSObject {
+ @public
+  NSMutableArray* _sections;
+  NSMutableArray* _containers;
+  NSMutableArray<NSString*>* _keys;
+  id _root;
+  BOOL _failed;
+  NSObject* (^_transformer)(id obj);
+}
+@end
+
+@implementation FIRCLSFileSectionBuilder
+@end
+
+static void FIRCLSFileSectionBuilderAddValue(FIRCLSFileSectionBuilder* builder, id value) {
+  if (!value) {
+    builder->_failed = YES;
+    return;
+  }
+
+  id container = [builder->_containers lastObject];
+  if (!container) {
+    builder->_root = value;
+  } else if ([container isKindOfClass:[NSMutableDictionary class]]) {
+    NSString* key = [builder->_keys lastObject];
+    if (key) {
+      [(NSMutableDictionary*)container setObject:value forKey:key];
+      [builder->_keys removeLastObject];
+    }
+  } else {
+    [(NSMutableArray*)container addObject:value];
   }
+}
+
+static void FIRCLSFileSectionBeginObject(void* context) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+  NSMutableDictionary* dictionary = [NSMutableDictionary dictionary];
+
+  FIRCLSFileSectionBuilderAddValue(builder, dictionary);
+  [builder->_containers addObject:dictionary];
+}
 
+static void FIRCLSFileSectionBeginArray(void* context) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
   NSMutableArray* array = [NSMutableArray array];
 
-  // loop through all the entries, and
-  for (NSString* component in components) {
-    NSData* data = [component dataUsingEncoding:NSUTF8StringEncoding];
+  FIRCLSFileSectionBuilderAddValue(builder, array);
+  [builder->_containers addObject:array];
+}
 
-    id obj = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-    if (!obj) {
-      continue;
+static void FIRCLSFileSectionEndContainer(void* context) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+
+  [builder->_containers removeLastObject];
+}
+
+static void FIRCLSFileSectionKey(void* context, const char* key, size_t length) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+  NSString* string = [[NSString alloc] initWithBytes:key
+                                              length:length
+                                            encoding:NSUTF8StringEncoding];
+
+  if (!string) {
+    builder->_failed = YES;
+    return;
+  }
+
+  [builder->_keys addObject:string];
+}
+
+static void FIRCLSFileSectionString(void* context, const char* value, size_t length) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+
+  FIRCLSFileSectionBuilderAddValue(
+      builder, [[NSString alloc] initWithBytes:value length:length encoding:NSUTF8StringEncoding]);
+}
+
+static void FIRCLSFileSectionNumber(void* context, const FIRCLSSectionReaderNumber* number) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+  NSNumber* value;
+
+  if (!number->isInteger) {
+    value = [NSNumber numberWithDouble:number->value];
+  } else if (number->isNegative) {
+    value = [NSNumber numberWithLongLong:(long long)(0 - number->magnitude)];
+  } else {
+    value = [NSNumber numberWithUnsignedLongLong:number->magnitude];
+  }
+
+  FIRCLSFileSectionBuilderAddValue(builder, value);
+}
+
+static void FIRCLSFileSectionBoolean(void* context, bool value) {
+  FIRCLSFileSectionBuilderAddValue((__bridge FIRCLSFileSectionBuilder*)context,
+                                   [NSNumber numberWithBool:value]);
+}
+
+static void FIRCLSFileSectionNull(void* context) {
+  FIRCLSFileSectionBuilderAddValue((__bridge FIRCLSFileSectionBuilder*)context, [NSNull null]);
+}
+
+static bool FIRCLSFileSectionEnd(void* context, size_t lineNumber, bool valid) {
+  FIRCLSFileSectionBuilder* builder = (__bridge FIRCLSFileSectionBuilder*)context;
+  id obj = builder->_root;
+
+  if (valid && !builder->_failed && obj) {
+    if (builder->_transformer) {
+      obj = builder->_transformer(obj);
     }
 
-    if (transformer) {
-      obj = transformer(obj);
+    if (obj) {
+      [builder->_sections addObject:obj];
     }
+  }
 
-    if (!obj) {
-      continue;
+  builder->_root = nil;
+  builder->_failed = NO;
+  [builder->_containers removeAllObjects];
+  [builder->_keys removeAllObjects];
+
+  return true;
+}
+
+NSArray* FIRCLSFileReadSections(const char* path,
+                                bool deleteOnFailure,
+                                NSObject* (^transformer)(id obj)) {
+  static const FIRCLSSectionReaderCallbacks callbacks = {
+      .beginObject = FIRCLSFileSectionBeginObject,
+      .endObject = FIRCLSFileSectionEndContainer,
+      .beginArray = FIRCLSFileSectionBeginArray,
+      .endArray = FIRCLSFileSectionEndContainer,
+      .key = FIRCLSFileSectionKey,
+      .string = FIRCLSFileSectionString,
+      .number = FIRCLSFileSectionNumber,
+      .boolean = FIRCLSFileSectionBoolean,
+      .null = FIRCLSFileSectionNull,
+      .endSection = FIRCLSFileSectionEnd,
+  };
+
+  if (!FIRCLSIsValidPointer(path)) {
+    FIRCLSSDKLogError("Error: input path is invalid\n");
+    return nil;
+  }
+
+  FIRCLSFileSectionBuilder* builder = [[FIRCLSFileSectionBuilder alloc] init];
+  builder->_sections = [NSMutableArray array];
+  builder->_containers = [NSMutableArray array];
+  builder->_keys = [NSMutableArray array];
+  builder->_transformer = transformer;
+
+  if (!FIRCLSSectionReaderReadFile(path, &callbacks, (__bridge void*)builder)) {
+    if (deleteOnFailure) {
+      unlink(path);
     }
 
-    [array addObject:obj];
+    FIRCLSSDKLog("Unable to read file %s\n", path);
+    return nil;
   }
 
-  return array;
+  return builder->_sections;
 }
 
 NSString* FIRCLSFileHexEncodeString(const char* string) {
@@ -693,27 +1037,13 @@ NSString* FIRCLSFileHexEncodeString(const char* string) {
 
 NSString* FIRCLSFileHexDecodeString(const char* string) {
   size_t length = strlen(string);
-  char* decodedBuffer = calloc(1, length);  // too long, but safe
+  char* decodedBuffer = calloc(1, length / 2 + 1);
   if (!decodedBuffer) {
     FIRCLSErrorLog(@"Unable to calloc in FIRCLSFileHexDecodeString");
     return nil;
   }
 
-  memset(decodedBuffer, 0, length);
-
-  for (int i = 0; i < length / 2; ++i) {
-    size_t index = i * 2;
-
-    uint8_t hiNybble = FIRCLSNybbleFromChar(string[index]);
-    uint8_t lowNybble = FIRCLSNybbleFromChar(string[index + 1]);
-
-    if (hiNybble == FIRCLSInvalidCharNybble || lowNybble == FIRCLSInvalidCharNybble) {
-      // char is invalid, abort loop
-      break;
-    }
-
-    decodedBuffer[i] = (hiNybble << 4) | lowNybble;
-  }
+  FIRCLSSectionReaderHexDecode(string, length, decodedBuffer, length / 2);
 
   NSString* strObject = [NSString stringWithUTF8String:decodedBuffer];
 
@@ -13,19 +13,80 @@
 // limitations under the License.
 
 #include <dispatch/dispatch.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSInternalLogging.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSContext.h"
 #include "Crashlytics/Crashlytics/Components/FIRCLSGlobals.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSUtility.h"
 
+#define CLS_INTERNAL_LOGGING_RECORD_COUNT (128)
+#define CLS_INTERNAL_LOGGING_ARGUMENT_COUNT (8)
+#define CLS_INTERNAL_LOGGING_STRING_CAPACITY (128)
+// Long enough to batch up a burst of logging, like an unwind, into a single write pass.
+#define CLS_INTERNAL_LOGGING_FLUSH_DELAY_NS (100 * NSEC_PER_MSEC)
+
+#define CLS_INTERNAL_LOGGING_STRING_MISSING UINT64_MAX
+
+// Arguments are captured as raw 64-bit values, except for strings, which are copied into the
+// record and captured as an offset into it.
+typedef struct {
+  _Atomic uint64_t sequence;
+  const char* format;
+  uint32_t argumentCount;
+  uint64_t arguments[CLS_INTERNAL_LOGGING_ARGUMENT_COUNT];
+  char strings[CLS_INTERNAL_LOGGING_STRING_CAPACITY];
+} FIRCLSInternalLogRecord;
+
+// A bounded multi-producer, single-consumer ring. A record's sequence equals its position while it
+// is free, and its position + 1 once a writer has finished filling it in.
+static struct {
+  FIRCLSInternalLogRecord records[CLS_INTERNAL_LOGGING_RECORD_COUNT];
+  _Atomic uint64_t head;
+  _Atomic uint64_t tail;
+  _Atomic uint64_t dropped;
+  atomic_bool flushing;
+  atomic_bool flushScheduled;
+  atomic_bool initialized;
+} _firclsInternalLog;
+
+static bool FIRCLSSDKFileLogCapture(FIRCLSInternalLogRecord* record,
+                                    const char* format,
+                                    va_list args);
+static void FIRCLSSDKFileLogScheduleFlush(void);
+static void FIRCLSSDKFileLogFlushFunction(void* context);
+static void FIRCLSSDKFileLogWriteRecord(int fd, const FIRCLSInternalLogRecord* record);
+
+// Runs during context initialization rather than lazily, since the first log call may come from a
+// crash handler, where neither dispatch_once nor open are safe to start.
+void FIRCLSSDKFileLogInitialize(void) {
+  atomic_store_explicit(&_firclsInternalLog.initialized, false, memory_order_release);
+
+  for (uint64_t i = 0; i < CLS_INTERNAL_LOGGING_RECORD_COUNT; ++i) {
+    atomic_store_explicit(&_firclsInternalLog.records[i].sequence, i, memory_order_relaxed);
+  }
+  atomic_store_explicit(&_firclsInternalLog.head, 0, memory_order_relaxed);
+  atomic_store_explicit(&_firclsInternalLog.tail, 0, memory_order_relaxed);
+  atomic_store_explicit(&_firclsInternalLog.dropped, 0, memory_order_relaxed);
+
+  if (_firclsContext.writable->internalLogging.logFd == -1) {
+    _firclsContext.writable->internalLogging.logFd =
+        open(_firclsContext.readonly->logPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  }
+
+  atomic_store_explicit(&_firclsInternalLog.initialized, true, memory_order_release);
+}
+
 void FIRCLSSDKFileLog(FIRCLSInternalLogLevel level, const char* format, ...) {
   if (!_firclsContext.readonly || !_firclsContext.writable) {
     return;
   }
 
-  const char* path = _firclsContext.readonly->logPath;
-  if (!FIRCLSIsValidPointer(path)) {
+  if (!FIRCLSIsValidPointer(_firclsContext.readonly->logPath)) {
     return;
   }
 
@@ -33,62 +94,258 @@ void FIRCLSSDKFileLog(FIRCLSInternalLogLevel level, const char* format, ...) {
     return;
   }
 
-  static dispatch_once_t onceToken;
-  dispatch_once(&onceToken, ^{
-    if (_firclsContext.writable->internalLogging.logFd == -1) {
-      _firclsContext.writable->internalLogging.logFd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
-    }
-  });
-
-  const int fd = _firclsContext.writable->internalLogging.logFd;
-  if (fd < 0) {
+  if (!atomic_load_explicit(&_firclsInternalLog.initialized, memory_order_acquire)) {
     return;
   }
 
+  FIRCLSInternalLogRecord* record = NULL;
+  bool flushed = false;
+  uint64_t position = atomic_load_explicit(&_firclsInternalLog.head, memory_order_relaxed);
+  for (;;) {
+    record = &_firclsInternalLog.records[position % CLS_INTERNAL_LOGGING_RECORD_COUNT];
+    const uint64_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+
+    if (sequence == position) {
+      if (atomic_compare_exchange_weak_explicit(&_firclsInternalLog.head, &position, position + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (sequence < position) {
+      // The reader hasn't caught up. Never wait here, since this may be running in a crash handler.
+      // In that case, though, nothing else is running, so it's safe to make room by flushing.
+      if (_firclsContext.writable->crashOccurred && !flushed) {
+        FIRCLSSDKFileLogFlush();
+        flushed = true;
+        position = atomic_load_explicit(&_firclsInternalLog.head, memory_order_relaxed);
+        continue;
+      }
+
+      atomic_fetch_add_explicit(&_firclsInternalLog.dropped, 1, memory_order_relaxed);
+      FIRCLSSDKFileLogScheduleFlush();
+      return;
+    } else {
+      position = atomic_load_explicit(&_firclsInternalLog.head, memory_order_relaxed);
+    }
+  }
+
   va_list args;
   va_start(args, format);
+  if (!FIRCLSSDKFileLogCapture(record, format, args)) {
+    // Too many arguments to defer. Keep the format, so there is still a trace of the call.
+    record->argumentCount = 0;
+    record->format = format;
+  }
+  va_end(args);
+
+  atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+
+  FIRCLSSDKFileLogScheduleFlush();
+}
+
+// Walks the format the same way FIRCLSSDKFileLogWriteRecord does, so that it knows how to pull
+// each argument off of the list.
+static bool FIRCLSSDKFileLogCapture(FIRCLSInternalLogRecord* record,
+                                    const char* format,
+                                    va_list args) {
+  size_t stringsUsed = 0;
+
+  record->format = format;
+  record->argumentCount = 0;
+
+  for (const char* c = format; *c != '\0'; ++c) {
+    if (*c != '%') {
+      continue;
+    }
+
+    c++;  // move to the format char
+    if (*c == '\0') {
+      break;
+    }
+
+    uint64_t value = 0;
+    switch (*c) {
+      case 'd':
+        value = (uint64_t)(int64_t)va_arg(args, int);
+        break;
+      case 'u':
+        value = va_arg(args, uint32_t);
+        break;
+      case 'p':
+        value = va_arg(args, uintptr_t);
+        break;
+      case 'x':
+        value = va_arg(args, unsigned int);
+        break;
+      case 's': {
+        const char* string = va_arg(args, const char*);
+        if (!string) {
+          string = "(null)";
+        }
+
+        if (stringsUsed >= CLS_INTERNAL_LOGGING_STRING_CAPACITY) {
+          value = CLS_INTERNAL_LOGGING_STRING_MISSING;
+          break;
+        }
+
+        value = stringsUsed;
+        const size_t available = CLS_INTERNAL_LOGGING_STRING_CAPACITY - stringsUsed - 1;
+        size_t length = strnlen(string, available);
+        memcpy(&record->strings[stringsUsed], string, length);
+        record->strings[stringsUsed + length] = '\0';
+        stringsUsed += length + 1;
+      } break;
+      default:
+        // doesn't consume an argument
+        continue;
+    }
+
+    if (record->argumentCount >= CLS_INTERNAL_LOGGING_ARGUMENT_COUNT) {
+      return false;
+    }
+
+    record->arguments[record->argumentCount++] = value;
+  }
+
+  return true;
+}
+
+// Formatting and writing is left to a single reader, off of the logging thread. Once a crash has
+// happened, there's no dispatching, and the crash handler flushes instead.
+static void FIRCLSSDKFileLogScheduleFlush(void) {
+  if (_firclsContext.writable->crashOccurred) {
+    return;
+  }
+
+  dispatch_queue_t queue = FIRCLSGetLoggingQueue();
+  if (!queue) {
+    return;
+  }
+
+  if (atomic_exchange_explicit(&_firclsInternalLog.flushScheduled, true, memory_order_acq_rel)) {
+    return;
+  }
+
+  dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, CLS_INTERNAL_LOGGING_FLUSH_DELAY_NS), queue,
+                   NULL, FIRCLSSDKFileLogFlushFunction);
+}
+
+static void FIRCLSSDKFileLogFlushFunction(void* context) {
+  atomic_store_explicit(&_firclsInternalLog.flushScheduled, false, memory_order_release);
+
+  FIRCLSSDKFileLogFlush();
+}
+
+void FIRCLSSDKFileLogFlush(void) {
+  if (!_firclsContext.readonly || !_firclsContext.writable) {
+    return;
+  }
+
+  if (!FIRCLSIsValidPointer(_firclsContext.readonly->logPath)) {
+    return;
+  }
+
+  if (!atomic_load_explicit(&_firclsInternalLog.initialized, memory_order_acquire)) {
+    return;
+  }
+
+  // During a crash, every other thread is suspended, possibly in the middle of a flush or of
+  // writing a record. Skip past both, since they will never finish.
+  const bool crashed = FIRCLSContextHasCrashed();
+  if (atomic_exchange_explicit(&_firclsInternalLog.flushing, true, memory_order_acquire) &&
+      !crashed) {
+    return;
+  }
+
+  const int fd = _firclsContext.writable->internalLogging.logFd;
+
+  uint64_t position = atomic_load_explicit(&_firclsInternalLog.tail, memory_order_relaxed);
+  const uint64_t head = atomic_load_explicit(&_firclsInternalLog.head, memory_order_relaxed);
+  for (; position < head; ++position) {
+    FIRCLSInternalLogRecord* record =
+        &_firclsInternalLog.records[position % CLS_INTERNAL_LOGGING_RECORD_COUNT];
+    const uint64_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+
+    if (sequence != position + 1) {
+      if (crashed) {
+        continue;
+      }
+
+      break;
+    }
+
+    if (fd >= 0) {
+      FIRCLSSDKFileLogWriteRecord(fd, record);
+    }
+
+    atomic_store_explicit(&record->sequence, position + CLS_INTERNAL_LOGGING_RECORD_COUNT,
+                          memory_order_release);
+  }
+
+  atomic_store_explicit(&_firclsInternalLog.tail, position, memory_order_relaxed);
+
+  const uint64_t dropped = atomic_exchange_explicit(&_firclsInternalLog.dropped, 0,
+                                                    memory_order_relaxed);
+  if (dropped > 0 && fd >= 0) {
+    const char* message = "WARN  [FIRCLSSDKFileLogFlush] dropped ";
+    write(fd, message, strlen(message));
+    FIRCLSFileFDWriteUInt64(fd, dropped, false);
+    write(fd, " records\n", 9);
+  }
+
+  atomic_store_explicit(&_firclsInternalLog.flushing, false, memory_order_release);
+}
+
+static void FIRCLSSDKFileLogWriteRecord(int fd, const FIRCLSInternalLogRecord* record) {
+  const char* format = record->format;
+  uint32_t argumentIndex = 0;
 
-#if DEBUG && 0
-  // It's nice to use printf here, so all the formatting works. However, its possible to hit a
-  // deadlock if you call vfprintf in a crash handler. So, this code is handy to keep, just in case,
-  // if there's a really tough thing to debug.
-  FILE* file = fopen(path, "a+");
-  vfprintf(file, format, args);
-  fclose(file);
-#else
   size_t formatLength = strlen(format);
   for (size_t idx = 0; idx < formatLength; ++idx) {
     if (format[idx] != '%') {
-      write(fd, &format[idx], 1);
+      // write out runs of literal text at once
+      size_t end = idx;
+      while (end < formatLength && format[end] != '%') {
+        end++;
+      }
+
+      write(fd, &format[idx], end - idx);
+      idx = end - 1;
       continue;
     }
 
     idx++;  // move to the format char
+    if (idx >= formatLength) {
+      write(fd, "%", 1);
+      break;
+    }
+
+    const bool consumesArgument = strchr("dupsx", format[idx]) != NULL;
+    if (consumesArgument && argumentIndex >= record->argumentCount) {
+      write(fd, &format[idx - 1], 2);
+      continue;
+    }
+
     switch (format[idx]) {
-      case 'd': {
-        int value = va_arg(args, int);
-        FIRCLSFileFDWriteInt64(fd, value);
-      } break;
-      case 'u': {
-        uint32_t value = va_arg(args, uint32_t);
-        FIRCLSFileFDWriteUInt64(fd, value, false);
-      } break;
-      case 'p': {
-        uintptr_t value = va_arg(args, uintptr_t);
+      case 'd':
+        FIRCLSFileFDWriteInt64(fd, (int64_t)record->arguments[argumentIndex++]);
+        break;
+      case 'u':
+      case 'x':
+        FIRCLSFileFDWriteUInt64(fd, record->arguments[argumentIndex++], format[idx] == 'x');
+        break;
+      case 'p':
         write(fd, "0x", 2);
-        FIRCLSFileFDWriteUInt64(fd, value, true);
-      } break;
+        FIRCLSFileFDWriteUInt64(fd, record->arguments[argumentIndex++], true);
+        break;
       case 's': {
-        const char* string = va_arg(args, const char*);
-        if (!string) {
-          string = "(null)";
+        const uint64_t offset = record->arguments[argumentIndex++];
+        if (offset >= CLS_INTERNAL_LOGGING_STRING_CAPACITY) {
+          write(fd, "...", 3);
+          break;
         }
 
-        write(fd, string, strlen(string));
-      } break;
-      case 'x': {
-        unsigned int value = va_arg(args, unsigned int);
-        FIRCLSFileFDWriteUInt64(fd, value, true);
+        const char* string = &record->strings[offset];
+        write(fd, string, strnlen(string, CLS_INTERNAL_LOGGING_STRING_CAPACITY - offset));
       } break;
       default:
         // unhandled, back up to write out the percent + the format char
@@ -96,6 +353,4 @@ void FIRCLSSDKFileLog(FIRCLSInternalLogLevel level, const char* format, ...) {
         break;
     }
   }
-#endif
-  va_end(args);
 }
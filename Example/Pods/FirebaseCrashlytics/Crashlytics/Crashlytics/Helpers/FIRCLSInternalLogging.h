@@ -35,23 +35,56 @@ typedef struct {
   FIRCLSInternalLogLevel logLevel;
 } FIRCLSInternalLoggingWritableContext;
 
+// Calls below this level are compiled out entirely. The value must be a plain integer, matching
+// FIRCLSInternalLogLevel, so that the preprocessor can compare it.
+#ifndef CLS_INTERNAL_LOGGING_MINIMUM_LEVEL
+#define CLS_INTERNAL_LOGGING_MINIMUM_LEVEL 1
+#endif
+
+#if CLS_INTERNAL_LOGGING_MINIMUM_LEVEL <= 1
 #define FIRCLSSDKLogDebug(__FORMAT__, ...)                                                 \
   FIRCLSSDKFileLog(FIRCLSInternalLogLevelDebug, "DEBUG [%s:%d] " __FORMAT__, __FUNCTION__, \
                    __LINE__, ##__VA_ARGS__)
+#else
+#define FIRCLSSDKLogDebug(__FORMAT__, ...) ((void)0)
+#endif
+#if CLS_INTERNAL_LOGGING_MINIMUM_LEVEL <= 2
 #define FIRCLSSDKLogInfo(__FORMAT__, ...)                                                 \
   FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "INFO  [%s:%d] " __FORMAT__, __FUNCTION__, \
                    __LINE__, ##__VA_ARGS__)
+#else
+#define FIRCLSSDKLogInfo(__FORMAT__, ...) ((void)0)
+#endif
+#if CLS_INTERNAL_LOGGING_MINIMUM_LEVEL <= 3
 #define FIRCLSSDKLogWarn(__FORMAT__, ...)                                                 \
   FIRCLSSDKFileLog(FIRCLSInternalLogLevelWarn, "WARN  [%s:%d] " __FORMAT__, __FUNCTION__, \
                    __LINE__, ##__VA_ARGS__)
+#else
+#define FIRCLSSDKLogWarn(__FORMAT__, ...) ((void)0)
+#endif
+#if CLS_INTERNAL_LOGGING_MINIMUM_LEVEL <= 4
 #define FIRCLSSDKLogError(__FORMAT__, ...)                                                 \
   FIRCLSSDKFileLog(FIRCLSInternalLogLevelError, "ERROR [%s:%d] " __FORMAT__, __FUNCTION__, \
                    __LINE__, ##__VA_ARGS__)
+#else
+#define FIRCLSSDKLogError(__FORMAT__, ...) ((void)0)
+#endif
 
 #define FIRCLSSDKLog FIRCLSSDKLogWarn
 
 __BEGIN_DECLS
 
+// Resets the ring and opens the log file. Must be called once the context's log path is set, and
+// before anything logs, since crash handlers can only read this state, not set it up.
+void FIRCLSSDKFileLogInitialize(void);
+
+// Records the format and its arguments into an in-memory ring, without formatting or writing
+// anything. The format must be a string literal, since only the pointer is kept. Strings passed for
+// %s are copied, and may be truncated.
 void FIRCLSSDKFileLog(FIRCLSInternalLogLevel level, const char* format, ...) __printflike(2, 3);
 
+// Formats every complete record in the ring and writes it to the log file. Writers schedule this
+// on their own outside of a crash. Crash handlers call it once they have finished recording.
+void FIRCLSSDKFileLogFlush(void);
+
 __END_DECLS
@@ -0,0 +1,675 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSSectionReader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+  const char* cursor;
+  const char* end;
+  const FIRCLSSectionReaderCallbacks* callbacks;
+  void* context;
+
+  uint32_t maximumDepth;
+  // true for whole documents, which may span lines
+  bool newlinesAreWhitespace;
+
+  // only used for strings that contain escapes
+  char* scratch;
+  size_t scratchLength;
+
+  // One bit per open container, set for objects and clear for arrays.  Containers are tracked
+  // here rather than on the call stack, so that deep documents can't overflow it.
+  uint8_t* containers;
+  size_t containersLength;
+} FIRCLSSectionReader;
+
+static void FIRCLSSectionReaderSkipWhitespace(FIRCLSSectionReader* reader) {
+  while (reader->cursor < reader->end) {
+    switch (*reader->cursor) {
+      case ' ':
+      case '\t':
+      case '\r':
+        reader->cursor++;
+        break;
+      case '\n':
+        if (!reader->newlinesAreWhitespace) {
+          return;
+        }
+
+        reader->cursor++;
+        break;
+      default:
+        return;
+    }
+  }
+}
+
+static bool FIRCLSSectionReaderConsume(FIRCLSSectionReader* reader, char c) {
+  FIRCLSSectionReaderSkipWhitespace(reader);
+
+  if (reader->cursor >= reader->end || *reader->cursor != c) {
+    return false;
+  }
+
+  reader->cursor++;
+  return true;
+}
+
+static bool FIRCLSSectionReaderReserveScratch(FIRCLSSectionReader* reader, size_t length) {
+  if (reader->scratchLength >= length) {
+    return true;
+  }
+
+  char* scratch = realloc(reader->scratch, length);
+  if (!scratch) {
+    return false;
+  }
+
+  reader->scratch = scratch;
+  reader->scratchLength = length;
+
+  return true;
+}
+
+static int FIRCLSSectionReaderNybble(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool FIRCLSSectionReaderParseCodeUnit(const char* p, const char* end, uint32_t* unit) {
+  if (end - p < 4) {
+    return false;
+  }
+
+  *unit = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int nybble = FIRCLSSectionReaderNybble(p[i]);
+    if (nybble < 0) {
+      return false;
+    }
+    *unit = (*unit << 4) | (uint32_t)nybble;
+  }
+
+  return true;
+}
+
+static size_t FIRCLSSectionReaderWriteUTF8(char* output, uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    output[0] = (char)codepoint;
+    return 1;
+  }
+  if (codepoint < 0x800) {
+    output[0] = (char)(0xC0 | (codepoint >> 6));
+    output[1] = (char)(0x80 | (codepoint & 0x3F));
+    return 2;
+  }
+  if (codepoint < 0x10000) {
+    output[0] = (char)(0xE0 | (codepoint >> 12));
+    output[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    output[2] = (char)(0x80 | (codepoint & 0x3F));
+    return 3;
+  }
+  output[0] = (char)(0xF0 | (codepoint >> 18));
+  output[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+  output[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+  output[3] = (char)(0x80 | (codepoint & 0x3F));
+  return 4;
+}
+
+// Expects the cursor to be just past the opening quote.  Strings without escapes, which is nearly
+// all of them, are returned in place.
+static bool FIRCLSSectionReaderParseString(FIRCLSSectionReader* reader,
+                                           const char** value,
+                                           size_t* length) {
+  const char* start = reader->cursor;
+  const char* p = start;
+  bool hasEscapes = false;
+
+  while (p < reader->end && *p != '"') {
+    if (*p == '\\') {
+      hasEscapes = true;
+      p++;
+    }
+    p++;
+  }
+
+  if (p >= reader->end) {
+    return false;
+  }
+
+  reader->cursor = p + 1;
+
+  if (!hasEscapes) {
+    *value = start;
+    *length = (size_t)(p - start);
+    return true;
+  }
+
+  // Unescaping never makes a string longer.  A \uXXXX escape is 6 bytes and produces at most 3,
+  // and a surrogate pair is 12 bytes and produces 4.
+  if (!FIRCLSSectionReaderReserveScratch(reader, (size_t)(p - start))) {
+    return false;
+  }
+
+  const char* end = p;
+  char* output = reader->scratch;
+
+  for (p = start; p < end; ++p) {
+    if (*p != '\\') {
+      *output++ = *p;
+      continue;
+    }
+
+    if (++p >= end) {
+      return false;
+    }
+
+    switch (*p) {
+      case '"':
+      case '\\':
+      case '/':
+        *output++ = *p;
+        break;
+      case 'b':
+        *output++ = '\b';
+        break;
+      case 'f':
+        *output++ = '\f';
+        break;
+      case 'n':
+        *output++ = '\n';
+        break;
+      case 'r':
+        *output++ = '\r';
+        break;
+      case 't':
+        *output++ = '\t';
+        break;
+      case 'u': {
+        uint32_t codepoint;
+        if (!FIRCLSSectionReaderParseCodeUnit(p + 1, end, &codepoint)) {
+          return false;
+        }
+        p += 4;
+
+        uint32_t low;
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF && end - p > 6 && p[1] == '\\' &&
+            p[2] == 'u' && FIRCLSSectionReaderParseCodeUnit(p + 3, end, &low) && low >= 0xDC00 &&
+            low <= 0xDFFF) {
+          codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          p += 6;
+        }
+
+        output += FIRCLSSectionReaderWriteUTF8(output, codepoint);
+      } break;
+      default:
+        return false;
+    }
+  }
+
+  *value = reader->scratch;
+  *length = (size_t)(output - reader->scratch);
+
+  return true;
+}
+
+static bool FIRCLSSectionReaderParseNumber(FIRCLSSectionReader* reader) {
+  FIRCLSSectionReaderNumber number = {.isInteger = true};
+  const char* start = reader->cursor;
+  const char* p = start;
+
+  if (p < reader->end && *p == '-') {
+    number.isNegative = true;
+    p++;
+  }
+
+  const char* digits = p;
+  while (p < reader->end && *p >= '0' && *p <= '9') {
+    const uint64_t digit = (uint64_t)(*p - '0');
+
+    if (number.magnitude > (UINT64_MAX - digit) / 10) {
+      number.isInteger = false;
+    } else {
+      number.magnitude = number.magnitude * 10 + digit;
+    }
+    p++;
+  }
+
+  if (p == digits) {
+    return false;
+  }
+
+  // A fraction or an exponent needs at least one digit, so that a number cut off by a truncated
+  // write isn't taken as a complete one.
+  if (p < reader->end && *p == '.') {
+    number.isInteger = false;
+    p++;
+    const char* fraction = p;
+    while (p < reader->end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+    if (p == fraction) {
+      return false;
+    }
+  }
+
+  if (p < reader->end && (*p == 'e' || *p == 'E')) {
+    number.isInteger = false;
+    p++;
+    if (p < reader->end && (*p == '+' || *p == '-')) {
+      p++;
+    }
+    const char* exponent = p;
+    while (p < reader->end && *p >= '0' && *p <= '9') {
+      p++;
+    }
+    if (p == exponent) {
+      return false;
+    }
+  }
+
+  // Negative integers must fit in an int64_t
+  if (number.isInteger && number.isNegative && number.magnitude > (uint64_t)INT64_MAX + 1) {
+    number.isInteger = false;
+  }
+
+  if (number.isInteger) {
+    number.value = (double)number.magnitude;
+    if (number.isNegative) {
+      number.value = -number.value;
+    }
+  } else {
+    // strtod needs a terminated string, and numbers are always short
+    char buffer[64];
+    const size_t length = (size_t)(p - start);
+
+    if (length >= sizeof(buffer)) {
+      return false;
+    }
+
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    number.value = strtod(buffer, NULL);
+  }
+
+  reader->cursor = p;
+
+  if (reader->callbacks->number) {
+    reader->callbacks->number(reader->context, &number);
+  }
+
+  return true;
+}
+
+static bool FIRCLSSectionReaderParseLiteral(FIRCLSSectionReader* reader, const char* literal) {
+  const size_t length = strlen(literal);
+
+  if ((size_t)(reader->end - reader->cursor) < length ||
+      memcmp(reader->cursor, literal, length) != 0) {
+    return false;
+  }
+
+  reader->cursor += length;
+
+  return true;
+}
+
+static bool FIRCLSSectionReaderPushContainer(FIRCLSSectionReader* reader,
+                                             uint32_t depth,
+                                             bool isObject) {
+  const size_t index = depth / 8;
+
+  if (index >= reader->containersLength) {
+    const size_t length = reader->containersLength == 0 ? 16 : reader->containersLength * 2;
+    uint8_t* containers = realloc(reader->containers, length);
+    if (!containers) {
+      return false;
+    }
+
+    reader->containers = containers;
+    reader->containersLength = length;
+  }
+
+  const uint8_t bit = (uint8_t)(1u << (depth % 8));
+  if (isObject) {
+    reader->containers[index] |= bit;
+  } else {
+    reader->containers[index] &= (uint8_t)~bit;
+  }
+
+  return true;
+}
+
+static bool FIRCLSSectionReaderContainerIsObject(FIRCLSSectionReader* reader, uint32_t depth) {
+  return (reader->containers[depth / 8] >> (depth % 8)) & 1;
+}
+
+// Parses an object's key and the colon after it, leaving the cursor at its value.
+static bool FIRCLSSectionReaderParseKey(FIRCLSSectionReader* reader) {
+  const char* key;
+  size_t length;
+
+  if (!FIRCLSSectionReaderConsume(reader, '"') ||
+      !FIRCLSSectionReaderParseString(reader, &key, &length)) {
+    return false;
+  }
+
+  if (reader->callbacks->key) {
+    reader->callbacks->key(reader->context, key, length);
+  }
+
+  return FIRCLSSectionReaderConsume(reader, ':');
+}
+
+static void FIRCLSSectionReaderEndContainer(FIRCLSSectionReader* reader, bool isObject) {
+  if (isObject) {
+    if (reader->callbacks->endObject) {
+      reader->callbacks->endObject(reader->context);
+    }
+  } else if (reader->callbacks->endArray) {
+    reader->callbacks->endArray(reader->context);
+  }
+}
+
+static bool FIRCLSSectionReaderParseScalar(FIRCLSSectionReader* reader) {
+  switch (*reader->cursor) {
+    case '"': {
+      const char* value;
+      size_t length;
+
+      reader->cursor++;
+      if (!FIRCLSSectionReaderParseString(reader, &value, &length)) {
+        return false;
+      }
+
+      if (reader->callbacks->string) {
+        reader->callbacks->string(reader->context, value, length);
+      }
+      return true;
+    }
+    case 't':
+    case 'f': {
+      const bool value = *reader->cursor == 't';
+
+      if (!FIRCLSSectionReaderParseLiteral(reader, value ? "true" : "false")) {
+        return false;
+      }
+
+      if (reader->callbacks->boolean) {
+        reader->callbacks->boolean(reader->context, value);
+      }
+      return true;
+    }
+    case 'n':
+      if (!FIRCLSSectionReaderParseLiteral(reader, "null")) {
+        return false;
+      }
+
+      if (reader->callbacks->null) {
+        reader->callbacks->null(reader->context);
+      }
+      return true;
+    default:
+      return FIRCLSSectionReaderParseNumber(reader);
+  }
+}
+
+// Parses one value, and everything nested in it, without recursing.  depth is the number of
+// containers that are open, and a value can only be read while it is below maximumDepth.
+static bool FIRCLSSectionReaderParseValue(FIRCLSSectionReader* reader) {
+  uint32_t depth = 0;
+
+  for (;;) {
+    if (depth >= reader->maximumDepth) {
+      return false;
+    }
+
+    FIRCLSSectionReaderSkipWhitespace(reader);
+
+    if (reader->cursor >= reader->end) {
+      return false;
+    }
+
+    const char c = *reader->cursor;
+    if (c == '{' || c == '[') {
+      const bool isObject = c == '{';
+
+      reader->cursor++;
+      if (!FIRCLSSectionReaderPushContainer(reader, depth, isObject)) {
+        return false;
+      }
+
+      if (isObject && reader->callbacks->beginObject) {
+        reader->callbacks->beginObject(reader->context);
+      } else if (!isObject && reader->callbacks->beginArray) {
+        reader->callbacks->beginArray(reader->context);
+      }
+
+      depth++;
+
+      if (!FIRCLSSectionReaderConsume(reader, isObject ? '}' : ']')) {
+        // the container has a first value to read
+        if (isObject && !FIRCLSSectionReaderParseKey(reader)) {
+          return false;
+        }
+        continue;
+      }
+
+      // an empty container is ended right away
+      depth--;
+      FIRCLSSectionReaderEndContainer(reader, isObject);
+    } else if (!FIRCLSSectionReaderParseScalar(reader)) {
+      return false;
+    }
+
+    // A value has been read.  Close every container that ends after it, until one has another
+    // value to read.
+    for (;;) {
+      if (depth == 0) {
+        return true;
+      }
+
+      const bool isObject = FIRCLSSectionReaderContainerIsObject(reader, depth - 1);
+
+      if (FIRCLSSectionReaderConsume(reader, ',')) {
+        if (isObject && !FIRCLSSectionReaderParseKey(reader)) {
+          return false;
+        }
+        break;
+      }
+
+      if (!FIRCLSSectionReaderConsume(reader, isObject ? '}' : ']')) {
+        return false;
+      }
+
+      depth--;
+      FIRCLSSectionReaderEndContainer(reader, isObject);
+    }
+  }
+}
+
+bool FIRCLSSectionReaderReadBuffer(const char* buffer,
+                                   size_t length,
+                                   const FIRCLSSectionReaderCallbacks* callbacks,
+                                   void* context) {
+  FIRCLSSectionReader reader = {0};
+  const char* const bufferEnd = buffer + length;
+  const char* line = buffer;
+  size_t lineNumber = 0;
+
+  if (!callbacks) {
+    return false;
+  }
+
+  reader.callbacks = callbacks;
+  reader.context = context;
+  reader.maximumDepth = FIRCLSSectionReaderMaximumDepth;
+
+  while (line < bufferEnd) {
+    const char* lineEnd = memchr(line, '\n', (size_t)(bufferEnd - line));
+    if (!lineEnd) {
+      lineEnd = bufferEnd;
+    }
+
+    lineNumber++;
+
+    reader.cursor = line;
+    reader.end = lineEnd;
+    line = lineEnd + 1;
+
+    // Blank lines, like the one after the final newline, are not sections
+    FIRCLSSectionReaderSkipWhitespace(&reader);
+    if (reader.cursor >= reader.end) {
+      continue;
+    }
+
+    bool valid = FIRCLSSectionReaderParseValue(&reader);
+    if (valid) {
+      FIRCLSSectionReaderSkipWhitespace(&reader);
+      valid = reader.cursor == reader.end;
+    }
+
+    if (callbacks->endSection && !callbacks->endSection(context, lineNumber, valid)) {
+      break;
+    }
+  }
+
+  free(reader.scratch);
+  free(reader.containers);
+
+  return true;
+}
+
+bool FIRCLSSectionReaderReadDocument(const char* buffer,
+                                     size_t length,
+                                     const FIRCLSSectionReaderCallbacks* callbacks,
+                                     void* context) {
+  FIRCLSSectionReader reader = {0};
+
+  if (!buffer || !callbacks) {
+    return false;
+  }
+
+  reader.cursor = buffer;
+  reader.end = buffer + length;
+  reader.callbacks = callbacks;
+  reader.context = context;
+  reader.maximumDepth = FIRCLSSectionReaderMaximumDocumentDepth;
+  reader.newlinesAreWhitespace = true;
+
+  bool valid = FIRCLSSectionReaderParseValue(&reader);
+  if (valid) {
+    FIRCLSSectionReaderSkipWhitespace(&reader);
+    valid = reader.cursor == reader.end;
+  }
+
+  free(reader.scratch);
+  free(reader.containers);
+
+  return valid;
+}
+
+bool FIRCLSSectionReaderReadFile(const char* path,
+                                 const FIRCLSSectionReaderCallbacks* callbacks,
+                                 void* context) {
+  struct stat statBuffer;
+  size_t length = 0;
+  bool success;
+  char* buffer;
+  int fd;
+
+  if (!path) {
+    return false;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  if (fstat(fd, &statBuffer) != 0) {
+    close(fd);
+    return false;
+  }
+
+  if (statBuffer.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  // The file is read rather than mapped.  A mapped file that gets truncated underneath the
+  // reader, by a cleanup or a crash that ran out of disk, raises SIGBUS on the next read past its
+  // end.  Reading just stops early, and whatever was read is parsed, so a cut-off line is reported
+  // as invalid like any other.
+  buffer = malloc((size_t)statBuffer.st_size);
+  if (!buffer) {
+    close(fd);
+    return false;
+  }
+
+  while (length < (size_t)statBuffer.st_size) {
+    const ssize_t result = read(fd, buffer + length, (size_t)statBuffer.st_size - length);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      break;
+    }
+
+    length += (size_t)result;
+  }
+
+  close(fd);
+
+  success = FIRCLSSectionReaderReadBuffer(buffer, length, callbacks, context);
+
+  free(buffer);
+
+  return success;
+}
+
+size_t FIRCLSSectionReaderHexDecode(const char* hex,
+                                    size_t length,
+                                    char* output,
+                                    size_t outputLength) {
+  size_t written = 0;
+
+  for (size_t i = 0; i + 1 < length && written < outputLength; i += 2) {
+    const int high = FIRCLSSectionReaderNybble(hex[i]);
+    const int low = FIRCLSSectionReaderNybble(hex[i + 1]);
+
+    if (high < 0 || low < 0) {
+      break;
+    }
+
+    output[written++] = (char)((high << 4) | low);
+  }
+
+  return written;
+}
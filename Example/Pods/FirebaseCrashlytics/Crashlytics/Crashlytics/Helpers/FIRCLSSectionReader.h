@@ -0,0 +1,89 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// A single-pass reader for the line-delimited JSON files written by FIRCLSFile.  Each line is one
+// section.  The file is read into a single buffer, and every value is handed to a callback as it
+// is parsed, so no intermediate objects are built.  This file only depends on libc, so that it can
+// be built and exercised off-device.
+
+__BEGIN_DECLS
+
+#define FIRCLSSectionReaderMaximumDepth (64)
+// Documents from other sources nest much more deeply.  MetricKit's call stack trees take two
+// levels per frame, and the deepest stacks are the ones that matter.  Nesting isn't parsed
+// recursively, so this only bounds the memory used to track it, at one bit per level.
+#define FIRCLSSectionReaderMaximumDocumentDepth (1 << 20)
+
+typedef struct {
+  bool isInteger;
+  bool isNegative;
+  // Valid when isInteger is true.  The absolute value of the number.
+  uint64_t magnitude;
+  // Always valid.
+  double value;
+} FIRCLSSectionReaderNumber;
+
+// Strings and keys are unescaped, but not NUL-terminated.  They point either into the file's
+// buffer or into a scratch buffer, and are only valid for the duration of the callback.
+//
+// Any of the callbacks may be NULL.  Values from a line that turns out to be invalid will already
+// have been delivered when endSection is called with valid == false, so consumers should only
+// commit their state in endSection.  Returning false from endSection stops the read.
+typedef struct {
+  void (*beginObject)(void* context);
+  void (*endObject)(void* context);
+  void (*beginArray)(void* context);
+  void (*endArray)(void* context);
+  void (*key)(void* context, const char* key, size_t length);
+  void (*string)(void* context, const char* value, size_t length);
+  void (*number)(void* context, const FIRCLSSectionReaderNumber* number);
+  void (*boolean)(void* context, bool value);
+  void (*null)(void* context);
+  bool (*endSection)(void* context, size_t lineNumber, bool valid);
+} FIRCLSSectionReaderCallbacks;
+
+// Returns false only if the file could not be opened or read into memory.  An empty file has no
+// sections.  If the file is truncated while it is being read, only what was read is parsed.
+bool FIRCLSSectionReaderReadFile(const char* path,
+                                 const FIRCLSSectionReaderCallbacks* callbacks,
+                                 void* context);
+bool FIRCLSSectionReaderReadBuffer(const char* buffer,
+                                   size_t length,
+                                   const FIRCLSSectionReaderCallbacks* callbacks,
+                                   void* context);
+
+// Reads a single JSON value, which may span lines, such as a JSONRepresentation from MetricKit.
+// endSection is not called. Returns whether the whole buffer was a valid value. As with sections,
+// values before an error will already have been delivered.
+bool FIRCLSSectionReaderReadDocument(const char* buffer,
+                                     size_t length,
+                                     const FIRCLSSectionReaderCallbacks* callbacks,
+                                     void* context);
+
+// Decodes the hex strings written by FIRCLSFileWriteHashEntryHexEncodedString.  Decoding stops at
+// the first invalid character, or when the output is full.  Returns the number of bytes written.
+// Safe to call from within a callback, so hex fields can be decoded without an extra pass.
+size_t FIRCLSSectionReaderHexDecode(const char* hex,
+                                    size_t length,
+                                    char* output,
+                                    size_t outputLength);
+
+__END_DECLS
@@ -110,6 +110,10 @@ const char* FIRCLSDupString(const char* string) {
 
   length = strlen(string);
   buffer = FIRCLSAllocatorSafeAllocate(_firclsContext.allocator, length + 1, CLS_READONLY);
+  if (!buffer) {
+    FIRCLSSDKLog("Unable to duplicate string, allocator exhausted\n");
+    return NULL;
+  }
 
   memcpy(buffer, string, length);
 
@@ -84,6 +84,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property(nonatomic, readonly) BOOL metricKitCollectionEnabled;
 
+/**
+ * When this is true, crash reports include how long each stage of the crash handler took
+ */
+@property(nonatomic, readonly) BOOL crashTimingsEnabled;
+
 /**
  * Returns the maximum number of custom exception events that will be
  * recorded in a session.
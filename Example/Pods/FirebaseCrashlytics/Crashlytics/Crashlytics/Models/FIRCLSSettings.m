@@ -289,6 +289,18 @@ NSString *const AppVersion = @"app_version";
   return NO;
 }
 
+- (BOOL)crashTimingsEnabled {
+  // Off unless the backend asks for it, since it only does so once it can process the "timings"
+  // section of a crash report.
+  NSNumber *value = [self featuresSettings][@"collect_crash_timings"];
+
+  if (value != nil) {
+    return value.boolValue;
+  }
+
+  return NO;
+}
+
 #pragma mark - Optional Limit Overrides
 
 - (uint32_t)errorLogBufferSize {
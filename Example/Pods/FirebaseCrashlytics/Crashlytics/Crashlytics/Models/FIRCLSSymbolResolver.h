@@ -23,4 +23,8 @@
 - (FIRStackFrame *)frameForAddress:(uint64_t)address;
 - (BOOL)updateStackFrame:(FIRStackFrame *)frame;
 
+/// Symbolicates all of the frames in one pass, matching each referenced image against the loaded
+/// images only once. Returns the number of frames that were updated.
+- (NSUInteger)updateStackFrames:(NSArray<FIRStackFrame *> *)frames;
+
 @end
@@ -15,6 +15,7 @@
 #import "Crashlytics/Crashlytics/Models/FIRCLSSymbolResolver.h"
 
 #include <dlfcn.h>
+#include <stdatomic.h>
 
 #include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImage.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
@@ -22,12 +23,49 @@
 #import "Crashlytics/Crashlytics/Helpers/FIRCLSLogger.h"
 #import "Crashlytics/Crashlytics/Private/FIRStackFrame_Private.h"
 
+// A compact, C-level view of one loaded binary image, so that lookups are a binary search over
+// plain integers rather than a linear scan over dictionaries.
+typedef struct {
+  uintptr_t base;
+  uintptr_t size;
+  uint32_t uuidIndex;
+} FIRCLSSymbolResolverImage;
+
+#define FIRCLSSymbolResolverNoUUID (UINT32_MAX)
+
+static const NSUInteger FIRCLSSymbolResolverChunkSize = 256;
+
+typedef enum {
+  FIRCLSSymbolResolverUUIDStateUnknown = 0,
+  FIRCLSSymbolResolverUUIDStateFound,
+  FIRCLSSymbolResolverUUIDStateMissing,
+} FIRCLSSymbolResolverUUIDState;
+
 @interface FIRCLSSymbolResolver () {
-  NSMutableArray* _binaryImages;
+  FIRCLSSymbolResolverImage* _images;
+  NSUInteger _imageCount;
+
+  // Indexed by FIRCLSSymbolResolverImage.uuidIndex
+  NSMutableArray<NSString*>* _uuids;
+  NSMutableArray<NSString*>* _libraries;
+  NSMutableDictionary<NSString*, NSNumber*>* _uuidIndexes;
+  uintptr_t* _localBaseAddresses;
+  uint8_t* _uuidStates;
 }
 
 @end
 
+static int FIRCLSSymbolResolverImageCompare(const void* a, const void* b) {
+  const FIRCLSSymbolResolverImage* imageA = a;
+  const FIRCLSSymbolResolverImage* imageB = b;
+
+  if (imageA->base < imageB->base) {
+    return -1;
+  }
+
+  return imageA->base > imageB->base ? 1 : 0;
+}
+
 @implementation FIRCLSSymbolResolver
 
 - (instancetype)init {
@@ -36,11 +74,19 @@
     return nil;
   }
 
-  _binaryImages = [NSMutableArray array];
+  _uuids = [NSMutableArray array];
+  _libraries = [NSMutableArray array];
+  _uuidIndexes = [NSMutableDictionary dictionary];
 
   return self;
 }
 
+- (void)dealloc {
+  free(_images);
+  free(_localBaseAddresses);
+  free(_uuidStates);
+}
+
 - (BOOL)loadBinaryImagesFromFile:(NSString*)path {
   if ([path length] == 0) {
     return NO;
@@ -53,6 +99,16 @@
     return NO;
   }
 
+  FIRCLSSymbolResolverImage* images =
+      realloc(_images, sizeof(FIRCLSSymbolResolverImage) * (_imageCount + sections.count));
+  if (!images) {
+    FIRCLSErrorLog(@"Unable to allocate binary image table for %@", path);
+    return NO;
+  }
+  _images = images;
+
+  const NSUInteger previousUUIDCount = _uuids.count;
+
   // filter out unloads, as well as loads with invalid entries
   for (NSDictionary* entry in sections) {
     NSDictionary* details = [entry objectForKey:@"load"];
@@ -71,41 +127,121 @@
       continue;
     }
 
-    [_binaryImages addObject:details];
+    FIRCLSSymbolResolverImage* image = &_images[_imageCount++];
+    image->base = (uintptr_t)[[details objectForKey:@"base"] unsignedIntegerValue];
+    image->size = (uintptr_t)[[details objectForKey:@"size"] unsignedIntegerValue];
+    image->uuidIndex = [self uuidIndexForImage:details];
   }
 
-  [_binaryImages sortUsingComparator:^NSComparisonResult(id obj1, id obj2) {
-    NSNumber* base1 = [obj1 objectForKey:@"base"];
-    NSNumber* base2 = [obj2 objectForKey:@"base"];
+  qsort(_images, _imageCount, sizeof(FIRCLSSymbolResolverImage),
+        FIRCLSSymbolResolverImageCompare);
 
-    return [base1 compare:base2];
-  }];
+  uintptr_t* localBaseAddresses = realloc(_localBaseAddresses, sizeof(uintptr_t) * _uuids.count);
+  if (localBaseAddresses) {
+    _localBaseAddresses = localBaseAddresses;
+  }
+  uint8_t* uuidStates = realloc(_uuidStates, sizeof(uint8_t) * _uuids.count);
+  if (uuidStates) {
+    _uuidStates = uuidStates;
+  }
+  if (_uuids.count > 0 && (!localBaseAddresses || !uuidStates)) {
+    FIRCLSErrorLog(@"Unable to allocate UUID table for %@", path);
+    _imageCount = 0;
+    return NO;
+  }
+
+  // images seen for the first time have not been matched with this process yet
+  for (NSUInteger i = previousUUIDCount; i < _uuids.count; ++i) {
+    _uuidStates[i] = FIRCLSSymbolResolverUUIDStateUnknown;
+  }
 
   return YES;
 }
 
-- (NSDictionary*)loadedBinaryImageForPC:(uintptr_t)pc {
-  NSUInteger index =
-      [_binaryImages indexOfObjectPassingTest:^BOOL(id obj, NSUInteger idx, BOOL* stop) {
-        uintptr_t base = [[obj objectForKey:@"base"] unsignedIntegerValue];
-        uintptr_t size = [[obj objectForKey:@"size"] unsignedIntegerValue];
+- (uint32_t)uuidIndexForImage:(NSDictionary*)details {
+  NSString* uuid = [details objectForKey:@"uuid"];
+  if (![uuid isKindOfClass:[NSString class]]) {
+    return FIRCLSSymbolResolverNoUUID;
+  }
 
-        return pc >= base && pc < (base + size);
-      }];
+  NSNumber* index = [_uuidIndexes objectForKey:uuid];
+  if (index) {
+    return [index unsignedIntValue];
+  }
 
-  if (index == NSNotFound) {
-    return nil;
+  NSString* imagePath = [details objectForKey:@"path"];
+  NSString* library = [imagePath isKindOfClass:[NSString class]] ? [imagePath lastPathComponent]
+                                                                 : (id)[NSNull null];
+
+  uint32_t newIndex = (uint32_t)_uuids.count;
+  [_uuids addObject:uuid];
+  [_libraries addObject:library];
+  [_uuidIndexes setObject:@(newIndex) forKey:uuid];
+
+  return newIndex;
+}
+
+/// Returns the image containing pc, or NULL.
+- (const FIRCLSSymbolResolverImage*)loadedBinaryImageForPC:(uintptr_t)pc {
+  NSUInteger low = 0;
+  NSUInteger high = _imageCount;
+
+  // find the first image with a base above pc, the candidate is the one just before it
+  while (low < high) {
+    NSUInteger middle = low + (high - low) / 2;
+
+    if (_images[middle].base <= pc) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (low == 0) {
+    return NULL;
   }
 
-  return [_binaryImages objectAtIndex:index];
+  const FIRCLSSymbolResolverImage* image = &_images[low - 1];
+  if (pc - image->base >= image->size) {
+    return NULL;
+  }
+
+  return image;
 }
 
-- (BOOL)fillInImageDetails:(FIRCLSBinaryImageDetails*)details forUUID:(NSString*)uuid {
-  if (!details || !uuid) {
-    return NO;
+/// Finds the in-process base address for every UUID in the list that has not been looked up yet,
+/// with a single pass over the loaded images.
+- (void)resolveLocalImagesForUUIDIndexes:(const uint32_t*)uuidIndexes count:(uint32_t)count {
+  if (count == 0) {
+    return;
   }
 
-  return FIRCLSBinaryImageFindImageForUUID([uuid UTF8String], details);
+  const char** uuidStrings = calloc(count, sizeof(const char*));
+  FIRCLSBinaryImageDetails* details = calloc(count, sizeof(FIRCLSBinaryImageDetails));
+  bool* found = calloc(count, sizeof(bool));
+
+  if (uuidStrings && details && found) {
+    for (uint32_t i = 0; i < count; ++i) {
+      uuidStrings[i] = [[_uuids objectAtIndex:uuidIndexes[i]] UTF8String];
+    }
+
+    FIRCLSBinaryImageFindImagesForUUIDs(uuidStrings, count, details, found);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t index = uuidIndexes[i];
+
+      if (found[i]) {
+        _localBaseAddresses[index] = (uintptr_t)details[i].node.baseAddress;
+        _uuidStates[index] = FIRCLSSymbolResolverUUIDStateFound;
+      } else {
+        _uuidStates[index] = FIRCLSSymbolResolverUUIDStateMissing;
+      }
+    }
+  }
+
+  free(uuidStrings);
+  free(details);
+  free(found);
 }
 
 - (FIRStackFrame*)frameForAddress:(uint64_t)address {
@@ -119,25 +255,110 @@
 }
 
 - (BOOL)updateStackFrame:(FIRStackFrame*)frame {
-  uint64_t address = [frame address];
-  if (address == 0) {
+  if (!frame) {
     return NO;
   }
 
-  NSDictionary* binaryImage = [self loadedBinaryImageForPC:(uintptr_t)address];
+  return [self updateStackFrames:@[ frame ]] == 1;
+}
+
+- (NSUInteger)updateStackFrames:(NSArray<FIRStackFrame*>*)frames {
+  const NSUInteger frameCount = frames.count;
+  NSUInteger updatedCount = 0;
+
+  if (frameCount == 0 || _imageCount == 0) {
+    return 0;
+  }
+
+  const FIRCLSSymbolResolverImage** frameImages =
+      calloc(frameCount, sizeof(FIRCLSSymbolResolverImage*));
+  uint32_t* pendingUUIDIndexes = calloc(frameCount, sizeof(uint32_t));
+  uint32_t pendingCount = 0;
+
+  if (!frameImages || !pendingUUIDIndexes) {
+    free(frameImages);
+    free(pendingUUIDIndexes);
+    return 0;
+  }
+
+  // First, find the image for every frame, and collect the images that still need to be matched
+  // up with what is loaded in this process.
+  for (NSUInteger i = 0; i < frameCount; ++i) {
+    const uint64_t address = [[frames objectAtIndex:i] address];
+    if (address == 0) {
+      continue;
+    }
+
+    const FIRCLSSymbolResolverImage* image = [self loadedBinaryImageForPC:(uintptr_t)address];
+    if (!image || image->uuidIndex == FIRCLSSymbolResolverNoUUID) {
+      continue;
+    }
 
-  FIRCLSBinaryImageDetails imageDetails;
+    frameImages[i] = image;
 
-  if (![self fillInImageDetails:&imageDetails forUUID:[binaryImage objectForKey:@"uuid"]]) {
+    if (_uuidStates[image->uuidIndex] == FIRCLSSymbolResolverUUIDStateUnknown) {
+      bool pending = false;
+      for (uint32_t j = 0; j < pendingCount && !pending; ++j) {
+        pending = pendingUUIDIndexes[j] == image->uuidIndex;
+      }
+
+      if (!pending) {
+        pendingUUIDIndexes[pendingCount++] = image->uuidIndex;
+      }
+    }
+  }
+
+  [self resolveLocalImagesForUUIDIndexes:pendingUUIDIndexes count:pendingCount];
+
+  // dladdr is thread-safe and each frame is independent, so large batches are split into chunks
+  // and spread across the cores.
+  const size_t chunkCount = (frameCount + FIRCLSSymbolResolverChunkSize - 1) /
+                            FIRCLSSymbolResolverChunkSize;
+  // dispatch_apply is synchronous, so the blocks can safely update the counter on this stack
+  _Atomic(NSUInteger) atomicUpdatedCount = 0;
+  _Atomic(NSUInteger)* updatedCounter = &atomicUpdatedCount;
+
+  dispatch_apply(chunkCount, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t chunk) {
+    const NSUInteger start = chunk * FIRCLSSymbolResolverChunkSize;
+    const NSUInteger end = MIN(start + FIRCLSSymbolResolverChunkSize, frameCount);
+    NSUInteger chunkUpdatedCount = 0;
+
+    @autoreleasepool {
+      for (NSUInteger i = start; i < end; ++i) {
+        const FIRCLSSymbolResolverImage* image = frameImages[i];
+        if (!image) {
+          continue;
+        }
+
+        if (self->_uuidStates[image->uuidIndex] != FIRCLSSymbolResolverUUIDStateFound) {
 #if DEBUG
-    FIRCLSSDKLog("Image not found\n");
+          FIRCLSSDKLog("Image not found\n");
 #endif
-    return NO;
-  }
+          continue;
+        }
+
+        if ([self updateStackFrame:[frames objectAtIndex:i] image:image]) {
+          chunkUpdatedCount++;
+        }
+      }
+    }
+
+    atomic_fetch_add(updatedCounter, chunkUpdatedCount);
+  });
+
+  updatedCount = atomic_load(&atomicUpdatedCount);
+
+  free(frameImages);
+  free(pendingUUIDIndexes);
+
+  return updatedCount;
+}
+
+- (BOOL)updateStackFrame:(FIRStackFrame*)frame image:(const FIRCLSSymbolResolverImage*)image {
+  uint64_t address = [frame address];
 
-  uintptr_t addr = (uintptr_t)address -
-                   (uintptr_t)[[binaryImage objectForKey:@"base"] unsignedIntegerValue] +
-                   (uintptr_t)imageDetails.node.baseAddress;
+  uintptr_t addr =
+      (uintptr_t)address - image->base + _localBaseAddresses[image->uuidIndex];
   Dl_info dlInfo;
 
   if (dladdr((void*)addr, &dlInfo) == 0) {
@@ -168,7 +389,8 @@
     [frame setOffset:addr - (uintptr_t)dlInfo.dli_saddr];
   }
 
-  [frame setLibrary:[[binaryImage objectForKey:@"path"] lastPathComponent]];
+  NSString* library = [_libraries objectAtIndex:image->uuidIndex];
+  [frame setLibrary:library == (id)[NSNull null] ? nil : library];
 
   return YES;
 }
@@ -17,6 +17,7 @@
 #import "Crashlytics/Crashlytics/Models/Record/FIRCLSReportAdapter.h"
 #import "Crashlytics/Crashlytics/Models/Record/FIRCLSReportAdapter_Private.h"
 
+#import "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
 #import "Crashlytics/Crashlytics/Helpers/FIRCLSLogger.h"
 #import "Crashlytics/Crashlytics/Models/FIRCLSInternalReport.h"
 
@@ -26,6 +27,18 @@
 #import <nanopb/pb_decode.h>
 #import <nanopb/pb_encode.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t FIRCLSReportAdapterVarintSize(uint64_t value);
+static size_t FIRCLSReportAdapterFileMessageSize(size_t filenameLength, size_t contentsLength);
+static bool FIRCLSReportAdapterStreamFile(pb_ostream_t *stream,
+                                          NSString *filename,
+                                          NSString *path,
+                                          size_t contentsLength);
+
 @interface FIRCLSReportAdapter ()
 
 @property(nonatomic, strong) FIRCLSInstallIdentifierModel *installIDModel;
@@ -89,34 +102,16 @@
 /// data as a dictionary.
 /// @param filePath Persisted crash file path
 + (NSArray<NSDictionary *> *)dictionariesFromEachLineOfFile:(NSString *)filePath {
-  NSString *content = [[NSString alloc] initWithContentsOfFile:filePath
-                                                      encoding:NSUTF8StringEncoding
-                                                         error:nil];
-  NSArray *lines =
-      [content componentsSeparatedByCharactersInSet:NSCharacterSet.newlineCharacterSet];
+  NSArray *sections = FIRCLSFileReadSections(filePath.fileSystemRepresentation, false, nil);
+  if (!sections) {
+    FIRCLSErrorLog(@"Failed to read JSON from file (%@)", filePath);
+    return @[];
+  }
 
   NSMutableArray<NSDictionary *> *array = [[NSMutableArray<NSDictionary *> alloc] init];
-
-  int lineNum = 0;
-  for (NSString *line in lines) {
-    lineNum++;
-
-    if (line.length == 0) {
-      // Likely newline at the end of the file
-      continue;
-    }
-
-    NSError *error;
-    NSDictionary *dict =
-        [NSJSONSerialization JSONObjectWithData:[line dataUsingEncoding:NSUTF8StringEncoding]
-                                        options:0
-                                          error:&error];
-
-    if (error) {
-      FIRCLSErrorLog(@"Failed to read JSON from file (%@) line (%d) with error: %@", filePath,
-                     lineNum, error);
-    } else {
-      [array addObject:dict];
+  for (id section in sections) {
+    if ([section isKindOfClass:[NSDictionary class]]) {
+      [array addObject:section];
     }
   }
 
@@ -128,15 +123,45 @@
 //
 
 - (NSData *)transportBytes {
-  pb_ostream_t sizestream = PB_OSTREAM_SIZING;
+  // The metadata fields are tiny, so nanopb sizes and encodes them directly. The record files make
+  // up nearly all of the report, so they are sized with stat and streamed from disk straight into
+  // the output buffer. This means that only one copy of the report ever lives in memory.
+  NSArray<NSString *> *clsRecords = [self clsRecordFilePaths];
+  NSMutableArray<NSString *> *filenames = [[NSMutableArray alloc] initWithCapacity:clsRecords.count];
+  NSMutableArray<NSString *> *paths = [[NSMutableArray alloc] initWithCapacity:clsRecords.count];
+  size_t *contentSizes = calloc(clsRecords.count + 1, sizeof(size_t));
+  if (contentSizes == NULL) {
+    return nil;
+  }
+
+  size_t payloadSize = 0;
+  for (NSString *path in clsRecords) {
+    struct stat statBuffer;
+    if (stat(path.fileSystemRepresentation, &statBuffer) != 0) {
+      FIRCLSErrorLog(@"Failed to stat %@ with error: %s", path, strerror(errno));
+      continue;
+    }
+
+    NSString *filename = path.lastPathComponent;
+    contentSizes[paths.count] = (size_t)statBuffer.st_size;
+    [paths addObject:path];
+    [filenames addObject:filename];
 
-  // Encode 1 time to determine the size.
+    size_t fileSize = FIRCLSReportAdapterFileMessageSize(
+        [filename lengthOfBytesUsingEncoding:NSUTF8StringEncoding], (size_t)statBuffer.st_size);
+    payloadSize += 1 + FIRCLSReportAdapterVarintSize(fileSize) + fileSize;
+  }
+
+  pb_ostream_t sizestream = PB_OSTREAM_SIZING;
   if (!pb_encode(&sizestream, google_crashlytics_Report_fields, &_report)) {
     FIRCLSErrorLog(@"Error in nanopb encoding for size: %s", PB_GET_ERROR(&sizestream));
   }
 
-  // Encode a 2nd time to actually get the bytes from it.
   size_t bufferSize = sizestream.bytes_written;
+  if (payloadSize > 0) {
+    bufferSize += 1 + FIRCLSReportAdapterVarintSize(payloadSize) + payloadSize;
+  }
+
   CFMutableDataRef dataRef = CFDataCreateMutable(CFAllocatorGetDefault(), bufferSize);
   CFDataSetLength(dataRef, bufferSize);
   pb_ostream_t ostream = pb_ostream_from_buffer((void *)CFDataGetBytePtr(dataRef), bufferSize);
@@ -144,9 +169,103 @@
     FIRCLSErrorLog(@"Error in nanopb encoding for bytes: %s", PB_GET_ERROR(&ostream));
   }
 
+  // The payload is left empty in the report struct, so nanopb skips it above and it can be
+  // appended here. Protobuf does not require fields to be in tag order.
+  if (payloadSize > 0) {
+    pb_encode_tag(&ostream, PB_WT_STRING, google_crashlytics_Report_apple_payload_tag);
+    pb_encode_varint(&ostream, payloadSize);
+
+    for (NSUInteger i = 0; i < paths.count; i++) {
+      if (!FIRCLSReportAdapterStreamFile(&ostream, filenames[i], paths[i], contentSizes[i])) {
+        FIRCLSErrorLog(@"Error in nanopb encoding for %@: %s", paths[i], PB_GET_ERROR(&ostream));
+      }
+    }
+  }
+
+  free(contentSizes);
+
   return CFBridgingRelease(dataRef);
 }
 
+/// Returns the number of bytes needed to encode value as a varint.
+static size_t FIRCLSReportAdapterVarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+/// Returns the encoded size of a FilesPayload.File message, without its own tag and length.
+static size_t FIRCLSReportAdapterFileMessageSize(size_t filenameLength, size_t contentsLength) {
+  return 1 + FIRCLSReportAdapterVarintSize(filenameLength) + filenameLength + 1 +
+         FIRCLSReportAdapterVarintSize(contentsLength) + contentsLength;
+}
+
+/// Writes one FilesPayload.File message, reading exactly `contentsLength` bytes from the file at
+/// `path` in fixed-size chunks. If the file is shorter than when it was sized, the rest of the
+/// contents are zero-filled so that the message stays well formed.
+static bool FIRCLSReportAdapterStreamFile(pb_ostream_t *stream,
+                                          NSString *filename,
+                                          NSString *path,
+                                          size_t contentsLength) {
+  static const size_t FIRCLSReportAdapterChunkSize = 32 * 1024;
+
+  NSData *filenameData = [filename dataUsingEncoding:NSUTF8StringEncoding];
+
+  if (!pb_encode_tag(stream, PB_WT_STRING, google_crashlytics_FilesPayload_files_tag) ||
+      !pb_encode_varint(stream,
+                        FIRCLSReportAdapterFileMessageSize(filenameData.length, contentsLength)) ||
+      !pb_encode_tag(stream, PB_WT_STRING, google_crashlytics_FilesPayload_File_filename_tag) ||
+      !pb_encode_varint(stream, filenameData.length) ||
+      !pb_write(stream, filenameData.bytes, filenameData.length) ||
+      !pb_encode_tag(stream, PB_WT_STRING, google_crashlytics_FilesPayload_File_contents_tag) ||
+      !pb_encode_varint(stream, contentsLength)) {
+    return false;
+  }
+
+  pb_byte_t *chunk = calloc(1, FIRCLSReportAdapterChunkSize);
+  if (chunk == NULL) {
+    return false;
+  }
+
+  int fd = open(path.fileSystemRepresentation, O_RDONLY);
+  if (fd < 0) {
+    FIRCLSErrorLog(@"Failed to open %@ with error: %s", path, strerror(errno));
+  }
+
+  bool success = true;
+  size_t remaining = contentsLength;
+  while (success && remaining > 0) {
+    size_t length = MIN(remaining, FIRCLSReportAdapterChunkSize);
+    ssize_t readLength = 0;
+
+    if (fd >= 0) {
+      readLength = read(fd, chunk, length);
+      if (readLength < 0 && errno == EINTR) {
+        continue;
+      }
+    }
+
+    if (readLength <= 0) {
+      FIRCLSErrorLog(@"Unexpected end of %@, %zu bytes missing", path, remaining);
+      memset(chunk, 0, length);
+      readLength = (ssize_t)length;
+    }
+
+    success = pb_write(stream, chunk, (size_t)readLength);
+    remaining -= (size_t)readLength;
+  }
+
+  if (fd >= 0) {
+    close(fd);
+  }
+  free(chunk);
+
+  return success;
+}
+
 //
 // MARK: NanoPB conversions
 //
@@ -162,42 +281,10 @@
   report.firebase_authentication_token = FIRCLSEncodeString(self.authToken);
   report.build_version = FIRCLSEncodeString(self.application.build_version);
   report.display_version = FIRCLSEncodeString(self.application.display_version);
-  report.apple_payload = [self protoFilesPayload];
+  // apple_payload is left empty, the record files are streamed in by -transportBytes
   return report;
 }
 
-- (google_crashlytics_FilesPayload)protoFilesPayload {
-  google_crashlytics_FilesPayload apple_payload = google_crashlytics_FilesPayload_init_default;
-
-  NSArray<NSString *> *clsRecords = [self clsRecordFilePaths];
-  google_crashlytics_FilesPayload_File *files =
-      calloc(1, sizeof(google_crashlytics_FilesPayload_File) * clsRecords.count);
-
-  if (files == NULL) {
-    // files and files_count are initialized to NULL and 0 by default.
-    return apple_payload;
-  }
-  for (NSUInteger i = 0; i < clsRecords.count; i++) {
-    google_crashlytics_FilesPayload_File file = google_crashlytics_FilesPayload_File_init_default;
-    file.filename = FIRCLSEncodeString(clsRecords[i].lastPathComponent);
-
-    NSError *error;
-    file.contents = FIRCLSEncodeData([NSData dataWithContentsOfFile:clsRecords[i]
-                                                            options:0
-                                                              error:&error]);
-    if (error) {
-      FIRCLSErrorLog(@"Failed to read from %@ with error: %@", clsRecords[i], error);
-    }
-
-    files[i] = file;
-  }
-
-  apple_payload.files = files;
-  apple_payload.files_count = (pb_size_t)clsRecords.count;
-
-  return apple_payload;
-}
-
 - (NSArray<NSString *> *)clsRecordFilePaths {
   NSMutableArray<NSString *> *clsRecords = [[NSMutableArray<NSString *> alloc] init];
 
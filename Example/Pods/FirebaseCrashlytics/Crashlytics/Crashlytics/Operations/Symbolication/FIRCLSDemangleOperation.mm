@@ -17,6 +17,67 @@
 
 #import <cxxabi.h>
 
+// Reports from the same app share most of their symbols, so demangled results are kept across
+// operations. Least recently used entries are evicted first once the cache is full.
+static const NSUInteger FIRCLSDemangleCacheCapacity = 4096;
+
+@interface FIRCLSDemangleCache : NSObject {
+  NSMutableDictionary<NSString *, id> *_entries;
+  NSMutableOrderedSet<NSString *> *_recency;
+}
+@end
+
+@implementation FIRCLSDemangleCache
+
++ (instancetype)sharedCache {
+  static FIRCLSDemangleCache *cache;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    cache = [[FIRCLSDemangleCache alloc] init];
+  });
+  return cache;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (!self) {
+    return nil;
+  }
+
+  _entries = [NSMutableDictionary dictionary];
+  _recency = [NSMutableOrderedSet orderedSet];
+
+  return self;
+}
+
+/// Returns the cached result, NSNull for symbols that are known not to demangle, or nil.
+- (id)objectForSymbol:(NSString *)symbol {
+  @synchronized(self) {
+    id result = [_entries objectForKey:symbol];
+    if (result) {
+      [_recency removeObject:symbol];
+      [_recency addObject:symbol];
+    }
+    return result;
+  }
+}
+
+- (void)setObject:(id)result forSymbol:(NSString *)symbol {
+  @synchronized(self) {
+    if (![_entries objectForKey:symbol] && _entries.count >= FIRCLSDemangleCacheCapacity) {
+      NSString *oldest = [_recency firstObject];
+      [_recency removeObjectAtIndex:0];
+      [_entries removeObjectForKey:oldest];
+    }
+
+    [_entries setObject:result forKey:symbol];
+    [_recency removeObject:symbol];
+    [_recency addObject:symbol];
+  }
+}
+
+@end
+
 @implementation FIRCLSDemangleOperation
 
 + (NSString *)demangleSymbol:(const char *)symbol {
@@ -84,10 +145,58 @@
 }
 
 - (void)main {
+  FIRCLSDemangleCache *cache = [FIRCLSDemangleCache sharedCache];
+  NSMutableDictionary<NSString *, id> *results = [NSMutableDictionary dictionary];
+  NSMutableOrderedSet<NSString *> *pending = [NSMutableOrderedSet orderedSet];
+
+  // Deduplicate first, so that each distinct symbol is demangled at most once
+  [self enumerateFramesWithBlock:^(FIRStackFrame *frame) {
+    NSString *rawSymbol = [frame rawSymbol];
+    if (!rawSymbol || [results objectForKey:rawSymbol] || [pending containsObject:rawSymbol]) {
+      return;
+    }
+
+    id cached = [cache objectForSymbol:rawSymbol];
+    if (cached) {
+      [results setObject:cached forKey:rawSymbol];
+    } else {
+      [pending addObject:rawSymbol];
+    }
+  }];
+
+  if ([self isCancelled]) {
+    return;
+  }
+
+  // __cxa_demangle is reentrant, so the misses can be spread over all of the cores
+  NSArray<NSString *> *symbols = [[pending array] copy];
+  const NSUInteger pendingCount = symbols.count;
+  CFTypeRef *demangled = (CFTypeRef *)calloc(pendingCount, sizeof(CFTypeRef));
+  if (pendingCount > 0 && !demangled) {
+    return;
+  }
+
+  dispatch_apply(pendingCount, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t i) {
+    @autoreleasepool {
+      NSString *symbol = [self demangleSymbol:[[symbols objectAtIndex:i] UTF8String]];
+      demangled[i] = CFBridgingRetain(symbol ?: (id)[NSNull null]);
+    }
+  });
+
+  for (NSUInteger i = 0; i < pendingCount; ++i) {
+    id result = CFBridgingRelease(demangled[i]);
+    NSString *rawSymbol = [symbols objectAtIndex:i];
+
+    [results setObject:result forKey:rawSymbol];
+    [cache setObject:result forSymbol:rawSymbol];
+  }
+  free(demangled);
+
   [self enumerateFramesWithBlock:^(FIRStackFrame *frame) {
-    NSString *demangedSymbol = [self demangleSymbol:[[frame rawSymbol] UTF8String]];
+    NSString *rawSymbol = [frame rawSymbol];
+    id demangedSymbol = rawSymbol ? [results objectForKey:rawSymbol] : nil;
 
-    if (demangedSymbol) {
+    if (demangedSymbol && demangedSymbol != [NSNull null]) {
       [frame setSymbol:demangedSymbol];
     }
   }];
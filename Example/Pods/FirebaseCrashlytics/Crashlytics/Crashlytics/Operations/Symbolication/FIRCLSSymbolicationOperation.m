@@ -19,9 +19,17 @@
 @implementation FIRCLSSymbolicationOperation
 
 - (void)main {
+  NSMutableArray<FIRStackFrame *> *frames = [NSMutableArray array];
+
   [self enumerateFramesWithBlock:^(FIRStackFrame *frame) {
-    [self.symbolResolver updateStackFrame:frame];
+    [frames addObject:frame];
   }];
+
+  if ([self isCancelled]) {
+    return;
+  }
+
+  [self.symbolResolver updateStackFrames:frames];
 }
 
 @end
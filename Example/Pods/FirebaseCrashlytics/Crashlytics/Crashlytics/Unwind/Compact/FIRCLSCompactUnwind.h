@@ -19,6 +19,7 @@
 
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSFeatures.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSThreadState.h"
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOUnwindInfo.h"
 
 // We have to pack the arrays defined in this header, so
 // we can reason about pointer math.
@@ -37,9 +38,8 @@ typedef struct {
   const void* ehFrame;
   uintptr_t loadAddress;
 
-  struct unwind_info_section_header unwindHeader;
-  struct unwind_info_section_header_index_entry indexHeader;
-  uint32_t firstLevelNextFunctionOffset;
+  // Reads unwindInfo, without going past the end of the section.
+  FIRCLSMachOUnwindInfo reader;
 } FIRCLSCompactUnwindContext;
 
 typedef struct {
@@ -53,13 +53,9 @@ typedef struct {
 
 bool FIRCLSCompactUnwindInit(FIRCLSCompactUnwindContext* context,
                              const void* unwindInfo,
+                             uint64_t unwindInfoSize,
                              const void* ehFrame,
                              uintptr_t loadAddress);
-void* FIRCLSCompactUnwindGetIndexData(FIRCLSCompactUnwindContext* context);
-void* FIRCLSCompactUnwindGetSecondLevelData(FIRCLSCompactUnwindContext* context);
-bool FIRCLSCompactUnwindFindFirstLevelIndex(FIRCLSCompactUnwindContext* context,
-                                            uintptr_t pc,
-                                            uint32_t* index);
 
 bool FIRCLSCompactUnwindDwarfFrame(FIRCLSCompactUnwindContext* context,
                                    uintptr_t dwarfOffset,
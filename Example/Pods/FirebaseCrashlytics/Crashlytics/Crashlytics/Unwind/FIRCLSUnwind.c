@@ -244,7 +244,8 @@ static bool FIRCLSUnwindWithCompactUnwindInfo(FIRCLSUnwindContext* context) {
     return false;
   }
 
-  if (!FIRCLSCompactUnwindInit(&context->compactUnwindState, image.unwindInfo, image.ehFrame,
+  if (!FIRCLSCompactUnwindInit(&context->compactUnwindState, image.unwindInfo,
+                               image.unwindInfoSize, image.ehFrame,
                                (uintptr_t)image.baseAddress)) {
     FIRCLSSDKLogError("Unable to read unwind info\n");
     return false;
@@ -0,0 +1,240 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Hammers one allocator from every core with a mix of size-class and raw allocations, checking
+// that no two live blocks overlap, and then repeatedly creates, exhausts and destroys allocators
+// to check that failed and torn-down allocators give all of their memory back.
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSAllocate.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRCLSBenchLiveBlocksPerThread (64)
+#define FIRCLSBenchOperationsPerThread (2000000)
+#define FIRCLSBenchExhaustionRounds (2000)
+
+typedef struct {
+  FIRCLSAllocatorRef allocator;
+  uint32_t seed;
+  uint64_t allocations;
+  uint64_t failures;
+  uint64_t corruptions;
+} FIRCLSBenchThread;
+
+typedef struct {
+  uint8_t* pointer;
+  size_t size;
+  uint8_t tag;
+} FIRCLSBenchBlock;
+
+static uint32_t FIRCLSBenchRandom(uint32_t* state) {
+  // xorshift32
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static bool FIRCLSBenchBlockIsIntact(const FIRCLSBenchBlock* block) {
+  for (size_t i = 0; i < block->size; ++i) {
+    if (block->pointer[i] != block->tag) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void* FIRCLSBenchStressThread(void* argument) {
+  FIRCLSBenchThread* thread = argument;
+  FIRCLSBenchBlock live[FIRCLSBenchLiveBlocksPerThread];
+
+  memset(live, 0, sizeof(live));
+
+  for (uint32_t i = 0; i < FIRCLSBenchOperationsPerThread; ++i) {
+    const uint32_t index = FIRCLSBenchRandom(&thread->seed) % FIRCLSBenchLiveBlocksPerThread;
+    FIRCLSBenchBlock* block = &live[index];
+
+    if (block->pointer) {
+      if (!FIRCLSBenchBlockIsIntact(block)) {
+        thread->corruptions++;
+      }
+
+      FIRCLSAllocatorFree(thread->allocator, block->pointer);
+      block->pointer = NULL;
+      continue;
+    }
+
+    // Mostly size-class blocks, with the occasional raw allocation that can never be reused.
+    const uint32_t random = FIRCLSBenchRandom(&thread->seed);
+    const size_t size = (random % 512 == 0) ? FIRCLSAllocatorMaximumSizeClass + 1 + random % 256
+                                            : 1 + random % FIRCLSAllocatorMaximumSizeClass;
+
+    block->pointer = FIRCLSAllocatorSafeAllocate(thread->allocator, size, CLS_READWRITE);
+    if (!block->pointer) {
+      thread->failures++;
+      continue;
+    }
+
+    thread->allocations++;
+    block->size = size;
+    block->tag = (uint8_t)(random >> 24) | 1;
+    memset(block->pointer, block->tag, size);
+  }
+
+  for (uint32_t i = 0; i < FIRCLSBenchLiveBlocksPerThread; ++i) {
+    if (live[i].pointer && !FIRCLSBenchBlockIsIntact(&live[i])) {
+      thread->corruptions++;
+    }
+  }
+
+  return NULL;
+}
+
+static void FIRCLSBenchConcurrentAllocation(void) {
+  const long threadCount = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? sysconf(_SC_NPROCESSORS_ONLN) : 2;
+  FIRCLSAllocatorRef allocator = FIRCLSAllocatorCreate(8 * 1024 * 1024, 0);
+  FIRCLSBenchThread threads[threadCount];
+  pthread_t pthreads[threadCount];
+
+  FIRCLSHostTestAssert(allocator != NULL);
+  if (!allocator) {
+    return;
+  }
+
+  const double start = FIRCLSHostTestSeconds();
+  for (long i = 0; i < threadCount; ++i) {
+    threads[i] = (FIRCLSBenchThread){.allocator = allocator,
+                                     .seed = 0x9E3779B9u * (uint32_t)(i + 1)};
+    pthread_create(&pthreads[i], NULL, FIRCLSBenchStressThread, &threads[i]);
+  }
+
+  uint64_t allocations = 0;
+  uint64_t failures = 0;
+  uint64_t corruptions = 0;
+  for (long i = 0; i < threadCount; ++i) {
+    pthread_join(pthreads[i], NULL);
+    allocations += threads[i].allocations;
+    failures += threads[i].failures;
+    corruptions += threads[i].corruptions;
+  }
+  const double elapsed = FIRCLSHostTestSeconds() - start;
+
+  printf("concurrent: %ld threads, %llu allocations, %llu exhausted, %.1f M allocations/s\n",
+         threadCount, (unsigned long long)allocations, (unsigned long long)failures,
+         (double)allocations / elapsed / 1e6);
+
+  FIRCLSHostTestAssert(corruptions == 0);
+  FIRCLSHostTestAssert(FIRCLSAllocatorExhaustionCount(allocator) == failures);
+
+  FIRCLSAllocatorDestroy(allocator);
+}
+
+// The number of mappings in this process, which goes up for good whenever an allocator leaks.
+static size_t FIRCLSBenchMappingCount(void) {
+  FILE* maps = fopen("/proc/self/maps", "r");
+  size_t count = 0;
+  int c;
+
+  if (!maps) {
+    return 0;
+  }
+
+  while ((c = fgetc(maps)) != EOF) {
+    count += (c == '\n');
+  }
+
+  fclose(maps);
+  return count;
+}
+
+static void* FIRCLSBenchExhaustThread(void* argument) {
+  FIRCLSBenchThread* thread = argument;
+
+  for (;;) {
+    const size_t size =
+        1 + FIRCLSBenchRandom(&thread->seed) % (FIRCLSAllocatorMaximumSizeClass * 2);
+
+    if (!FIRCLSAllocatorSafeAllocate(thread->allocator, size, CLS_READWRITE)) {
+      thread->failures++;
+      return NULL;
+    }
+
+    thread->allocations++;
+  }
+}
+
+static void FIRCLSBenchAllocationFailure(void) {
+  size_t mappingsBefore = 0;
+  uint64_t failures = 0;
+  uint64_t reportedFailures = 0;
+
+  const double start = FIRCLSHostTestSeconds();
+  for (uint32_t round = 0; round < FIRCLSBenchExhaustionRounds; ++round) {
+    FIRCLSAllocatorRef allocator = FIRCLSAllocatorCreate(64 * 1024, 16 * 1024);
+    FIRCLSBenchThread threads[4];
+    pthread_t pthreads[4];
+
+    FIRCLSHostTestAssert(allocator != NULL);
+    if (!allocator) {
+      return;
+    }
+
+    for (uint32_t i = 0; i < 4; ++i) {
+      threads[i] = (FIRCLSBenchThread){.allocator = allocator, .seed = round * 4 + i + 1};
+      pthread_create(&pthreads[i], NULL, FIRCLSBenchExhaustThread, &threads[i]);
+    }
+
+    for (uint32_t i = 0; i < 4; ++i) {
+      pthread_join(pthreads[i], NULL);
+      failures += threads[i].failures;
+    }
+
+    reportedFailures += FIRCLSAllocatorExhaustionCount(allocator);
+    FIRCLSAllocatorDestroy(allocator);
+
+    // Counted after the first round, once the thread stacks that get cached are in place.
+    if (round == 0) {
+      mappingsBefore = FIRCLSBenchMappingCount();
+    }
+  }
+  const double elapsed = FIRCLSHostTestSeconds() - start;
+
+  // A mapping that can never succeed must not leave anything behind either.
+  FIRCLSHostTestAssert(FIRCLSAllocatorCreate(SIZE_MAX / 4, SIZE_MAX / 4) == NULL);
+
+  const size_t mappingsAfter = FIRCLSBenchMappingCount();
+
+  printf("exhaustion: %u allocators exhausted and destroyed, %.1f us each, mappings %zu -> %zu\n",
+         FIRCLSBenchExhaustionRounds, elapsed / FIRCLSBenchExhaustionRounds * 1e6, mappingsBefore,
+         mappingsAfter);
+
+  FIRCLSHostTestAssert(failures == reportedFailures);
+  FIRCLSHostTestAssert(mappingsAfter <= mappingsBefore);
+}
+
+int main(void) {
+  FIRCLSHostTestRun(FIRCLSBenchConcurrentAllocation);
+  FIRCLSHostTestRun(FIRCLSBenchAllocationFailure);
+
+  return FIRCLSHostTestFinish();
+}
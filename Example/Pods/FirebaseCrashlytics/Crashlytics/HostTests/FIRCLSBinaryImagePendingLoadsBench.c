@@ -0,0 +1,656 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Feeds a corpus of Mach-O images through the pending load ring, the way dyld's callbacks do at
+// launch, and compares the time spent in the callbacks against parsing each image inline.  Then
+// it unloads images while they are queued or being parsed, protecting each one's memory as soon
+// as its unload returns, so that any read of an unloaded header faults.
+//
+// The corpus is every slice of the Mach-O files given as arguments, or, with none, a set of
+// generated images with a typical number of load commands.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImagePendingLoads.h"
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOView.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define FIRCLSBenchGeneratedImageCount (700)
+#define FIRCLSBenchWorkerCount (4)
+#define FIRCLSBenchUnloadRounds (200)
+#define FIRCLSBenchUnloadThreads (4)
+#define FIRCLSBenchHeaderSize64 (32)
+
+// What FIRCLSBinaryImageFillInImageDetails pulls out of each image.
+typedef struct {
+  uint8_t uuid[FIRCLSMachOViewUUIDLength];
+  uint64_t unwindInfo;
+  uint64_t ehFrame;
+  uint64_t crashInfo;
+  uint64_t textSize;
+  uint32_t commandCount;
+} FIRCLSBenchDetails;
+
+typedef struct {
+  // A private copy of the header and load commands, in its own mapping.
+  uint8_t* header;
+  size_t mappedLength;
+  FIRCLSBenchDetails expected;
+  FIRCLSBenchDetails parsed;
+  _Atomic(bool) kept;
+  _Atomic(bool) cancelled;
+  // only touched by the thread that loads the image
+  bool unloaded;
+} FIRCLSBenchImage;
+
+static struct {
+  FIRCLSBenchImage* images;
+  uint32_t count;
+  uint32_t capacity;
+} FIRCLSBenchCorpus;
+
+#pragma mark - Corpus
+
+static bool FIRCLSBenchAddImage(const void* header, size_t length) {
+  if (FIRCLSBenchCorpus.count == FIRCLSBenchCorpus.capacity) {
+    const uint32_t capacity =
+        FIRCLSBenchCorpus.capacity == 0 ? 256 : FIRCLSBenchCorpus.capacity * 2;
+    FIRCLSBenchImage* images = realloc(FIRCLSBenchCorpus.images, capacity * sizeof(*images));
+    if (!images) {
+      return false;
+    }
+
+    FIRCLSBenchCorpus.images = images;
+    FIRCLSBenchCorpus.capacity = capacity;
+  }
+
+  const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t mappedLength = (length + pageSize - 1) / pageSize * pageSize;
+  void* copy =
+      mmap(NULL, mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (copy == MAP_FAILED) {
+    return false;
+  }
+
+  memcpy(copy, header, length);
+
+  FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[FIRCLSBenchCorpus.count++];
+  memset(image, 0, sizeof(*image));
+  image->header = copy;
+  image->mappedLength = mappedLength;
+
+  return true;
+}
+
+static bool FIRCLSBenchAddSlice(const FIRCLSMachOSliceView* slice, void* context) {
+  // Only the header and load commands are mapped for a loaded image's slice.
+  const size_t length = (size_t)(slice->commands.data - slice->view.data) + slice->commands.length;
+
+  if (!FIRCLSBenchAddImage(slice->view.data, length)) {
+    return false;
+  }
+
+  (*(uint32_t*)context)++;
+  return true;
+}
+
+static void FIRCLSBenchWrite32(uint8_t** cursor, uint32_t value) {
+  memcpy(*cursor, &value, sizeof(value));
+  *cursor += sizeof(value);
+}
+
+static void FIRCLSBenchWrite64(uint8_t** cursor, uint64_t value) {
+  memcpy(*cursor, &value, sizeof(value));
+  *cursor += sizeof(value);
+}
+
+static void FIRCLSBenchWriteName(uint8_t** cursor, const char* name) {
+  memset(*cursor, 0, FIRCLSMachOViewNameLength);
+  memcpy(*cursor, name, strlen(name));
+  *cursor += FIRCLSMachOViewNameLength;
+}
+
+static void FIRCLSBenchWriteSection(uint8_t** cursor,
+                                    const char* segment,
+                                    const char* section,
+                                    uint64_t addr,
+                                    uint64_t size) {
+  FIRCLSBenchWriteName(cursor, section);
+  FIRCLSBenchWriteName(cursor, segment);
+  FIRCLSBenchWrite64(cursor, addr);
+  FIRCLSBenchWrite64(cursor, size);
+  for (uint32_t i = 0; i < 8; ++i) {
+    // offset, align, reloff, nreloc, flags, and three reserved
+    FIRCLSBenchWrite32(cursor, 0);
+  }
+}
+
+// A thin 64-bit dylib with __TEXT and __DATA segments holding the sections that are looked up,
+// a UUID, and enough dylib and symbol commands to look like a typical framework.
+static bool FIRCLSBenchGenerateImage(uint32_t index) {
+  uint8_t buffer[4096];
+  uint8_t* cursor = buffer + FIRCLSBenchHeaderSize64;
+  uint32_t commandCount = 0;
+  const uint64_t base = 0x100000000ull + (uint64_t)index * 0x1000000ull;
+
+  // __TEXT, with three sections
+  FIRCLSBenchWrite32(&cursor, 0x19);
+  FIRCLSBenchWrite32(&cursor, 72 + 3 * 80);
+  FIRCLSBenchWriteName(&cursor, "__TEXT");
+  FIRCLSBenchWrite64(&cursor, base);
+  FIRCLSBenchWrite64(&cursor, 0x40000 + index * 0x1000);
+  FIRCLSBenchWrite64(&cursor, 0);
+  FIRCLSBenchWrite64(&cursor, 0x40000);
+  FIRCLSBenchWrite32(&cursor, 5);
+  FIRCLSBenchWrite32(&cursor, 5);
+  FIRCLSBenchWrite32(&cursor, 3);
+  FIRCLSBenchWrite32(&cursor, 0);
+  FIRCLSBenchWriteSection(&cursor, "__TEXT", "__text", base + 0x1000, 0x30000);
+  FIRCLSBenchWriteSection(&cursor, "__TEXT", "__unwind_info", base + 0x31000, 0x2000 + index);
+  FIRCLSBenchWriteSection(&cursor, "__TEXT", "__eh_frame", base + 0x33000, 0x800);
+  commandCount++;
+
+  // __DATA, with __crash_info
+  FIRCLSBenchWrite32(&cursor, 0x19);
+  FIRCLSBenchWrite32(&cursor, 72 + 80);
+  FIRCLSBenchWriteName(&cursor, "__DATA");
+  FIRCLSBenchWrite64(&cursor, base + 0x40000 + index * 0x1000);
+  FIRCLSBenchWrite64(&cursor, 0x8000);
+  FIRCLSBenchWrite64(&cursor, 0x40000);
+  FIRCLSBenchWrite64(&cursor, 0x8000);
+  FIRCLSBenchWrite32(&cursor, 3);
+  FIRCLSBenchWrite32(&cursor, 3);
+  FIRCLSBenchWrite32(&cursor, 1);
+  FIRCLSBenchWrite32(&cursor, 0);
+  FIRCLSBenchWriteSection(&cursor, "__DATA", "__crash_info", base + 0x41000 + index * 0x1000,
+                          0x40);
+  commandCount++;
+
+  // LC_UUID
+  FIRCLSBenchWrite32(&cursor, 0x1b);
+  FIRCLSBenchWrite32(&cursor, 24);
+  for (uint32_t i = 0; i < FIRCLSMachOViewUUIDLength; ++i) {
+    *cursor++ = (uint8_t)(index * 31 + i);
+  }
+  commandCount++;
+
+  // LC_LOAD_DYLIB, with a path, standing in for everything else that gets walked over
+  for (uint32_t i = 0; i < 24; ++i) {
+    FIRCLSBenchWrite32(&cursor, 0xc);
+    FIRCLSBenchWrite32(&cursor, 64);
+    memset(cursor, 'a' + (i % 26), 56);
+    cursor += 56;
+    commandCount++;
+  }
+
+  const uint32_t sizeofcmds = (uint32_t)(cursor - buffer) - FIRCLSBenchHeaderSize64;
+  uint8_t* header = buffer;
+  FIRCLSBenchWrite32(&header, 0xfeedfacf);
+  FIRCLSBenchWrite32(&header, 0x0100000c);  // CPU_TYPE_ARM64
+  FIRCLSBenchWrite32(&header, 0);
+  FIRCLSBenchWrite32(&header, 6);  // MH_DYLIB
+  FIRCLSBenchWrite32(&header, commandCount);
+  FIRCLSBenchWrite32(&header, sizeofcmds);
+  FIRCLSBenchWrite32(&header, 0);
+  FIRCLSBenchWrite32(&header, 0);
+
+  return FIRCLSBenchAddImage(buffer, (size_t)(cursor - buffer));
+}
+
+static bool FIRCLSBenchLoadCorpus(int argc, char** argv) {
+  if (argc <= 1) {
+    for (uint32_t i = 0; i < FIRCLSBenchGeneratedImageCount; ++i) {
+      if (!FIRCLSBenchGenerateImage(i)) {
+        return false;
+      }
+    }
+
+    printf("corpus: %u generated images\n", FIRCLSBenchCorpus.count);
+    return true;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    FIRCLSMachOView file;
+    uint32_t slices = 0;
+
+    if (!FIRCLSMachOViewMapFile(argv[i], &file)) {
+      fprintf(stderr, "skipping %s, which could not be mapped\n", argv[i]);
+      continue;
+    }
+
+    FIRCLSMachOViewEnumerateSlices(&file, FIRCLSBenchAddSlice, &slices);
+    FIRCLSMachOViewUnmapFile(&file);
+
+    if (slices == 0) {
+      fprintf(stderr, "skipping %s, which has no Mach-O slices\n", argv[i]);
+    }
+  }
+
+  printf("corpus: %u slices from %d files\n", FIRCLSBenchCorpus.count, argc - 1);
+  return FIRCLSBenchCorpus.count > 0;
+}
+
+#pragma mark - Parsing
+
+static void FIRCLSBenchFindSection(const FIRCLSMachOSliceView* slice,
+                                   const char* segment,
+                                   const char* name,
+                                   uint64_t* addr) {
+  FIRCLSMachOViewSection section;
+
+  if (FIRCLSMachOSliceViewFindSection(slice, segment, name, &section)) {
+    *addr = section.addr;
+  }
+}
+
+static bool FIRCLSBenchVisitCommand(uint32_t type, const FIRCLSMachOView* command, void* context) {
+  FIRCLSBenchDetails* details = context;
+  uint64_t vmsize;
+
+  details->commandCount++;
+
+  // LC_SEGMENT_64 __TEXT, whose size is recorded for each node
+  if (type == 0x19 && command->length >= 72 && memcmp(command->data + 8, "__TEXT", 7) == 0 &&
+      FIRCLSMachOViewReadUInt64(command, 32, false, &vmsize)) {
+    details->textSize = vmsize;
+  }
+
+  return true;
+}
+
+// The same lookups as FIRCLSBinaryImageFillInImageDetails, which only ever read the header and
+// load commands of a loaded image.
+static void FIRCLSBenchParse(const void* header, FIRCLSBenchDetails* details) {
+  FIRCLSMachOSliceView slice;
+
+  memset(details, 0, sizeof(*details));
+  if (!FIRCLSMachOSliceViewInitWithHeader(&slice, header)) {
+    return;
+  }
+
+  FIRCLSMachOSliceViewEnumerateLoadCommands(&slice, FIRCLSBenchVisitCommand, details);
+  FIRCLSMachOSliceViewGetUUID(&slice, details->uuid);
+  FIRCLSBenchFindSection(&slice, "__TEXT", "__unwind_info", &details->unwindInfo);
+  FIRCLSBenchFindSection(&slice, "__TEXT", "__eh_frame", &details->ehFrame);
+  FIRCLSBenchFindSection(&slice, "__DATA", "__crash_info", &details->crashInfo);
+}
+
+#pragma mark - Consumer
+
+// Stands in for the binary image queue, with dispatch_apply spread over a few workers.
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  bool passRequested;
+  // holds passes back, so that the callbacks can be timed on their own
+  bool paused;
+  bool exiting;
+  uint64_t passesStarted;
+  uint64_t passesFinished;
+
+  FIRCLSBinaryImagePendingLoad loads[FIRCLSBinaryImagePendingLoadBatchSize];
+  FIRCLSBenchDetails details[FIRCLSBinaryImagePendingLoadBatchSize];
+  bool kept[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  _Atomic(uint32_t) nextIndex;
+  uint32_t generation;
+  uint32_t finishedWorkers;
+  // re-reads each header this many times, to widen the window in which unloads find it parsing
+  uint32_t parseRepeats;
+} FIRCLSBenchConsumer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .changed = PTHREAD_COND_INITIALIZER,
+    .parseRepeats = 1,
+};
+
+static void* FIRCLSBenchWorkerMain(void* context) {
+  uint32_t generation = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+    while (FIRCLSBenchConsumer.generation == generation && !FIRCLSBenchConsumer.exiting) {
+      pthread_cond_wait(&FIRCLSBenchConsumer.changed, &FIRCLSBenchConsumer.lock);
+    }
+    if (FIRCLSBenchConsumer.exiting) {
+      pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+      return NULL;
+    }
+    generation = FIRCLSBenchConsumer.generation;
+    pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+
+    for (;;) {
+      const uint32_t i = atomic_fetch_add(&FIRCLSBenchConsumer.nextIndex, 1);
+      if (i >= FIRCLSBenchConsumer.count) {
+        break;
+      }
+
+      for (uint32_t repeat = 0; repeat < FIRCLSBenchConsumer.parseRepeats; ++repeat) {
+        FIRCLSBenchParse(FIRCLSBenchConsumer.loads[i].header, &FIRCLSBenchConsumer.details[i]);
+      }
+      FIRCLSBenchConsumer.kept[i] = FIRCLSBinaryImagePendingLoadsFinish(i);
+    }
+
+    pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+    FIRCLSBenchConsumer.finishedWorkers++;
+    pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+    pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+  }
+}
+
+static void FIRCLSBenchApply(uint32_t count) {
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  FIRCLSBenchConsumer.count = count;
+  atomic_store(&FIRCLSBenchConsumer.nextIndex, 0);
+  FIRCLSBenchConsumer.finishedWorkers = 0;
+  FIRCLSBenchConsumer.generation++;
+  pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+  while (FIRCLSBenchConsumer.finishedWorkers < FIRCLSBenchWorkerCount) {
+    pthread_cond_wait(&FIRCLSBenchConsumer.changed, &FIRCLSBenchConsumer.lock);
+  }
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+}
+
+// Mirrors FIRCLSBinaryImageProcessPendingLoads, storing the details of the images that are kept.
+static void FIRCLSBenchProcessPendingLoads(void) {
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+
+  for (;;) {
+    uint32_t count = 0;
+
+    if (FIRCLSBinaryImagePendingLoadsClaim(FIRCLSBenchConsumer.loads, &count) == 0) {
+      break;
+    }
+
+    FIRCLSBenchApply(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      if (!FIRCLSBenchConsumer.kept[i]) {
+        continue;
+      }
+
+      // the slide stands in for the image's index
+      const intptr_t index = FIRCLSBenchConsumer.loads[i].vmaddr_slide;
+      FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[index];
+      image->parsed = FIRCLSBenchConsumer.details[i];
+      atomic_store(&image->kept, true);
+    }
+  }
+}
+
+static void* FIRCLSBenchConsumerMain(void* context) {
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  for (;;) {
+    while ((!FIRCLSBenchConsumer.passRequested || FIRCLSBenchConsumer.paused) &&
+           !FIRCLSBenchConsumer.exiting) {
+      pthread_cond_wait(&FIRCLSBenchConsumer.changed, &FIRCLSBenchConsumer.lock);
+    }
+    if (!FIRCLSBenchConsumer.passRequested) {
+      break;
+    }
+
+    FIRCLSBenchConsumer.passRequested = false;
+    FIRCLSBenchConsumer.passesStarted++;
+    pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+
+    FIRCLSBenchProcessPendingLoads();
+
+    pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+    FIRCLSBenchConsumer.passesFinished++;
+    pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+  }
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+
+  return NULL;
+}
+
+static void FIRCLSBenchRequestPass(void) {
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  FIRCLSBenchConsumer.passRequested = true;
+  pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+}
+
+static void FIRCLSBenchPause(void) {
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  FIRCLSBenchConsumer.paused = true;
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+}
+
+// Waits for a pass that starts after everything enqueued so far, which drains all of it.
+static void FIRCLSBenchDrain(void) {
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  const uint64_t pass = FIRCLSBenchConsumer.passesStarted + 1;
+
+  FIRCLSBenchConsumer.paused = false;
+  FIRCLSBenchConsumer.passRequested = true;
+  pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+  while (FIRCLSBenchConsumer.passesFinished < pass) {
+    pthread_cond_wait(&FIRCLSBenchConsumer.changed, &FIRCLSBenchConsumer.lock);
+  }
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+}
+
+#pragma mark - Callbacks
+
+// What FIRCLSBinaryImageChanged does for a load. Returns false if the image had to be parsed
+// inline because the ring was full.
+static bool FIRCLSBenchLoad(FIRCLSBenchImage* image) {
+  bool scheduleProcessing = false;
+
+  if (!FIRCLSBinaryImagePendingLoadsEnqueue(image->header, image - FIRCLSBenchCorpus.images,
+                                            &scheduleProcessing)) {
+    FIRCLSBenchParse(image->header, &image->parsed);
+    atomic_store(&image->kept, true);
+    return false;
+  }
+
+  if (scheduleProcessing) {
+    FIRCLSBenchRequestPass();
+  }
+
+  return true;
+}
+
+// What FIRCLSBinaryImageChanged does for an unload, followed by dyld unmapping the image.
+static void FIRCLSBenchUnload(FIRCLSBenchImage* image) {
+  if (FIRCLSBinaryImagePendingLoadsCancel(image->header)) {
+    atomic_store(&image->cancelled, true);
+  } else {
+    FIRCLSBenchDetails details;
+    FIRCLSBenchParse(image->header, &details);
+  }
+
+  // Any read from here on faults.
+  image->unloaded = true;
+  mprotect(image->header, image->mappedLength, PROT_NONE);
+}
+
+static bool FIRCLSBenchDetailsEqual(const FIRCLSBenchDetails* a, const FIRCLSBenchDetails* b) {
+  return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static void FIRCLSBenchResetImages(void) {
+  for (uint32_t i = 0; i < FIRCLSBenchCorpus.count; ++i) {
+    FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[i];
+
+    mprotect(image->header, image->mappedLength, PROT_READ);
+    memset(&image->parsed, 0, sizeof(image->parsed));
+    atomic_store(&image->kept, false);
+    atomic_store(&image->cancelled, false);
+    image->unloaded = false;
+  }
+}
+
+#pragma mark - Phases
+
+static void FIRCLSBenchLaunch(void) {
+  const uint32_t count = FIRCLSBenchCorpus.count;
+
+  // Before: everything is parsed inside the callbacks.
+  double start = FIRCLSHostTestSeconds();
+  for (uint32_t i = 0; i < count; ++i) {
+    FIRCLSBenchParse(FIRCLSBenchCorpus.images[i].header, &FIRCLSBenchCorpus.images[i].expected);
+  }
+  const double inlineSeconds = FIRCLSHostTestSeconds() - start;
+
+  // After: the callbacks only enqueue, and the parsing happens behind them. The pass is held
+  // back until they are done, since on a machine with few cores it would otherwise be timed as
+  // part of them.
+  FIRCLSBenchResetImages();
+  FIRCLSBinaryImagePendingLoadsInit();
+  FIRCLSBenchPause();
+
+  uint32_t inlineFallbacks = 0;
+  start = FIRCLSHostTestSeconds();
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!FIRCLSBenchLoad(&FIRCLSBenchCorpus.images[i])) {
+      inlineFallbacks++;
+    }
+  }
+  const double callbackSeconds = FIRCLSHostTestSeconds() - start;
+  start = FIRCLSHostTestSeconds();
+  FIRCLSBenchDrain();
+  const double passSeconds = FIRCLSHostTestSeconds() - start;
+
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    const FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[i];
+
+    if (!atomic_load(&image->kept) || !FIRCLSBenchDetailsEqual(&image->parsed, &image->expected)) {
+      mismatches++;
+    }
+  }
+
+  printf("launch: %u images, %.1f us in callbacks parsing inline, %.1f us in callbacks "
+         "enqueueing, then %.1f us to parse them on %u workers; %u parsed inline because the ring "
+         "was full\n",
+         count, inlineSeconds * 1e6, callbackSeconds * 1e6, passSeconds * 1e6,
+         FIRCLSBenchWorkerCount, inlineFallbacks);
+  FIRCLSHostTestAssert(mismatches == 0);
+}
+
+typedef struct {
+  uint32_t first;
+  uint32_t stride;
+  uint32_t seed;
+} FIRCLSBenchUnloader;
+
+static void* FIRCLSBenchUnloaderMain(void* context) {
+  FIRCLSBenchUnloader* unloader = context;
+
+  // Each thread loads its share, and unloads some of them straight away and some a little later,
+  // so that unloads land while loads are queued, claimed, and being parsed.
+  for (uint32_t i = unloader->first; i < FIRCLSBenchCorpus.count; i += unloader->stride) {
+    FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[i];
+
+    FIRCLSBenchLoad(image);
+
+    unloader->seed = unloader->seed * 1103515245u + 12345u;
+    if ((unloader->seed >> 16) % 3 == 0) {
+      FIRCLSBenchUnload(image);
+    }
+  }
+
+  for (uint32_t i = unloader->first; i < FIRCLSBenchCorpus.count; i += unloader->stride) {
+    FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[i];
+
+    unloader->seed = unloader->seed * 1103515245u + 12345u;
+    if (!image->unloaded && (unloader->seed >> 16) % 3 == 1) {
+      FIRCLSBenchUnload(image);
+    }
+  }
+
+  return NULL;
+}
+
+static void FIRCLSBenchUnloads(void) {
+  uint64_t cancelled = 0;
+  uint64_t keptAfterCancel = 0;
+  uint64_t lost = 0;
+
+  FIRCLSBenchConsumer.parseRepeats = 16;
+
+  const double start = FIRCLSHostTestSeconds();
+  for (uint32_t round = 0; round < FIRCLSBenchUnloadRounds; ++round) {
+    pthread_t threads[FIRCLSBenchUnloadThreads];
+    FIRCLSBenchUnloader unloaders[FIRCLSBenchUnloadThreads];
+
+    FIRCLSBenchResetImages();
+    FIRCLSBinaryImagePendingLoadsInit();
+
+    for (uint32_t t = 0; t < FIRCLSBenchUnloadThreads; ++t) {
+      unloaders[t] = (FIRCLSBenchUnloader){t, FIRCLSBenchUnloadThreads, round * 7919u + t + 1};
+      pthread_create(&threads[t], NULL, FIRCLSBenchUnloaderMain, &unloaders[t]);
+    }
+    for (uint32_t t = 0; t < FIRCLSBenchUnloadThreads; ++t) {
+      pthread_join(threads[t], NULL);
+    }
+
+    FIRCLSBenchDrain();
+
+    for (uint32_t i = 0; i < FIRCLSBenchCorpus.count; ++i) {
+      const FIRCLSBenchImage* image = &FIRCLSBenchCorpus.images[i];
+      const bool kept = atomic_load(&image->kept);
+
+      if (atomic_load(&image->cancelled)) {
+        cancelled++;
+        keptAfterCancel += kept ? 1 : 0;
+      } else if (!kept || !FIRCLSBenchDetailsEqual(&image->parsed, &image->expected)) {
+        // every load that wasn't cancelled is recorded, unloaded or not
+        lost++;
+      }
+    }
+  }
+
+  printf("unloads: %u rounds in %.2f s, %llu loads cancelled\n", FIRCLSBenchUnloadRounds,
+         FIRCLSHostTestSeconds() - start, (unsigned long long)cancelled);
+  FIRCLSHostTestAssert(cancelled > 0);
+  FIRCLSHostTestAssert(keptAfterCancel == 0);
+  FIRCLSHostTestAssert(lost == 0);
+}
+
+int main(int argc, char** argv) {
+  if (!FIRCLSBenchLoadCorpus(argc, argv)) {
+    fprintf(stderr, "no corpus to run against\n");
+    return EXIT_FAILURE;
+  }
+
+  pthread_t consumer;
+  pthread_t workers[FIRCLSBenchWorkerCount];
+
+  pthread_create(&consumer, NULL, FIRCLSBenchConsumerMain, NULL);
+  for (uint32_t i = 0; i < FIRCLSBenchWorkerCount; ++i) {
+    pthread_create(&workers[i], NULL, FIRCLSBenchWorkerMain, NULL);
+  }
+
+  FIRCLSHostTestRun(FIRCLSBenchLaunch);
+  FIRCLSHostTestRun(FIRCLSBenchUnloads);
+
+  pthread_mutex_lock(&FIRCLSBenchConsumer.lock);
+  FIRCLSBenchConsumer.exiting = true;
+  pthread_cond_broadcast(&FIRCLSBenchConsumer.changed);
+  pthread_mutex_unlock(&FIRCLSBenchConsumer.lock);
+
+  pthread_join(consumer, NULL);
+  for (uint32_t i = 0; i < FIRCLSBenchWorkerCount; ++i) {
+    pthread_join(workers[i], NULL);
+  }
+
+  return FIRCLSHostTestFinish();
+}
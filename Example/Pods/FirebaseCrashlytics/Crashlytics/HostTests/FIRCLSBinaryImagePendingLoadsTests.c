@@ -0,0 +1,347 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSBinaryImagePendingLoads.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRCLSTestHeaderCount (20000)
+#define FIRCLSTestProducerCount (4)
+
+// Headers are only compared, never read, so any distinct 4-byte aligned addresses will do.
+static uint32_t FIRCLSTestHeaders[FIRCLSTestHeaderCount];
+
+static const void* FIRCLSTestHeader(uint32_t index) {
+  return &FIRCLSTestHeaders[index];
+}
+
+static uint32_t FIRCLSTestHeaderIndex(const void* header) {
+  return (uint32_t)((const uint32_t*)header - FIRCLSTestHeaders);
+}
+
+// Claims and finishes everything in the ring, and returns the headers delivered, in order.
+static uint32_t FIRCLSTestDrain(uint32_t* indexes, uint32_t capacity) {
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t delivered = 0;
+  uint32_t count;
+
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  while (FIRCLSBinaryImagePendingLoadsClaim(batch, &count) > 0) {
+    for (uint32_t i = 0; i < count; ++i) {
+      FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(i));
+      if (delivered < capacity) {
+        indexes[delivered] = FIRCLSTestHeaderIndex(batch[i].header);
+      }
+      delivered++;
+    }
+  }
+
+  return delivered;
+}
+
+static void testDeliversInOrder(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+
+  bool schedule;
+  for (uint32_t i = 0; i < 10; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), i * 4096,
+                                                              &schedule));
+    // Only the first load of a pass schedules one.
+    FIRCLSHostTestAssert(schedule == (i == 0));
+  }
+
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) == 10);
+  FIRCLSHostTestAssert(count == 10);
+  for (uint32_t i = 0; i < count; ++i) {
+    FIRCLSHostTestAssert(batch[i].header == FIRCLSTestHeader(i));
+    FIRCLSHostTestAssert(batch[i].vmaddr_slide == (intptr_t)(i * 4096));
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(i));
+  }
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) == 0);
+  FIRCLSHostTestAssert(count == 0);
+
+  // Once a pass has begun, the next load schedules another one.
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(10), 0, &schedule));
+  FIRCLSHostTestAssert(schedule);
+}
+
+static void testClaimsAreBatched(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+
+  bool schedule;
+  for (uint32_t i = 0; i < 150; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), 0, &schedule));
+  }
+
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  const uint32_t expected[] = {FIRCLSBinaryImagePendingLoadBatchSize,
+                               FIRCLSBinaryImagePendingLoadBatchSize,
+                               150 - 2 * FIRCLSBinaryImagePendingLoadBatchSize, 0};
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  for (uint32_t pass = 0; pass < sizeof(expected) / sizeof(expected[0]); ++pass) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) == expected[pass]);
+    FIRCLSHostTestAssert(count == expected[pass]);
+    for (uint32_t i = 0; i < count; ++i) {
+      FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(i));
+    }
+  }
+}
+
+static void testFullRingRejectsAndWrapsAround(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+
+  bool schedule;
+  for (uint32_t i = 0; i < FIRCLSBinaryImagePendingLoadCapacity; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), 0, &schedule));
+  }
+  FIRCLSHostTestAssert(!FIRCLSBinaryImagePendingLoadsEnqueue(
+      FIRCLSTestHeader(FIRCLSBinaryImagePendingLoadCapacity), 0, &schedule));
+
+  // Claiming a batch frees its cells for the next loads, which land at the start of the ring.
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) ==
+                       FIRCLSBinaryImagePendingLoadBatchSize);
+  for (uint32_t i = 0; i < count; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(i));
+  }
+  const uint32_t total =
+      FIRCLSBinaryImagePendingLoadCapacity + FIRCLSBinaryImagePendingLoadBatchSize;
+  for (uint32_t i = FIRCLSBinaryImagePendingLoadCapacity; i < total; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), 0, &schedule));
+  }
+  FIRCLSHostTestAssert(
+      !FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(total), 0, &schedule));
+
+  static uint32_t indexes[FIRCLSBinaryImagePendingLoadCapacity];
+  const uint32_t delivered = FIRCLSTestDrain(indexes, FIRCLSBinaryImagePendingLoadCapacity);
+  FIRCLSHostTestAssert(delivered == FIRCLSBinaryImagePendingLoadCapacity);
+  for (uint32_t i = 0; i < delivered; ++i) {
+    FIRCLSHostTestAssert(indexes[i] == FIRCLSBinaryImagePendingLoadBatchSize + i);
+  }
+}
+
+static void testCancelledLoadsAreSkipped(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+
+  bool schedule;
+  for (uint32_t i = 0; i < 3; ++i) {
+    FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), 0, &schedule));
+  }
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsCancel(FIRCLSTestHeader(1)));
+  FIRCLSHostTestAssert(!FIRCLSBinaryImagePendingLoadsCancel(FIRCLSTestHeader(1)));
+  FIRCLSHostTestAssert(!FIRCLSBinaryImagePendingLoadsCancel(FIRCLSTestHeader(3)));
+
+  // The cancelled cell is still consumed, but not handed out.
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) == 3);
+  FIRCLSHostTestAssert(count == 2);
+  FIRCLSHostTestAssert(batch[0].header == FIRCLSTestHeader(0));
+  FIRCLSHostTestAssert(batch[1].header == FIRCLSTestHeader(2));
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(0));
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsFinish(1));
+
+  // Once parsed, an unload isn't found, and is recorded after the load instead.
+  FIRCLSHostTestAssert(!FIRCLSBinaryImagePendingLoadsCancel(FIRCLSTestHeader(0)));
+}
+
+typedef struct {
+  const void* header;
+  _Atomic(bool) started;
+  _Atomic(bool) returned;
+  bool cancelled;
+} FIRCLSTestUnload;
+
+static void* FIRCLSTestUnloadThread(void* argument) {
+  FIRCLSTestUnload* unload = argument;
+
+  atomic_store(&unload->started, true);
+  unload->cancelled = FIRCLSBinaryImagePendingLoadsCancel(unload->header);
+  atomic_store(&unload->returned, true);
+
+  return NULL;
+}
+
+static void testCancelWaitsForParsing(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+
+  bool schedule;
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(0), 0, &schedule));
+
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t count;
+  FIRCLSBinaryImagePendingLoadsBeginPass();
+  FIRCLSHostTestAssert(FIRCLSBinaryImagePendingLoadsClaim(batch, &count) == 1);
+
+  FIRCLSTestUnload unload = {.header = FIRCLSTestHeader(0)};
+  pthread_t thread;
+  pthread_create(&thread, NULL, FIRCLSTestUnloadThread, &unload);
+  while (!atomic_load(&unload.started)) {
+    sched_yield();
+  }
+  usleep(50 * 1000);
+
+  // The header has to stay mapped until the consumer is done with it.
+  FIRCLSHostTestAssert(!atomic_load(&unload.returned));
+  FIRCLSHostTestAssert(!FIRCLSBinaryImagePendingLoadsFinish(0));
+
+  pthread_join(thread, NULL);
+  FIRCLSHostTestAssert(unload.cancelled);
+}
+
+typedef struct {
+  uint32_t first;
+  uint32_t count;
+} FIRCLSTestProducer;
+
+static struct {
+  // Set once each header has been enqueued, so the unloader only unloads loaded images.
+  _Atomic(bool) enqueued[FIRCLSTestHeaderCount];
+  _Atomic(uint32_t) enqueuedCount;
+  // Written by the consumer only.
+  uint32_t kept[FIRCLSTestHeaderCount];
+  uint32_t dropped[FIRCLSTestHeaderCount];
+  uint32_t lastKept[FIRCLSTestProducerCount];
+  uint32_t outOfOrder;
+  // Written by the unloader only.
+  bool cancelled[FIRCLSTestHeaderCount];
+} FIRCLSTestConcurrency;
+
+static void* FIRCLSTestProducerThread(void* argument) {
+  const FIRCLSTestProducer* producer = argument;
+
+  for (uint32_t i = producer->first; i < producer->first + producer->count; ++i) {
+    bool schedule;
+    while (!FIRCLSBinaryImagePendingLoadsEnqueue(FIRCLSTestHeader(i), 0, &schedule)) {
+      sched_yield();
+    }
+    atomic_store(&FIRCLSTestConcurrency.enqueued[i], true);
+    atomic_fetch_add(&FIRCLSTestConcurrency.enqueuedCount, 1);
+  }
+
+  return NULL;
+}
+
+static void* FIRCLSTestConsumerThread(void* argument) {
+  const uint32_t perProducer = FIRCLSTestHeaderCount / FIRCLSTestProducerCount;
+  FIRCLSBinaryImagePendingLoad batch[FIRCLSBinaryImagePendingLoadBatchSize];
+  uint32_t consumed = 0;
+  uint32_t count;
+
+  while (consumed < FIRCLSTestHeaderCount) {
+    FIRCLSBinaryImagePendingLoadsBeginPass();
+    const uint32_t claimed = FIRCLSBinaryImagePendingLoadsClaim(batch, &count);
+    if (claimed == 0) {
+      sched_yield();
+      continue;
+    }
+
+    consumed += claimed;
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t index = FIRCLSTestHeaderIndex(batch[i].header);
+      if (!FIRCLSBinaryImagePendingLoadsFinish(i)) {
+        FIRCLSTestConcurrency.dropped[index]++;
+        continue;
+      }
+
+      // Each producer enqueues in order, so its loads come out in order too.
+      const uint32_t producer = index / perProducer;
+      if (index + 1 <= FIRCLSTestConcurrency.lastKept[producer]) {
+        FIRCLSTestConcurrency.outOfOrder++;
+      }
+      FIRCLSTestConcurrency.lastKept[producer] = index + 1;
+      FIRCLSTestConcurrency.kept[index]++;
+    }
+  }
+
+  return NULL;
+}
+
+static void* FIRCLSTestUnloaderThread(void* argument) {
+  // Unloads every seventh image, as soon as it has been loaded.
+  for (uint32_t i = 0; i < FIRCLSTestHeaderCount; i += 7) {
+    while (!atomic_load(&FIRCLSTestConcurrency.enqueued[i])) {
+      sched_yield();
+    }
+    FIRCLSTestConcurrency.cancelled[i] =
+        FIRCLSBinaryImagePendingLoadsCancel(FIRCLSTestHeader(i));
+  }
+
+  return NULL;
+}
+
+static void testConcurrentProducersAndUnloads(void) {
+  FIRCLSBinaryImagePendingLoadsInit();
+  memset(&FIRCLSTestConcurrency, 0, sizeof(FIRCLSTestConcurrency));
+
+  const uint32_t perProducer = FIRCLSTestHeaderCount / FIRCLSTestProducerCount;
+  FIRCLSTestProducer producers[FIRCLSTestProducerCount];
+  pthread_t producerThreads[FIRCLSTestProducerCount];
+  pthread_t consumerThread;
+  pthread_t unloaderThread;
+
+  pthread_create(&consumerThread, NULL, FIRCLSTestConsumerThread, NULL);
+  pthread_create(&unloaderThread, NULL, FIRCLSTestUnloaderThread, NULL);
+  for (uint32_t i = 0; i < FIRCLSTestProducerCount; ++i) {
+    producers[i].first = i * perProducer;
+    producers[i].count = perProducer;
+    pthread_create(&producerThreads[i], NULL, FIRCLSTestProducerThread, &producers[i]);
+  }
+  for (uint32_t i = 0; i < FIRCLSTestProducerCount; ++i) {
+    pthread_join(producerThreads[i], NULL);
+  }
+  pthread_join(unloaderThread, NULL);
+  pthread_join(consumerThread, NULL);
+
+  // Every load is delivered once, and an unload that reports it cancelled wins over the consumer.
+  uint32_t cancelledCount = 0;
+  for (uint32_t i = 0; i < FIRCLSTestHeaderCount; ++i) {
+    const uint32_t kept = FIRCLSTestConcurrency.kept[i];
+    const uint32_t dropped = FIRCLSTestConcurrency.dropped[i];
+    const bool cancelled = FIRCLSTestConcurrency.cancelled[i];
+
+    FIRCLSHostTestAssert(kept + dropped <= 1);
+    FIRCLSHostTestAssert(kept == (cancelled ? 0 : 1));
+    FIRCLSHostTestAssert(dropped == 0 || cancelled);
+    cancelledCount += cancelled ? 1 : 0;
+  }
+  FIRCLSHostTestAssert(FIRCLSTestConcurrency.outOfOrder == 0);
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestConcurrency.enqueuedCount) ==
+                       FIRCLSTestHeaderCount);
+  printf("  %u loads, %u cancelled by an unload\n", FIRCLSTestHeaderCount, cancelledCount);
+}
+
+int main(void) {
+  FIRCLSHostTestRun(testDeliversInOrder);
+  FIRCLSHostTestRun(testClaimsAreBatched);
+  FIRCLSHostTestRun(testFullRingRejectsAndWrapsAround);
+  FIRCLSHostTestRun(testCancelledLoadsAreSkipped);
+  FIRCLSHostTestRun(testCancelWaitsForParsing);
+  FIRCLSHostTestRun(testConcurrentProducersAndUnloads);
+
+  return FIRCLSHostTestFinish();
+}
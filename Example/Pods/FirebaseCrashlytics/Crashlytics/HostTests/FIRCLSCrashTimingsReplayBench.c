@@ -0,0 +1,533 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Replays the crash handler's stages through FIRCLSCrashTimings, with a known amount of work in
+// each, and reads the "timings" sections that were written back with FIRCLSSectionReader to check
+// them.  Then it prints how long each stage took across all of the sections, which is how handler
+// latency is tracked in CI.
+//
+// Given the paths of report files, it instead checks and aggregates the timings sections in those.
+
+#include "Crashlytics/Crashlytics/Components/FIRCLSCrashTimings.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSSectionReader.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRCLSReplayRuns (200)
+#define FIRCLSReplayThreads (8)
+#define FIRCLSReplayStageCount (FIRCLSCrashTimingCheckpointCount - 1)
+
+// Stage i ends at checkpoint i + 1.
+static const char* const FIRCLSReplayStageNames[FIRCLSReplayStageCount] = {
+    "suspend_threads", "record_threads", "record_runtime", "record_names",
+    "record_stats",    "create_marker",  "flush_log",
+};
+
+typedef struct {
+  bool hasStage[FIRCLSReplayStageCount];
+  uint64_t stage[FIRCLSReplayStageCount];
+  bool hasTotal;
+  uint64_t total;
+  bool hasThreadCount;
+  uint64_t threadCount;
+  bool hasSlowestThread;
+  uint64_t slowestThread;
+  bool hasSlowestThreadTime;
+  uint64_t slowestThreadTime;
+} FIRCLSReplayTimings;
+
+typedef enum {
+  FIRCLSReplayKeyStage,
+  FIRCLSReplayKeyTotal,
+  FIRCLSReplayKeyThreadCount,
+  FIRCLSReplayKeySlowestThread,
+  FIRCLSReplayKeySlowestThreadTime,
+  FIRCLSReplayKeyUnknown,
+} FIRCLSReplayKey;
+
+typedef struct {
+  uint32_t depth;
+  bool inTimings;
+  bool malformed;
+  FIRCLSReplayKey key;
+  uint32_t stage;
+  int32_t lastStage;
+  FIRCLSReplayTimings current;
+
+  FIRCLSReplayTimings* sections;
+  size_t sectionCount;
+  size_t sectionCapacity;
+  size_t malformedCount;
+} FIRCLSReplayReader;
+
+static void FIRCLSReplayBeginObject(void* context) {
+  FIRCLSReplayReader* reader = context;
+
+  reader->depth++;
+  if (reader->inTimings && reader->depth > 2) {
+    reader->malformed = true;
+  }
+}
+
+static void FIRCLSReplayEndObject(void* context) {
+  FIRCLSReplayReader* reader = context;
+
+  reader->depth--;
+}
+
+static void FIRCLSReplayUnexpectedValue(void* context) {
+  FIRCLSReplayReader* reader = context;
+
+  if (reader->inTimings) {
+    reader->malformed = true;
+  }
+}
+
+static void FIRCLSReplayUnexpectedString(void* context, const char* value, size_t length) {
+  FIRCLSReplayUnexpectedValue(context);
+}
+
+static void FIRCLSReplayUnexpectedBoolean(void* context, bool value) {
+  FIRCLSReplayUnexpectedValue(context);
+}
+
+static bool FIRCLSReplayKeyIs(const char* key, size_t length, const char* name) {
+  return strlen(name) == length && memcmp(key, name, length) == 0;
+}
+
+static void FIRCLSReplayKeyCallback(void* context, const char* key, size_t length) {
+  FIRCLSReplayReader* reader = context;
+
+  if (reader->depth == 1) {
+    reader->inTimings = FIRCLSReplayKeyIs(key, length, "timings");
+    return;
+  }
+
+  if (!reader->inTimings || reader->depth != 2) {
+    return;
+  }
+
+  reader->key = FIRCLSReplayKeyUnknown;
+
+  for (uint32_t i = 0; i < FIRCLSReplayStageCount; ++i) {
+    if (FIRCLSReplayKeyIs(key, length, FIRCLSReplayStageNames[i])) {
+      // Stages are always written in the order they run in.
+      if ((int32_t)i <= reader->lastStage) {
+        reader->malformed = true;
+      }
+
+      reader->key = FIRCLSReplayKeyStage;
+      reader->stage = i;
+      reader->lastStage = (int32_t)i;
+      return;
+    }
+  }
+
+  if (FIRCLSReplayKeyIs(key, length, "total")) {
+    reader->key = FIRCLSReplayKeyTotal;
+  } else if (FIRCLSReplayKeyIs(key, length, "thread_count")) {
+    reader->key = FIRCLSReplayKeyThreadCount;
+  } else if (FIRCLSReplayKeyIs(key, length, "slowest_thread")) {
+    reader->key = FIRCLSReplayKeySlowestThread;
+  } else if (FIRCLSReplayKeyIs(key, length, "slowest_thread_time")) {
+    reader->key = FIRCLSReplayKeySlowestThreadTime;
+  } else {
+    reader->malformed = true;
+  }
+}
+
+static void FIRCLSReplayNumber(void* context, const FIRCLSSectionReaderNumber* number) {
+  FIRCLSReplayReader* reader = context;
+  FIRCLSReplayTimings* timings = &reader->current;
+
+  if (!reader->inTimings) {
+    return;
+  }
+
+  if (reader->depth != 2 || !number->isInteger || number->isNegative) {
+    reader->malformed = true;
+    return;
+  }
+
+  const uint64_t value = number->magnitude;
+
+  switch (reader->key) {
+    case FIRCLSReplayKeyStage:
+      timings->hasStage[reader->stage] = true;
+      timings->stage[reader->stage] = value;
+      break;
+    case FIRCLSReplayKeyTotal:
+      timings->hasTotal = true;
+      timings->total = value;
+      break;
+    case FIRCLSReplayKeyThreadCount:
+      timings->hasThreadCount = true;
+      timings->threadCount = value;
+      break;
+    case FIRCLSReplayKeySlowestThread:
+      timings->hasSlowestThread = true;
+      timings->slowestThread = value;
+      break;
+    case FIRCLSReplayKeySlowestThreadTime:
+      timings->hasSlowestThreadTime = true;
+      timings->slowestThreadTime = value;
+      break;
+    case FIRCLSReplayKeyUnknown:
+      break;
+  }
+}
+
+// Everything the handler guarantees about a section it wrote.
+static bool FIRCLSReplayTimingsAreConsistent(const FIRCLSReplayTimings* timings) {
+  if (!timings->hasTotal || !timings->hasThreadCount) {
+    return false;
+  }
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < FIRCLSReplayStageCount; ++i) {
+    sum += timings->hasStage[i] ? timings->stage[i] : 0;
+  }
+
+  if (sum != timings->total) {
+    return false;
+  }
+
+  if (timings->threadCount == 0) {
+    return !timings->hasSlowestThread && !timings->hasSlowestThreadTime;
+  }
+
+  if (!timings->hasSlowestThread || !timings->hasSlowestThreadTime ||
+      timings->slowestThread >= timings->threadCount) {
+    return false;
+  }
+
+  // Threads are only recorded during their stage, if that was reached.
+  const uint32_t recordThreads = FIRCLSCrashTimingCheckpointThreadsRecorded - 1;
+  return !timings->hasStage[recordThreads] ||
+         timings->slowestThreadTime <= timings->stage[recordThreads];
+}
+
+static bool FIRCLSReplayEndSection(void* context, size_t lineNumber, bool valid) {
+  FIRCLSReplayReader* reader = context;
+
+  if (reader->inTimings) {
+    if (!valid || reader->malformed || !FIRCLSReplayTimingsAreConsistent(&reader->current)) {
+      fprintf(stderr, "line %zu: invalid timings section\n", lineNumber);
+      reader->malformedCount++;
+    } else {
+      if (reader->sectionCount == reader->sectionCapacity) {
+        reader->sectionCapacity = reader->sectionCapacity ? reader->sectionCapacity * 2 : 64;
+        reader->sections =
+            realloc(reader->sections, reader->sectionCapacity * sizeof(FIRCLSReplayTimings));
+        if (!reader->sections) {
+          return false;
+        }
+      }
+
+      reader->sections[reader->sectionCount++] = reader->current;
+    }
+  }
+
+  reader->depth = 0;
+  reader->inTimings = false;
+  reader->malformed = false;
+  reader->lastStage = -1;
+  memset(&reader->current, 0, sizeof(FIRCLSReplayTimings));
+
+  return true;
+}
+
+static const FIRCLSSectionReaderCallbacks FIRCLSReplayCallbacks = {
+    .beginObject = FIRCLSReplayBeginObject,
+    .endObject = FIRCLSReplayEndObject,
+    .beginArray = FIRCLSReplayUnexpectedValue,
+    .key = FIRCLSReplayKeyCallback,
+    .string = FIRCLSReplayUnexpectedString,
+    .number = FIRCLSReplayNumber,
+    .boolean = FIRCLSReplayUnexpectedBoolean,
+    .null = FIRCLSReplayUnexpectedValue,
+    .endSection = FIRCLSReplayEndSection,
+};
+
+static void FIRCLSReplayReaderInit(FIRCLSReplayReader* reader) {
+  memset(reader, 0, sizeof(FIRCLSReplayReader));
+  reader->lastStage = -1;
+}
+
+static void FIRCLSReplaySpin(uint64_t nanoseconds) {
+  const uint64_t start = FIRCLSCrashTimingsNow();
+
+  while (FIRCLSCrashTimingsNow() - start < nanoseconds) {
+  }
+}
+
+// Work done in each stage, and by each thread, in microseconds.
+static uint64_t FIRCLSReplayStageWork(uint32_t stage) {
+  return 20 + 10 * stage;
+}
+
+static uint64_t FIRCLSReplayThreadWork(uint32_t run, uint32_t thread) {
+  return thread == run % FIRCLSReplayThreads ? 60 : 10;
+}
+
+// Some runs skip a checkpoint, as when the handler fails part of the way through a stage.
+static bool FIRCLSReplayReachesStage(uint32_t run, uint32_t stage) {
+  return (run + stage) % 11 != 0;
+}
+
+static void FIRCLSReplayHandler(const FIRCLSCrashTimingsReadOnlyContext* roContext,
+                                FIRCLSCrashTimingsWritableContext* rwContext,
+                                uint32_t run,
+                                FIRCLSFile* file) {
+  FIRCLSCrashTimingsStart(roContext, rwContext);
+
+  for (uint32_t stage = 0; stage < FIRCLSReplayStageCount; ++stage) {
+    if (stage + 1 == FIRCLSCrashTimingCheckpointThreadsRecorded) {
+      for (uint32_t thread = 0; thread < FIRCLSReplayThreads; ++thread) {
+        const uint64_t startTicks = FIRCLSCrashTimingsNow();
+
+        FIRCLSReplaySpin(FIRCLSReplayThreadWork(run, thread) * 1000);
+        FIRCLSCrashTimingsRecordThread(roContext, rwContext, thread, startTicks);
+      }
+    } else {
+      FIRCLSReplaySpin(FIRCLSReplayStageWork(stage) * 1000);
+    }
+
+    if (FIRCLSReplayReachesStage(run, stage)) {
+      FIRCLSCrashTimingsCheckpoint(roContext, rwContext, stage + 1);
+    }
+  }
+
+  FIRCLSCrashTimingsWrite(roContext, rwContext, file);
+}
+
+static char FIRCLSReplayPath[] = "/tmp/FIRCLSCrashTimingsReplay.XXXXXX";
+
+static void FIRCLSReplayEmittedSections(void) {
+  FIRCLSCrashTimingsReadOnlyContext roContext;
+  FIRCLSCrashTimingsWritableContext rwContext;
+  FIRCLSReplayReader reader;
+  FIRCLSFile file;
+
+  const int fd = mkstemp(FIRCLSReplayPath);
+  FIRCLSHostTestAssert(fd >= 0);
+  close(fd);
+
+  FIRCLSCrashTimingsInit(&roContext, &rwContext, true);
+  FIRCLSHostTestAssert(FIRCLSFileInitWithPath(&file, FIRCLSReplayPath, false));
+
+  for (uint32_t run = 0; run < FIRCLSReplayRuns; ++run) {
+    FIRCLSReplayHandler(&roContext, &rwContext, run, &file);
+  }
+
+  FIRCLSHostTestAssert(FIRCLSFileClose(&file));
+
+  FIRCLSReplayReaderInit(&reader);
+  FIRCLSHostTestAssert(FIRCLSSectionReaderReadFile(FIRCLSReplayPath, &FIRCLSReplayCallbacks,
+                                                   &reader));
+  FIRCLSHostTestAssert(reader.malformedCount == 0);
+  FIRCLSHostTestAssert(reader.sectionCount == FIRCLSReplayRuns);
+
+  for (uint32_t run = 0; run < reader.sectionCount && run < FIRCLSReplayRuns; ++run) {
+    const FIRCLSReplayTimings* timings = &reader.sections[run];
+    uint64_t work = 0;
+
+    // The work in a stage that wasn't reached shows up in the next one that was.
+    for (uint32_t stage = 0; stage < FIRCLSReplayStageCount; ++stage) {
+      if (stage + 1 == FIRCLSCrashTimingCheckpointThreadsRecorded) {
+        for (uint32_t thread = 0; thread < FIRCLSReplayThreads; ++thread) {
+          work += FIRCLSReplayThreadWork(run, thread) * 1000;
+        }
+      } else {
+        work += FIRCLSReplayStageWork(stage) * 1000;
+      }
+
+      FIRCLSHostTestAssert(timings->hasStage[stage] == FIRCLSReplayReachesStage(run, stage));
+      if (timings->hasStage[stage]) {
+        FIRCLSHostTestAssert(timings->stage[stage] >= work);
+        work = 0;
+      }
+    }
+
+    FIRCLSHostTestAssert(timings->threadCount == FIRCLSReplayThreads);
+    // The slow thread is almost always the slowest, but another one can be preempted for longer, so
+    // only the time is checked.
+    const uint32_t slowest = run % FIRCLSReplayThreads;
+    FIRCLSHostTestAssert(timings->slowestThreadTime >= FIRCLSReplayThreadWork(run, slowest) * 1000);
+  }
+
+  free(reader.sections);
+}
+
+static void FIRCLSReplayNothingWhenDisabledOrNotStarted(void) {
+  FIRCLSCrashTimingsReadOnlyContext roContext;
+  FIRCLSCrashTimingsWritableContext rwContext;
+  char path[] = "/tmp/FIRCLSCrashTimingsReplay.XXXXXX";
+  FIRCLSFile file;
+
+  const int fd = mkstemp(path);
+  FIRCLSHostTestAssert(fd >= 0);
+  close(fd);
+
+  FIRCLSHostTestAssert(FIRCLSFileInitWithPath(&file, path, false));
+
+  FIRCLSCrashTimingsInit(&roContext, &rwContext, false);
+  FIRCLSReplayHandler(&roContext, &rwContext, 1, &file);
+  FIRCLSHostTestAssert(rwContext.checkpoints[FIRCLSCrashTimingCheckpointStart] == 0);
+  FIRCLSHostTestAssert(rwContext.threadCount == 0);
+
+  FIRCLSCrashTimingsInit(&roContext, &rwContext, true);
+  FIRCLSCrashTimingsWrite(&roContext, &rwContext, &file);
+
+  FIRCLSHostTestAssert(file.writtenLength == 0);
+  FIRCLSHostTestAssert(FIRCLSFileClose(&file));
+
+  unlink(path);
+}
+
+static void FIRCLSReplayInconsistentSectionsAreRejected(void) {
+  static const char* const lines[] = {
+      // stages don't add up to the total
+      "{\"timings\":{\"suspend_threads\":5,\"total\":6,\"thread_count\":0}}\n",
+      // out of order
+      "{\"timings\":{\"record_threads\":5,\"suspend_threads\":1,\"total\":6,"
+      "\"thread_count\":0}}\n",
+      // slowest thread out of range
+      "{\"timings\":{\"total\":0,\"thread_count\":2,\"slowest_thread\":2,"
+      "\"slowest_thread_time\":0}}\n",
+      // slowest thread slower than its stage
+      "{\"timings\":{\"record_threads\":5,\"total\":5,\"thread_count\":1,"
+      "\"slowest_thread\":0,\"slowest_thread_time\":6}}\n",
+      // unknown key, and a value of the wrong type
+      "{\"timings\":{\"total\":0,\"thread_count\":0,\"other\":1}}\n",
+      "{\"timings\":{\"total\":\"0\",\"thread_count\":0}}\n",
+  };
+
+  for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    FIRCLSReplayReader reader;
+
+    FIRCLSReplayReaderInit(&reader);
+    FIRCLSHostTestAssert(FIRCLSSectionReaderReadBuffer(lines[i], strlen(lines[i]),
+                                                       &FIRCLSReplayCallbacks, &reader));
+    FIRCLSHostTestAssert(reader.sectionCount == 0);
+    FIRCLSHostTestAssert(reader.malformedCount == 1);
+    free(reader.sections);
+  }
+
+  // Other sections of a report are skipped.
+  static const char report[] =
+      "{\"threads\":[{\"stacktrace\":[1,2]}]}\n"
+      "{\"timings\":{\"suspend_threads\":5,\"total\":5,\"thread_count\":0}}\n";
+  FIRCLSReplayReader reader;
+
+  FIRCLSReplayReaderInit(&reader);
+  FIRCLSHostTestAssert(FIRCLSSectionReaderReadBuffer(report, strlen(report),
+                                                     &FIRCLSReplayCallbacks, &reader));
+  FIRCLSHostTestAssert(reader.sectionCount == 1 && reader.malformedCount == 0);
+  free(reader.sections);
+}
+
+static int FIRCLSReplayCompare(const void* a, const void* b) {
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void FIRCLSReplayPrintDistribution(const char* name, uint64_t* values, size_t count) {
+  if (count == 0) {
+    printf("%-20s %6zu\n", name, count);
+    return;
+  }
+
+  qsort(values, count, sizeof(uint64_t), FIRCLSReplayCompare);
+
+  printf("%-20s %6zu %10.1f %10.1f %10.1f\n", name, count, values[count / 2] / 1e3,
+         values[count * 9 / 10] / 1e3, values[count - 1] / 1e3);
+}
+
+static void FIRCLSReplayPrintAggregate(const FIRCLSReplayReader* reader) {
+  uint64_t* values = malloc((reader->sectionCount + 1) * sizeof(uint64_t));
+
+  FIRCLSHostTestAssert(values != NULL);
+  if (!values) {
+    return;
+  }
+
+  printf("%-20s %6s %10s %10s %10s   (us)\n", "stage", "count", "median", "p90", "max");
+
+  for (uint32_t stage = 0; stage < FIRCLSReplayStageCount; ++stage) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < reader->sectionCount; ++i) {
+      if (reader->sections[i].hasStage[stage]) {
+        values[count++] = reader->sections[i].stage[stage];
+      }
+    }
+
+    FIRCLSReplayPrintDistribution(FIRCLSReplayStageNames[stage], values, count);
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < reader->sectionCount; ++i) {
+    if (reader->sections[i].threadCount > 0) {
+      values[count++] = reader->sections[i].slowestThreadTime;
+    }
+  }
+  FIRCLSReplayPrintDistribution("slowest_thread_time", values, count);
+
+  for (size_t i = 0; i < reader->sectionCount; ++i) {
+    values[i] = reader->sections[i].total;
+  }
+  FIRCLSReplayPrintDistribution("total", values, reader->sectionCount);
+
+  free(values);
+}
+
+static void FIRCLSReplayAggregate(const char* const* paths, size_t pathCount) {
+  FIRCLSReplayReader reader;
+
+  FIRCLSReplayReaderInit(&reader);
+
+  for (size_t i = 0; i < pathCount; ++i) {
+    FIRCLSHostTestAssert(FIRCLSSectionReaderReadFile(paths[i], &FIRCLSReplayCallbacks, &reader));
+  }
+
+  FIRCLSHostTestAssert(reader.malformedCount == 0);
+  FIRCLSReplayPrintAggregate(&reader);
+
+  free(reader.sections);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc > 1) {
+    FIRCLSReplayAggregate(argv + 1, (size_t)argc - 1);
+    return FIRCLSHostTestFinish();
+  }
+
+  FIRCLSHostTestRun(FIRCLSReplayEmittedSections);
+  FIRCLSHostTestRun(FIRCLSReplayNothingWhenDisabledOrNotStarted);
+  FIRCLSHostTestRun(FIRCLSReplayInconsistentSectionsAreRejected);
+
+  const char* const paths[] = {FIRCLSReplayPath};
+  FIRCLSReplayAggregate(paths, 1);
+  unlink(FIRCLSReplayPath);
+
+  return FIRCLSHostTestFinish();
+}
@@ -0,0 +1,323 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSInternalLogging.h"
+#include "Crashlytics/Crashlytics/Components/FIRCLSGlobals.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FIRCLSTestRingCapacity (128)
+#define FIRCLSTestWriterCount (4)
+#define FIRCLSTestRecordsPerWriter (2000)
+
+#pragma mark - Context
+
+FIRCLSContext _firclsContext;
+dispatch_queue_t _firclsLoggingQueue;
+
+static FIRCLSReadOnlyContext FIRCLSTestReadOnly;
+static FIRCLSReadWriteContext FIRCLSTestWritable;
+static char FIRCLSTestLogPath[] = "/tmp/FIRCLSInternalLoggingTests.XXXXXX";
+
+// Flushes are scheduled on the logging queue, which doesn't exist here. They are kept instead, and
+// tests run them when they want to.
+static struct {
+  _Atomic(uint32_t) scheduledCount;
+  _Atomic(dispatch_function_t) work;
+  _Atomic(void*) context;
+} FIRCLSTestTimer;
+
+dispatch_time_t dispatch_time(dispatch_time_t when, int64_t delta) {
+  return when + (dispatch_time_t)delta;
+}
+
+void dispatch_after_f(dispatch_time_t when,
+                      dispatch_queue_t queue,
+                      void* context,
+                      dispatch_function_t work) {
+  atomic_store(&FIRCLSTestTimer.context, context);
+  atomic_store(&FIRCLSTestTimer.work, work);
+  atomic_fetch_add(&FIRCLSTestTimer.scheduledCount, 1);
+}
+
+bool FIRCLSContextHasCrashed(void) {
+  return _firclsContext.writable->crashOccurred;
+}
+
+static void FIRCLSTestRunScheduledFlush(void) {
+  const dispatch_function_t work = atomic_exchange(&FIRCLSTestTimer.work, NULL);
+  if (work) {
+    work(atomic_load(&FIRCLSTestTimer.context));
+  }
+}
+
+static void FIRCLSTestSetUp(FIRCLSInternalLogLevel level) {
+  // Anything a previous test left scheduled has to run, or no flush would be scheduled again.
+  FIRCLSTestRunScheduledFlush();
+
+  if (FIRCLSTestWritable.internalLogging.logFd >= 0) {
+    close(FIRCLSTestWritable.internalLogging.logFd);
+  }
+  truncate(FIRCLSTestLogPath, 0);
+
+  FIRCLSTestReadOnly.logPath = FIRCLSTestLogPath;
+  FIRCLSTestWritable.internalLogging.logFd = -1;
+  FIRCLSTestWritable.internalLogging.logLevel = level;
+  FIRCLSTestWritable.crashOccurred = false;
+  _firclsContext.readonly = &FIRCLSTestReadOnly;
+  _firclsContext.writable = &FIRCLSTestWritable;
+  atomic_store(&FIRCLSTestTimer.scheduledCount, 0);
+
+  FIRCLSSDKFileLogInitialize();
+}
+
+// Returns the log file's contents, which the caller frees.
+static char* FIRCLSTestReadLog(size_t* length) {
+  struct stat status;
+  stat(FIRCLSTestLogPath, &status);
+
+  char* contents = calloc((size_t)status.st_size + 1, 1);
+  const int fd = open(FIRCLSTestLogPath, O_RDONLY);
+  *length = (size_t)read(fd, contents, (size_t)status.st_size);
+  close(fd);
+
+  return contents;
+}
+
+static bool FIRCLSTestLogEquals(const char* expected) {
+  size_t length;
+  char* contents = FIRCLSTestReadLog(&length);
+  const bool equal = length == strlen(expected) && memcmp(contents, expected, length) == 0;
+
+  if (!equal) {
+    fprintf(stderr, "log was:\n%s\nexpected:\n%s\n", contents, expected);
+  }
+  free(contents);
+
+  return equal;
+}
+
+#pragma mark - Tests
+
+static void testFormatsRecordsWhenFlushed(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "a %d b %s c %u %x %p\n", -5, "str", 7u, 0xbeefu,
+                   (void*)0x1234);
+  const char* volatile missing = NULL;
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "%s and %s\n", "one", missing);
+
+  // Nothing is formatted or written on the logging thread.
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals(""));
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestTimer.scheduledCount) == 1);
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals("a -5 b str c 7 beef 0x1234\none and (null)\n"));
+}
+
+static void testSchedulesOneFlushAtATime(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+
+  for (uint32_t i = 0; i < 3; ++i) {
+    FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "n%u\n", i);
+  }
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestTimer.scheduledCount) == 1);
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "n%u\n", 3u);
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestTimer.scheduledCount) == 2);
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals("n0\nn1\nn2\nn3\n"));
+}
+
+static void testLevelsBelowTheContextsAreSkipped(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelWarn);
+
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "info\n");
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestTimer.scheduledCount) == 0);
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelError, "error\n");
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals("error\n"));
+}
+
+static void testStringsAreBounded(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+
+  char longString[300];
+  memset(longString, 'x', sizeof(longString) - 1);
+  longString[sizeof(longString) - 1] = '\0';
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "%s|%s\n", longString, "tail");
+
+  // The first string takes all of the record's string space, and the second doesn't fit.
+  char expected[160];
+  memset(expected, 'x', 127);
+  strcpy(expected + 127, "|...\n");
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals(expected));
+}
+
+static void testTooManyArgumentsKeepsTheFormat(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+
+  FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "%d %d %d %d %d %d %d %d %d\n", 1, 2, 3, 4, 5, 6,
+                   7, 8, 9);
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals("%d %d %d %d %d %d %d %d %d\n"));
+}
+
+static void testFullRingDropsAndReportsIt(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+
+  for (uint32_t i = 0; i < FIRCLSTestRingCapacity + 5; ++i) {
+    FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "n%u\n", i);
+  }
+
+  char expected[FIRCLSTestRingCapacity * 8 + 64];
+  size_t length = 0;
+  for (uint32_t i = 0; i < FIRCLSTestRingCapacity; ++i) {
+    length += (size_t)snprintf(expected + length, sizeof(expected) - length, "n%u\n", i);
+  }
+  snprintf(expected + length, sizeof(expected) - length,
+           "WARN  [FIRCLSSDKFileLogFlush] dropped 5 records\n");
+
+  FIRCLSTestRunScheduledFlush();
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals(expected));
+}
+
+static void testCrashFlushesAFullRingInline(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+  FIRCLSTestWritable.crashOccurred = true;
+
+  const uint32_t count = FIRCLSTestRingCapacity * 2 + 10;
+  for (uint32_t i = 0; i < count; ++i) {
+    FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "n%u\n", i);
+  }
+
+  // Nothing may be dispatched during a crash, and nothing is dropped, as the handler flushes.
+  FIRCLSHostTestAssert(atomic_load(&FIRCLSTestTimer.scheduledCount) == 0);
+  FIRCLSSDKFileLogFlush();
+
+  char expected[FIRCLSTestRingCapacity * 24];
+  size_t length = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    length += (size_t)snprintf(expected + length, sizeof(expected) - length, "n%u\n", i);
+  }
+  FIRCLSHostTestAssert(FIRCLSTestLogEquals(expected));
+}
+
+static _Atomic(bool) FIRCLSTestWritersDone;
+
+static void* FIRCLSTestWriterThread(void* argument) {
+  const uint32_t writer = (uint32_t)(uintptr_t)argument;
+
+  for (uint32_t i = 0; i < FIRCLSTestRecordsPerWriter; ++i) {
+    FIRCLSSDKFileLog(FIRCLSInternalLogLevelInfo, "t%u n%u\n", writer, i);
+    // Give the flusher a chance to keep up, so that it runs while records are being written.
+    if (i % 256 == 255) {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+static void* FIRCLSTestFlusherThread(void* argument) {
+  while (!atomic_load(&FIRCLSTestWritersDone)) {
+    FIRCLSSDKFileLogFlush();
+    sched_yield();
+  }
+
+  return NULL;
+}
+
+static void testConcurrentWriters(void) {
+  FIRCLSTestSetUp(FIRCLSInternalLogLevelDebug);
+  atomic_store(&FIRCLSTestWritersDone, false);
+
+  pthread_t writers[FIRCLSTestWriterCount];
+  pthread_t flusher;
+  pthread_create(&flusher, NULL, FIRCLSTestFlusherThread, NULL);
+  for (uint32_t i = 0; i < FIRCLSTestWriterCount; ++i) {
+    pthread_create(&writers[i], NULL, FIRCLSTestWriterThread, (void*)(uintptr_t)i);
+  }
+  for (uint32_t i = 0; i < FIRCLSTestWriterCount; ++i) {
+    pthread_join(writers[i], NULL);
+  }
+  atomic_store(&FIRCLSTestWritersDone, true);
+  pthread_join(flusher, NULL);
+  FIRCLSSDKFileLogFlush();
+
+  // Every record is either written whole, once, and in its writer's order, or counted as dropped.
+  size_t length;
+  char* contents = FIRCLSTestReadLog(&length);
+  uint32_t next[FIRCLSTestWriterCount] = {0};
+  uint32_t written = 0;
+  uint32_t dropped = 0;
+  uint32_t malformed = 0;
+  char* savedLine;
+  for (char* line = strtok_r(contents, "\n", &savedLine); line;
+       line = strtok_r(NULL, "\n", &savedLine)) {
+    unsigned int writer;
+    unsigned int sequence;
+    unsigned int count;
+    if (sscanf(line, "t%u n%u", &writer, &sequence) == 2 && writer < FIRCLSTestWriterCount &&
+        sequence >= next[writer]) {
+      next[writer] = sequence + 1;
+      written++;
+    } else if (sscanf(line, "WARN  [FIRCLSSDKFileLogFlush] dropped %u records", &count) == 1) {
+      dropped += count;
+    } else {
+      malformed++;
+    }
+  }
+  free(contents);
+
+  FIRCLSHostTestAssert(malformed == 0);
+  FIRCLSHostTestAssert(written + dropped == FIRCLSTestWriterCount * FIRCLSTestRecordsPerWriter);
+  printf("  %u records written, %u dropped\n", written, dropped);
+}
+
+int main(void) {
+  const int fd = mkstemp(FIRCLSTestLogPath);
+  if (fd < 0) {
+    perror("mkstemp");
+    return EXIT_FAILURE;
+  }
+  close(fd);
+  FIRCLSTestWritable.internalLogging.logFd = -1;
+  _firclsLoggingQueue = (dispatch_queue_t)&FIRCLSTestTimer;
+
+  FIRCLSHostTestRun(testFormatsRecordsWhenFlushed);
+  FIRCLSHostTestRun(testSchedulesOneFlushAtATime);
+  FIRCLSHostTestRun(testLevelsBelowTheContextsAreSkipped);
+  FIRCLSHostTestRun(testStringsAreBounded);
+  FIRCLSHostTestRun(testTooManyArgumentsKeepsTheFormat);
+  FIRCLSHostTestRun(testFullRingDropsAndReportsIt);
+  FIRCLSHostTestRun(testCrashFlushesAFullRingInline);
+  FIRCLSHostTestRun(testConcurrentWriters);
+
+  unlink(FIRCLSTestLogPath);
+  return FIRCLSHostTestFinish();
+}
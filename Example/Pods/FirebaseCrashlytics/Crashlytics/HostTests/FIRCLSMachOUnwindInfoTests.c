@@ -0,0 +1,272 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOUnwindInfo.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A section with one regular and one compressed second-level page, laid out as ld64 does:
+//
+//   functions 0x1000 ..< 0x5000 are in a regular page with entries at 0x1000, 0x1100 and 0x1800,
+//   the last of which has no encoding
+//   functions 0x5000 ..< 0x9000 are in a compressed page with entries at 0x5000, using a common
+//   encoding, and 0x5200, using one of the page's own
+typedef struct {
+  uint8_t bytes[160];
+  size_t length;
+} FIRCLSUnwindInfoTestSection;
+
+static void FIRCLSTestPut32(FIRCLSUnwindInfoTestSection* section, size_t offset, uint32_t value) {
+  memcpy(section->bytes + offset, &value, sizeof(value));
+  if (offset + sizeof(value) > section->length) {
+    section->length = offset + sizeof(value);
+  }
+}
+
+static void FIRCLSTestPut16(FIRCLSUnwindInfoTestSection* section, size_t offset, uint16_t value) {
+  memcpy(section->bytes + offset, &value, sizeof(value));
+  if (offset + sizeof(value) > section->length) {
+    section->length = offset + sizeof(value);
+  }
+}
+
+static FIRCLSUnwindInfoTestSection FIRCLSTestMakeSection(void) {
+  FIRCLSUnwindInfoTestSection section = {{0}, 0};
+  const size_t regularPage = 72;
+  const size_t compressedPage = 104;
+
+  // unwind_info_section_header
+  FIRCLSTestPut32(&section, 0, 1);
+  FIRCLSTestPut32(&section, 4, 28);  // common encodings
+  FIRCLSTestPut32(&section, 8, 2);
+  FIRCLSTestPut32(&section, 12, 0);  // personalities
+  FIRCLSTestPut32(&section, 16, 0);
+  FIRCLSTestPut32(&section, 20, 36);  // first-level index
+  FIRCLSTestPut32(&section, 24, 3);
+
+  FIRCLSTestPut32(&section, 28, 0x1000);
+  FIRCLSTestPut32(&section, 32, 0x2000);
+
+  // functionOffset, secondLevelPagesSectionOffset, lsdaIndexArraySectionOffset
+  FIRCLSTestPut32(&section, 36, 0x1000);
+  FIRCLSTestPut32(&section, 40, (uint32_t)regularPage);
+  FIRCLSTestPut32(&section, 48, 0x5000);
+  FIRCLSTestPut32(&section, 52, (uint32_t)compressedPage);
+  FIRCLSTestPut32(&section, 60, 0x9000);
+  FIRCLSTestPut32(&section, 64, 0);
+  FIRCLSTestPut32(&section, 68, 0);
+
+  // unwind_info_regular_second_level_page_header, then functionOffset and encoding pairs
+  FIRCLSTestPut32(&section, regularPage, 2);
+  FIRCLSTestPut16(&section, regularPage + 4, 8);
+  FIRCLSTestPut16(&section, regularPage + 6, 3);
+  FIRCLSTestPut32(&section, regularPage + 8, 0x1000);
+  FIRCLSTestPut32(&section, regularPage + 12, 0x11);
+  FIRCLSTestPut32(&section, regularPage + 16, 0x1100);
+  FIRCLSTestPut32(&section, regularPage + 20, 0x12);
+  FIRCLSTestPut32(&section, regularPage + 24, 0x1800);
+  FIRCLSTestPut32(&section, regularPage + 28, 0);
+
+  // unwind_info_compressed_second_level_page_header, then entries, then the page's encodings
+  FIRCLSTestPut32(&section, compressedPage, 3);
+  FIRCLSTestPut16(&section, compressedPage + 4, 12);
+  FIRCLSTestPut16(&section, compressedPage + 6, 2);
+  FIRCLSTestPut16(&section, compressedPage + 8, 20);
+  FIRCLSTestPut16(&section, compressedPage + 10, 1);
+  FIRCLSTestPut32(&section, compressedPage + 12, (0u << 24) | 0x000);
+  FIRCLSTestPut32(&section, compressedPage + 16, (2u << 24) | 0x200);
+  FIRCLSTestPut32(&section, compressedPage + 20, 0x33);
+
+  return section;
+}
+
+typedef struct {
+  uint32_t offset;
+  bool found;
+  FIRCLSMachOUnwindInfoEntry entry;
+} FIRCLSUnwindInfoTestCase;
+
+static const FIRCLSUnwindInfoTestCase FIRCLSTestCases[] = {
+    {0x0fff, false, {0, 0, 0}},
+    {0x1000, true, {0x11, 0x1000, 0x1100}},
+    {0x10ff, true, {0x11, 0x1000, 0x1100}},
+    {0x1100, true, {0x12, 0x1100, 0x1800}},
+    {0x1800, true, {0, 0x1800, 0x5000}},
+    {0x4fff, true, {0, 0x1800, 0x5000}},
+    {0x5000, true, {0x1000, 0x5000, 0x5200}},
+    {0x5200, true, {0x33, 0x5200, 0x9000}},
+    {0x8fff, true, {0x33, 0x5200, 0x9000}},
+    {0x9000, false, {0, 0, 0}},
+};
+
+#define FIRCLSTestCaseCount (sizeof(FIRCLSTestCases) / sizeof(FIRCLSTestCases[0]))
+
+static bool FIRCLSTestEntriesEqual(const FIRCLSMachOUnwindInfoEntry* a,
+                                   const FIRCLSMachOUnwindInfoEntry* b) {
+  return a->encoding == b->encoding && a->functionStart == b->functionStart &&
+         a->functionEnd == b->functionEnd;
+}
+
+static void testLooksUpRegularAndCompressedPages(void) {
+  const FIRCLSUnwindInfoTestSection bytes = FIRCLSTestMakeSection();
+  const FIRCLSMachOView section = {bytes.bytes, bytes.length};
+  FIRCLSMachOUnwindInfo unwindInfo;
+
+  FIRCLSHostTestAssert(FIRCLSMachOUnwindInfoInit(&unwindInfo, &section, false));
+
+  for (size_t i = 0; i < FIRCLSTestCaseCount; ++i) {
+    FIRCLSMachOUnwindInfoEntry entry;
+    const bool found = FIRCLSMachOUnwindInfoLookup(&unwindInfo, FIRCLSTestCases[i].offset, &entry);
+
+    FIRCLSHostTestAssert(found == FIRCLSTestCases[i].found);
+    if (found && FIRCLSTestCases[i].found) {
+      FIRCLSHostTestAssert(FIRCLSTestEntriesEqual(&entry, &FIRCLSTestCases[i].entry));
+    }
+  }
+}
+
+static void testSortedLookupsMatchSingleLookups(void) {
+  const FIRCLSUnwindInfoTestSection bytes = FIRCLSTestMakeSection();
+  const FIRCLSMachOView section = {bytes.bytes, bytes.length};
+  FIRCLSMachOUnwindInfo unwindInfo;
+  uint32_t offsets[FIRCLSTestCaseCount];
+  FIRCLSMachOUnwindInfoEntry entries[FIRCLSTestCaseCount];
+  bool found[FIRCLSTestCaseCount];
+  uint32_t expectedCount = 0;
+
+  FIRCLSHostTestAssert(FIRCLSMachOUnwindInfoInit(&unwindInfo, &section, false));
+
+  for (size_t i = 0; i < FIRCLSTestCaseCount; ++i) {
+    offsets[i] = FIRCLSTestCases[i].offset;
+    expectedCount += FIRCLSTestCases[i].found ? 1 : 0;
+  }
+
+  FIRCLSHostTestAssert(FIRCLSMachOUnwindInfoLookupSorted(&unwindInfo, offsets, FIRCLSTestCaseCount,
+                                                         entries, found) == expectedCount);
+
+  for (size_t i = 0; i < FIRCLSTestCaseCount; ++i) {
+    FIRCLSHostTestAssert(found[i] == FIRCLSTestCases[i].found);
+    if (found[i] && FIRCLSTestCases[i].found) {
+      FIRCLSHostTestAssert(FIRCLSTestEntriesEqual(&entries[i], &FIRCLSTestCases[i].entry));
+    }
+  }
+}
+
+static void testSwappedSectionsAreRead(void) {
+  FIRCLSUnwindInfoTestSection bytes = FIRCLSTestMakeSection();
+
+  // The header, the common encodings and the index are all uint32s.
+  for (size_t offset = 0; offset < 72; offset += 4) {
+    uint32_t value;
+
+    memcpy(&value, bytes.bytes + offset, sizeof(value));
+    value = __builtin_bswap32(value);
+    memcpy(bytes.bytes + offset, &value, sizeof(value));
+  }
+
+  const FIRCLSMachOView section = {bytes.bytes, bytes.length};
+  FIRCLSMachOUnwindInfo unwindInfo;
+  FIRCLSMachOUnwindInfoEntry entry;
+
+  FIRCLSHostTestAssert(FIRCLSMachOUnwindInfoInit(&unwindInfo, &section, true));
+  FIRCLSHostTestAssert(unwindInfo.indexCount == 3);
+
+  // the pages weren't swapped, so only the first-level search can be relied on
+  FIRCLSHostTestAssert(!FIRCLSMachOUnwindInfoLookup(&unwindInfo, 0x0fff, &entry));
+  FIRCLSHostTestAssert(!FIRCLSMachOUnwindInfoLookup(&unwindInfo, 0x9000, &entry));
+}
+
+// Each truncated copy is allocated at exactly its length, so any read past the end is caught by
+// the sanitizers.  A lookup may fail, but anything it finds must be what the whole section says.
+static void testTruncatedSectionsFailCleanly(void) {
+  const FIRCLSUnwindInfoTestSection bytes = FIRCLSTestMakeSection();
+
+  for (size_t length = 0; length < bytes.length; ++length) {
+    uint8_t* copy = malloc(length == 0 ? 1 : length);
+    FIRCLSMachOUnwindInfo unwindInfo;
+
+    FIRCLSHostTestAssert(copy != NULL);
+    if (!copy) {
+      return;
+    }
+
+    memcpy(copy, bytes.bytes, length);
+
+    const FIRCLSMachOView section = {copy, length};
+    if (FIRCLSMachOUnwindInfoInit(&unwindInfo, &section, false)) {
+      for (size_t i = 0; i < FIRCLSTestCaseCount; ++i) {
+        FIRCLSMachOUnwindInfoEntry entry;
+
+        if (FIRCLSMachOUnwindInfoLookup(&unwindInfo, FIRCLSTestCases[i].offset, &entry)) {
+          FIRCLSHostTestAssert(FIRCLSTestCases[i].found);
+          FIRCLSHostTestAssert(FIRCLSTestEntriesEqual(&entry, &FIRCLSTestCases[i].entry));
+        }
+      }
+    }
+
+    free(copy);
+  }
+}
+
+static void testCorruptSectionsFailCleanly(void) {
+  const FIRCLSUnwindInfoTestSection original = FIRCLSTestMakeSection();
+  uint32_t seed = 0x2545f491;
+
+  // Overwrite a few random bytes at a time, including the offsets and counts that every lookup
+  // depends on.
+  for (uint32_t round = 0; round < 20000; ++round) {
+    FIRCLSUnwindInfoTestSection bytes = original;
+
+    for (uint32_t j = 0; j < 3; ++j) {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      bytes.bytes[seed % bytes.length] = (uint8_t)(seed >> 24);
+    }
+
+    uint8_t* copy = malloc(bytes.length);
+    FIRCLSHostTestAssert(copy != NULL);
+    if (!copy) {
+      return;
+    }
+    memcpy(copy, bytes.bytes, bytes.length);
+
+    const FIRCLSMachOView section = {copy, bytes.length};
+    FIRCLSMachOUnwindInfo unwindInfo;
+
+    if (FIRCLSMachOUnwindInfoInit(&unwindInfo, &section, false)) {
+      for (uint32_t offset = 0; offset < 0xa000; offset += 0x80) {
+        FIRCLSMachOUnwindInfoEntry entry;
+
+        FIRCLSMachOUnwindInfoLookup(&unwindInfo, offset, &entry);
+      }
+    }
+
+    free(copy);
+  }
+}
+
+int main(void) {
+  FIRCLSHostTestRun(testLooksUpRegularAndCompressedPages);
+  FIRCLSHostTestRun(testSortedLookupsMatchSingleLookups);
+  FIRCLSHostTestRun(testSwappedSectionsAreRead);
+  FIRCLSHostTestRun(testTruncatedSectionsFailCleanly);
+  FIRCLSHostTestRun(testCorruptSectionsFailCleanly);
+
+  return FIRCLSHostTestFinish();
+}
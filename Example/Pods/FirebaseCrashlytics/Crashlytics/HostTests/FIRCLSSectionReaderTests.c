@@ -0,0 +1,381 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSSectionReader.h"
+
+#include "FIRCLSHostTest.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Records what the reader delivers as a compact trace, with one entry per section, so that tests
+// can compare whole files at once.
+typedef struct {
+  char trace[4096];
+  size_t traceLength;
+  uint32_t validSections;
+  uint32_t invalidSections;
+  size_t lastLineNumber;
+} FIRCLSSectionReaderTestRecorder;
+
+static void FIRCLSTestAppend(FIRCLSSectionReaderTestRecorder* recorder, const char* s, size_t n) {
+  if (recorder->traceLength + n >= sizeof(recorder->trace)) {
+    n = sizeof(recorder->trace) - recorder->traceLength - 1;
+  }
+
+  memcpy(recorder->trace + recorder->traceLength, s, n);
+  recorder->traceLength += n;
+  recorder->trace[recorder->traceLength] = '\0';
+}
+
+static void FIRCLSTestBeginObject(void* context) {
+  FIRCLSTestAppend(context, "{", 1);
+}
+
+static void FIRCLSTestEndObject(void* context) {
+  FIRCLSTestAppend(context, "}", 1);
+}
+
+static void FIRCLSTestBeginArray(void* context) {
+  FIRCLSTestAppend(context, "[", 1);
+}
+
+static void FIRCLSTestEndArray(void* context) {
+  FIRCLSTestAppend(context, "]", 1);
+}
+
+static void FIRCLSTestKey(void* context, const char* key, size_t length) {
+  FIRCLSTestAppend(context, key, length);
+  FIRCLSTestAppend(context, ":", 1);
+}
+
+static void FIRCLSTestString(void* context, const char* value, size_t length) {
+  FIRCLSTestAppend(context, "'", 1);
+  FIRCLSTestAppend(context, value, length);
+  FIRCLSTestAppend(context, "'", 1);
+}
+
+static void FIRCLSTestNumber(void* context, const FIRCLSSectionReaderNumber* number) {
+  char buffer[32];
+  int length;
+
+  if (number->isInteger) {
+    length = snprintf(buffer, sizeof(buffer), "%s%llu", number->isNegative ? "-" : "",
+                      (unsigned long long)number->magnitude);
+  } else {
+    length = snprintf(buffer, sizeof(buffer), "%g", number->value);
+  }
+
+  FIRCLSTestAppend(context, buffer, (size_t)length);
+}
+
+static void FIRCLSTestBoolean(void* context, bool value) {
+  FIRCLSTestAppend(context, value ? "T" : "F", 1);
+}
+
+static void FIRCLSTestNull(void* context) {
+  FIRCLSTestAppend(context, "N", 1);
+}
+
+static bool FIRCLSTestEndSection(void* context, size_t lineNumber, bool valid) {
+  FIRCLSSectionReaderTestRecorder* recorder = context;
+
+  if (valid) {
+    recorder->validSections++;
+  } else {
+    recorder->invalidSections++;
+  }
+
+  recorder->lastLineNumber = lineNumber;
+  FIRCLSTestAppend(recorder, valid ? "|" : "!|", valid ? 1 : 2);
+
+  return true;
+}
+
+static const FIRCLSSectionReaderCallbacks FIRCLSTestCallbacks = {
+    .beginObject = FIRCLSTestBeginObject,
+    .endObject = FIRCLSTestEndObject,
+    .beginArray = FIRCLSTestBeginArray,
+    .endArray = FIRCLSTestEndArray,
+    .key = FIRCLSTestKey,
+    .string = FIRCLSTestString,
+    .number = FIRCLSTestNumber,
+    .boolean = FIRCLSTestBoolean,
+    .null = FIRCLSTestNull,
+    .endSection = FIRCLSTestEndSection,
+};
+
+static FIRCLSSectionReaderTestRecorder FIRCLSTestReadString(const char* contents) {
+  FIRCLSSectionReaderTestRecorder recorder = {0};
+
+  FIRCLSSectionReaderReadBuffer(contents, strlen(contents), &FIRCLSTestCallbacks, &recorder);
+
+  return recorder;
+}
+
+// Writes contents to a new temporary file, and returns its path, which the caller unlinks.
+static char* FIRCLSTestWriteFile(const char* contents, size_t length) {
+  static char path[64];
+  strcpy(path, "/tmp/FIRCLSSectionReaderTests.XXXXXX");
+
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  const bool written = write(fd, contents, length) == (ssize_t)length;
+  close(fd);
+
+  return written ? path : NULL;
+}
+
+static const char* const FIRCLSTestRecords =
+    "{\"identity\":{\"generator\":\"Crashlytics\",\"started_at\":1700000000,\"beta\":false}}\n"
+    "{\"binary_images\":[{\"uuid\":\"0a1b\",\"base\":4294967296,\"size\":-12,\"path\":null}]}\n"
+    "{\"threads\":[{\"crashed\":true,\"stacktrace\":[1.5,2,3]}]}\n";
+
+static void testReadsSections(void) {
+  FIRCLSSectionReaderTestRecorder recorder = FIRCLSTestReadString(FIRCLSTestRecords);
+
+  FIRCLSHostTestAssert(recorder.validSections == 3);
+  FIRCLSHostTestAssert(recorder.invalidSections == 0);
+  FIRCLSHostTestAssert(strcmp(recorder.trace,
+                              "{identity:{generator:'Crashlytics'started_at:1700000000beta:F}}|"
+                              "{binary_images:[{uuid:'0a1b'base:4294967296size:-12path:N}]}|"
+                              "{threads:[{crashed:Tstacktrace:[1.523]}]}|") == 0);
+}
+
+static void testUnescapesStrings(void) {
+  FIRCLSSectionReaderTestRecorder recorder =
+      FIRCLSTestReadString("{\"k\\n\":\"a\\\"b\\\\c\\u00e9\\ud83d\\ude00\"}\n");
+
+  FIRCLSHostTestAssert(recorder.validSections == 1);
+  FIRCLSHostTestAssert(strcmp(recorder.trace, "{k\n:'a\"b\\c\xc3\xa9\xf0\x9f\x98\x80'}|") == 0);
+}
+
+static void testSkipsBlankLinesAndMissingFinalNewline(void) {
+  FIRCLSSectionReaderTestRecorder recorder = FIRCLSTestReadString("\n  \n{\"a\":1}\n\r\n{\"b\":2}");
+
+  FIRCLSHostTestAssert(recorder.validSections == 2);
+  FIRCLSHostTestAssert(recorder.lastLineNumber == 5);
+  FIRCLSHostTestAssert(strcmp(recorder.trace, "{a:1}|{b:2}|") == 0);
+}
+
+// Every kind of damage only invalidates its own line, and the lines after it are still read.
+static void testCorruptSectionsAreInvalid(void) {
+  static const char* const corruptLines[] = {
+      "{\"a\":1",                // unterminated object
+      "{\"a\":[1,2}",            // mismatched brackets
+      "{\"a\":1}}",              // trailing garbage
+      "{\"a\" 1}",               // missing colon
+      "{\"a\":1,}",              // trailing comma
+      "{a:1}",                   // unquoted key
+      "{\"a\":\"unterminated}",  // unterminated string
+      "{\"a\":\"\\q\"}",         // invalid escape
+      "{\"a\":\"\\u12\"}",       // short unicode escape
+      "{\"a\":tru}",             // truncated literal
+      "{\"a\":-}",               // bare minus
+      "{\"a\":1e}",              // truncated exponent
+      "\x01\xff\xfe garbage",    // binary noise
+      "{\"a\":1.}",              // truncated fraction
+  };
+  const size_t count = sizeof(corruptLines) / sizeof(corruptLines[0]);
+
+  for (size_t i = 0; i < count; ++i) {
+    char contents[256];
+    const int length = snprintf(contents, sizeof(contents), "{\"before\":1}\n%s\n{\"after\":2}\n",
+                                corruptLines[i]);
+    FIRCLSSectionReaderTestRecorder recorder = {0};
+
+    FIRCLSSectionReaderReadBuffer(contents, (size_t)length, &FIRCLSTestCallbacks, &recorder);
+
+    if (recorder.validSections != 2 || recorder.invalidSections != 1) {
+      fprintf(stderr, "corrupt line %zu: %u valid, %u invalid\n", i, recorder.validSections,
+              recorder.invalidSections);
+    }
+    FIRCLSHostTestAssert(recorder.validSections == 2);
+    FIRCLSHostTestAssert(recorder.invalidSections == 1);
+    FIRCLSHostTestAssert(strstr(recorder.trace, "{after:2}|") != NULL);
+  }
+}
+
+// A file that was preallocated, but never completely written, ends in NULs.
+static void testTrailingNULsAreInvalid(void) {
+  static const char contents[] = "{\"before\":1}\n{\"a\":\"b\"}\0\0\0\n{\"after\":2}\n\0\0";
+  FIRCLSSectionReaderTestRecorder recorder = {0};
+
+  FIRCLSSectionReaderReadBuffer(contents, sizeof(contents) - 1, &FIRCLSTestCallbacks, &recorder);
+
+  FIRCLSHostTestAssert(recorder.validSections == 2);
+  FIRCLSHostTestAssert(recorder.invalidSections == 2);
+}
+
+static void testNestingBeyondTheLimitIsInvalid(void) {
+  char contents[FIRCLSSectionReaderMaximumDepth * 2 + 64];
+  size_t length = 0;
+
+  for (uint32_t i = 0; i < FIRCLSSectionReaderMaximumDepth + 1; ++i) {
+    contents[length++] = '[';
+  }
+  for (uint32_t i = 0; i < FIRCLSSectionReaderMaximumDepth + 1; ++i) {
+    contents[length++] = ']';
+  }
+  memcpy(contents + length, "\n{\"after\":2}\n", 13);
+  length += 13;
+
+  FIRCLSSectionReaderTestRecorder recorder = {0};
+  FIRCLSSectionReaderReadBuffer(contents, length, &FIRCLSTestCallbacks, &recorder);
+
+  FIRCLSHostTestAssert(recorder.invalidSections == 1);
+  FIRCLSHostTestAssert(recorder.validSections == 1);
+}
+
+typedef struct {
+  uint32_t depth;
+  uint32_t deepest;
+  uint32_t objects;
+} FIRCLSSectionReaderTestDepth;
+
+static void FIRCLSTestDepthBegin(void* context) {
+  FIRCLSSectionReaderTestDepth* depth = context;
+
+  if (++depth->depth > depth->deepest) {
+    depth->deepest = depth->depth;
+  }
+}
+
+static void FIRCLSTestDepthBeginObject(void* context) {
+  ((FIRCLSSectionReaderTestDepth*)context)->objects++;
+  FIRCLSTestDepthBegin(context);
+}
+
+static void FIRCLSTestDepthEnd(void* context) {
+  ((FIRCLSSectionReaderTestDepth*)context)->depth--;
+}
+
+static const FIRCLSSectionReaderCallbacks FIRCLSTestDepthCallbacks = {
+    .beginObject = FIRCLSTestDepthBeginObject,
+    .endObject = FIRCLSTestDepthEnd,
+    .beginArray = FIRCLSTestDepthBegin,
+    .endArray = FIRCLSTestDepthEnd,
+};
+
+// Call stack trees nest two levels per frame, so a deep recursion makes for a very deep document.
+// It has to parse in full, and balanced, without running out of stack.
+static void testDeepDocumentsAreValid(void) {
+  const uint32_t frames = 100000;
+  const char* const open = "{\"address\":1,\"subFrames\":[\n";
+  const char* const close = "]}";
+  const size_t capacity = frames * (strlen(open) + strlen(close)) + 1;
+  char* contents = malloc(capacity);
+  size_t length = 0;
+
+  FIRCLSHostTestAssert(contents != NULL);
+  if (!contents) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < frames; ++i) {
+    memcpy(contents + length, open, strlen(open));
+    length += strlen(open);
+  }
+  for (uint32_t i = 0; i < frames; ++i) {
+    memcpy(contents + length, close, strlen(close));
+    length += strlen(close);
+  }
+
+  FIRCLSSectionReaderTestDepth depth = {0};
+  FIRCLSHostTestAssert(
+      FIRCLSSectionReaderReadDocument(contents, length, &FIRCLSTestDepthCallbacks, &depth));
+  FIRCLSHostTestAssert(depth.objects == frames);
+  FIRCLSHostTestAssert(depth.deepest == frames * 2);
+  FIRCLSHostTestAssert(depth.depth == 0);
+
+  // a missing close at the very bottom still makes the whole document invalid
+  depth = (FIRCLSSectionReaderTestDepth){0};
+  FIRCLSHostTestAssert(
+      !FIRCLSSectionReaderReadDocument(contents, length - 1, &FIRCLSTestDepthCallbacks, &depth));
+
+  free(contents);
+}
+
+// Cuts the file at every possible length, the way a crash on a full disk or a concurrent cleanup
+// would, and checks that only the lines that were completely written are valid.
+static void testTruncatedFiles(void) {
+  const size_t fullLength = strlen(FIRCLSTestRecords);
+  uint32_t completeLines = 0;
+
+  for (size_t length = 0; length <= fullLength; ++length) {
+    char* path = FIRCLSTestWriteFile(FIRCLSTestRecords, length);
+    FIRCLSSectionReaderTestRecorder recorder = {0};
+
+    FIRCLSHostTestAssert(path != NULL);
+    if (!path) {
+      return;
+    }
+
+    FIRCLSHostTestAssert(FIRCLSSectionReaderReadFile(path, &FIRCLSTestCallbacks, &recorder));
+    unlink(path);
+
+    if (length > 0 && FIRCLSTestRecords[length - 1] == '\n') {
+      completeLines++;
+    }
+
+    // A line cut right before its newline is still complete JSON.
+    const bool cutBeforeNewline = length < fullLength && FIRCLSTestRecords[length] == '\n';
+    const uint32_t expectedValid = completeLines + (cutBeforeNewline ? 1 : 0);
+    const bool partialLine = length > 0 && FIRCLSTestRecords[length - 1] != '\n' &&
+                             !cutBeforeNewline;
+
+    FIRCLSHostTestAssert(recorder.validSections == expectedValid);
+    FIRCLSHostTestAssert(recorder.invalidSections == (partialLine ? 1u : 0u));
+  }
+}
+
+static void testMissingFile(void) {
+  FIRCLSSectionReaderTestRecorder recorder = {0};
+
+  FIRCLSHostTestAssert(!FIRCLSSectionReaderReadFile("/nonexistent/FIRCLSSectionReaderTests",
+                                                    &FIRCLSTestCallbacks, &recorder));
+  FIRCLSHostTestAssert(recorder.validSections == 0);
+}
+
+static void testHexDecode(void) {
+  char output[8];
+
+  FIRCLSHostTestAssert(FIRCLSSectionReaderHexDecode("48656c6C6f", 10, output, sizeof(output)) == 5);
+  FIRCLSHostTestAssert(memcmp(output, "Hello", 5) == 0);
+
+  // stops at the first invalid character, at an odd trailing nybble, and when the output is full
+  FIRCLSHostTestAssert(FIRCLSSectionReaderHexDecode("4142zz43", 8, output, sizeof(output)) == 2);
+  FIRCLSHostTestAssert(FIRCLSSectionReaderHexDecode("414", 3, output, sizeof(output)) == 1);
+  FIRCLSHostTestAssert(FIRCLSSectionReaderHexDecode("41424344", 8, output, 3) == 3);
+}
+
+int main(void) {
+  FIRCLSHostTestRun(testReadsSections);
+  FIRCLSHostTestRun(testUnescapesStrings);
+  FIRCLSHostTestRun(testSkipsBlankLinesAndMissingFinalNewline);
+  FIRCLSHostTestRun(testCorruptSectionsAreInvalid);
+  FIRCLSHostTestRun(testTrailingNULsAreInvalid);
+  FIRCLSHostTestRun(testNestingBeyondTheLimitIsInvalid);
+  FIRCLSHostTestRun(testDeepDocumentsAreValid);
+  FIRCLSHostTestRun(testTruncatedFiles);
+  FIRCLSHostTestRun(testMissingFile);
+  FIRCLSHostTestRun(testHexDecode);
+
+  return FIRCLSHostTestFinish();
+}
@@ -0,0 +1,44 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSInternalLogging.h"
+
+#include <dispatch/dispatch.h>
+#include <stdbool.h>
+
+// Stands in for the device header, which pulls in every component's context. Only what the
+// components built on the host read is declared, and tests set it up themselves.
+
+__BEGIN_DECLS
+
+typedef struct {
+  const char* logPath;
+} FIRCLSReadOnlyContext;
+
+typedef struct {
+  FIRCLSInternalLoggingWritableContext internalLogging;
+  volatile bool crashOccurred;
+} FIRCLSReadWriteContext;
+
+typedef struct {
+  FIRCLSReadOnlyContext* readonly;
+  FIRCLSReadWriteContext* writable;
+} FIRCLSContext;
+
+bool FIRCLSContextHasCrashed(void);
+
+__END_DECLS
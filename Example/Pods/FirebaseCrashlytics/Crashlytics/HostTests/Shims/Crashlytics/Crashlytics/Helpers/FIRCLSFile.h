@@ -0,0 +1,55 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+// The real header declares a function that takes a block, which host compilers don't support.
+// Only what Shims/FIRCLSHostFile.c implements is declared here.
+
+__BEGIN_DECLS
+
+typedef struct {
+  int fd;
+  int collectionDepth;
+  bool needComma;
+
+  bool bufferWrites;
+  char* writeBuffer;
+  size_t writeBufferLength;
+
+  off_t writtenLength;
+} FIRCLSFile;
+
+bool FIRCLSFileInitWithPath(FIRCLSFile* file, const char* path, bool bufferWrites);
+bool FIRCLSFileClose(FIRCLSFile* file);
+
+void FIRCLSFileWriteSectionStart(FIRCLSFile* file, const char* name);
+void FIRCLSFileWriteSectionEnd(FIRCLSFile* file);
+
+void FIRCLSFileWriteHashStart(FIRCLSFile* file);
+void FIRCLSFileWriteHashEnd(FIRCLSFile* file);
+void FIRCLSFileWriteHashKey(FIRCLSFile* file, const char* key);
+void FIRCLSFileWriteHashEntryUint64(FIRCLSFile* file, const char* key, uint64_t value);
+
+void FIRCLSFileFDWriteUInt64(int fd, uint64_t number, bool hex);
+void FIRCLSFileFDWriteInt64(int fd, int64_t number);
+
+__END_DECLS
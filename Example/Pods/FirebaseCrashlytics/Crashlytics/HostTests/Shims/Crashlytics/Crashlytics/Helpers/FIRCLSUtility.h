@@ -0,0 +1,45 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <mach/vm_types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/cdefs.h>
+
+// Stands in for the device header, which pulls in the whole crash context.  SDK logging goes to
+// stderr, and only when FIRCLS_HOST_VERBOSE is set, so that benches aren't measuring it.
+
+#ifndef MAP_NOCACHE
+#define MAP_NOCACHE 0
+#endif
+
+#define FIRCLSIsValidPointer(x) ((uintptr_t)x >= 4096)
+
+__BEGIN_DECLS
+
+void FIRCLSHostShimLog(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+__END_DECLS
+
+// FIRCLSInternalLogging itself is built for its own tests, which get the real macros.
+#ifndef FIRCLSSDKLog
+#define FIRCLSSDKLogDebug(__FORMAT__, ...) FIRCLSHostShimLog(__FORMAT__, ##__VA_ARGS__)
+#define FIRCLSSDKLogInfo(__FORMAT__, ...) FIRCLSHostShimLog(__FORMAT__, ##__VA_ARGS__)
+#define FIRCLSSDKLogWarn(__FORMAT__, ...) FIRCLSHostShimLog(__FORMAT__, ##__VA_ARGS__)
+#define FIRCLSSDKLogError(__FORMAT__, ...) FIRCLSHostShimLog(__FORMAT__, ##__VA_ARGS__)
+#define FIRCLSSDKLog FIRCLSSDKLogWarn
+#endif
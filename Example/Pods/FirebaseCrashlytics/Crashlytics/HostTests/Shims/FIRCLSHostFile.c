@@ -0,0 +1,121 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// The part of FIRCLSFile's writer that C components use to write sections and numbers, for host
+// builds, where FIRCLSFile.m can't be compiled.  The output is the same line-delimited JSON,
+// written unbuffered.
+// Keys aren't escaped, because only fixed keys are written through here.
+
+#include "Crashlytics/Crashlytics/Helpers/FIRCLSFile.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+bool FIRCLSFileInitWithPath(FIRCLSFile* file, const char* path, bool bufferWrites) {
+  memset(file, 0, sizeof(FIRCLSFile));
+
+  file->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+  return file->fd >= 0;
+}
+
+bool FIRCLSFileClose(FIRCLSFile* file) {
+  const bool closed = close(file->fd) == 0;
+
+  file->fd = -1;
+
+  return closed;
+}
+
+static void FIRCLSHostFileWrite(FIRCLSFile* file, const char* string, size_t length) {
+  while (length > 0) {
+    const ssize_t written = write(file->fd, string, length);
+    if (written <= 0) {
+      return;
+    }
+
+    string += written;
+    length -= (size_t)written;
+    file->writtenLength += written;
+  }
+}
+
+void FIRCLSFileWriteHashStart(FIRCLSFile* file) {
+  if (file->needComma) {
+    FIRCLSHostFileWrite(file, ",", 1);
+  }
+  FIRCLSHostFileWrite(file, "{", 1);
+
+  file->collectionDepth++;
+  file->needComma = false;
+}
+
+void FIRCLSFileWriteHashEnd(FIRCLSFile* file) {
+  FIRCLSHostFileWrite(file, "}", 1);
+
+  if (file->collectionDepth <= 0) {
+    return;
+  }
+
+  file->collectionDepth--;
+  file->needComma = file->collectionDepth > 0;
+}
+
+void FIRCLSFileWriteHashKey(FIRCLSFile* file, const char* key) {
+  if (file->needComma) {
+    FIRCLSHostFileWrite(file, ",", 1);
+  }
+
+  FIRCLSHostFileWrite(file, "\"", 1);
+  FIRCLSHostFileWrite(file, key, strlen(key));
+  FIRCLSHostFileWrite(file, "\":", 2);
+
+  file->needComma = false;
+}
+
+void FIRCLSFileWriteHashEntryUint64(FIRCLSFile* file, const char* key, uint64_t value) {
+  char string[24];
+
+  FIRCLSFileWriteHashKey(file, key);
+  FIRCLSHostFileWrite(file, string, (size_t)snprintf(string, sizeof(string), "%" PRIu64, value));
+
+  file->needComma = true;
+}
+
+void FIRCLSFileFDWriteUInt64(int fd, uint64_t number, bool hex) {
+  char string[24];
+  const int length = snprintf(string, sizeof(string), hex ? "%" PRIx64 : "%" PRIu64, number);
+
+  write(fd, string, (size_t)length);
+}
+
+void FIRCLSFileFDWriteInt64(int fd, int64_t number) {
+  char string[24];
+
+  write(fd, string, (size_t)snprintf(string, sizeof(string), "%" PRId64, number));
+}
+
+void FIRCLSFileWriteSectionStart(FIRCLSFile* file, const char* name) {
+  FIRCLSFileWriteHashStart(file);
+  FIRCLSFileWriteHashKey(file, name);
+}
+
+void FIRCLSFileWriteSectionEnd(FIRCLSFile* file) {
+  FIRCLSFileWriteHashEnd(file);
+  FIRCLSHostFileWrite(file, "\n", 1);
+}
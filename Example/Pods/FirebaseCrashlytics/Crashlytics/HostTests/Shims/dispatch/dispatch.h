@@ -0,0 +1,39 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// Only the timer that FIRCLSInternalLogging schedules its flushes with is declared. Tests that
+// link code using it define these, so that they decide when the scheduled work runs.
+
+#define NSEC_PER_MSEC 1000000ull
+
+typedef struct FIRCLSHostDispatchQueue* dispatch_queue_t;
+typedef uint64_t dispatch_time_t;
+typedef void (*dispatch_function_t)(void*);
+
+#define DISPATCH_TIME_NOW (0ull)
+
+__BEGIN_DECLS
+
+dispatch_time_t dispatch_time(dispatch_time_t when, int64_t delta);
+void dispatch_after_f(dispatch_time_t when,
+                      dispatch_queue_t queue,
+                      void* context,
+                      dispatch_function_t work);
+
+__END_DECLS
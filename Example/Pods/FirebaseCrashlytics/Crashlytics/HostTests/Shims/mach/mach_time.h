@@ -0,0 +1,40 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <mach/mach.h>
+
+#include <stdint.h>
+#include <time.h>
+
+// Host ticks are CLOCK_MONOTONIC nanoseconds.
+typedef struct {
+  uint32_t numer;
+  uint32_t denom;
+} mach_timebase_info_data_t;
+
+static inline kern_return_t mach_timebase_info(mach_timebase_info_data_t* info) {
+  info->numer = 1;
+  info->denom = 1;
+  return KERN_SUCCESS;
+}
+
+static inline uint64_t mach_absolute_time(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
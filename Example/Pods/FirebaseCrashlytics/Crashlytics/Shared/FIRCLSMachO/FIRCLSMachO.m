@@ -14,6 +14,7 @@
 
 #include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachO.h"
 #include "Crashlytics/Crashlytics/Helpers/FIRCLSDefines.h"
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOView.h"
 
 #include <Foundation/Foundation.h>
 
@@ -23,11 +24,7 @@
 #include <mach-o/ldsyms.h>
 #include <mach-o/utils.h>
 
-#include <sys/mman.h>
-#include <sys/stat.h>
-
 #include <dlfcn.h>
-#include <fcntl.h>
 
 #include <stdio.h>
 
@@ -41,49 +38,29 @@ static void FIRCLSMachOHeaderValues(FIRCLSMachOSliceRef slice,
                                     uint32_t* cmdCount);
 static bool FIRCLSMachOSliceIsValid(FIRCLSMachOSliceRef slice);
 
+typedef struct {
+  FIRCLSMachOLoadCommandIteratorFunc function;
+  void* context;
+} FIRCLSMachOLoadCommandIteration;
+
 bool FIRCLSMachOFileInitWithPath(FIRCLSMachOFileRef file, const char* path) {
+  FIRCLSMachOView view;
+
   if (!file || !path) {
     return false;
   }
 
-  file->fd = 0;
+  // The mapping keeps the file open, so there is no descriptor to hold on to.
+  file->fd = -1;
   file->mappedFile = NULL;
   file->mappedSize = 0;
 
-  file->fd = open(path, O_RDONLY);
-  if (file->fd < 0) {
-    // unable to open mach-o file
+  if (!FIRCLSMachOViewMapFile(path, &view)) {
     return false;
   }
 
-  NSError* attributesError;
-  NSString* objCPath = [NSString stringWithCString:path encoding:NSUTF8StringEncoding];
-  NSDictionary* fileAttributes =
-      [[NSFileManager defaultManager] attributesOfItemAtPath:objCPath error:&attributesError];
-  if (attributesError != nil) {
-    close(file->fd);
-    return false;
-  }
-  NSNumber* fileSizeNumber = [fileAttributes objectForKey:NSFileSize];
-  long long currentFileSize = [fileSizeNumber longLongValue];
-  NSFileAttributeType fileType = [fileAttributes objectForKey:NSFileType];
-
-  // We need some minimum size for this to even be a possible mach-o file.  I believe
-  // its probably quite a bit bigger than this, but this at least covers something.
-  // We also need it to be a regular file.
-  file->mappedSize = (size_t)currentFileSize;
-  if (currentFileSize < 16 || ![fileType isEqualToString:NSFileTypeRegular]) {
-    close(file->fd);
-    return false;
-  }
-
-  // Map the file to memory. MAP_SHARED can potentially reduce the amount of actual private
-  // memory needed to do this mapping. Also, be sure to check for the correct failure result.
-  file->mappedFile = mmap(0, file->mappedSize, PROT_READ, MAP_FILE | MAP_SHARED, file->fd, 0);
-  if (!file->mappedFile || (file->mappedFile == MAP_FAILED)) {
-    close(file->fd);
-    return false;
-  }
+  file->mappedFile = (void*)view.data;
+  file->mappedSize = view.length;
 
   return true;
 }
@@ -101,15 +78,42 @@ void FIRCLSMachOFileDestroy(FIRCLSMachOFileRef file) {
     return;
   }
 
-  if (file->mappedFile && file->mappedSize > 0) {
-    munmap(file->mappedFile, file->mappedSize);
+  FIRCLSMachOView view = {.data = file->mappedFile, .length = file->mappedSize};
+
+  FIRCLSMachOViewUnmapFile(&view);
+
+  file->mappedFile = NULL;
+  file->mappedSize = 0;
+
+  if (file->fd >= 0) {
+    close(file->fd);
+    file->fd = -1;
   }
+}
+
+static bool FIRCLSMachOFileSliceIterator(const FIRCLSMachOSliceView* sliceView, void* context) {
+  FIRCLSMachOSliceIterator block = (__bridge FIRCLSMachOSliceIterator)context;
+  struct FIRCLSMachOSlice slice;
+
+  slice.startAddress = sliceView->view.data;
+  slice.cputype = sliceView->cputype;
+  slice.cpusubtype = sliceView->cpusubtype;
 
-  close(file->fd);
+  block(&slice);
+
+  return true;
 }
 
 void FIRCLSMachOFileEnumerateSlices(FIRCLSMachOFileRef file, FIRCLSMachOSliceIterator block) {
-  FIRCLSMachOEnumerateSlicesAtAddress(file->mappedFile, block);
+  if (!file || !file->mappedFile || !block) {
+    return;
+  }
+
+  // Unlike FIRCLSMachOEnumerateSlicesAtAddress, the size of a file is known, so every fat_arch
+  // entry and slice can be checked against it.
+  FIRCLSMachOView view = {.data = file->mappedFile, .length = file->mappedSize};
+
+  FIRCLSMachOViewEnumerateSlices(&view, FIRCLSMachOFileSliceIterator, (__bridge void*)block);
 }
 
 void FIRCLSMachOEnumerateSlicesAtAddress(void* executableData, FIRCLSMachOSliceIterator block) {
@@ -226,29 +230,55 @@ static bool FIRCLSMachOSliceIsValid(FIRCLSMachOSliceRef slice) {
   return true;
 }
 
+static bool FIRCLSMachOLoadCommandIterator_f(uint32_t type,
+                                             const FIRCLSMachOView* command,
+                                             void* context) {
+  FIRCLSMachOLoadCommandIteration* iteration = context;
+
+  iteration->function(type, (uint32_t)command->length, (const struct load_command*)command->data,
+                      iteration->context);
+
+  return true;
+}
+
+static bool FIRCLSMachOLoadCommandIteratorBlock(uint32_t type,
+                                                const FIRCLSMachOView* command,
+                                                void* context) {
+  FIRCLSMachOLoadCommandIterator block = (__bridge FIRCLSMachOLoadCommandIterator)context;
+
+  block(type, (uint32_t)command->length, (const struct load_command*)command->data);
+
+  return true;
+}
+
+// Walking the commands through a view stops at the header's sizeofcmds, and at any command whose
+// cmdsize would run past it, rather than trusting every cmdsize.
 void FIRCLSMachOSliceEnumerateLoadCommands_f(FIRCLSMachOSliceRef slice,
                                              void* context,
                                              FIRCLSMachOLoadCommandIteratorFunc function) {
-  const struct load_command* cmd;
-  uint32_t cmdCount;
+  FIRCLSMachOSliceView sliceView;
+
+  if (!function) {
+    return;
+  }
 
   if (!FIRCLSMachOSliceIsValid(slice)) {
     return;
   }
 
-  FIRCLSMachOHeaderValues(slice, &cmd, &cmdCount);
+  if (!FIRCLSMachOSliceViewInitWithHeader(&sliceView, slice->startAddress)) {
+    return;
+  }
 
-  for (uint32_t i = 0; cmd != NULL && i < cmdCount; ++i) {
-    function(cmd->cmd, cmd->cmdsize, cmd, context);
+  FIRCLSMachOLoadCommandIteration iteration = {.function = function, .context = context};
 
-    cmd = (struct load_command*)((uintptr_t)cmd + cmd->cmdsize);
-  }
+  FIRCLSMachOSliceViewEnumerateLoadCommands(&sliceView, FIRCLSMachOLoadCommandIterator_f,
+                                            &iteration);
 }
 
 void FIRCLSMachOSliceEnumerateLoadCommands(FIRCLSMachOSliceRef slice,
                                            FIRCLSMachOLoadCommandIterator block) {
-  const struct load_command* cmd;
-  uint32_t cmdCount;
+  FIRCLSMachOSliceView sliceView;
 
   if (!block) {
     return;
@@ -258,13 +288,12 @@ void FIRCLSMachOSliceEnumerateLoadCommands(FIRCLSMachOSliceRef slice,
     return;
   }
 
-  FIRCLSMachOHeaderValues(slice, &cmd, &cmdCount);
-
-  for (uint32_t i = 0; cmd != NULL && i < cmdCount; ++i) {
-    block(cmd->cmd, cmd->cmdsize, cmd);
-
-    cmd = (struct load_command*)((uintptr_t)cmd + cmd->cmdsize);
+  if (!FIRCLSMachOSliceViewInitWithHeader(&sliceView, slice->startAddress)) {
+    return;
   }
+
+  FIRCLSMachOSliceViewEnumerateLoadCommands(&sliceView, FIRCLSMachOLoadCommandIteratorBlock,
+                                            (__bridge void*)block);
 }
 
 struct FIRCLSMachOSlice FIRCLSMachOSliceGetCurrent(void) {
@@ -410,30 +439,21 @@ bool FIRCLSMachOSliceInitSectionByName(FIRCLSMachOSliceRef slice,
 
   memset(section, 0, sizeof(FIRCLSMachOSection));
 
-// Deprecated code for vision OS, entire function is not used anywhere
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wdeprecated-declarations"
-  if (FIRCLSMachOSliceIs64Bit(slice)) {
-    const struct section_64* sect =
-        getsectbynamefromheader_64(slice->startAddress, segName, sectionName);
-    if (!sect) {
-      return false;
-    }
+  FIRCLSMachOSliceView sliceView;
+  FIRCLSMachOViewSection viewSection;
 
-    section->addr = sect->addr;
-    section->size = sect->size;
-    section->offset = sect->offset;
-  } else {
-    const struct section* sect = getsectbynamefromheader(slice->startAddress, segName, sectionName);
-    if (!sect) {
-      return false;
-    }
+  if (!FIRCLSMachOSliceViewInitWithHeader(&sliceView, slice->startAddress)) {
+    return false;
+  }
 
-    section->addr = sect->addr;
-    section->size = sect->size;
-    section->offset = sect->offset;
+  if (!FIRCLSMachOSliceViewFindSection(&sliceView, segName, sectionName, &viewSection)) {
+    return false;
   }
-#pragma clang diagnostic pop
+
+  section->addr = viewSection.addr;
+  section->size = viewSection.size;
+  section->offset = viewSection.offset;
+
   return true;
 }
 
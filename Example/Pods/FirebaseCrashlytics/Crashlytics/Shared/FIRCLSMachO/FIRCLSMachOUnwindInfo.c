@@ -0,0 +1,383 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOUnwindInfo.h"
+
+#include <string.h>
+
+// These mirror <mach-o/compact_unwind_encoding.h>.
+#define FIRCLSMachOUnwindInfoVersion (1)
+#define FIRCLSMachOUnwindInfoIndexEntrySize (12)
+#define FIRCLSMachOUnwindInfoRegularEntrySize (8)
+#define FIRCLSMachOUnwindInfoEncodingSize (4)
+#define FIRCLSMachOUnwindInfoRegularPageKind (2)
+#define FIRCLSMachOUnwindInfoCompressedPageKind (3)
+#define FIRCLSMachOUnwindInfoCompressedOffsetMask (0x00ffffffu)
+
+typedef struct {
+  uint32_t index;
+  uint32_t functionOffset;
+  uint32_t nextFunctionOffset;
+  uint32_t pageOffset;
+} FIRCLSMachOUnwindInfoFirstLevel;
+
+static bool FIRCLSMachOUnwindInfoReadUInt16(const FIRCLSMachOView* view,
+                                            uint64_t offset,
+                                            bool swap,
+                                            uint16_t* value) {
+  FIRCLSMachOView bytes;
+
+  if (!FIRCLSMachOViewSubview(view, offset, sizeof(uint16_t), &bytes)) {
+    return false;
+  }
+
+  memcpy(value, bytes.data, sizeof(uint16_t));
+
+  if (swap) {
+    *value = __builtin_bswap16(*value);
+  }
+
+  return true;
+}
+
+// Finds the last of count sorted keys that is <= target. Keys are the masked uint32 at the start of
+// each stride-sized entry.
+static bool FIRCLSMachOUnwindInfoSearch(const FIRCLSMachOView* view,
+                                        uint64_t base,
+                                        uint64_t stride,
+                                        uint32_t count,
+                                        uint32_t mask,
+                                        bool swap,
+                                        uint32_t target,
+                                        uint32_t* index) {
+  uint32_t low = 0;
+  uint32_t high = count;
+  uint32_t key;
+
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+
+    if (!FIRCLSMachOViewReadUInt32(view, base + middle * stride, swap, &key)) {
+      return false;
+    }
+
+    if ((key & mask) <= target) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  // low is now the first key that is > target
+  if (low == 0) {
+    return false;
+  }
+
+  *index = low - 1;
+
+  return true;
+}
+
+static bool FIRCLSMachOUnwindInfoReadFirstLevel(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                                uint32_t index,
+                                                FIRCLSMachOUnwindInfoFirstLevel* firstLevel) {
+  const uint64_t offset =
+      unwindInfo->indexOffset + (uint64_t)index * FIRCLSMachOUnwindInfoIndexEntrySize;
+
+  firstLevel->index = index;
+
+  return FIRCLSMachOViewReadUInt32(&unwindInfo->section, offset, unwindInfo->swapped,
+                                   &firstLevel->functionOffset) &&
+         FIRCLSMachOViewReadUInt32(&unwindInfo->section, offset + 4, unwindInfo->swapped,
+                                   &firstLevel->pageOffset) &&
+         FIRCLSMachOViewReadUInt32(&unwindInfo->section,
+                                   offset + FIRCLSMachOUnwindInfoIndexEntrySize,
+                                   unwindInfo->swapped, &firstLevel->nextFunctionOffset);
+}
+
+static bool FIRCLSMachOUnwindInfoFindFirstLevel(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                                uint32_t offset,
+                                                FIRCLSMachOUnwindInfoFirstLevel* firstLevel) {
+  uint32_t index;
+
+  // The last entry only marks the end of the previous one, so it is not searched.
+  if (!FIRCLSMachOUnwindInfoSearch(&unwindInfo->section, unwindInfo->indexOffset,
+                                   FIRCLSMachOUnwindInfoIndexEntrySize, unwindInfo->indexCount - 1,
+                                   UINT32_MAX, unwindInfo->swapped, offset, &index)) {
+    return false;
+  }
+
+  if (!FIRCLSMachOUnwindInfoReadFirstLevel(unwindInfo, index, firstLevel)) {
+    return false;
+  }
+
+  return offset < firstLevel->nextFunctionOffset;
+}
+
+static bool FIRCLSMachOUnwindInfoLookupRegular(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                               const FIRCLSMachOView* page,
+                                               const FIRCLSMachOUnwindInfoFirstLevel* firstLevel,
+                                               uint32_t offset,
+                                               FIRCLSMachOUnwindInfoEntry* entry) {
+  const bool swap = unwindInfo->swapped;
+  uint16_t entryPageOffset;
+  uint16_t entryCount;
+  uint32_t index;
+
+  if (!FIRCLSMachOUnwindInfoReadUInt16(page, 4, swap, &entryPageOffset) ||
+      !FIRCLSMachOUnwindInfoReadUInt16(page, 6, swap, &entryCount)) {
+    return false;
+  }
+
+  // regular entries hold full offsets from the image
+  if (!FIRCLSMachOUnwindInfoSearch(page, entryPageOffset, FIRCLSMachOUnwindInfoRegularEntrySize,
+                                   entryCount, UINT32_MAX, swap, offset, &index)) {
+    return false;
+  }
+
+  const uint64_t entryOffset =
+      entryPageOffset + (uint64_t)index * FIRCLSMachOUnwindInfoRegularEntrySize;
+
+  if (!FIRCLSMachOViewReadUInt32(page, entryOffset, swap, &entry->functionStart) ||
+      !FIRCLSMachOViewReadUInt32(page, entryOffset + 4, swap, &entry->encoding)) {
+    return false;
+  }
+
+  entry->functionEnd = firstLevel->nextFunctionOffset;
+
+  if (index + 1 < entryCount) {
+    return FIRCLSMachOViewReadUInt32(page, entryOffset + FIRCLSMachOUnwindInfoRegularEntrySize,
+                                     swap, &entry->functionEnd);
+  }
+
+  return true;
+}
+
+static bool FIRCLSMachOUnwindInfoLookupCompressed(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                                  const FIRCLSMachOView* page,
+                                                  const FIRCLSMachOUnwindInfoFirstLevel* firstLevel,
+                                                  uint32_t offset,
+                                                  FIRCLSMachOUnwindInfoEntry* entry) {
+  const bool swap = unwindInfo->swapped;
+  uint16_t entryPageOffset;
+  uint16_t entryCount;
+  uint16_t encodingsPageOffset;
+  uint16_t encodingsCount;
+  uint32_t index;
+  uint32_t value;
+
+  if (!FIRCLSMachOUnwindInfoReadUInt16(page, 4, swap, &entryPageOffset) ||
+      !FIRCLSMachOUnwindInfoReadUInt16(page, 6, swap, &entryCount) ||
+      !FIRCLSMachOUnwindInfoReadUInt16(page, 8, swap, &encodingsPageOffset) ||
+      !FIRCLSMachOUnwindInfoReadUInt16(page, 10, swap, &encodingsCount)) {
+    return false;
+  }
+
+  // compressed entries are relative to the first-level entry, in their low 24 bits
+  const uint32_t target = offset - firstLevel->functionOffset;
+
+  if (!FIRCLSMachOUnwindInfoSearch(page, entryPageOffset, sizeof(uint32_t), entryCount,
+                                   FIRCLSMachOUnwindInfoCompressedOffsetMask, swap, target,
+                                   &index)) {
+    return false;
+  }
+
+  const uint64_t entryOffset = entryPageOffset + (uint64_t)index * sizeof(uint32_t);
+
+  if (!FIRCLSMachOViewReadUInt32(page, entryOffset, swap, &value)) {
+    return false;
+  }
+
+  entry->functionStart =
+      firstLevel->functionOffset + (value & FIRCLSMachOUnwindInfoCompressedOffsetMask);
+
+  // The encoding index points into the common encodings first, then into the page's own.
+  const uint32_t encodingIndex = value >> 24;
+
+  if (encodingIndex < unwindInfo->commonEncodingsCount) {
+    if (!FIRCLSMachOViewReadUInt32(
+            &unwindInfo->section,
+            unwindInfo->commonEncodingsOffset +
+                (uint64_t)encodingIndex * FIRCLSMachOUnwindInfoEncodingSize,
+            swap, &entry->encoding)) {
+      return false;
+    }
+  } else {
+    const uint32_t pageEncodingIndex = encodingIndex - unwindInfo->commonEncodingsCount;
+
+    if (pageEncodingIndex >= encodingsCount ||
+        !FIRCLSMachOViewReadUInt32(
+            page,
+            encodingsPageOffset + (uint64_t)pageEncodingIndex * FIRCLSMachOUnwindInfoEncodingSize,
+            swap, &entry->encoding)) {
+      return false;
+    }
+  }
+
+  entry->functionEnd = firstLevel->nextFunctionOffset;
+
+  if (index + 1 < entryCount) {
+    if (!FIRCLSMachOViewReadUInt32(page, entryOffset + sizeof(uint32_t), swap, &value)) {
+      return false;
+    }
+
+    entry->functionEnd =
+        firstLevel->functionOffset + (value & FIRCLSMachOUnwindInfoCompressedOffsetMask);
+  }
+
+  return true;
+}
+
+static bool FIRCLSMachOUnwindInfoLookupInFirstLevel(
+    const FIRCLSMachOUnwindInfo* unwindInfo,
+    const FIRCLSMachOUnwindInfoFirstLevel* firstLevel,
+    uint32_t offset,
+    FIRCLSMachOUnwindInfoEntry* entry) {
+  FIRCLSMachOView page;
+  uint32_t kind;
+
+  if (firstLevel->pageOffset == 0) {
+    return false;
+  }
+
+  if (!FIRCLSMachOViewSubview(&unwindInfo->section, firstLevel->pageOffset,
+                              unwindInfo->section.length - firstLevel->pageOffset, &page)) {
+    return false;
+  }
+
+  if (!FIRCLSMachOViewReadUInt32(&page, 0, unwindInfo->swapped, &kind)) {
+    return false;
+  }
+
+  memset(entry, 0, sizeof(FIRCLSMachOUnwindInfoEntry));
+
+  switch (kind) {
+    case FIRCLSMachOUnwindInfoRegularPageKind:
+      return FIRCLSMachOUnwindInfoLookupRegular(unwindInfo, &page, firstLevel, offset, entry);
+    case FIRCLSMachOUnwindInfoCompressedPageKind:
+      return FIRCLSMachOUnwindInfoLookupCompressed(unwindInfo, &page, firstLevel, offset, entry);
+    default:
+      return false;
+  }
+}
+
+#pragma mark - API
+bool FIRCLSMachOUnwindInfoInit(FIRCLSMachOUnwindInfo* unwindInfo,
+                               const FIRCLSMachOView* section,
+                               bool swapped) {
+  uint32_t version;
+
+  if (!unwindInfo || !section) {
+    return false;
+  }
+
+  memset(unwindInfo, 0, sizeof(FIRCLSMachOUnwindInfo));
+
+  if (!FIRCLSMachOViewReadUInt32(section, 0, swapped, &version) ||
+      version != FIRCLSMachOUnwindInfoVersion) {
+    return false;
+  }
+
+  if (!FIRCLSMachOViewReadUInt32(section, 4, swapped, &unwindInfo->commonEncodingsOffset) ||
+      !FIRCLSMachOViewReadUInt32(section, 8, swapped, &unwindInfo->commonEncodingsCount) ||
+      !FIRCLSMachOViewReadUInt32(section, 20, swapped, &unwindInfo->indexOffset) ||
+      !FIRCLSMachOViewReadUInt32(section, 24, swapped, &unwindInfo->indexCount)) {
+    return false;
+  }
+
+  // There is always one more first-level entry than there are pages, which marks the end of the
+  // last one.
+  if (unwindInfo->indexCount < 2) {
+    return false;
+  }
+
+  unwindInfo->section = *section;
+  unwindInfo->swapped = swapped;
+
+  return true;
+}
+
+bool FIRCLSMachOUnwindInfoInitWithSlice(FIRCLSMachOUnwindInfo* unwindInfo,
+                                        const FIRCLSMachOSliceView* slice) {
+  FIRCLSMachOViewSection section;
+  FIRCLSMachOView data;
+
+  if (!slice) {
+    return false;
+  }
+
+  if (!FIRCLSMachOSliceViewFindSection(slice, "__TEXT", "__unwind_info", &section)) {
+    return false;
+  }
+
+  if (!FIRCLSMachOSliceViewGetSectionData(slice, &section, &data)) {
+    return false;
+  }
+
+  return FIRCLSMachOUnwindInfoInit(unwindInfo, &data, slice->swapped);
+}
+
+bool FIRCLSMachOUnwindInfoLookup(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                 uint32_t offset,
+                                 FIRCLSMachOUnwindInfoEntry* entry) {
+  FIRCLSMachOUnwindInfoFirstLevel firstLevel;
+
+  if (!unwindInfo || !entry) {
+    return false;
+  }
+
+  if (!FIRCLSMachOUnwindInfoFindFirstLevel(unwindInfo, offset, &firstLevel)) {
+    return false;
+  }
+
+  return FIRCLSMachOUnwindInfoLookupInFirstLevel(unwindInfo, &firstLevel, offset, entry);
+}
+
+uint32_t FIRCLSMachOUnwindInfoLookupSorted(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                           const uint32_t* offsets,
+                                           uint32_t count,
+                                           FIRCLSMachOUnwindInfoEntry* entries,
+                                           bool* found) {
+  FIRCLSMachOUnwindInfoFirstLevel firstLevel;
+  bool haveFirstLevel = false;
+  uint32_t foundCount = 0;
+
+  if (!unwindInfo || !offsets || !entries || !found) {
+    return 0;
+  }
+
+  memset(found, 0, sizeof(bool) * count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t offset = offsets[i];
+
+    // Sorted offsets mostly land in the page of the one before, so only search the first level
+    // again once they have moved past it.
+    if (!haveFirstLevel || offset < firstLevel.functionOffset ||
+        offset >= firstLevel.nextFunctionOffset) {
+      haveFirstLevel = FIRCLSMachOUnwindInfoFindFirstLevel(unwindInfo, offset, &firstLevel);
+
+      if (!haveFirstLevel) {
+        continue;
+      }
+    }
+
+    if (FIRCLSMachOUnwindInfoLookupInFirstLevel(unwindInfo, &firstLevel, offset, &entries[i])) {
+      found[i] = true;
+      foundCount++;
+    }
+  }
+
+  return foundCount;
+}
@@ -0,0 +1,67 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOView.h"
+
+// A bounds-checked reader for __TEXT,__unwind_info, built on FIRCLSMachOView. It answers the same
+// question as FIRCLSCompactUnwindLookupAndCompute's lookup step, but reads from a view over a
+// mapped binary or dSYM instead of from the live image, so that addresses from reports can be
+// re-resolved off-device. Like the rest of FIRCLSMachOView, it only depends on libc.
+
+__BEGIN_DECLS
+
+typedef struct {
+  FIRCLSMachOView section;
+  bool swapped;
+
+  uint32_t commonEncodingsOffset;
+  uint32_t commonEncodingsCount;
+  uint32_t indexOffset;
+  uint32_t indexCount;
+} FIRCLSMachOUnwindInfo;
+
+// Offsets are relative to the image's mach header, which for a file is its __TEXT vmaddr.
+typedef struct {
+  // Zero means the function has no compact unwind information.
+  uint32_t encoding;
+  uint32_t functionStart;
+  uint32_t functionEnd;
+} FIRCLSMachOUnwindInfoEntry;
+
+bool FIRCLSMachOUnwindInfoInit(FIRCLSMachOUnwindInfo* unwindInfo,
+                               const FIRCLSMachOView* section,
+                               bool swapped);
+bool FIRCLSMachOUnwindInfoInitWithSlice(FIRCLSMachOUnwindInfo* unwindInfo,
+                                        const FIRCLSMachOSliceView* slice);
+
+bool FIRCLSMachOUnwindInfoLookup(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                 uint32_t offset,
+                                 FIRCLSMachOUnwindInfoEntry* entry);
+
+// Looks up many offsets in one walk over the first-level index. The offsets must be sorted in
+// ascending order. entries and found must both have room for count entries. Returns the number
+// found.
+uint32_t FIRCLSMachOUnwindInfoLookupSorted(const FIRCLSMachOUnwindInfo* unwindInfo,
+                                           const uint32_t* offsets,
+                                           uint32_t count,
+                                           FIRCLSMachOUnwindInfoEntry* entries,
+                                           bool* found);
+
+__END_DECLS
@@ -0,0 +1,553 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Crashlytics/Shared/FIRCLSMachO/FIRCLSMachOView.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// These mirror <mach-o/loader.h> and <mach-o/fat.h>, which are not available everywhere this
+// file is built.
+#define FIRCLSMachOViewMHMagic (0xfeedfaceu)
+#define FIRCLSMachOViewMHCigam (0xcefaedfeu)
+#define FIRCLSMachOViewMHMagic64 (0xfeedfacfu)
+#define FIRCLSMachOViewMHCigam64 (0xcffaedfeu)
+#define FIRCLSMachOViewFatMagic (0xcafebabeu)
+#define FIRCLSMachOViewFatMagic64 (0xcafebabfu)
+
+#define FIRCLSMachOViewLCSegment (0x1u)
+#define FIRCLSMachOViewLCSegment64 (0x19u)
+#define FIRCLSMachOViewLCUUID (0x1bu)
+
+#define FIRCLSMachOViewHeaderSize (28)
+#define FIRCLSMachOViewHeaderSize64 (32)
+#define FIRCLSMachOViewFatArchSize (20)
+#define FIRCLSMachOViewFatArchSize64 (32)
+#define FIRCLSMachOViewLoadCommandSize (8)
+#define FIRCLSMachOViewUUIDCommandSize (24)
+#define FIRCLSMachOViewSegmentCommandSize (56)
+#define FIRCLSMachOViewSegmentCommandSize64 (72)
+#define FIRCLSMachOViewSectionSize (68)
+#define FIRCLSMachOViewSectionSize64 (80)
+
+#define FIRCLSMachOViewSectionTypeMask (0xffu)
+#define FIRCLSMachOViewSectionTypeZeroFill (0x1u)
+#define FIRCLSMachOViewSectionTypeGBZeroFill (0xcu)
+#define FIRCLSMachOViewSectionTypeThreadLocalZeroFill (0x12u)
+
+// We need some minimum size for this to even be a possible mach-o file.
+#define FIRCLSMachOViewMinimumFileSize (16)
+
+typedef struct {
+  const char* segName;
+  const char* sectionName;
+  FIRCLSMachOViewSection* section;
+  const FIRCLSMachOSliceView* slice;
+  bool found;
+} FIRCLSMachOViewSectionSearch;
+
+static bool FIRCLSMachOViewHostIsLittleEndian(void) {
+  const uint16_t one = 1;
+
+  return *(const uint8_t*)&one == 1;
+}
+
+#pragma mark - Views
+bool FIRCLSMachOViewSubview(const FIRCLSMachOView* view,
+                            uint64_t offset,
+                            uint64_t length,
+                            FIRCLSMachOView* subview) {
+  if (!view || !view->data || !subview) {
+    return false;
+  }
+
+  if (offset > view->length || length > view->length - offset) {
+    return false;
+  }
+
+  subview->data = view->data + offset;
+  subview->length = (size_t)length;
+
+  return true;
+}
+
+bool FIRCLSMachOViewReadUInt32(const FIRCLSMachOView* view,
+                               uint64_t offset,
+                               bool swap,
+                               uint32_t* value) {
+  FIRCLSMachOView bytes;
+
+  if (!value || !FIRCLSMachOViewSubview(view, offset, sizeof(uint32_t), &bytes)) {
+    return false;
+  }
+
+  // memcpy, because nothing guarantees the offset is aligned
+  memcpy(value, bytes.data, sizeof(uint32_t));
+
+  if (swap) {
+    *value = __builtin_bswap32(*value);
+  }
+
+  return true;
+}
+
+bool FIRCLSMachOViewReadUInt64(const FIRCLSMachOView* view,
+                               uint64_t offset,
+                               bool swap,
+                               uint64_t* value) {
+  FIRCLSMachOView bytes;
+
+  if (!value || !FIRCLSMachOViewSubview(view, offset, sizeof(uint64_t), &bytes)) {
+    return false;
+  }
+
+  memcpy(value, bytes.data, sizeof(uint64_t));
+
+  if (swap) {
+    *value = __builtin_bswap64(*value);
+  }
+
+  return true;
+}
+
+bool FIRCLSMachOViewMapFile(const char* path, FIRCLSMachOView* view) {
+  struct stat fileStat;
+
+  if (!path || !view) {
+    return false;
+  }
+
+  view->data = NULL;
+  view->length = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) ||
+      fileStat.st_size < FIRCLSMachOViewMinimumFileSize) {
+    close(fd);
+    return false;
+  }
+
+  // MAP_SHARED can potentially reduce the amount of actual private memory needed to do this
+  // mapping. The mapping holds its own reference to the file, so the descriptor can be closed.
+  void* mappedFile = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (!mappedFile || mappedFile == MAP_FAILED) {
+    return false;
+  }
+
+  view->data = mappedFile;
+  view->length = (size_t)fileStat.st_size;
+
+  return true;
+}
+
+void FIRCLSMachOViewUnmapFile(FIRCLSMachOView* view) {
+  if (!view || !view->data) {
+    return;
+  }
+
+  munmap((void*)view->data, view->length);
+
+  view->data = NULL;
+  view->length = 0;
+}
+
+#pragma mark - Slices
+bool FIRCLSMachOSliceViewInit(FIRCLSMachOSliceView* slice, const FIRCLSMachOView* view) {
+  uint32_t magic;
+  uint32_t value;
+  uint32_t commandsSize;
+  uint64_t headerSize;
+
+  if (!slice || !FIRCLSMachOViewReadUInt32(view, 0, false, &magic)) {
+    return false;
+  }
+
+  memset(slice, 0, sizeof(FIRCLSMachOSliceView));
+
+  switch (magic) {
+    case FIRCLSMachOViewMHMagic:
+    case FIRCLSMachOViewMHCigam:
+      slice->is64Bit = false;
+      slice->swapped = magic == FIRCLSMachOViewMHCigam;
+      headerSize = FIRCLSMachOViewHeaderSize;
+      break;
+    case FIRCLSMachOViewMHMagic64:
+    case FIRCLSMachOViewMHCigam64:
+      slice->is64Bit = true;
+      slice->swapped = magic == FIRCLSMachOViewMHCigam64;
+      headerSize = FIRCLSMachOViewHeaderSize64;
+      break;
+    default:
+      // not a valid header
+      return false;
+  }
+
+  // the 32 and 64 bit headers only differ after these fields
+  if (!FIRCLSMachOViewReadUInt32(view, 4, slice->swapped, &value)) {
+    return false;
+  }
+  slice->cputype = (int32_t)value;
+
+  if (!FIRCLSMachOViewReadUInt32(view, 8, slice->swapped, &value)) {
+    return false;
+  }
+  slice->cpusubtype = (int32_t)value;
+
+  if (!FIRCLSMachOViewReadUInt32(view, 16, slice->swapped, &slice->commandCount) ||
+      !FIRCLSMachOViewReadUInt32(view, 20, slice->swapped, &commandsSize)) {
+    return false;
+  }
+
+  if (!FIRCLSMachOViewSubview(view, headerSize, commandsSize, &slice->commands)) {
+    return false;
+  }
+
+  slice->view = *view;
+
+  return true;
+}
+
+bool FIRCLSMachOSliceViewInitWithHeader(FIRCLSMachOSliceView* slice, const void* header) {
+  uint32_t magic;
+  uint32_t commandsSize;
+  uint64_t headerSize;
+
+  if (!slice || !header) {
+    return false;
+  }
+
+  // A loaded image is mapped at least as far as the end of its load commands, so read just enough
+  // of the header to find that bound.
+  memcpy(&magic, header, sizeof(uint32_t));
+
+  switch (magic) {
+    case FIRCLSMachOViewMHMagic:
+    case FIRCLSMachOViewMHCigam:
+      headerSize = FIRCLSMachOViewHeaderSize;
+      break;
+    case FIRCLSMachOViewMHMagic64:
+    case FIRCLSMachOViewMHCigam64:
+      headerSize = FIRCLSMachOViewHeaderSize64;
+      break;
+    default:
+      return false;
+  }
+
+  FIRCLSMachOView view = {.data = header, .length = (size_t)headerSize};
+
+  if (!FIRCLSMachOViewReadUInt32(
+          &view, 20, magic == FIRCLSMachOViewMHCigam || magic == FIRCLSMachOViewMHCigam64,
+          &commandsSize)) {
+    return false;
+  }
+
+  view.length = (size_t)(headerSize + commandsSize);
+
+  return FIRCLSMachOSliceViewInit(slice, &view);
+}
+
+uint32_t FIRCLSMachOViewEnumerateSlices(const FIRCLSMachOView* view,
+                                        FIRCLSMachOViewSliceFunc function,
+                                        void* context) {
+  FIRCLSMachOSliceView slice;
+  uint32_t magic;
+  uint32_t archCount;
+  uint32_t visitedCount = 0;
+
+  if (!function) {
+    return 0;
+  }
+
+  // fat headers are always big-endian
+  const bool swapFat = FIRCLSMachOViewHostIsLittleEndian();
+
+  if (!FIRCLSMachOViewReadUInt32(view, 0, swapFat, &magic)) {
+    return 0;
+  }
+
+  if (magic != FIRCLSMachOViewFatMagic && magic != FIRCLSMachOViewFatMagic64) {
+    if (!FIRCLSMachOSliceViewInit(&slice, view)) {
+      return 0;
+    }
+
+    function(&slice, context);
+
+    return 1;
+  }
+
+  if (!FIRCLSMachOViewReadUInt32(view, 4, swapFat, &archCount)) {
+    return 0;
+  }
+
+  const bool isFat64 = magic == FIRCLSMachOViewFatMagic64;
+  const uint64_t archSize = isFat64 ? FIRCLSMachOViewFatArchSize64 : FIRCLSMachOViewFatArchSize;
+
+  for (uint32_t i = 0; i < archCount; ++i) {
+    const uint64_t archOffset = 8 + i * archSize;
+    uint64_t sliceOffset;
+    uint64_t sliceSize;
+
+    if (isFat64) {
+      if (!FIRCLSMachOViewReadUInt64(view, archOffset + 8, swapFat, &sliceOffset) ||
+          !FIRCLSMachOViewReadUInt64(view, archOffset + 16, swapFat, &sliceSize)) {
+        break;
+      }
+    } else {
+      uint32_t offset32;
+      uint32_t size32;
+
+      if (!FIRCLSMachOViewReadUInt32(view, archOffset + 8, swapFat, &offset32) ||
+          !FIRCLSMachOViewReadUInt32(view, archOffset + 12, swapFat, &size32)) {
+        break;
+      }
+
+      sliceOffset = offset32;
+      sliceSize = size32;
+    }
+
+    FIRCLSMachOView sliceBytes;
+
+    if (!FIRCLSMachOViewSubview(view, sliceOffset, sliceSize, &sliceBytes)) {
+      continue;
+    }
+
+    if (!FIRCLSMachOSliceViewInit(&slice, &sliceBytes)) {
+      continue;
+    }
+
+    visitedCount++;
+
+    if (!function(&slice, context)) {
+      break;
+    }
+  }
+
+  return visitedCount;
+}
+
+#pragma mark - Load Commands
+bool FIRCLSMachOSliceViewEnumerateLoadCommands(const FIRCLSMachOSliceView* slice,
+                                               FIRCLSMachOViewLoadCommandFunc function,
+                                               void* context) {
+  uint64_t offset = 0;
+
+  if (!slice || !function) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < slice->commandCount; ++i) {
+    FIRCLSMachOView command;
+    uint32_t type;
+    uint32_t size;
+
+    if (!FIRCLSMachOViewReadUInt32(&slice->commands, offset, slice->swapped, &type) ||
+        !FIRCLSMachOViewReadUInt32(&slice->commands, offset + 4, slice->swapped, &size)) {
+      return false;
+    }
+
+    // a command smaller than its own header would never advance
+    if (size < FIRCLSMachOViewLoadCommandSize) {
+      return false;
+    }
+
+    if (!FIRCLSMachOViewSubview(&slice->commands, offset, size, &command)) {
+      return false;
+    }
+
+    if (!function(type, &command, context)) {
+      return true;
+    }
+
+    offset += size;
+  }
+
+  return true;
+}
+
+static bool FIRCLSMachOViewFindUUID(uint32_t type, const FIRCLSMachOView* command, void* context) {
+  if (type != FIRCLSMachOViewLCUUID || command->length < FIRCLSMachOViewUUIDCommandSize) {
+    return true;
+  }
+
+  memcpy(context, command->data + FIRCLSMachOViewLoadCommandSize, FIRCLSMachOViewUUIDLength);
+
+  return false;
+}
+
+bool FIRCLSMachOSliceViewGetUUID(const FIRCLSMachOSliceView* slice,
+                                 uint8_t uuid[FIRCLSMachOViewUUIDLength]) {
+  uint8_t found[FIRCLSMachOViewUUIDLength];
+  const uint8_t zero[FIRCLSMachOViewUUIDLength] = {0};
+
+  if (!uuid) {
+    return false;
+  }
+
+  memset(found, 0, sizeof(found));
+
+  FIRCLSMachOSliceViewEnumerateLoadCommands(slice, FIRCLSMachOViewFindUUID, found);
+
+  if (memcmp(found, zero, FIRCLSMachOViewUUIDLength) == 0) {
+    return false;
+  }
+
+  memcpy(uuid, found, FIRCLSMachOViewUUIDLength);
+
+  return true;
+}
+
+#pragma mark - Sections
+static bool FIRCLSMachOViewNameMatches(const uint8_t* field, const char* name) {
+  // names fill all 16 bytes when they are that long, and so are not always terminated
+  return strncmp((const char*)field, name, FIRCLSMachOViewNameLength) == 0;
+}
+
+static void FIRCLSMachOViewCopyName(char* destination, const uint8_t* field) {
+  memcpy(destination, field, FIRCLSMachOViewNameLength);
+  destination[FIRCLSMachOViewNameLength] = '\0';
+}
+
+static bool FIRCLSMachOViewSearchSegment(uint32_t type,
+                                         const FIRCLSMachOView* command,
+                                         void* context) {
+  FIRCLSMachOViewSectionSearch* search = context;
+  const bool swapped = search->slice->swapped;
+  uint64_t commandSize;
+  uint64_t sectionSize;
+  uint64_t nsectsOffset;
+  uint32_t sectionCount;
+
+  if (type == FIRCLSMachOViewLCSegment) {
+    commandSize = FIRCLSMachOViewSegmentCommandSize;
+    sectionSize = FIRCLSMachOViewSectionSize;
+    nsectsOffset = 48;
+  } else if (type == FIRCLSMachOViewLCSegment64) {
+    commandSize = FIRCLSMachOViewSegmentCommandSize64;
+    sectionSize = FIRCLSMachOViewSectionSize64;
+    nsectsOffset = 64;
+  } else {
+    return true;
+  }
+
+  if (command->length < commandSize) {
+    return true;
+  }
+
+  // Object files put all of their sections in one segment with an empty name.
+  const uint8_t* segname = command->data + FIRCLSMachOViewLoadCommandSize;
+  if (segname[0] != '\0' && !FIRCLSMachOViewNameMatches(segname, search->segName)) {
+    return true;
+  }
+
+  if (!FIRCLSMachOViewReadUInt32(command, nsectsOffset, swapped, &sectionCount)) {
+    return true;
+  }
+
+  for (uint32_t i = 0; i < sectionCount; ++i) {
+    FIRCLSMachOView section;
+
+    if (!FIRCLSMachOViewSubview(command, commandSize + i * sectionSize, sectionSize, &section)) {
+      break;
+    }
+
+    if (!FIRCLSMachOViewNameMatches(section.data, search->sectionName) ||
+        !FIRCLSMachOViewNameMatches(section.data + FIRCLSMachOViewNameLength, search->segName)) {
+      continue;
+    }
+
+    FIRCLSMachOViewSection* result = search->section;
+
+    FIRCLSMachOViewCopyName(result->sectname, section.data);
+    FIRCLSMachOViewCopyName(result->segname, section.data + FIRCLSMachOViewNameLength);
+
+    if (type == FIRCLSMachOViewLCSegment64) {
+      FIRCLSMachOViewReadUInt64(&section, 32, swapped, &result->addr);
+      FIRCLSMachOViewReadUInt64(&section, 40, swapped, &result->size);
+      FIRCLSMachOViewReadUInt32(&section, 48, swapped, &result->offset);
+      FIRCLSMachOViewReadUInt32(&section, 64, swapped, &result->flags);
+    } else {
+      uint32_t addr32;
+      uint32_t size32;
+
+      FIRCLSMachOViewReadUInt32(&section, 32, swapped, &addr32);
+      FIRCLSMachOViewReadUInt32(&section, 36, swapped, &size32);
+      FIRCLSMachOViewReadUInt32(&section, 40, swapped, &result->offset);
+      FIRCLSMachOViewReadUInt32(&section, 56, swapped, &result->flags);
+
+      result->addr = addr32;
+      result->size = size32;
+    }
+
+    search->found = true;
+
+    return false;
+  }
+
+  return true;
+}
+
+bool FIRCLSMachOSliceViewFindSection(const FIRCLSMachOSliceView* slice,
+                                     const char* segName,
+                                     const char* sectionName,
+                                     FIRCLSMachOViewSection* section) {
+  if (!slice || !segName || !sectionName || !section) {
+    return false;
+  }
+
+  memset(section, 0, sizeof(FIRCLSMachOViewSection));
+
+  FIRCLSMachOViewSectionSearch search = {
+      .segName = segName,
+      .sectionName = sectionName,
+      .section = section,
+      .slice = slice,
+      .found = false,
+  };
+
+  FIRCLSMachOSliceViewEnumerateLoadCommands(slice, FIRCLSMachOViewSearchSegment, &search);
+
+  return search.found;
+}
+
+bool FIRCLSMachOSliceViewGetSectionData(const FIRCLSMachOSliceView* slice,
+                                        const FIRCLSMachOViewSection* section,
+                                        FIRCLSMachOView* data) {
+  if (!slice || !section || !data) {
+    return false;
+  }
+
+  switch (section->flags & FIRCLSMachOViewSectionTypeMask) {
+    case FIRCLSMachOViewSectionTypeZeroFill:
+    case FIRCLSMachOViewSectionTypeGBZeroFill:
+    case FIRCLSMachOViewSectionTypeThreadLocalZeroFill:
+      return false;
+  }
+
+  // The header is always at offset zero, so a zero offset means the contents are not in this file,
+  // as is the case for most sections of a dSYM.
+  if (section->offset == 0) {
+    return false;
+  }
+
+  return FIRCLSMachOViewSubview(&slice->view, section->offset, section->size, data);
+}
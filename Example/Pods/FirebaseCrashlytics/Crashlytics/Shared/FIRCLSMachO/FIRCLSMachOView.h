@@ -0,0 +1,113 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+
+// The parsing core behind FIRCLSMachO. Everything here works on bounds-checked views over bytes
+// that are already in memory, either a mapped file or a loaded image, and never copies them. It
+// only depends on libc and POSIX, and carries its own copies of the few Mach-O constants it needs,
+// so that it can be built and run against dSYMs and app bundles off-device.
+
+__BEGIN_DECLS
+
+#define FIRCLSMachOViewUUIDLength (16)
+#define FIRCLSMachOViewNameLength (16)
+
+typedef struct {
+  const uint8_t* data;
+  size_t length;
+} FIRCLSMachOView;
+
+// Each of these fails, rather than reading past the end of the view.
+bool FIRCLSMachOViewSubview(const FIRCLSMachOView* view,
+                            uint64_t offset,
+                            uint64_t length,
+                            FIRCLSMachOView* subview);
+bool FIRCLSMachOViewReadUInt32(const FIRCLSMachOView* view,
+                               uint64_t offset,
+                               bool swap,
+                               uint32_t* value);
+bool FIRCLSMachOViewReadUInt64(const FIRCLSMachOView* view,
+                               uint64_t offset,
+                               bool swap,
+                               uint64_t* value);
+
+// Maps a regular file read-only. The view must be released with FIRCLSMachOViewUnmapFile.
+bool FIRCLSMachOViewMapFile(const char* path, FIRCLSMachOView* view);
+void FIRCLSMachOViewUnmapFile(FIRCLSMachOView* view);
+
+typedef struct {
+  // From the mach header to the end of the slice.
+  FIRCLSMachOView view;
+  // Just the load commands, as bounded by the header's sizeofcmds.
+  FIRCLSMachOView commands;
+  uint32_t commandCount;
+  int32_t cputype;
+  int32_t cpusubtype;
+  bool is64Bit;
+  // The slice was written with the opposite byte order from this host.
+  bool swapped;
+} FIRCLSMachOSliceView;
+
+bool FIRCLSMachOSliceViewInit(FIRCLSMachOSliceView* slice, const FIRCLSMachOView* view);
+// For an image that is already loaded, where the only bound is the header's own sizeofcmds. The
+// slice covers the header and load commands, but not the section contents.
+bool FIRCLSMachOSliceViewInitWithHeader(FIRCLSMachOSliceView* slice, const void* header);
+
+// Return false from an iterator to stop early.
+typedef bool (*FIRCLSMachOViewSliceFunc)(const FIRCLSMachOSliceView* slice, void* context);
+typedef bool (*FIRCLSMachOViewLoadCommandFunc)(uint32_t type,
+                                               const FIRCLSMachOView* command,
+                                               void* context);
+
+// Visits the single slice of a thin file, or every valid slice of a fat one, and returns the
+// number visited. Slices that fall outside of the view, or have no valid header, are skipped.
+uint32_t FIRCLSMachOViewEnumerateSlices(const FIRCLSMachOView* view,
+                                        FIRCLSMachOViewSliceFunc function,
+                                        void* context);
+
+// Returns false if a malformed load command was found. Any commands before it will already have
+// been visited.
+bool FIRCLSMachOSliceViewEnumerateLoadCommands(const FIRCLSMachOSliceView* slice,
+                                               FIRCLSMachOViewLoadCommandFunc function,
+                                               void* context);
+
+bool FIRCLSMachOSliceViewGetUUID(const FIRCLSMachOSliceView* slice,
+                                 uint8_t uuid[FIRCLSMachOViewUUIDLength]);
+
+typedef struct {
+  char segname[FIRCLSMachOViewNameLength + 1];
+  char sectname[FIRCLSMachOViewNameLength + 1];
+  uint64_t addr;
+  uint64_t size;
+  uint32_t offset;
+  uint32_t flags;
+} FIRCLSMachOViewSection;
+
+bool FIRCLSMachOSliceViewFindSection(const FIRCLSMachOSliceView* slice,
+                                     const char* segName,
+                                     const char* sectionName,
+                                     FIRCLSMachOViewSection* section);
+// The section's contents within the slice, for slices that come from a file. Fails for
+// zero-fill sections, and for sections that extend past the end of the slice.
+bool FIRCLSMachOSliceViewGetSectionData(const FIRCLSMachOSliceView* slice,
+                                        const FIRCLSMachOViewSection* section,
+                                        FIRCLSMachOView* data);
+
+__END_DECLS
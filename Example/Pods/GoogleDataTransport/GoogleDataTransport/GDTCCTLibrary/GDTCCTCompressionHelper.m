@@ -18,75 +18,186 @@
 
 #import <zlib.h>
 
-@implementation GDTCCTCompressionHelper
+/** The size the output of a compressor grows by when deflate runs out of room. */
+static const NSUInteger kGDTCCTGzipOutputChunkSize = 64 * 1024;
 
-+ (nullable NSData *)gzippedData:(NSData *)data {
-#if defined(__LP64__) && __LP64__
-  // Don't support > 32bit length for 64 bit, see note in header.
-  if (data.length > UINT_MAX) {
-    return nil;
-  }
-#endif
+/** The number of idle zlib streams kept for each compression level. */
+enum { kGDTCCTGzipPoolSizePerLevel = 2 };
+
+/** The number of compression levels, from Z_DEFAULT_COMPRESSION (-1) to Z_BEST_COMPRESSION (9). */
+enum { kGDTCCTGzipLevelCount = Z_BEST_COMPRESSION + 2 };
+
+/** The idle zlib streams, by compression level + 1. Guarded by @synchronized on the class. */
+static z_stream *gGDTCCTGzipPool[kGDTCCTGzipLevelCount][kGDTCCTGzipPoolSizePerLevel];
+
+/** Frees a zlib stream. */
+static void GDTCCTGzipStreamFree(z_stream *stream) {
+  deflateEnd(stream);
+  free(stream);
+}
 
-  enum { kChunkSize = 1024 };
+@implementation GDTCCTGzipCompressor {
+  /** The zlib stream, or NULL once the compressor has finished or failed. */
+  z_stream *_stream;
 
-  const void *bytes = [data bytes];
-  NSUInteger length = [data length];
+  /** The compression level of the stream. */
+  int _level;
 
-  int level = Z_DEFAULT_COMPRESSION;
-  if (!bytes || !length) {
+  /** The compressed data. Its length is the room allocated for deflate to write to. */
+  NSMutableData *_output;
+
+  /** The number of bytes of `_output` that have been written. */
+  NSUInteger _outputLength;
+}
+
+- (nullable instancetype)initWithLevel:(GDTCCTCompressionLevel)level {
+  if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
     return nil;
   }
+  self = [super init];
+  if (self) {
+    _level = (int)level;
+    _stream = [[self class] dequeueStreamWithLevel:_level];
+    if (_stream == NULL) {
+      return nil;
+    }
+    _output = [NSMutableData data];
+  }
+  return self;
+}
 
-  z_stream strm;
-  bzero(&strm, sizeof(z_stream));
+- (void)dealloc {
+  if (_stream) {
+    [[self class] enqueueStream:_stream level:_level];
+  }
+}
 
-  int memLevel = 8;          // Default.
-  int windowBits = 15 + 16;  // Enable gzip header instead of zlib header.
+- (BOOL)appendBytes:(const void *)bytes length:(NSUInteger)length {
+  if (_stream == NULL) {
+    return NO;
+  }
+  // zlib counts input in uInt, so longer input is fed in slices.
+  const Bytef *next = bytes;
+  while (length > 0) {
+    uInt sliceLength = (uInt)MIN(length, (NSUInteger)UINT_MAX);
+    _stream->next_in = (Bytef *)next;
+    _stream->avail_in = sliceLength;
+    if (![self deflateWithFlush:Z_NO_FLUSH]) {
+      return NO;
+    }
+    next += sliceLength;
+    length -= sliceLength;
+  }
+  return YES;
+}
 
-  int retCode;
-  if (deflateInit2(&strm, level, Z_DEFLATED, windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+- (BOOL)appendData:(NSData *)data {
+  return [self appendBytes:data.bytes length:data.length];
+}
+
+- (nullable NSData *)finish {
+  if (_stream == NULL) {
     return nil;
   }
+  _stream->next_in = NULL;
+  _stream->avail_in = 0;
+  if (![self deflateWithFlush:Z_FINISH]) {
+    return nil;
+  }
+  [[self class] enqueueStream:_stream level:_level];
+  _stream = NULL;
 
-  // Hint the size at 1/4 the input size.
-  NSMutableData *result = [NSMutableData dataWithCapacity:(length / 4)];
-  unsigned char output[kChunkSize];
+  NSMutableData *output = _output;
+  output.length = _outputLength;
+  _output = nil;
+  return output;
+}
 
-  // Setup the input.
-  strm.avail_in = (unsigned int)length;
-  strm.next_in = (unsigned char *)bytes;
+#pragma mark - Private helper methods
 
-  // Collect the data.
+/** Runs deflate on the stream's input, writing straight into the end of `_output` and growing it
+ * as needed. With Z_NO_FLUSH, this returns once all the input is consumed; with Z_FINISH, once the
+ * stream has ended. On error, the stream is freed.
+ *
+ * @param flush The zlib flush mode.
+ * @return YES if deflate succeeded, NO otherwise.
+ */
+- (BOOL)deflateWithFlush:(int)flush {
+  int retCode;
   do {
-    // update what we're passing in
-    strm.avail_out = kChunkSize;
-    strm.next_out = output;
-    retCode = deflate(&strm, Z_FINISH);
-    if ((retCode != Z_OK) && (retCode != Z_STREAM_END)) {
-      deflateEnd(&strm);
-      return nil;
+    if (_outputLength == _output.length) {
+      [_output increaseLengthBy:kGDTCCTGzipOutputChunkSize];
     }
-    // Collect what we got.
-    unsigned gotBack = kChunkSize - strm.avail_out;
-    if (gotBack > 0) {
-      [result appendBytes:output length:gotBack];
+    uInt available = (uInt)MIN(_output.length - _outputLength, (NSUInteger)UINT_MAX);
+    _stream->next_out = (Bytef *)_output.mutableBytes + _outputLength;
+    _stream->avail_out = available;
+    retCode = deflate(_stream, flush);
+    _outputLength += available - _stream->avail_out;
+    // Z_BUF_ERROR only means deflate had nothing to do, which isn't fatal.
+    if (retCode != Z_OK && retCode != Z_STREAM_END && retCode != Z_BUF_ERROR) {
+      GDTCCTGzipStreamFree(_stream);
+      _stream = NULL;
+      _output = nil;
+      return NO;
     }
+  } while (flush == Z_FINISH ? retCode != Z_STREAM_END : _stream->avail_out == 0);
+  return YES;
+}
 
-  } while (retCode == Z_OK);
-
-  // If the loop exits, it used all input and the stream ended.
-  NSAssert(strm.avail_in == 0,
-           @"Should have finished deflating without using all input, %u bytes left", strm.avail_in);
-  NSAssert(retCode == Z_STREAM_END,
-           @"thought we finished deflate w/o getting a result of stream end, code %d", retCode);
+/** Returns an idle stream with the given level from the pool, or a new one if there is none.
+ *
+ * @param level The compression level.
+ * @return A stream ready to start a gzip stream, or NULL if zlib couldn't be initialized.
+ */
++ (nullable z_stream *)dequeueStreamWithLevel:(int)level {
+  @synchronized(self) {
+    z_stream **pool = gGDTCCTGzipPool[level + 1];
+    for (int i = 0; i < kGDTCCTGzipPoolSizePerLevel; i++) {
+      if (pool[i]) {
+        z_stream *stream = pool[i];
+        pool[i] = NULL;
+        return stream;
+      }
+    }
+  }
 
-  // Clean up.
-  deflateEnd(&strm);
+  z_stream *stream = calloc(1, sizeof(z_stream));
+  if (stream == NULL) {
+    return NULL;
+  }
+  int memLevel = 8;          // Default.
+  int windowBits = 15 + 16;  // Enable gzip header instead of zlib header.
+  if (deflateInit2(stream, level, Z_DEFLATED, windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    free(stream);
+    return NULL;
+  }
+  return stream;
+}
 
-  return result;
+/** Resets a stream and puts it in the pool, or frees it if the pool for its level is full.
+ *
+ * @param stream The stream, which may be in the middle of a gzip stream.
+ * @param level The compression level of the stream.
+ */
++ (void)enqueueStream:(z_stream *)stream level:(int)level {
+  if (deflateReset(stream) == Z_OK) {
+    @synchronized(self) {
+      z_stream **pool = gGDTCCTGzipPool[level + 1];
+      for (int i = 0; i < kGDTCCTGzipPoolSizePerLevel; i++) {
+        if (pool[i] == NULL) {
+          pool[i] = stream;
+          return;
+        }
+      }
+    }
+  }
+  GDTCCTGzipStreamFree(stream);
 }
 
+@end
+
+@implementation GDTCCTCompressionHelper
+
 + (BOOL)isGzipped:(NSData *)data {
   const UInt8 *bytes = (const UInt8 *)data.bytes;
   return (data.length >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b);
@@ -167,6 +167,175 @@ gdt_cct_LogEvent GDTCCTConstructLogEvent(GDTCOREvent *event) {
   return logEvent;
 }
 
+#pragma mark - Encoded event helpers
+
+/** Encodes a message, sizing it with a first pass and writing it with a second one.
+ *
+ * @param fields The nanopb fields of the message.
+ * @param message The message to encode.
+ * @return The bytes of the message, or nil if it couldn't be encoded.
+ */
+static NSData *_Nullable GDTCCTEncodeMessage(const pb_field_t fields[], const void *message) {
+  pb_ostream_t sizestream = PB_OSTREAM_SIZING;
+  if (!pb_encode(&sizestream, fields, message)) {
+    GDTCORLogError(GDTCORMCEGeneralError, @"Error in nanopb encoding for size: %s",
+                   PB_GET_ERROR(&sizestream));
+    return nil;
+  }
+
+  NSMutableData *data = [NSMutableData dataWithLength:sizestream.bytes_written];
+  pb_ostream_t ostream = pb_ostream_from_buffer(data.mutableBytes, data.length);
+  if (!pb_encode(&ostream, fields, message)) {
+    GDTCORLogError(GDTCORMCEGeneralError, @"Error in nanopb encoding for bytes: %s",
+                   PB_GET_ERROR(&ostream));
+    return nil;
+  }
+  return data;
+}
+
+/** Writes a log request from its parts, in the order of its fields, so that the bytes are the
+ * same as nanopb would encode for the equivalent gdt_cct_LogRequest. The encoded events are written
+ * as they are, each under a log_event tag and length. Given a sizing stream, this only adds up the
+ * length of the log request.
+ *
+ * @param stream The stream to write to.
+ * @param clientInfoField The encoded client_info field.
+ * @param logSource The CCT log source of the log request.
+ * @param encodedEvents The encoded gdt_cct_LogEvents of the log request.
+ * @param requestTimeFields The encoded request_time_ms and request_uptime_ms fields.
+ * @return YES if the log request was written.
+ */
+static BOOL GDTCCTWriteLogRequest(pb_ostream_t *stream,
+                                  NSData *clientInfoField,
+                                  int32_t logSource,
+                                  NSArray<NSData *> *encodedEvents,
+                                  NSData *requestTimeFields) {
+  if (!pb_write(stream, clientInfoField.bytes, clientInfoField.length) ||
+      !pb_encode_tag(stream, PB_WT_VARINT, gdt_cct_LogRequest_log_source_tag) ||
+      !pb_encode_varint(stream, (uint64_t)(int64_t)logSource)) {
+    return NO;
+  }
+  for (NSData *encodedEvent in encodedEvents) {
+    if (!pb_encode_tag(stream, PB_WT_STRING, gdt_cct_LogRequest_log_event_tag) ||
+        !pb_encode_string(stream, encodedEvent.bytes, encodedEvent.length)) {
+      return NO;
+    }
+  }
+  return pb_write(stream, requestTimeFields.bytes, requestTimeFields.length);
+}
+
+NSData *_Nullable GDTCCTEncodeLogEvent(GDTCOREvent *event) {
+  gdt_cct_LogEvent logEvent = GDTCCTConstructLogEvent(event);
+  NSData *data = GDTCCTEncodeMessage(gdt_cct_LogEvent_fields, &logEvent);
+  pb_release(gdt_cct_LogEvent_fields, &logEvent);
+  return data;
+}
+
+/** Writes a batched log request from its parts. Each log request is sized before it is written,
+ * since its length comes first. Given a sizing stream, this only adds up the length of the batch.
+ *
+ * @param stream The stream to write to.
+ * @param clientInfoField The encoded client_info field.
+ * @param requestTimeFields The encoded request_time_ms and request_uptime_ms fields.
+ * @param logMappingIDToEncodedEvents A map of mapping IDs to the encoded events to send for them.
+ * @return YES if the batch was written.
+ */
+static BOOL GDTCCTWriteBatchedLogRequest(
+    pb_ostream_t *stream,
+    NSData *clientInfoField,
+    NSData *requestTimeFields,
+    NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents) {
+  __block BOOL success = YES;
+  [logMappingIDToEncodedEvents
+      enumerateKeysAndObjectsUsingBlock:^(NSString *_Nonnull logMappingID,
+                                          NSArray<NSData *> *_Nonnull encodedEvents,
+                                          BOOL *_Nonnull stop) {
+        if (encodedEvents.count == 0) {
+          return;
+        }
+        int32_t logSource = [logMappingID intValue];
+        pb_ostream_t logRequestSizeStream = PB_OSTREAM_SIZING;
+        GDTCCTWriteLogRequest(&logRequestSizeStream, clientInfoField, logSource, encodedEvents,
+                              requestTimeFields);
+        success =
+            pb_encode_tag(stream, PB_WT_STRING, gdt_cct_BatchedLogRequest_log_request_tag) &&
+            pb_encode_varint(stream, logRequestSizeStream.bytes_written) &&
+            GDTCCTWriteLogRequest(stream, clientInfoField, logSource, encodedEvents,
+                                  requestTimeFields);
+        *stop = !success;
+      }];
+  return success;
+}
+
+/** Encodes the fields that every log request of a batch shares.
+ *
+ * @param clientInfoField Set to the encoded client_info field.
+ * @param requestTimeFields Set to the encoded request_time_ms and request_uptime_ms fields.
+ * @return YES if both were encoded.
+ */
+static BOOL GDTCCTEncodeSharedLogRequestFields(NSData **clientInfoField,
+                                               NSData **requestTimeFields) {
+  gdt_cct_LogRequest clientInfoRequest = gdt_cct_LogRequest_init_default;
+  clientInfoRequest.client_info = GDTCCTConstructClientInfo();
+  clientInfoRequest.has_client_info = 1;
+  *clientInfoField = GDTCCTEncodeMessage(gdt_cct_LogRequest_fields, &clientInfoRequest);
+  pb_release(gdt_cct_LogRequest_fields, &clientInfoRequest);
+
+  gdt_cct_LogRequest requestTimeRequest = gdt_cct_LogRequest_init_default;
+  GDTCORClock *currentTime = [GDTCORClock snapshot];
+  requestTimeRequest.request_time_ms = currentTime.timeMillis;
+  requestTimeRequest.has_request_time_ms = 1;
+  requestTimeRequest.request_uptime_ms = [currentTime uptimeMilliseconds];
+  requestTimeRequest.has_request_uptime_ms = 1;
+  *requestTimeFields = GDTCCTEncodeMessage(gdt_cct_LogRequest_fields, &requestTimeRequest);
+
+  return *clientInfoField != nil && *requestTimeFields != nil;
+}
+
+BOOL GDTCCTWriteBatchedLogRequestWithEncodedEvents(
+    pb_ostream_t *stream,
+    NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents) {
+  NSData *clientInfoField;
+  NSData *requestTimeFields;
+  if (!GDTCCTEncodeSharedLogRequestFields(&clientInfoField, &requestTimeFields)) {
+    return NO;
+  }
+
+  if (!GDTCCTWriteBatchedLogRequest(stream, clientInfoField, requestTimeFields,
+                                    logMappingIDToEncodedEvents)) {
+    GDTCORLogError(GDTCORMCEGeneralError, @"Error writing the batched log request: %s",
+                   PB_GET_ERROR(stream));
+    return NO;
+  }
+  return YES;
+}
+
+NSData *GDTCCTEncodeBatchedLogRequestWithEncodedEvents(
+    NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents) {
+  NSData *clientInfoField;
+  NSData *requestTimeFields;
+  if (!GDTCCTEncodeSharedLogRequestFields(&clientInfoField, &requestTimeFields)) {
+    return [[NSData alloc] init];
+  }
+
+  // Sized first, so that the batch is written into a buffer of the exact size, and the bytes of
+  // each event are copied once.
+  pb_ostream_t sizeStream = PB_OSTREAM_SIZING;
+  GDTCCTWriteBatchedLogRequest(&sizeStream, clientInfoField, requestTimeFields,
+                               logMappingIDToEncodedEvents);
+
+  NSMutableData *data = [NSMutableData dataWithLength:sizeStream.bytes_written];
+  pb_ostream_t stream = pb_ostream_from_buffer(data.mutableBytes, data.length);
+  if (!GDTCCTWriteBatchedLogRequest(&stream, clientInfoField, requestTimeFields,
+                                    logMappingIDToEncodedEvents) ||
+      stream.bytes_written != data.length) {
+    GDTCORLogError(GDTCORMCEGeneralError, @"Error writing the batched log request: %s",
+                   PB_GET_ERROR(&stream));
+    return [[NSData alloc] init];
+  }
+  return data;
+}
+
 gdt_cct_ComplianceData GDTCCTConstructComplianceData(GDTCORProductData *productData) {
   privacy_context_external_ExternalPRequestContext prequest =
       privacy_context_external_ExternalPRequestContext_init_default;
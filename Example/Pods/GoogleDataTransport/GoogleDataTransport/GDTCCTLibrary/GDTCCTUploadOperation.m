@@ -25,6 +25,7 @@
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRegistrar.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
+#import "GoogleDataTransport/GDTCORLibrary/Private/GDTCOREvent_Private.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetrics.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadBatch.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
@@ -287,15 +288,19 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
 /** Composes and sends URL request. */
 - (FBLPromise<GDTCCTURLSessionDataResponse *> *)sendURLRequestWithBatch:(GDTCORUploadBatch *)batch
                                                                  target:(GDTCORTarget)target {
+  // Batches are limited in stored bytes, so the ratio of sent bytes is recorded against those
+  // rather than the encoded request.
+  NSUInteger storedLength = 0;
+  for (GDTCOREvent *event in batch.events) {
+    storedLength += event.storedPayloadLength;
+  }
+  __block NSUInteger sentLength = 0;
   return [FBLPromise
              onQueue:self.uploaderQueue
                   do:^NSURLRequest * {
                     // 1. Prepare URL request.
-                    NSData *requestProtoData = [self constructRequestProtoWithEvents:batch.events];
-                    NSData *gzippedData = [GDTCCTCompressionHelper gzippedData:requestProtoData];
-                    BOOL usingGzipData =
-                        gzippedData != nil && gzippedData.length < requestProtoData.length;
-                    NSData *dataToSend = usingGzipData ? gzippedData : requestProtoData;
+                    NSData *dataToSend = [self constructRequestBodyWithEvents:batch.events];
+                    sentLength = dataToSend.length;
                     NSURLRequest *request = [self constructRequestWithURL:self.uploadURL
                                                                 forTarget:target
                                                                      data:dataToSend];
@@ -331,6 +336,10 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
                 // Invalidate session to release the delegate (which is `self`) to break the retain
                 // cycle.
                 [self.uploaderSession finishTasksAndInvalidate];
+
+                [self.metadataProvider recordUploadWithStoredLength:storedLength
+                                                         sentLength:sentLength
+                                                          forTarget:target];
                 return response;
               })
       .recoverOn(self.uploaderQueue, ^id(NSError *error) {
@@ -443,28 +452,62 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
   return isAfterNextUploadTime;
 }
 
-/** Constructs data given an upload package.
+/** A nanopb stream callback that compresses what is written with the stream's GDTCCTGzipCompressor.
+ */
+static bool GDTCCTGzipStreamCallback(pb_ostream_t *stream, const pb_byte_t *buf, size_t count) {
+  GDTCCTGzipCompressor *compressor = (__bridge GDTCCTGzipCompressor *)stream->state;
+  return [compressor appendBytes:buf length:count];
+}
+
+/** Constructs the body of a request given an upload package. The batch is compressed as it is
+ * encoded, so the uncompressed request is never held in memory, unless compressing it doesn't
+ * make it any smaller.
  *
  * @param events The events used to construct the request proto bytes.
- * @return Proto bytes representing a gdt_cct_LogRequest object.
+ * @return The gzipped, or if that's no smaller, plain proto bytes of a gdt_cct_BatchedLogRequest.
  */
-- (nonnull NSData *)constructRequestProtoWithEvents:(NSSet<GDTCOREvent *> *)events {
-  // Segment the log events by log type.
-  NSMutableDictionary<NSString *, NSMutableSet<GDTCOREvent *> *> *logMappingIDToLogSet =
+- (nonnull NSData *)constructRequestBodyWithEvents:(NSSet<GDTCOREvent *> *)events {
+  NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents =
+      [self encodedEventsByMappingIDWithEvents:events];
+
+  GDTCCTGzipCompressor *compressor =
+      [[GDTCCTGzipCompressor alloc] initWithLevel:GDTCCTCompressionLevelDefault];
+  if (compressor) {
+    pb_ostream_t stream = {&GDTCCTGzipStreamCallback, (__bridge void *)compressor, SIZE_MAX, 0};
+    if (GDTCCTWriteBatchedLogRequestWithEncodedEvents(&stream, logMappingIDToEncodedEvents)) {
+      NSData *gzippedData = [compressor finish];
+      if (gzippedData != nil && gzippedData.length < stream.bytes_written) {
+        return gzippedData;
+      }
+    }
+  }
+
+  return GDTCCTEncodeBatchedLogRequestWithEncodedEvents(logMappingIDToEncodedEvents);
+}
+
+/** Groups the encoded events of an upload package by mapping ID.
+ *
+ * @param events The events of the upload package.
+ * @return A map of mapping IDs to the encoded events to send for them.
+ */
+- (NSDictionary<NSString *, NSArray<NSData *> *> *)encodedEventsByMappingIDWithEvents:
+    (NSSet<GDTCOREvent *> *)events {
+  // Segment the encoded log events by log type. Stored events were encoded when they were stored,
+  // so only the others, such as the metrics event, are encoded here.
+  NSMutableDictionary<NSString *, NSMutableArray<NSData *> *> *logMappingIDToEncodedEvents =
       [[NSMutableDictionary alloc] init];
   [events enumerateObjectsUsingBlock:^(GDTCOREvent *_Nonnull event, BOOL *_Nonnull stop) {
-    NSMutableSet *logSet = logMappingIDToLogSet[event.mappingID];
-    logSet = logSet ? logSet : [[NSMutableSet alloc] init];
-    [logSet addObject:event];
-    logMappingIDToLogSet[event.mappingID] = logSet;
+    NSData *encodedEvent = event.encodedPayload ?: GDTCCTEncodeLogEvent(event);
+    if (encodedEvent == nil) {
+      return;
+    }
+    NSMutableArray<NSData *> *encodedEvents = logMappingIDToEncodedEvents[event.mappingID];
+    encodedEvents = encodedEvents ? encodedEvents : [[NSMutableArray alloc] init];
+    [encodedEvents addObject:encodedEvent];
+    logMappingIDToEncodedEvents[event.mappingID] = encodedEvents;
   }];
 
-  gdt_cct_BatchedLogRequest batchedLogRequest =
-      GDTCCTConstructBatchedLogRequest(logMappingIDToLogSet);
-
-  NSData *data = GDTCCTEncodeBatchedLogRequest(&batchedLogRequest);
-  pb_release(gdt_cct_BatchedLogRequest_fields, &batchedLogRequest);
-  return data ? data : [[NSData alloc] init];
+  return logMappingIDToEncodedEvents;
 }
 
 /** Constructs a request to the given URL and target with the specified request body data.
@@ -521,27 +564,32 @@ typedef void (^GDTCCTUploaderEventBatchBlock)(NSNumber *_Nullable batchID,
   return request;
 }
 
-/** Creates and returns a storage event selector for the specified target and conditions. */
+/** Creates and returns a storage event selector for the specified target and conditions. The
+ * selected events are limited to the batch size the metadata provider wants for the conditions.
+ */
 - (GDTCORStorageEventSelector *)eventSelectorTarget:(GDTCORTarget)target
                                      withConditions:(GDTCORUploadConditions)conditions {
-  if ((conditions & GDTCORUploadConditionHighPriority) == GDTCORUploadConditionHighPriority) {
-    return [GDTCORStorageEventSelector eventSelectorForTarget:target];
-  }
-  NSMutableSet<NSNumber *> *qosTiers = [[NSMutableSet alloc] init];
-  if (conditions & GDTCORUploadConditionWifiData) {
-    [qosTiers addObjectsFromArray:@[
-      @(GDTCOREventQoSFast), @(GDTCOREventQoSWifiOnly), @(GDTCOREventQosDefault),
-      @(GDTCOREventQoSTelemetry), @(GDTCOREventQoSUnknown)
-    ]];
-  }
-  if (conditions & GDTCORUploadConditionMobileData) {
-    [qosTiers addObjectsFromArray:@[ @(GDTCOREventQoSFast), @(GDTCOREventQosDefault) ]];
+  GDTCORStorageSizeBytes maxPayloadBytes =
+      [self.metadataProvider maxBatchPayloadBytesForTarget:target conditions:conditions];
+  NSMutableSet<NSNumber *> *qosTiers;
+  if ((conditions & GDTCORUploadConditionHighPriority) != GDTCORUploadConditionHighPriority) {
+    qosTiers = [[NSMutableSet alloc] init];
+    if (conditions & GDTCORUploadConditionWifiData) {
+      [qosTiers addObjectsFromArray:@[
+        @(GDTCOREventQoSFast), @(GDTCOREventQoSWifiOnly), @(GDTCOREventQosDefault),
+        @(GDTCOREventQoSTelemetry), @(GDTCOREventQoSUnknown)
+      ]];
+    }
+    if (conditions & GDTCORUploadConditionMobileData) {
+      [qosTiers addObjectsFromArray:@[ @(GDTCOREventQoSFast), @(GDTCOREventQosDefault) ]];
+    }
   }
 
   return [[GDTCORStorageEventSelector alloc] initWithTarget:target
                                                    eventIDs:nil
                                                  mappingIDs:nil
-                                                   qosTiers:qosTiers];
+                                                   qosTiers:qosTiers
+                                            maxPayloadBytes:maxPayloadBytes];
 }
 
 - (FBLPromise<GDTCORUploadBatch *> *)batchByAddingMetricsEventToBatch:(GDTCORUploadBatch *)batch
@@ -22,10 +22,24 @@
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREndpoints.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 
+#import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTNanopbHelpers.h"
 #import "GoogleDataTransport/GDTCCTLibrary/Private/GDTCCTUploadOperation.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/** The compressed request size to aim batches at on wifi. */
+static const GDTCORStorageSizeBytes kGDTCCTWifiBatchSentBytes = 256 * 1024;
+
+/** The compressed request size to aim batches at on mobile data, where a smaller request is less
+ * likely to fail part way and cost more data to retry. */
+static const GDTCORStorageSizeBytes kGDTCCTMobileBatchSentBytes = 64 * 1024;
+
+/** The ratio of sent to stored bytes assumed until an upload to the target has been recorded. */
+static const double kGDTCCTDefaultCompressionRatio = 0.25;
+
+/** The weight of the latest upload in the moving average of the compression ratio. */
+static const double kGDTCCTUploadStatisticsWeight = 0.2;
+
 @interface GDTCCTUploader () <NSURLSessionDelegate, GDTCCTUploadMetadataProvider>
 
 @property(nonatomic, readonly) NSOperationQueue *uploadOperationQueue;
@@ -34,6 +48,10 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic, readonly)
     NSMutableDictionary<NSNumber * /*GDTCORTarget*/, GDTCORClock *> *nextUploadTimeByTarget;
 
+/** The moving averages of the ratio of sent to stored bytes of uploads, by target. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber * /*GDTCORTarget*/, NSNumber *> *compressionRatioByTarget;
+
 @end
 
 @implementation GDTCCTUploader
@@ -67,6 +85,7 @@ static NSURL *_testServerURL = nil;
     _uploadOperationQueue = [[NSOperationQueue alloc] init];
     _uploadOperationQueue.maxConcurrentOperationCount = 1;
     _nextUploadTimeByTarget = [[NSMutableDictionary alloc] init];
+    _compressionRatioByTarget = [[NSMutableDictionary alloc] init];
   }
   return self;
 }
@@ -130,6 +149,12 @@ static NSURL *_testServerURL = nil;
                  @(self.uploadOperationQueue.operationCount));
 }
 
+- (nullable NSData *)encodedPayloadForEvent:(GDTCOREvent *)event {
+  // Events are stored as the gdt_cct_LogEvent they are sent as, so that uploads only need to
+  // concatenate them.
+  return GDTCCTEncodeLogEvent(event);
+}
+
 #pragma mark - URLs
 
 + (void)setTestServerURL:(NSURL *_Nullable)serverURL {
@@ -193,6 +218,48 @@ static NSURL *_testServerURL = nil;
   return nil;
 }
 
+- (void)recordUploadWithStoredLength:(NSUInteger)storedLength
+                          sentLength:(NSUInteger)sentLength
+                           forTarget:(GDTCORTarget)target {
+  if (storedLength == 0) {
+    return;
+  }
+  double ratio = (double)sentLength / (double)storedLength;
+  @synchronized(self.compressionRatioByTarget) {
+    NSNumber *averageRatio = self.compressionRatioByTarget[@(target)];
+    double weight = kGDTCCTUploadStatisticsWeight;
+    self.compressionRatioByTarget[@(target)] =
+        averageRatio ? @(averageRatio.doubleValue * (1 - weight) + ratio * weight) : @(ratio);
+  }
+}
+
+- (GDTCORStorageSizeBytes)maxBatchPayloadBytesForTarget:(GDTCORTarget)target
+                                             conditions:(GDTCORUploadConditions)conditions {
+  double ratio = kGDTCCTDefaultCompressionRatio;
+  @synchronized(self.compressionRatioByTarget) {
+    NSNumber *averageRatio = self.compressionRatioByTarget[@(target)];
+    if (averageRatio) {
+      // Don't let a few very repetitive batches make the next one unbounded.
+      ratio = MAX(averageRatio.doubleValue, 0.02);
+    }
+  }
+  GDTCORStorageSizeBytes sentBytes = (conditions & GDTCORUploadConditionMobileData)
+                                         ? kGDTCCTMobileBatchSentBytes
+                                         : kGDTCCTWifiBatchSentBytes;
+  return (GDTCORStorageSizeBytes)(sentBytes / MIN(ratio, 1.0));
+}
+
+#pragma mark - GDTCORUploader scheduling
+
+- (NSTimeInterval)timeIntervalUntilNextUploadForTarget:(GDTCORTarget)target {
+  GDTCORClock *nextUploadTime = [self nextUploadTimeForTarget:target];
+  GDTCORClock *now = [GDTCORClock snapshot];
+  if (nextUploadTime == nil || [now isAfter:nextUploadTime]) {
+    return 0;
+  }
+  return (nextUploadTime.timeMillis - now.timeMillis) / 1000.0;
+}
+
 #if GDT_TEST
 - (BOOL)waitForUploadFinishedWithTimeout:(NSTimeInterval)timeout {
   NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:timeout];
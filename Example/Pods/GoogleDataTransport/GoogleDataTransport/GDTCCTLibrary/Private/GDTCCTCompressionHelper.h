@@ -18,15 +18,56 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-/** A class with methods to help with gzipped data. */
-@interface GDTCCTCompressionHelper : NSObject
+/** The zlib compression levels gzip compression can use. Any level from 1 to 9 is also valid. */
+typedef NS_ENUM(NSInteger, GDTCCTCompressionLevel) {
+  /** zlib's default level, a balance between speed and size. */
+  GDTCCTCompressionLevelDefault = -1,
+
+  /** The fastest level. */
+  GDTCCTCompressionLevelFastest = 1,
+
+  /** The level that produces the smallest output. */
+  GDTCCTCompressionLevelSmallest = 9,
+};
+
+/** Compresses data into the gzip format as it's appended, so that it doesn't need to be in a single
+ * buffer first.
+ *
+ * The zlib state of a compressor is put in a pool once it finishes, and reused by the next
+ * compressor with the same level, which saves allocating and initializing it for every upload.
+ * NOTE: A compressor is not thread-safe, but different compressors can be used concurrently.
+ */
+@interface GDTCCTGzipCompressor : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Creates a compressor.
+ *
+ * @param level The compression level.
+ * @return A compressor, or nil if zlib couldn't be initialized.
+ */
+- (nullable instancetype)initWithLevel:(GDTCCTCompressionLevel)level NS_DESIGNATED_INITIALIZER;
+
+/** Compresses the given bytes. Bytes of any length can be appended.
+ *
+ * @return NO if there was an error, in which case `finish` will return nil.
+ */
+- (BOOL)appendBytes:(const void *)bytes length:(NSUInteger)length;
+
+/** Compresses the given data. Equivalent to `appendBytes:length:`. */
+- (BOOL)appendData:(NSData *)data;
 
-/** Compresses the given data and returns a new data object.
+/** Finishes the gzip stream and returns it. The compressor can't be used afterwards.
  *
- * @note Reduced version from GULNSData+zlib.m of GoogleUtilities.
- * @return Compressed data, or nil if there was an error.
+ * @return The compressed data, or nil if there was an error.
  */
-+ (nullable NSData *)gzippedData:(NSData *)data;
+- (nullable NSData *)finish;
+
+@end
+
+/** A class with methods to help with gzipped data. Data is compressed with
+ * `GDTCCTGzipCompressor`. */
+@interface GDTCCTCompressionHelper : NSObject
 
 /** Returns YES if the data looks like it was gzip compressed by checking for the gzip magic number.
  *
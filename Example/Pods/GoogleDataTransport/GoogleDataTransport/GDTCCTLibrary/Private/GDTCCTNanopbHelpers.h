@@ -85,6 +85,40 @@ gdt_cct_LogRequest GDTCCTConstructLogRequest(int32_t logSource, NSSet<GDTCOREven
 FOUNDATION_EXPORT
 gdt_cct_LogEvent GDTCCTConstructLogEvent(GDTCOREvent *event);
 
+/** Encodes the gdt_cct_LogEvent of a GDTCOREvent to bytes.
+ *
+ * @param event The GDTCOREvent to encode.
+ * @return The bytes of the gdt_cct_LogEvent, or nil if it couldn't be encoded.
+ */
+FOUNDATION_EXPORT
+NSData *_Nullable GDTCCTEncodeLogEvent(GDTCOREvent *event);
+
+/** Encodes a batched log request from events that have already been encoded with
+ * `GDTCCTEncodeLogEvent`. Rather than constructing a gdt_cct_BatchedLogRequest, the tags and
+ * lengths of the batch and its log requests are written around the bytes of the events, into a
+ * single buffer of the exact size. The bytes are the same as `GDTCCTEncodeBatchedLogRequest` would
+ * produce for the same events.
+ *
+ * @param logMappingIDToEncodedEvents A map of mapping IDs to the encoded events to send for them.
+ * @return The bytes of the gdt_cct_BatchedLogRequest.
+ */
+FOUNDATION_EXPORT
+NSData *GDTCCTEncodeBatchedLogRequestWithEncodedEvents(
+    NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents);
+
+/** Writes the same bytes as `GDTCCTEncodeBatchedLogRequestWithEncodedEvents` to a stream, a piece
+ * at a time, so that the batch never has to be in a single buffer. The bytes of each event are
+ * written with a single call to the stream's callback, and so are copied at most once.
+ *
+ * @param stream The stream to write to. Its bytes_written is the length of the batch afterwards.
+ * @param logMappingIDToEncodedEvents A map of mapping IDs to the encoded events to send for them.
+ * @return YES if the whole batch was written.
+ */
+FOUNDATION_EXPORT
+BOOL GDTCCTWriteBatchedLogRequestWithEncodedEvents(
+    pb_ostream_t *stream,
+    NSDictionary<NSString *, NSArray<NSData *> *> *logMappingIDToEncodedEvents);
+
 /** Constructs a `gdt_cct_ComplianceData` given a `GDTCORProductData` instance.
  *
  * @param productData The product data to convert to compliance data.
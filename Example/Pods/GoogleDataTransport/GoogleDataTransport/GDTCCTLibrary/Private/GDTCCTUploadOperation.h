@@ -16,6 +16,7 @@
 
 #import <Foundation/Foundation.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBytes.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORUploader.h"
 
 @protocol GDTCORStoragePromiseProtocol;
@@ -36,6 +37,22 @@ NS_ASSUME_NONNULL_BEGIN
 /** Returns an API key for the specified target. */
 - (nullable NSString *)APIKeyForTarget:(GDTCORTarget)target;
 
+/** Records a completed upload for the specified target, so that later batches can be sized to
+ * the ratio of sent to stored bytes it got.
+ *
+ * @param storedLength The length of the stored payloads of the uploaded events.
+ * @param sentLength The length of the request body that was sent.
+ * @param target The target of the upload.
+ */
+- (void)recordUploadWithStoredLength:(NSUInteger)storedLength
+                          sentLength:(NSUInteger)sentLength
+                           forTarget:(GDTCORTarget)target;
+
+/** Returns the most bytes of stored events to put in a batch for the specified target, so that the
+ * compressed request is about the size wanted under the conditions. */
+- (GDTCORStorageSizeBytes)maxBatchPayloadBytesForTarget:(GDTCORTarget)target
+                                             conditions:(GDTCORUploadConditions)conditions;
+
 @end
 
 /** Class capable of uploading events to the CCT backend. */
@@ -16,29 +16,84 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** The version of the ledger file layout. Ledgers with a different version are ignored. */
+static const uint32_t kGDTCORDirectorySizeLedgerVersion = 2;
+
+/** How long a persisted size is trusted before the directory is walked again to reconcile it. */
+static const NSTimeInterval kGDTCORDirectorySizeReconcileInterval = 24 * 60 * 60;
+
+/** The contents of the ledger file. */
+typedef struct {
+  uint32_t version;
+  /** The length of the path that follows the ledger, of the file that was being changed when the
+   * ledger was written, or 0 if there was none. */
+  uint32_t pendingPathLength;
+  /** The size of the directory, including the change to the pending file. */
+  uint64_t sizeBytes;
+  /** When the size was last calculated from the file system, in seconds since 1970. */
+  double reconciledAt;
+  /** The size of the pending file once its change is made. */
+  uint64_t pendingSizeBytes;
+} GDTCORDirectorySizeLedger;
+
 @interface GDTCORDirectorySizeTracker ()
 
 /** The observed directory path. */
 @property(nonatomic, readonly) NSString *directoryPath;
 
+/** The file the size is persisted in, if any. */
+@property(nonatomic, readonly, nullable) NSString *ledgerPath;
+
 /** The cached content size of the observed directory. */
 @property(nonatomic, nullable) NSNumber *cachedSizeBytes;
 
+/** When the cached size was last calculated from the file system. */
+@property(nonatomic) NSTimeInterval reconciledAt;
+
+/** YES while a walk of the directory is scheduled. */
+@property(nonatomic) BOOL isReconciling;
+
 @end
 
-@implementation GDTCORDirectorySizeTracker
+@implementation GDTCORDirectorySizeTracker {
+  /** The ledger file descriptor, opened on first use. */
+  int _ledgerFD;
+}
 
 - (instancetype)initWithDirectoryPath:(NSString *)path {
+  return [self initWithDirectoryPath:path ledgerPath:nil];
+}
+
+- (instancetype)initWithDirectoryPath:(NSString *)path ledgerPath:(nullable NSString *)ledgerPath {
   self = [super init];
   if (self) {
     _directoryPath = path;
+    _ledgerPath = [ledgerPath copy];
+    _ledgerFD = -1;
   }
   return self;
 }
 
+- (void)dealloc {
+  if (_ledgerFD >= 0) {
+    close(_ledgerFD);
+  }
+}
+
 - (GDTCORStorageSizeBytes)directoryContentSize {
   if (self.cachedSizeBytes == nil) {
-    self.cachedSizeBytes = @([self calculateDirectoryContentSize]);
+    [self readLedger];
+  }
+
+  if (self.cachedSizeBytes == nil) {
+    self.cachedSizeBytes = @([self contentSizeOfDirectoryAtPath:self.directoryPath]);
+    self.reconciledAt = [NSDate date].timeIntervalSince1970;
+    [self writeLedgerWithPendingPath:nil size:0];
   }
 
   return self.cachedSizeBytes.unsignedLongLongValue;
@@ -51,6 +106,7 @@
   }
 
   self.cachedSizeBytes = @([self directoryContentSize] + fileSize);
+  [self writeLedgerWithPendingPath:nil size:0];
 }
 
 - (void)fileWasRemovedAtPath:(NSString *)path withSize:(GDTCORStorageSizeBytes)fileSize {
@@ -59,17 +115,75 @@
     return;
   }
 
-  self.cachedSizeBytes = @([self directoryContentSize] - fileSize);
+  GDTCORStorageSizeBytes currentSize = [self directoryContentSize];
+  self.cachedSizeBytes = @(currentSize > fileSize ? currentSize - fileSize : 0);
+  [self writeLedgerWithPendingPath:nil size:0];
+}
+
+- (BOOL)changeFileAtPath:(NSString *)path
+                fromSize:(GDTCORStorageSizeBytes)oldSize
+                  toSize:(GDTCORStorageSizeBytes)newSize
+              usingBlock:(BOOL (^)(void))change {
+  if (![path hasPrefix:self.directoryPath]) {
+    // Not tracked because the file is not inside the directory.
+    return change();
+  }
+
+  GDTCORStorageSizeBytes currentSize = [self directoryContentSize];
+  GDTCORStorageSizeBytes sizeBefore = currentSize > oldSize ? currentSize - oldSize : 0;
+  GDTCORStorageSizeBytes changedSize = sizeBefore + newSize;
+
+  // The ledger already counts the change while it is made. If it is interrupted, the size of the
+  // file named in the ledger tells how much of it was made when the ledger is next read.
+  self.cachedSizeBytes = @(changedSize);
+  [self writeLedgerWithPendingPath:path size:newSize];
+  if (change()) {
+    return YES;
+  }
+
+  self.cachedSizeBytes = @(currentSize);
+  [self writeLedgerWithPendingPath:nil size:0];
+  return NO;
 }
 
 - (void)resetCachedSize {
   self.cachedSizeBytes = nil;
+
+  int fd = [self ledgerFD];
+  if (fd >= 0) {
+    ftruncate(fd, 0);
+  }
+}
+
+- (void)reconcileIfNeededOnQueue:(dispatch_queue_t)queue {
+  if (self.isReconciling) {
+    return;
+  }
+
+  // Make sure the size has been loaded, which may itself have just calculated it.
+  [self directoryContentSize];
+
+  NSTimeInterval now = [NSDate date].timeIntervalSince1970;
+  NSTimeInterval age = now - self.reconciledAt;
+  if (age >= 0 && age < kGDTCORDirectorySizeReconcileInterval) {
+    return;
+  }
+
+  // The walk runs on the client's queue, after the work already queued on it, so no change can be
+  // made while the snapshot is taken and the result replaces the cached size as is.
+  self.isReconciling = YES;
+  dispatch_async(queue, ^{
+    self.isReconciling = NO;
+    self.cachedSizeBytes = @([self contentSizeOfDirectoryAtPath:self.directoryPath]);
+    self.reconciledAt = [NSDate date].timeIntervalSince1970;
+    [self writeLedgerWithPendingPath:nil size:0];
+  });
 }
 
-- (GDTCORStorageSizeBytes)calculateDirectoryContentSize {
+- (GDTCORStorageSizeBytes)contentSizeOfDirectoryAtPath:(NSString *)path {
   NSArray *prefetchedProperties = @[ NSURLIsRegularFileKey, NSURLFileSizeKey ];
   uint64_t totalBytes = 0;
-  NSURL *directoryURL = [NSURL fileURLWithPath:self.directoryPath];
+  NSURL *directoryURL = [NSURL fileURLWithPath:path];
 
   NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager]
                  enumeratorAtURL:directoryURL
@@ -98,4 +212,94 @@
   return fileSize.unsignedLongLongValue;
 }
 
+/** Returns the size of a file, or the content size of a directory, or 0 if there is neither. */
+- (GDTCORStorageSizeBytes)sizeOfItemAtPath:(NSString *)path {
+  struct stat status;
+  if (lstat(path.fileSystemRepresentation, &status) != 0) {
+    return 0;
+  }
+  if (S_ISDIR(status.st_mode)) {
+    return [self contentSizeOfDirectoryAtPath:path];
+  }
+  return S_ISREG(status.st_mode) ? (GDTCORStorageSizeBytes)status.st_size : 0;
+}
+
+#pragma mark - Ledger
+
+- (int)ledgerFD {
+  if (_ledgerFD < 0 && self.ledgerPath != nil) {
+    _ledgerFD = open(self.ledgerPath.fileSystemRepresentation, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  }
+  return _ledgerFD;
+}
+
+- (void)readLedger {
+  int fd = [self ledgerFD];
+  if (fd < 0) {
+    return;
+  }
+
+  GDTCORDirectorySizeLedger ledger;
+  if (pread(fd, &ledger, sizeof(ledger), 0) != sizeof(ledger) ||
+      ledger.version != kGDTCORDirectorySizeLedgerVersion) {
+    return;
+  }
+
+  GDTCORStorageSizeBytes sizeBytes = ledger.sizeBytes;
+  if (ledger.pendingPathLength > 0) {
+    // The last change may not have been made, or only partly. Count the file as it is instead.
+    char pendingPath[PATH_MAX];
+    if (ledger.pendingPathLength > sizeof(pendingPath) ||
+        pread(fd, pendingPath, ledger.pendingPathLength, sizeof(ledger)) !=
+            (ssize_t)ledger.pendingPathLength) {
+      return;
+    }
+    NSString *path = [[NSFileManager defaultManager]
+        stringWithFileSystemRepresentation:pendingPath
+                                    length:ledger.pendingPathLength];
+    GDTCORStorageSizeBytes pendingSize = [self sizeOfItemAtPath:path];
+    sizeBytes = sizeBytes > ledger.pendingSizeBytes ? sizeBytes - ledger.pendingSizeBytes : 0;
+    sizeBytes += pendingSize;
+  }
+
+  self.cachedSizeBytes = @(sizeBytes);
+  self.reconciledAt = ledger.reconciledAt;
+  if (ledger.pendingPathLength > 0) {
+    [self writeLedgerWithPendingPath:nil size:0];
+  }
+}
+
+/** Persists the cached size in a single write, together with the file that is about to be changed,
+ * if any. A change that isn't reported this way, e.g. with `fileWasAddedAtPath:withSize:`, can be
+ * lost to a crash right after the file was written, and is corrected by the next reconciliation.
+ */
+- (void)writeLedgerWithPendingPath:(nullable NSString *)pendingPath
+                              size:(GDTCORStorageSizeBytes)pendingSize {
+  int fd = [self ledgerFD];
+  if (fd < 0 || self.cachedSizeBytes == nil) {
+    return;
+  }
+
+  const char *path = pendingPath.fileSystemRepresentation;
+  size_t pathLength = path ? strlen(path) : 0;
+  if (pathLength >= PATH_MAX) {
+    // Not expected for the paths in the tracked directory, but the ledger can't name it.
+    pathLength = 0;
+  }
+
+  uint8_t buffer[sizeof(GDTCORDirectorySizeLedger) + PATH_MAX];
+  GDTCORDirectorySizeLedger ledger = {
+      .version = kGDTCORDirectorySizeLedgerVersion,
+      .pendingPathLength = (uint32_t)pathLength,
+      .sizeBytes = self.cachedSizeBytes.unsignedLongLongValue,
+      .reconciledAt = self.reconciledAt,
+      .pendingSizeBytes = pathLength > 0 ? pendingSize : 0,
+  };
+  memcpy(buffer, &ledger, sizeof(ledger));
+  if (pathLength > 0) {
+    memcpy(buffer + sizeof(ledger), path, pathLength);
+  }
+  pwrite(fd, buffer, sizeof(ledger) + pathLength, 0);
+}
+
 @end
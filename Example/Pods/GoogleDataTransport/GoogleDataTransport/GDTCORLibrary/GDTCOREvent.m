@@ -69,6 +69,8 @@
   copy.qosTier = _qosTier;
   copy.clockSnapshot = _clockSnapshot;
   copy.customBytes = _customBytes;
+  copy.encodedPayload = _encodedPayload;
+  copy.storedPayloadLength = _storedPayloadLength;
   GDTCORLogDebug(@"Copying event %@ to event %@", self, copy);
   return copy;
 }
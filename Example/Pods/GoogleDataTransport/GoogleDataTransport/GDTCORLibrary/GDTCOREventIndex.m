@@ -0,0 +1,159 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventIndex.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLog.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORExpiryWheel.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The events with the same mapping ID, by event ID. */
+typedef NSMutableDictionary<NSString *, GDTCOREventLogEntry *> GDTCOREventIndexPosting;
+
+/** The postings of a qosTier, by mapping ID. */
+typedef NSMutableDictionary<NSString *, GDTCOREventIndexPosting *> GDTCOREventIndexQoSTier;
+
+/** The qosTiers of a target, by qosTier. */
+typedef NSMutableDictionary<NSNumber *, GDTCOREventIndexQoSTier *> GDTCOREventIndexTarget;
+
+@implementation GDTCOREventIndex {
+  /** The indexed events, by target, then qosTier, then mapping ID. Empty levels are removed, so
+   * that a target only has an entry while it has events.
+   */
+  NSMutableDictionary<NSNumber *, GDTCOREventIndexTarget *> *_targets;
+
+  /** The indexed events, by event ID. */
+  NSMutableDictionary<NSString *, GDTCOREventLogEntry *> *_entriesByID;
+
+  /** The indexed events, by expiration. */
+  GDTCORExpiryWheel *_expiryWheel;
+}
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _targets = [NSMutableDictionary dictionary];
+    _entriesByID = [NSMutableDictionary dictionary];
+    _expiryWheel =
+        [[GDTCORExpiryWheel alloc] initWithTime:(int64_t)[NSDate date].timeIntervalSince1970];
+  }
+  return self;
+}
+
+- (void)addEntry:(GDTCOREventLogEntry *)entry {
+  [self removeEntryWithEventID:entry.eventID];
+  _entriesByID[entry.eventID] = entry;
+  [_expiryWheel addEntry:entry];
+
+  NSNumber *targetKey = @(entry.target);
+  GDTCOREventIndexTarget *target = _targets[targetKey];
+  if (target == nil) {
+    target = [NSMutableDictionary dictionary];
+    _targets[targetKey] = target;
+  }
+  NSNumber *qosTierKey = @(entry.qosTier);
+  GDTCOREventIndexQoSTier *qosTier = target[qosTierKey];
+  if (qosTier == nil) {
+    qosTier = [NSMutableDictionary dictionary];
+    target[qosTierKey] = qosTier;
+  }
+  GDTCOREventIndexPosting *posting = qosTier[entry.mappingID];
+  if (posting == nil) {
+    posting = [NSMutableDictionary dictionary];
+    qosTier[entry.mappingID] = posting;
+  }
+  posting[entry.eventID] = entry;
+}
+
+- (void)removeEntryWithEventID:(NSString *)eventID {
+  GDTCOREventLogEntry *entry = _entriesByID[eventID];
+  if (entry == nil) {
+    return;
+  }
+  [_entriesByID removeObjectForKey:eventID];
+  [_expiryWheel removeEntryWithEventID:eventID];
+
+  NSNumber *targetKey = @(entry.target);
+  NSNumber *qosTierKey = @(entry.qosTier);
+  GDTCOREventIndexTarget *target = _targets[targetKey];
+  GDTCOREventIndexQoSTier *qosTier = target[qosTierKey];
+  GDTCOREventIndexPosting *posting = qosTier[entry.mappingID];
+  [posting removeObjectForKey:eventID];
+  if (posting.count == 0) {
+    [qosTier removeObjectForKey:entry.mappingID];
+  }
+  if (qosTier.count == 0) {
+    [target removeObjectForKey:qosTierKey];
+  }
+  if (target.count == 0) {
+    [_targets removeObjectForKey:targetKey];
+  }
+}
+
+- (nullable GDTCOREventLogEntry *)entryWithEventID:(NSString *)eventID {
+  return _entriesByID[eventID];
+}
+
+- (NSArray<GDTCOREventLogEntry *> *)entriesForTarget:(GDTCORTarget)target
+                                            eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                                            qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+                                          mappingIDs:(nullable NSSet<NSString *> *)mappingIDs {
+  BOOL checkingQosTiers = qosTiers.count > 0;
+  BOOL checkingMappingIDs = mappingIDs.count > 0;
+  NSMutableArray<GDTCOREventLogEntry *> *entries = [NSMutableArray array];
+
+  // Selecting by event ID is already a lookup per ID, so the other parameters are just checked.
+  if (eventIDs.count > 0) {
+    for (NSString *eventID in eventIDs) {
+      GDTCOREventLogEntry *entry = _entriesByID[eventID];
+      if (entry && entry.target == target &&
+          (!checkingQosTiers || [qosTiers containsObject:@(entry.qosTier)]) &&
+          (!checkingMappingIDs || [mappingIDs containsObject:entry.mappingID])) {
+        [entries addObject:entry];
+      }
+    }
+    return entries;
+  }
+
+  GDTCOREventIndexTarget *targetIndex = _targets[@(target)];
+  if (targetIndex == nil) {
+    return entries;
+  }
+  for (NSNumber *qosTierKey in (checkingQosTiers ? qosTiers : targetIndex.allKeys)) {
+    GDTCOREventIndexQoSTier *qosTier = targetIndex[qosTierKey];
+    for (NSString *mappingID in (checkingMappingIDs ? mappingIDs : qosTier.allKeys)) {
+      [entries addObjectsFromArray:qosTier[mappingID].allValues];
+    }
+  }
+  return entries;
+}
+
+- (BOOL)hasEntriesForTarget:(GDTCORTarget)target {
+  return _targets[@(target)] != nil;
+}
+
+- (NSArray<GDTCOREventLogEntry *> *)removeEntriesExpiredAtTime:(int64_t)time {
+  NSArray<GDTCOREventLogEntry *> *expiredEntries = [_expiryWheel advanceToTime:time];
+  for (GDTCOREventLogEntry *entry in expiredEntries) {
+    [self removeEntryWithEventID:entry.eventID];
+  }
+  return expiredEntries;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,818 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLogRecord.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The extension of segment files. Their name is the segment number. */
+static NSString *const kGDTCOREventLogSegmentExtension = @"gdtseg";
+
+/** Once a segment is this large it is sealed, and appends go to a new one. */
+static const uint64_t kGDTCOREventLogSegmentSize = 256 * 1024;
+
+/** A sealed segment whose live events take up less than this fraction of it is compacted. */
+static const double kGDTCOREventLogCompactionLiveFraction = 0.25;
+
+#pragma mark - GDTCOREventLogEntry
+
+@interface GDTCOREventLogEntry ()
+
+@property(nonatomic, readwrite) uint64_t segmentNumber;
+@property(nonatomic, readwrite) uint64_t offset;
+@property(nonatomic, readwrite) uint32_t payloadLength;
+
+@end
+
+@implementation GDTCOREventLogEntry
+
+- (instancetype)initWithEventID:(NSString *)eventID
+                      mappingID:(NSString *)mappingID
+                         target:(GDTCORTarget)target
+                        qosTier:(NSInteger)qosTier
+                     expiration:(int64_t)expiration
+                  payloadFormat:(GDTCOREventLogPayloadFormat)payloadFormat {
+  self = [super init];
+  if (self) {
+    _eventID = [eventID copy];
+    _mappingID = [mappingID copy];
+    _target = target;
+    _qosTier = qosTier;
+    _expiration = expiration;
+    _payloadFormat = payloadFormat;
+  }
+  return self;
+}
+
+@end
+
+#pragma mark - GDTCOREventLogSegment
+
+/** The in-memory state of a segment file. */
+@interface GDTCOREventLogSegment : NSObject
+
+@property(nonatomic) uint64_t number;
+
+@property(nonatomic) NSString *path;
+
+/** The length of the file. */
+@property(nonatomic) uint64_t size;
+
+/** YES once the index block has been appended. */
+@property(nonatomic) BOOL sealed;
+
+/** The number of live events in the segment. */
+@property(nonatomic) NSUInteger liveCount;
+
+/** The length of the records of the live events in the segment. */
+@property(nonatomic) uint64_t liveSize;
+
+/** The segments that removal records in this segment removed events from. This segment has to be
+ * kept as long as they are, or the removed events would come back the next time the log is opened.
+ */
+@property(nonatomic) NSMutableIndexSet *removalTargets;
+
+/** The index block entries of the records appended so far, while the segment is not sealed. */
+@property(nonatomic, nullable) NSMutableData *pendingIndex;
+
+@end
+
+@implementation GDTCOREventLogSegment
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _removalTargets = [NSMutableIndexSet indexSet];
+  }
+  return self;
+}
+
+@end
+
+#pragma mark - GDTCOREventLog
+
+@interface GDTCOREventLog ()
+
+@property(nonatomic, readonly) NSString *directoryPath;
+
+@property(nonatomic, readonly, nullable) GDTCORDirectorySizeTracker *sizeTracker;
+
+/** The segments by number. */
+@property(nonatomic, readonly) NSMutableDictionary<NSNumber *, GDTCOREventLogSegment *> *segments;
+
+/** The segment appends go to, if it has been opened. */
+@property(nonatomic, nullable) GDTCOREventLogSegment *activeSegment;
+
+@end
+
+@implementation GDTCOREventLog {
+  NSMutableDictionary<NSString *, GDTCOREventLogEntry *> *_entries;
+
+  /** The file descriptor of the active segment. */
+  int _activeFD;
+
+  /** The number to give the next new segment. */
+  uint64_t _nextSegmentNumber;
+}
+
+- (instancetype)initWithDirectoryPath:(NSString *)path
+                          sizeTracker:(nullable GDTCORDirectorySizeTracker *)sizeTracker {
+  self = [super init];
+  if (self) {
+    _directoryPath = [path copy];
+    _sizeTracker = sizeTracker;
+    _entries = [NSMutableDictionary dictionary];
+    _segments = [NSMutableDictionary dictionary];
+    _activeFD = -1;
+    _nextSegmentNumber = 1;
+    [self load];
+  }
+  return self;
+}
+
+- (void)dealloc {
+  if (_activeFD >= 0) {
+    close(_activeFD);
+  }
+}
+
+- (NSDictionary<NSString *, GDTCOREventLogEntry *> *)entries {
+  return _entries;
+}
+
+- (GDTCORStorageSizeBytes)reclaimableSize {
+  GDTCORStorageSizeBytes reclaimableSize = 0;
+  for (GDTCOREventLogSegment *segment in self.segments.objectEnumerator) {
+    reclaimableSize += segment.size - segment.liveSize;
+  }
+  return reclaimableSize;
+}
+
++ (GDTCORStorageSizeBytes)recordLengthForEntry:(GDTCOREventLogEntry *)entry
+                                 payloadLength:(NSUInteger)payloadLength {
+  return sizeof(GDTCOREventLogRecordHeader) +
+         [entry.eventID lengthOfBytesUsingEncoding:NSUTF8StringEncoding] +
+         [entry.mappingID lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + payloadLength;
+}
+
+#pragma mark - Loading
+
+- (void)load {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  [fileManager createDirectoryAtPath:self.directoryPath
+         withIntermediateDirectories:YES
+                          attributes:nil
+                               error:nil];
+
+  NSMutableArray<NSNumber *> *numbers = [NSMutableArray array];
+  for (NSString *fileName in [fileManager contentsOfDirectoryAtPath:self.directoryPath error:nil]) {
+    if ([fileName.pathExtension isEqualToString:kGDTCOREventLogSegmentExtension]) {
+      [numbers addObject:@(strtoull(fileName.UTF8String, NULL, 10))];
+    }
+  }
+  [numbers sortUsingSelector:@selector(compare:)];
+
+  // Removals refer back to events in earlier segments, so the segments are loaded in order.
+  for (NSUInteger i = 0; i < numbers.count; i++) {
+    @autoreleasepool {
+      [self loadSegment:numbers[i].unsignedLongLongValue isLast:(i == numbers.count - 1)];
+    }
+  }
+
+  [self deleteUnneededSegments];
+  [self compactSparseSegments];
+}
+
+- (void)loadSegment:(uint64_t)number isLast:(BOOL)isLast {
+  GDTCOREventLogSegment *segment = [[GDTCOREventLogSegment alloc] init];
+  segment.number = number;
+  segment.path = [self pathForSegment:number];
+  _nextSegmentNumber = MAX(_nextSegmentNumber, number + 1);
+
+  NSData *data = [NSData dataWithContentsOfFile:segment.path
+                                        options:NSDataReadingMappedIfSafe
+                                          error:nil];
+  const uint8_t *bytes = data.bytes;
+  uint64_t length = data.length;
+  segment.size = length;
+  self.segments[@(number)] = segment;
+
+  // A sealed segment only needs its index block to be read.
+  GDTCOREventLogRecordHeader header;
+  uint64_t indexOffset = GDTCOREventLogReadIndex(bytes, length, &header);
+  if (indexOffset != UINT64_MAX) {
+    segment.sealed = YES;
+    [self loadIndex:bytes + indexOffset + sizeof(header)
+             length:header.payloadLength
+            segment:segment];
+    return;
+  }
+
+  // Otherwise every record's header is read, and its checksum verified. An earlier segment without
+  // a valid index is still read, but never appended to.
+  segment.sealed = !isLast;
+  uint64_t validLength = GDTCOREventLogValidLength(bytes, length);
+  uint64_t offset = 0;
+  while (offset < validLength) {
+    uint64_t recordLength = GDTCOREventLogReadRecord(bytes, validLength, offset, false, &header);
+    [self loadRecord:&header
+                body:bytes + offset + sizeof(header)
+              offset:offset
+             segment:segment];
+    offset += recordLength;
+  }
+
+  if (isLast) {
+    // Anything after the last complete record is from an append that was interrupted, and is
+    // dropped so that appends can continue from there.
+    if (validLength < length) {
+      GDTCORLogDebug(@"Truncating event log segment %@ from %llu to %llu bytes", segment.path,
+                     length, validLength);
+      [self changeSegment:segment
+                   toSize:validLength
+               usingBlock:^BOOL {
+                 return truncate(segment.path.fileSystemRepresentation, (off_t)validLength) == 0;
+               }];
+      segment.size = validLength;
+    }
+    self.activeSegment = segment;
+  }
+}
+
+- (void)loadIndex:(const uint8_t *)bytes
+           length:(uint64_t)length
+          segment:(GDTCOREventLogSegment *)segment {
+  uint64_t position = 0;
+  while (length - position >= sizeof(uint64_t) + sizeof(GDTCOREventLogRecordHeader)) {
+    uint64_t offset;
+    memcpy(&offset, bytes + position, sizeof(offset));
+    position += sizeof(offset);
+
+    GDTCOREventLogRecordHeader header;
+    memcpy(&header, bytes + position, sizeof(header));
+    position += sizeof(header);
+
+    uint64_t metadataLength = (uint64_t)header.eventIDLength + header.mappingIDLength;
+    if (header.kind == GDTCOREventLogRecordKindRemoval) {
+      metadataLength += header.payloadLength;
+    }
+    if (header.magic != kGDTCOREventLogRecordMagic || length - position < metadataLength) {
+      GDTCORLogDebug(@"The index of event log segment %@ is malformed", segment.path);
+      return;
+    }
+
+    [self loadRecord:&header body:bytes + position offset:offset segment:segment];
+    position += metadataLength;
+  }
+}
+
+/** Applies a record to the in-memory state.
+ *
+ * @param body The record's body. For events it only needs to include the IDs, not the payload.
+ */
+- (void)loadRecord:(const GDTCOREventLogRecordHeader *)header
+              body:(const uint8_t *)body
+            offset:(uint64_t)offset
+           segment:(GDTCOREventLogSegment *)segment {
+  switch (header->kind) {
+    case GDTCOREventLogRecordKindEvent: {
+      NSString *eventID = [[NSString alloc] initWithBytes:body
+                                                   length:header->eventIDLength
+                                                 encoding:NSUTF8StringEncoding];
+      NSString *mappingID = [[NSString alloc] initWithBytes:body + header->eventIDLength
+                                                     length:header->mappingIDLength
+                                                   encoding:NSUTF8StringEncoding];
+      if (eventID == nil || mappingID == nil) {
+        return;
+      }
+
+      GDTCOREventLogEntry *entry =
+          [[GDTCOREventLogEntry alloc] initWithEventID:eventID
+                                             mappingID:mappingID
+                                                target:header->target
+                                               qosTier:header->qosTier
+                                            expiration:header->expiration
+                                         payloadFormat:header->payloadFormat];
+      entry.segmentNumber = segment.number;
+      entry.offset = offset;
+      entry.payloadLength = header->payloadLength;
+      [self addLiveEntry:entry];
+      break;
+    }
+
+    case GDTCOREventLogRecordKindRemoval: {
+      const uint8_t *payload = body + header->eventIDLength + header->mappingIDLength;
+      uint32_t position = 0;
+      while (header->payloadLength - position >= sizeof(uint16_t)) {
+        uint16_t eventIDLength;
+        memcpy(&eventIDLength, payload + position, sizeof(eventIDLength));
+        position += sizeof(eventIDLength);
+        if (header->payloadLength - position < eventIDLength) {
+          break;
+        }
+
+        NSString *eventID = [[NSString alloc] initWithBytes:payload + position
+                                                     length:eventIDLength
+                                                   encoding:NSUTF8StringEncoding];
+        position += eventIDLength;
+        GDTCOREventLogEntry *entry = eventID ? _entries[eventID] : nil;
+        if (entry) {
+          [self removeLiveEntry:entry removedBySegment:segment];
+        }
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  if (!segment.sealed) {
+    [self appendIndexEntryForRecord:header body:body offset:offset segment:segment];
+  }
+}
+
+#pragma mark - Appending
+
+- (BOOL)appendEntries:(NSArray<GDTCOREventLogEntry *> *)entries
+             payloads:(NSArray<NSData *> *)payloads
+                error:(NSError **)error {
+  NSMutableData *records = [NSMutableData data];
+  NSMutableArray<NSValue *> *headers = [NSMutableArray arrayWithCapacity:entries.count];
+
+  for (NSUInteger i = 0; i < entries.count; i++) {
+    GDTCOREventLogEntry *entry = entries[i];
+    NSData *eventID = [entry.eventID dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *mappingID = [entry.mappingID dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *payload = payloads[i];
+    if (eventID.length > UINT16_MAX || mappingID.length > UINT16_MAX ||
+        payload.length > UINT32_MAX) {
+      if (error) {
+        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+      }
+      return NO;
+    }
+
+    GDTCOREventLogRecordHeader header = {
+        .magic = kGDTCOREventLogRecordMagic,
+        .kind = GDTCOREventLogRecordKindEvent,
+        .payloadFormat = entry.payloadFormat,
+        .eventIDLength = (uint16_t)eventID.length,
+        .mappingIDLength = (uint16_t)mappingID.length,
+        .target = (int32_t)entry.target,
+        .qosTier = (int32_t)entry.qosTier,
+        .payloadLength = (uint32_t)payload.length,
+        .expiration = entry.expiration,
+    };
+    uint32_t checksum = GDTCOREventLogChecksum(0, eventID.bytes, eventID.length);
+    checksum = GDTCOREventLogChecksum(checksum, mappingID.bytes, mappingID.length);
+    header.checksum = GDTCOREventLogChecksum(checksum, payload.bytes, payload.length);
+
+    [headers addObject:[NSValue valueWithBytes:&header
+                                      objCType:@encode(GDTCOREventLogRecordHeader)]];
+    [records appendBytes:&header length:sizeof(header)];
+    [records appendData:eventID];
+    [records appendData:mappingID];
+    [records appendData:payload];
+  }
+
+  GDTCOREventLogSegment *segment = [self appendRecords:records error:error];
+  if (segment == nil) {
+    return NO;
+  }
+
+  uint64_t firstOffset = segment.size - records.length;
+  uint64_t position = 0;
+  for (NSUInteger i = 0; i < entries.count; i++) {
+    GDTCOREventLogRecordHeader header;
+    [headers[i] getValue:&header];
+
+    GDTCOREventLogEntry *entry = entries[i];
+    entry.segmentNumber = segment.number;
+    entry.offset = firstOffset + position;
+    entry.payloadLength = header.payloadLength;
+    [self addLiveEntry:entry];
+    [self appendIndexEntryForRecord:&header
+                               body:(const uint8_t *)records.bytes + position + sizeof(header)
+                             offset:entry.offset
+                            segment:segment];
+    position += sizeof(header) + GDTCOREventLogBodyLength(&header);
+  }
+
+  [self sealActiveSegmentIfFull];
+  return YES;
+}
+
+/** Writes records to the end of the active segment and synchronizes it.
+ *
+ * @return The segment that was appended to, or nil if the write or the synchronization failed.
+ */
+- (nullable GDTCOREventLogSegment *)appendRecords:(NSData *)records error:(NSError **)error {
+  GDTCOREventLogSegment *segment = [self openActiveSegmentWithError:error];
+  if (segment == nil) {
+    return nil;
+  }
+
+  int fd = _activeFD;
+  __block int appendError = 0;
+  BOOL appended = [self changeSegment:segment
+                               toSize:segment.size + records.length
+                           usingBlock:^BOOL {
+                             appendError = GDTCOREventLogAppend(fd, records.bytes, records.length,
+                                                                segment.size);
+                             return appendError == 0;
+                           }];
+  if (!appended) {
+    if (error) {
+      *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:appendError userInfo:nil];
+    }
+    return nil;
+  }
+
+  segment.size += records.length;
+  return segment;
+}
+
+/** Makes a change to a segment file, through the size tracker if there is one, so that the storage
+ * size is updated in the same step.
+ *
+ * @return The result of `change`.
+ */
+- (BOOL)changeSegment:(GDTCOREventLogSegment *)segment
+               toSize:(uint64_t)size
+           usingBlock:(BOOL (^)(void))change {
+  if (self.sizeTracker == nil) {
+    return change();
+  }
+  return [self.sizeTracker changeFileAtPath:segment.path
+                                   fromSize:segment.size
+                                     toSize:size
+                                 usingBlock:change];
+}
+
+- (nullable GDTCOREventLogSegment *)openActiveSegmentWithError:(NSError **)error {
+  if (self.activeSegment == nil || self.activeSegment.sealed) {
+    GDTCOREventLogSegment *segment = [[GDTCOREventLogSegment alloc] init];
+    segment.number = _nextSegmentNumber++;
+    segment.path = [self pathForSegment:segment.number];
+    segment.pendingIndex = [NSMutableData data];
+    self.segments[@(segment.number)] = segment;
+    self.activeSegment = segment;
+  }
+
+  if (_activeFD < 0) {
+    _activeFD = open(self.activeSegment.path.fileSystemRepresentation,
+                     O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (_activeFD < 0) {
+      if (error) {
+        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+      }
+      return nil;
+    }
+  }
+
+  return self.activeSegment;
+}
+
+- (void)appendIndexEntryForRecord:(const GDTCOREventLogRecordHeader *)header
+                             body:(const uint8_t *)body
+                           offset:(uint64_t)offset
+                          segment:(GDTCOREventLogSegment *)segment {
+  if (segment.pendingIndex == nil) {
+    segment.pendingIndex = [NSMutableData data];
+  }
+
+  uint64_t metadataLength = (uint64_t)header->eventIDLength + header->mappingIDLength;
+  if (header->kind == GDTCOREventLogRecordKindRemoval) {
+    metadataLength += header->payloadLength;
+  } else if (header->kind != GDTCOREventLogRecordKindEvent) {
+    return;
+  }
+
+  [segment.pendingIndex appendBytes:&offset length:sizeof(offset)];
+  [segment.pendingIndex appendBytes:header length:sizeof(*header)];
+  [segment.pendingIndex appendBytes:body length:(NSUInteger)metadataLength];
+}
+
+/** Appends the index block and trailer to the active segment once it is full. */
+- (void)sealActiveSegmentIfFull {
+  GDTCOREventLogSegment *segment = self.activeSegment;
+  if (segment == nil || segment.sealed || segment.size < kGDTCOREventLogSegmentSize) {
+    return;
+  }
+
+  NSData *index = segment.pendingIndex ?: [NSData data];
+  GDTCOREventLogRecordHeader header = {
+      .magic = kGDTCOREventLogRecordMagic,
+      .checksum = GDTCOREventLogChecksum(0, index.bytes, index.length),
+      .kind = GDTCOREventLogRecordKindIndex,
+      .payloadLength = (uint32_t)index.length,
+  };
+  GDTCOREventLogTrailer trailer = {
+      .indexOffset = segment.size,
+      .magic = kGDTCOREventLogTrailerMagic,
+  };
+
+  NSMutableData *records = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+  [records appendData:index];
+  [records appendBytes:&trailer length:sizeof(trailer)];
+  if ([self appendRecords:records error:nil] == nil) {
+    // The segment stays active and is sealed on a later append.
+    return;
+  }
+
+  segment.sealed = YES;
+  segment.pendingIndex = nil;
+  close(_activeFD);
+  _activeFD = -1;
+
+  [self deleteUnneededSegments];
+}
+
+#pragma mark - Reading
+
+- (NSDictionary<NSString *, NSData *> *)payloadsForEntries:
+    (NSArray<GDTCOREventLogEntry *> *)entries {
+  NSMutableDictionary<NSNumber *, NSMutableArray<GDTCOREventLogEntry *> *> *entriesBySegment =
+      [NSMutableDictionary dictionary];
+  for (GDTCOREventLogEntry *entry in entries) {
+    NSNumber *number = @(entry.segmentNumber);
+    if (entriesBySegment[number] == nil) {
+      entriesBySegment[number] = [NSMutableArray array];
+    }
+    [entriesBySegment[number] addObject:entry];
+  }
+
+  NSMutableDictionary<NSString *, NSData *> *payloads = [NSMutableDictionary dictionary];
+  [entriesBySegment enumerateKeysAndObjectsUsingBlock:^(
+                        NSNumber *number, NSMutableArray<GDTCOREventLogEntry *> *segmentEntries,
+                        BOOL *stop) {
+    GDTCOREventLogSegment *segment = self.segments[number];
+    if (segment == nil) {
+      return;
+    }
+
+    int fd = open(segment.path.fileSystemRepresentation, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      GDTCORLogDebug(@"Unable to open event log segment %@: %d", segment.path, errno);
+      return;
+    }
+
+    for (GDTCOREventLogEntry *entry in segmentEntries) {
+      @autoreleasepool {
+        NSData *payload = [self payloadForEntry:entry fileDescriptor:fd];
+        if (payload) {
+          payloads[entry.eventID] = payload;
+        }
+      }
+    }
+    close(fd);
+  }];
+
+  return payloads;
+}
+
+- (nullable NSData *)payloadForEntry:(GDTCOREventLogEntry *)entry fileDescriptor:(int)fd {
+  uint64_t recordLength = [[self class] recordLengthForEntry:entry
+                                               payloadLength:entry.payloadLength];
+  NSMutableData *record = [NSMutableData dataWithLength:(NSUInteger)recordLength];
+  if (pread(fd, record.mutableBytes, record.length, (off_t)entry.offset) != (ssize_t)recordLength) {
+    return nil;
+  }
+
+  GDTCOREventLogRecordHeader header;
+  if (GDTCOREventLogReadRecord(record.bytes, record.length, 0, true, &header) != recordLength ||
+      header.kind != GDTCOREventLogRecordKindEvent) {
+    GDTCORLogDebug(@"The record of event %@ is corrupt", entry.eventID);
+    return nil;
+  }
+
+  return [record subdataWithRange:NSMakeRange((NSUInteger)(recordLength - header.payloadLength),
+                                              header.payloadLength)];
+}
+
+#pragma mark - Removing
+
+- (void)removeEntries:(NSArray<GDTCOREventLogEntry *> *)entries {
+  NSMutableArray<GDTCOREventLogEntry *> *liveEntries = [NSMutableArray array];
+  NSMutableData *payload = [NSMutableData data];
+  for (GDTCOREventLogEntry *entry in entries) {
+    if (_entries[entry.eventID] == nil) {
+      continue;
+    }
+
+    NSData *eventID = [entry.eventID dataUsingEncoding:NSUTF8StringEncoding];
+    uint16_t eventIDLength = (uint16_t)eventID.length;
+    [payload appendBytes:&eventIDLength length:sizeof(eventIDLength)];
+    [payload appendData:eventID];
+    [liveEntries addObject:_entries[entry.eventID]];
+  }
+
+  if (liveEntries.count == 0) {
+    return;
+  }
+
+  GDTCOREventLogRecordHeader header = {
+      .magic = kGDTCOREventLogRecordMagic,
+      .checksum = GDTCOREventLogChecksum(0, payload.bytes, payload.length),
+      .kind = GDTCOREventLogRecordKindRemoval,
+      .payloadLength = (uint32_t)payload.length,
+  };
+  NSMutableData *record = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+  [record appendData:payload];
+
+  NSError *error;
+  GDTCOREventLogSegment *segment = [self appendRecords:record error:&error];
+  if (segment == nil) {
+    // The events are still removed for the rest of this run, but will come back the next time the
+    // log is opened, and be removed again then.
+    GDTCORLogDebug(@"Unable to append a removal to the event log: %@", error);
+  } else {
+    [self appendIndexEntryForRecord:&header
+                               body:payload.bytes
+                             offset:segment.size - record.length
+                            segment:segment];
+  }
+
+  for (GDTCOREventLogEntry *entry in liveEntries) {
+    [self removeLiveEntry:entry removedBySegment:segment];
+  }
+
+  [self sealActiveSegmentIfFull];
+  [self deleteUnneededSegments];
+  [self compactSparseSegments];
+}
+
+#pragma mark - Compacting
+
+/** Moves the live events of sealed segments that are mostly removed events to the active segment,
+ * so that the sealed segments can be deleted. Only segments that would then be deleted are
+ * compacted, which leaves out those still kept for their removal records.
+ */
+- (void)compactSparseSegments {
+  NSArray<NSNumber *> *numbers =
+      [self.segments.allKeys sortedArrayUsingSelector:@selector(compare:)];
+  for (NSNumber *number in numbers) {
+    GDTCOREventLogSegment *segment = self.segments[number];
+    if (segment == nil || !segment.sealed || segment.liveCount == 0 ||
+        segment.liveSize >= segment.size * kGDTCOREventLogCompactionLiveFraction ||
+        [self isSegmentNeededForRemovals:segment]) {
+      continue;
+    }
+
+    @autoreleasepool {
+      NSMutableArray<GDTCOREventLogEntry *> *entries = [NSMutableArray array];
+      for (GDTCOREventLogEntry *entry in _entries.objectEnumerator) {
+        if (entry.segmentNumber == segment.number) {
+          [entries addObject:entry];
+        }
+      }
+      NSDictionary<NSString *, NSData *> *payloadsByEventID = [self payloadsForEntries:entries];
+      NSMutableArray<GDTCOREventLogEntry *> *movedEntries = [NSMutableArray array];
+      NSMutableArray<NSData *> *payloads = [NSMutableArray array];
+      for (GDTCOREventLogEntry *entry in entries) {
+        NSData *payload = payloadsByEventID[entry.eventID];
+        if (payload) {
+          [movedEntries addObject:entry];
+          [payloads addObject:payload];
+        }
+      }
+      if (movedEntries.count == 0) {
+        continue;
+      }
+
+      // The entries are the ones the client holds, so they are moved in place. Their old copies
+      // stay live until the new ones are appended, and are superseded by them if the log is opened
+      // before the old segment is deleted, as the latest copy of an event wins.
+      for (GDTCOREventLogEntry *entry in movedEntries) {
+        [self removeLiveEntry:entry removedBySegment:nil];
+      }
+      NSError *error;
+      if (![self appendEntries:movedEntries payloads:payloads error:&error]) {
+        GDTCORLogDebug(@"Unable to compact event log segment %@: %@", segment.path, error);
+        for (GDTCOREventLogEntry *entry in movedEntries) {
+          [self addLiveEntry:entry];
+        }
+        // The other segments would fail to append the same way, but the ones already compacted
+        // are still deleted below.
+        break;
+      }
+    }
+  }
+  [self deleteUnneededSegments];
+}
+
+#pragma mark - Bookkeeping
+
+- (void)addLiveEntry:(GDTCOREventLogEntry *)entry {
+  GDTCOREventLogEntry *existingEntry = _entries[entry.eventID];
+  if (existingEntry) {
+    // The latest copy of an event wins.
+    GDTCOREventLogSegment *existingSegment = self.segments[@(existingEntry.segmentNumber)];
+    existingSegment.liveCount -= 1;
+    existingSegment.liveSize -= [[self class] recordLengthForEntry:existingEntry
+                                                     payloadLength:existingEntry.payloadLength];
+  }
+  _entries[entry.eventID] = entry;
+  GDTCOREventLogSegment *segment = self.segments[@(entry.segmentNumber)];
+  segment.liveCount += 1;
+  segment.liveSize += [[self class] recordLengthForEntry:entry payloadLength:entry.payloadLength];
+}
+
+- (void)removeLiveEntry:(GDTCOREventLogEntry *)entry
+       removedBySegment:(nullable GDTCOREventLogSegment *)removingSegment {
+  [_entries removeObjectForKey:entry.eventID];
+
+  GDTCOREventLogSegment *segment = self.segments[@(entry.segmentNumber)];
+  segment.liveCount -= 1;
+  segment.liveSize -= [[self class] recordLengthForEntry:entry payloadLength:entry.payloadLength];
+  if (removingSegment && segment && segment != removingSegment) {
+    [removingSegment.removalTargets addIndex:(NSUInteger)segment.number];
+  }
+}
+
+/** Deletes the sealed segments that no longer hold anything that matters. Deleting one segment can
+ * make another one unneeded, as it may have only been kept for its removal records. A segment that
+ * couldn't be deleted is kept, along with the segments its removal records refer to, and deleting
+ * it is tried again the next time.
+ */
+- (void)deleteUnneededSegments {
+  BOOL deletedSegment = YES;
+  while (deletedSegment) {
+    deletedSegment = NO;
+    for (GDTCOREventLogSegment *segment in self.segments.allValues) {
+      if (!segment.sealed || segment.liveCount > 0) {
+        continue;
+      }
+
+      if ([self isSegmentNeededForRemovals:segment]) {
+        continue;
+      }
+
+      __block NSError *error;
+      BOOL removed = [self changeSegment:segment
+                                  toSize:0
+                              usingBlock:^BOOL {
+                                if ([[NSFileManager defaultManager]
+                                        removeItemAtPath:segment.path
+                                                   error:&error]) {
+                                  return YES;
+                                }
+                                // A segment that is already gone counts as deleted.
+                                return [error.domain isEqualToString:NSCocoaErrorDomain] &&
+                                       error.code == NSFileNoSuchFileError;
+                              }];
+      if (!removed) {
+        GDTCORLogDebug(@"Unable to delete event log segment %@: %@", segment.path, error);
+        continue;
+      }
+      [self.segments removeObjectForKey:@(segment.number)];
+      deletedSegment = YES;
+    }
+  }
+}
+
+/** Returns YES if a segment has to be kept because its removal records still refer to events in
+ * other segments.
+ */
+- (BOOL)isSegmentNeededForRemovals:(GDTCOREventLogSegment *)segment {
+  __block BOOL isNeeded = NO;
+  [segment.removalTargets enumerateIndexesUsingBlock:^(NSUInteger number, BOOL *stop) {
+    if (self.segments[@(number)] != nil) {
+      isNeeded = YES;
+      *stop = YES;
+    }
+  }];
+  return isNeeded;
+}
+
+- (NSString *)pathForSegment:(uint64_t)number {
+  NSString *fileName = [NSString stringWithFormat:@"%llu.%@", number,
+                                                  kGDTCOREventLogSegmentExtension];
+  return [self.directoryPath stringByAppendingPathComponent:fileName];
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
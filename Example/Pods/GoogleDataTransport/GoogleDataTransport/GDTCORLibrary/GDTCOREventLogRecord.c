@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLogRecord.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+uint64_t GDTCOREventLogBodyLength(const GDTCOREventLogRecordHeader *header) {
+  return (uint64_t)header->eventIDLength + header->mappingIDLength + header->payloadLength;
+}
+
+uint32_t GDTCOREventLogChecksum(uint32_t checksum, const void *bytes, uint64_t length) {
+  const Bytef *position = bytes;
+  uLong result = checksum;
+  while (length > 0) {
+    uInt chunk = length > UINT32_MAX ? UINT32_MAX : (uInt)length;
+    result = crc32(result, position, chunk);
+    position += chunk;
+    length -= chunk;
+  }
+  return (uint32_t)result;
+}
+
+uint64_t GDTCOREventLogReadRecord(const uint8_t *bytes,
+                                  uint64_t length,
+                                  uint64_t offset,
+                                  bool verifyChecksum,
+                                  GDTCOREventLogRecordHeader *header) {
+  if (offset > length || length - offset < sizeof(GDTCOREventLogRecordHeader)) {
+    return 0;
+  }
+  memcpy(header, bytes + offset, sizeof(GDTCOREventLogRecordHeader));
+  if (header->magic != kGDTCOREventLogRecordMagic) {
+    return 0;
+  }
+
+  uint64_t bodyLength = GDTCOREventLogBodyLength(header);
+  uint64_t bodyOffset = offset + sizeof(GDTCOREventLogRecordHeader);
+  if (length - bodyOffset < bodyLength) {
+    return 0;
+  }
+  if (verifyChecksum &&
+      GDTCOREventLogChecksum(0, bytes + bodyOffset, bodyLength) != header->checksum) {
+    return 0;
+  }
+
+  return sizeof(GDTCOREventLogRecordHeader) + bodyLength;
+}
+
+uint64_t GDTCOREventLogValidLength(const uint8_t *bytes, uint64_t length) {
+  GDTCOREventLogRecordHeader header;
+  uint64_t offset = 0;
+  while (offset < length) {
+    uint64_t recordLength = GDTCOREventLogReadRecord(bytes, length, offset, true, &header);
+    if (recordLength == 0) {
+      break;
+    }
+    offset += recordLength;
+  }
+  return offset;
+}
+
+uint64_t GDTCOREventLogReadIndex(const uint8_t *bytes,
+                                 uint64_t length,
+                                 GDTCOREventLogRecordHeader *header) {
+  GDTCOREventLogTrailer trailer;
+  if (length < sizeof(trailer)) {
+    return UINT64_MAX;
+  }
+  memcpy(&trailer, bytes + length - sizeof(trailer), sizeof(trailer));
+  if (trailer.magic != kGDTCOREventLogTrailerMagic) {
+    return UINT64_MAX;
+  }
+
+  uint64_t indexLength =
+      GDTCOREventLogReadRecord(bytes, length - sizeof(trailer), trailer.indexOffset, true, header);
+  if (indexLength == 0 || header->kind != GDTCOREventLogRecordKindIndex) {
+    return UINT64_MAX;
+  }
+  return trailer.indexOffset;
+}
+
+int GDTCOREventLogAppend(int fd, const void *records, uint64_t length, uint64_t offset) {
+  const uint8_t *bytes = records;
+  uint64_t written = 0;
+  while (written < length) {
+    ssize_t result = pwrite(fd, bytes + written, (size_t)(length - written),
+                            (off_t)(offset + written));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      int writeError = result < 0 ? errno : EIO;
+      ftruncate(fd, (off_t)offset);
+      return writeError;
+    }
+    written += (uint64_t)result;
+  }
+  if (fsync(fd) != 0) {
+    int syncError = errno;
+    ftruncate(fd, (off_t)offset);
+    return syncError;
+  }
+  return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORExpiryWheel.h"
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLog.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** The number of bits of the expiration second each level of the wheel tells apart. */
+static const int kGDTCORExpiryWheelLevelBits = 6;
+
+/** The number of slots on each level. */
+static const int kGDTCORExpiryWheelSlotCount = 1 << kGDTCORExpiryWheelLevelBits;
+
+/** The number of levels. Together they span 2^36 seconds, which is over 2000 years. */
+static const int kGDTCORExpiryWheelLevelCount = 6;
+
+/** The location of events that have expired, but haven't been returned yet. */
+static const NSInteger kGDTCORExpiryWheelDueLocation = -1;
+
+/** The location of events that expire too far in the future for the wheel to hold. */
+static const NSInteger kGDTCORExpiryWheelOverflowLocation = -2;
+
+/** The events in a slot, by event ID. */
+typedef NSMutableDictionary<NSString *, GDTCOREventLogEntry *> GDTCORExpiryWheelSlot;
+
+@implementation GDTCORExpiryWheel {
+  /** The slots of each level. They are created when first needed. */
+  GDTCORExpiryWheelSlot *_slots[kGDTCORExpiryWheelLevelCount][kGDTCORExpiryWheelSlotCount];
+
+  /** The number of events on each level. */
+  NSUInteger _levelCounts[kGDTCORExpiryWheelLevelCount];
+
+  /** The events that have expired, but haven't been returned yet. */
+  GDTCORExpiryWheelSlot *_due;
+
+  /** The events that expire too far in the future for the wheel to hold. */
+  GDTCORExpiryWheelSlot *_overflow;
+
+  /** The location of each event, as `level * kGDTCORExpiryWheelSlotCount + slot`, or one of the
+   * special locations.
+   */
+  NSMutableDictionary<NSString *, NSNumber *> *_locations;
+}
+
+- (instancetype)initWithTime:(int64_t)time {
+  self = [super init];
+  if (self) {
+    _time = time;
+    _due = [NSMutableDictionary dictionary];
+    _overflow = [NSMutableDictionary dictionary];
+    _locations = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (void)addEntry:(GDTCOREventLogEntry *)entry {
+  [self removeEntryWithEventID:entry.eventID];
+  [self placeEntry:entry];
+}
+
+- (void)removeEntryWithEventID:(NSString *)eventID {
+  NSNumber *location = _locations[eventID];
+  if (location == nil) {
+    return;
+  }
+  [_locations removeObjectForKey:eventID];
+
+  NSInteger index = location.integerValue;
+  if (index == kGDTCORExpiryWheelDueLocation) {
+    [_due removeObjectForKey:eventID];
+  } else if (index == kGDTCORExpiryWheelOverflowLocation) {
+    [_overflow removeObjectForKey:eventID];
+  } else {
+    NSInteger level = index / kGDTCORExpiryWheelSlotCount;
+    NSInteger slot = index % kGDTCORExpiryWheelSlotCount;
+    [_slots[level][slot] removeObjectForKey:eventID];
+    _levelCounts[level] -= 1;
+  }
+}
+
+- (NSArray<GDTCOREventLogEntry *> *)advanceToTime:(int64_t)time {
+  while (_time < time) {
+    // No event on an empty level or below it can expire before the end of the current slot of the
+    // level above it, so the wheel can go straight there.
+    int emptyLevels = 0;
+    while (emptyLevels < kGDTCORExpiryWheelLevelCount && _levelCounts[emptyLevels] == 0) {
+      emptyLevels++;
+    }
+    if (emptyLevels == kGDTCORExpiryWheelLevelCount && _overflow.count == 0) {
+      _time = time;
+      break;
+    }
+    if (emptyLevels > 0) {
+      int64_t slotEnd = _time | ((1LL << (kGDTCORExpiryWheelLevelBits * emptyLevels)) - 1);
+      if (slotEnd >= time) {
+        _time = time;
+        break;
+      }
+      _time = slotEnd;
+    }
+
+    // Step one second. The events in the slot the wheel enters on each level move down, and the
+    // events in the first level's slot expire.
+    int64_t next = _time + 1;
+    NSMutableArray<GDTCOREventLogEntry *> *movingEntries = [NSMutableArray array];
+    int overflowShift = kGDTCORExpiryWheelLevelBits * kGDTCORExpiryWheelLevelCount;
+    if ((next >> overflowShift) != (_time >> overflowShift)) {
+      [movingEntries addObjectsFromArray:_overflow.allValues];
+      [_overflow removeAllObjects];
+    }
+    for (int level = kGDTCORExpiryWheelLevelCount - 1; level >= 0; level--) {
+      int shift = kGDTCORExpiryWheelLevelBits * level;
+      if (level > 0 && (next >> shift) == (_time >> shift)) {
+        continue;
+      }
+      GDTCORExpiryWheelSlot *slot =
+          _slots[level][(next >> shift) & (kGDTCORExpiryWheelSlotCount - 1)];
+      if (slot.count > 0) {
+        [movingEntries addObjectsFromArray:slot.allValues];
+        _levelCounts[level] -= slot.count;
+        [slot removeAllObjects];
+      }
+    }
+
+    _time = next;
+    for (GDTCOREventLogEntry *entry in movingEntries) {
+      [self placeEntry:entry];
+    }
+  }
+
+  NSArray<GDTCOREventLogEntry *> *expiredEntries = _due.allValues;
+  [_locations removeObjectsForKeys:_due.allKeys];
+  [_due removeAllObjects];
+  return expiredEntries;
+}
+
+#pragma mark - Private helper methods
+
+/** Puts an event in the due list, an overflow slot, or on the lowest level whose slots can tell its
+ * expiration apart from the current time.
+ */
+- (void)placeEntry:(GDTCOREventLogEntry *)entry {
+  if (entry.expiration <= _time) {
+    _due[entry.eventID] = entry;
+    _locations[entry.eventID] = @(kGDTCORExpiryWheelDueLocation);
+    return;
+  }
+
+  uint64_t difference = (uint64_t)entry.expiration ^ (uint64_t)_time;
+  int level = (63 - __builtin_clzll(difference)) / kGDTCORExpiryWheelLevelBits;
+  if (level >= kGDTCORExpiryWheelLevelCount) {
+    _overflow[entry.eventID] = entry;
+    _locations[entry.eventID] = @(kGDTCORExpiryWheelOverflowLocation);
+    return;
+  }
+
+  int slotIndex = (int)((uint64_t)entry.expiration >> (kGDTCORExpiryWheelLevelBits * level)) &
+                  (kGDTCORExpiryWheelSlotCount - 1);
+  GDTCORExpiryWheelSlot *slot = _slots[level][slotIndex];
+  if (slot == nil) {
+    slot = [NSMutableDictionary dictionary];
+    _slots[level][slotIndex] = slot;
+  }
+  slot[entry.eventID] = entry;
+  _levelCounts[level] += 1;
+  _locations[entry.eventID] = @(level * kGDTCORExpiryWheelSlotCount + slotIndex);
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
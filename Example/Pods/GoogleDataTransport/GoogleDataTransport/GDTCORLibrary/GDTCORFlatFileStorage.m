@@ -20,6 +20,7 @@
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORLifecycle.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageEventSelector.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORUploader.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 
@@ -28,6 +29,8 @@
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORUploadCoordinator.h"
 
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORDirectorySizeTracker.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventIndex.h"
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLog.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -37,13 +40,11 @@ static NSString *const gBatchIDCounterKey = @"GDTCORFlatFileStorageBatchIDCounte
 /** The separator used between metadata elements in filenames. */
 static NSString *const kMetadataSeparator = @"-";
 
-NSString *const kGDTCOREventComponentsEventIDKey = @"GDTCOREventComponentsEventIDKey";
+/** The separator between the event IDs in a batch file. */
+static NSString *const kBatchEventIDSeparator = @"\n";
 
-NSString *const kGDTCOREventComponentsQoSTierKey = @"GDTCOREventComponentsQoSTierKey";
-
-NSString *const kGDTCOREventComponentsMappingIDKey = @"GDTCOREventComponentsMappingIDKey";
-
-NSString *const kGDTCOREventComponentsExpirationKey = @"GDTCOREventComponentsExpirationKey";
+/** The number of bytes of migrated events to append at once. */
+static const NSUInteger kLegacyMigrationAppendSize = 1024 * 1024;
 
 NSString *const kGDTCORBatchComponentsTargetKey = @"GDTCORBatchComponentsTargetKey";
 
@@ -53,18 +54,94 @@ NSString *const kGDTCORBatchComponentsExpirationKey = @"GDTCORBatchComponentsExp
 
 NSString *const GDTCORFlatFileStorageErrorDomain = @"GDTCORFlatFileStorage";
 
+/** The hidden file in the root directory that the storage size is persisted in. */
+static NSString *const kGDTCORFlatFileStorageSizeLedgerName = @".gdt_storage_size";
+
 const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 
+/** How long a stored event waits for others to be appended to the log with it. */
+static const int64_t kGDTCORFlatFileStorageGroupCommitDelay = 5 * NSEC_PER_MSEC;
+
+/** The number of bytes of waiting events that are appended to the log without waiting longer. */
+static const GDTCORStorageSizeBytes kGDTCORFlatFileStorageGroupCommitSize = 64 * 1024;
+
+/** A batch of events, which are excluded from queries until the batch is removed. */
+@interface GDTCORFlatFileStorageBatch : NSObject
+
+@property(nonatomic) NSNumber *batchID;
+
+@property(nonatomic) GDTCORTarget target;
+
+@property(nonatomic) NSDate *expirationDate;
+
+@property(nonatomic) NSSet<NSString *> *eventIDs;
+
+/** The file the batch is persisted in. */
+@property(nonatomic) NSString *path;
+
+@end
+
+@implementation GDTCORFlatFileStorageBatch
+@end
+
+/** An event that has been encoded, and is waiting to be appended to the log with others. */
+@interface GDTCORFlatFileStoragePendingEvent : NSObject
+
+@property(nonatomic) GDTCOREvent *event;
+
+@property(nonatomic) GDTCOREventLogEntry *entry;
+
+@property(nonatomic) NSData *payload;
+
+/** Called once the event has been appended, or failed to be. */
+@property(nonatomic) void (^completion)(BOOL wasWritten, NSError *_Nullable error);
+
+/** Ends the background task that keeps the app running until the event is appended. */
+@property(nonatomic) dispatch_block_t endBackgroundTask;
+
+@end
+
+@implementation GDTCORFlatFileStoragePendingEvent
+@end
+
 @interface GDTCORFlatFileStorage ()
 
 /** An instance of the size tracker to keep track of the disk space consumed by the storage. */
 @property(nonatomic, readonly) GDTCORDirectorySizeTracker *sizeTracker;
 
+/** The log the events are stored in. Opened on first use, on the storage queue. */
+@property(nonatomic, readonly) GDTCOREventLog *eventLog;
+
+/** The current batches by batchID. Loaded together with the event log. */
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSNumber *, GDTCORFlatFileStorageBatch *> *batches;
+
+/** The IDs of all of the events in the current batches. */
+@property(nonatomic, readonly) NSMutableSet<NSString *> *batchedEventIDs;
+
+/** The live events that aren't in a batch, which are the ones queries select from. Built together
+ * with the event log.
+ */
+@property(nonatomic, readonly) GDTCOREventIndex *eventIndex;
+
+/** The stored events that are waiting to be appended to the log together. Everything that reads
+ * the log or the index appends them first.
+ */
+@property(nonatomic, readonly) NSMutableArray<GDTCORFlatFileStoragePendingEvent *> *pendingEvents;
+
+/** The number of bytes the pending events will take in the log. */
+@property(nonatomic) GDTCORStorageSizeBytes pendingEventsSize;
+
+/** YES if appending the pending events has been scheduled. */
+@property(nonatomic) BOOL isCommitScheduled;
+
 @end
 
 @implementation GDTCORFlatFileStorage
 
 @synthesize sizeTracker = _sizeTracker;
+@synthesize eventLog = _eventLog;
+@synthesize eventIndex = _eventIndex;
 @synthesize delegate = _delegate;
 
 + (void)load {
@@ -92,18 +169,48 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
     _storageQueue =
         dispatch_queue_create("com.google.GDTCORFlatFileStorage", DISPATCH_QUEUE_SERIAL);
     _uploadCoordinator = [GDTCORUploadCoordinator sharedInstance];
+    _batches = [NSMutableDictionary dictionary];
+    _batchedEventIDs = [NSMutableSet set];
+    _pendingEvents = [NSMutableArray array];
   }
   return self;
 }
 
 - (GDTCORDirectorySizeTracker *)sizeTracker {
   if (_sizeTracker == nil) {
-    _sizeTracker =
-        [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:GDTCORRootDirectory().path];
+    NSString *rootPath = GDTCORRootDirectory().path;
+    NSString *ledgerPath =
+        [rootPath stringByAppendingPathComponent:kGDTCORFlatFileStorageSizeLedgerName];
+    _sizeTracker = [[GDTCORDirectorySizeTracker alloc] initWithDirectoryPath:rootPath
+                                                                  ledgerPath:ledgerPath];
   }
   return _sizeTracker;
 }
 
+- (GDTCOREventLog *)eventLog {
+  if (_eventLog == nil) {
+    _eventLog = [[GDTCOREventLog alloc] initWithDirectoryPath:[[self class] eventLogStoragePath]
+                                                  sizeTracker:self.sizeTracker];
+    [self syncThreadUnsafeLoadBatches];
+
+    _eventIndex = [[GDTCOREventIndex alloc] init];
+    for (GDTCOREventLogEntry *entry in _eventLog.entries.objectEnumerator) {
+      if (![self.batchedEventIDs containsObject:entry.eventID]) {
+        [_eventIndex addEntry:entry];
+      }
+    }
+
+    [self syncThreadUnsafeMigrateLegacyEvents];
+  }
+  return _eventLog;
+}
+
+- (GDTCOREventIndex *)eventIndex {
+  // The index is built when the event log is opened.
+  (void)self.eventLog;
+  return _eventIndex;
+}
+
 #pragma mark - GDTCORStorageProtocol
 
 - (void)storeEvent:(GDTCOREvent *)event
@@ -133,24 +240,36 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                   [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
                   bgID = GDTCORBackgroundIdentifierInvalid;
                 }];
+  dispatch_block_t endBackgroundTask = ^{
+    // Cancel or end the associated background task if it's still valid.
+    [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
+    bgID = GDTCORBackgroundIdentifierInvalid;
+  };
 
   dispatch_async(_storageQueue, ^{
-    // Check that a backend implementation is available for this target.
-    GDTCORTarget target = event.target;
-    NSString *filePath = [GDTCORFlatFileStorage pathForTarget:target
-                                                      eventID:event.eventID
-                                                      qosTier:@(event.qosTier)
-                                               expirationDate:event.expirationDate
-                                                    mappingID:event.mappingID];
     NSError *error;
-    NSData *encodedEvent = GDTCOREncodeArchive(event, nil, &error);
-    if (error) {
+    GDTCOREventLogPayloadFormat payloadFormat;
+    NSData *encodedEvent = [self syncThreadUnsafeEncodeEvent:event
+                                               payloadFormat:&payloadFormat
+                                                       error:&error];
+    if (encodedEvent == nil || error) {
       completion(NO, error);
+      endBackgroundTask();
       return;
     }
 
-    // Check storage size limit before storing the event.
-    uint64_t resultingStorageSize = self.sizeTracker.directoryContentSize + encodedEvent.length;
+    GDTCOREventLogEntry *entry = [GDTCORFlatFileStorage logEntryForEvent:event
+                                                           payloadFormat:payloadFormat];
+
+    // Check storage size limit before storing the event, counting the events still waiting to be
+    // appended. Only live events count, as the space taken by removed ones is reclaimed as the
+    // event log is compacted.
+    GDTCORStorageSizeBytes recordLength =
+        [GDTCOREventLog recordLengthForEntry:entry payloadLength:encodedEvent.length];
+    GDTCORStorageSizeBytes storedSize = self.sizeTracker.directoryContentSize;
+    GDTCORStorageSizeBytes reclaimableSize = MIN(self.eventLog.reclaimableSize, storedSize);
+    uint64_t resultingStorageSize =
+        storedSize - reclaimableSize + self.pendingEventsSize + recordLength;
     if (resultingStorageSize > kGDTCORFlatFileStorageSizeLimit) {
       NSError *error = [NSError
           errorWithDomain:GDTCORFlatFileStorageErrorDomain
@@ -164,32 +283,33 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
         [self.delegate storage:self didDropEvent:event];
       }
       completion(NO, error);
+      endBackgroundTask();
       return;
     }
 
-    // Write the encoded event to the file.
-    BOOL writeResult = GDTCORWriteDataToFile(encodedEvent, filePath, &error);
-    if (writeResult == NO || error) {
-      GDTCORLogDebug(@"Attempt to write archive failed: path:%@ error:%@", filePath, error);
-      completion(NO, error);
-      return;
-    } else {
-      GDTCORLogDebug(@"Writing archive succeeded: %@", filePath);
-      completion(YES, nil);
-    }
-
-    // Notify size tracker.
-    [self.sizeTracker fileWasAddedAtPath:filePath withSize:encodedEvent.length];
-
-    // Check the QoS, if it's high priority, notify the target that it has a high priority event.
-    if (event.qosTier == GDTCOREventQoSFast) {
-      // TODO: Remove a direct dependency on the upload coordinator.
-      [self.uploadCoordinator forceUploadForTarget:target];
+    // Queue the encoded event to be appended to the log together with the events stored around the
+    // same time, so that a burst of events is written and synchronized to disk once.
+    GDTCORFlatFileStoragePendingEvent *pendingEvent =
+        [[GDTCORFlatFileStoragePendingEvent alloc] init];
+    pendingEvent.event = event;
+    pendingEvent.entry = entry;
+    pendingEvent.payload = encodedEvent;
+    pendingEvent.completion = completion;
+    pendingEvent.endBackgroundTask = endBackgroundTask;
+    [self.pendingEvents addObject:pendingEvent];
+    self.pendingEventsSize += recordLength;
+
+    if (self.pendingEventsSize >= kGDTCORFlatFileStorageGroupCommitSize) {
+      [self syncThreadUnsafeCommitPendingEvents];
+    } else if (!self.isCommitScheduled) {
+      self.isCommitScheduled = YES;
+      dispatch_time_t deadline =
+          dispatch_time(DISPATCH_TIME_NOW, kGDTCORFlatFileStorageGroupCommitDelay);
+      dispatch_after(deadline, self.storageQueue, ^{
+        self.isCommitScheduled = NO;
+        [self syncThreadUnsafeCommitPendingEvents];
+      });
     }
-
-    // Cancel or end the associated background task if it's still valid.
-    [[GDTCORApplication sharedApplication] endBackgroundTask:bgID];
-    bgID = GDTCORBackgroundIdentifierInvalid;
   });
 }
 
@@ -199,64 +319,59 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                         (nonnull void (^)(NSNumber *_Nullable batchID,
                                           NSSet<GDTCOREvent *> *_Nullable events))onComplete {
   dispatch_queue_t queue = _storageQueue;
-  void (^onPathsForTargetComplete)(NSNumber *, NSSet<NSString *> *_Nonnull) = ^(
-      NSNumber *batchID, NSSet<NSString *> *_Nonnull paths) {
+  void (^onBatchIDFetchComplete)(NSNumber *) = ^(NSNumber *batchID) {
     dispatch_async(queue, ^{
+      [self syncThreadUnsafeCommitPendingEvents];
+      NSArray<GDTCOREventLogEntry *> *entries =
+          [self.eventIndex entriesForTarget:eventSelector.selectedTarget
+                                   eventIDs:eventSelector.selectedEventIDs
+                                   qosTiers:eventSelector.selectedQosTiers
+                                 mappingIDs:eventSelector.selectedMappingIDs];
+      if (eventSelector.maxPayloadBytes > 0) {
+        entries = [GDTCORFlatFileStorage entries:entries
+                           limitedToPayloadBytes:eventSelector.maxPayloadBytes];
+      }
+      NSDictionary<NSString *, NSData *> *payloads = [self.eventLog payloadsForEntries:entries];
+
       NSMutableSet<GDTCOREvent *> *events = [[NSMutableSet alloc] init];
-      for (NSString *eventPath in paths) {
-        NSError *error;
-        GDTCOREvent *event =
-            (GDTCOREvent *)GDTCORDecodeArchiveAtPath([GDTCOREvent class], eventPath, &error);
-        if (event == nil || error) {
-          GDTCORLogDebug(@"Error deserializing event: %@", error);
-          [[NSFileManager defaultManager] removeItemAtPath:eventPath error:nil];
-          continue;
-        } else {
-          NSString *fileName = [eventPath lastPathComponent];
-          NSString *batchPath =
-              [GDTCORFlatFileStorage batchPathForTarget:eventSelector.selectedTarget
-                                                batchID:batchID
-                                         expirationDate:expiration];
-          [[NSFileManager defaultManager] createDirectoryAtPath:batchPath
-                                    withIntermediateDirectories:YES
-                                                     attributes:nil
-                                                          error:nil];
-          NSString *destinationPath = [batchPath stringByAppendingPathComponent:fileName];
-          error = nil;
-          [[NSFileManager defaultManager] moveItemAtPath:eventPath
-                                                  toPath:destinationPath
-                                                   error:&error];
-          if (error) {
-            GDTCORLogDebug(@"An event file wasn't moveable into the batch directory: %@", error);
+      NSMutableArray<GDTCOREventLogEntry *> *unreadableEntries = [NSMutableArray array];
+      for (GDTCOREventLogEntry *entry in entries) {
+        @autoreleasepool {
+          GDTCOREvent *event = [GDTCORFlatFileStorage eventForEntry:entry
+                                                            payload:payloads[entry.eventID]];
+          if (event == nil) {
+            [unreadableEntries addObject:entry];
+          } else {
+            [events addObject:event];
           }
-          [events addObject:event];
-        }
-      }
-      if (onComplete) {
-        if (events.count == 0) {
-          onComplete(nil, nil);
-        } else {
-          onComplete(batchID, events);
         }
       }
-    });
-  };
+      [self syncThreadUnsafeRemoveEntries:unreadableEntries];
 
-  void (^onBatchIDFetchComplete)(NSNumber *) = ^(NSNumber *batchID) {
-    dispatch_async(queue, ^{
-      if (batchID == nil) {
+      if (events.count == 0) {
         if (onComplete) {
           onComplete(nil, nil);
-          return;
         }
+        return;
+      }
+
+      GDTCORFlatFileStorageBatch *batch = [[GDTCORFlatFileStorageBatch alloc] init];
+      batch.batchID = batchID;
+      batch.target = eventSelector.selectedTarget;
+      batch.expirationDate = expiration;
+      NSMutableSet<NSString *> *eventIDs = [NSMutableSet setWithCapacity:events.count];
+      for (GDTCOREvent *event in events) {
+        [eventIDs addObject:event.eventID];
+      }
+      batch.eventIDs = eventIDs;
+      batch.path = [GDTCORFlatFileStorage batchPathForTarget:batch.target
+                                                     batchID:batchID
+                                              expirationDate:expiration];
+      [self syncThreadUnsafeAddBatch:batch];
+
+      if (onComplete) {
+        onComplete(batchID, events);
       }
-      [self pathsForTarget:eventSelector.selectedTarget
-                  eventIDs:eventSelector.selectedEventIDs
-                  qosTiers:eventSelector.selectedQosTiers
-                mappingIDs:eventSelector.selectedMappingIDs
-                onComplete:^(NSSet<NSString *> *_Nonnull paths) {
-                  onPathsForTargetComplete(batchID, paths);
-                }];
     });
   };
 
@@ -286,24 +401,19 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 - (void)batchIDsForTarget:(GDTCORTarget)target
                onComplete:(nonnull void (^)(NSSet<NSNumber *> *_Nullable))onComplete {
   dispatch_async(_storageQueue, ^{
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSError *error;
-    NSArray<NSString *> *batchPaths =
-        [fileManager contentsOfDirectoryAtPath:[GDTCORFlatFileStorage batchDataStoragePath]
-                                         error:&error];
-    if (error || batchPaths.count == 0) {
+    // Make sure the batches have been loaded.
+    [self eventLog];
+
+    if (self.batches.count == 0) {
       if (onComplete) {
         onComplete(nil);
       }
       return;
     }
     NSMutableSet<NSNumber *> *batchIDs = [[NSMutableSet alloc] init];
-    for (NSString *path in batchPaths) {
-      NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:path];
-      NSNumber *targetNumber = components[kGDTCORBatchComponentsTargetKey];
-      NSNumber *batchID = components[kGDTCORBatchComponentsBatchIDKey];
-      if (batchID != nil && targetNumber.intValue == target) {
-        [batchIDs addObject:batchID];
+    for (GDTCORFlatFileStorageBatch *batch in self.batches.allValues) {
+      if (batch.target == target) {
+        [batchIDs addObject:batch.batchID];
       }
     }
     if (onComplete) {
@@ -327,12 +437,16 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
       // The -isKindOfClass check is necessary because without an explicit 'return nil' in the block
       // the implicit return value will be the block itself. The compiler doesn't detect this.
       if (newValue != nil && [newValue isKindOfClass:[NSData class]] && newValue.length) {
-        NSError *newValueError;
-        if ([newValue writeToFile:dataPath options:NSDataWritingAtomic error:&newValueError]) {
-          // Update storage size.
-          [self.sizeTracker fileWasRemovedAtPath:dataPath withSize:data.length];
-          [self.sizeTracker fileWasAddedAtPath:dataPath withSize:newValue.length];
-        } else {
+        __block NSError *newValueError;
+        BOOL written = [self.sizeTracker changeFileAtPath:dataPath
+                                                 fromSize:data.length
+                                                   toSize:newValue.length
+                                               usingBlock:^BOOL {
+                                                 return [newValue writeToFile:dataPath
+                                                                      options:NSDataWritingAtomic
+                                                                        error:&newValueError];
+                                               }];
+        if (!written) {
           GDTCORLogDebug(@"Error writing new value in libraryDataForKey: %@", newValueError);
         }
       }
@@ -350,11 +464,19 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
     return;
   }
   dispatch_async(_storageQueue, ^{
-    NSError *error;
+    __block NSError *error;
     NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
-    if ([data writeToFile:dataPath options:NSDataWritingAtomic error:&error]) {
-      [self.sizeTracker fileWasAddedAtPath:dataPath withSize:data.length];
-    }
+    // The write replaces any existing value.
+    GDTCORStorageSizeBytes previousSize =
+        [self.sizeTracker fileSizeAtURL:[NSURL fileURLWithPath:dataPath]];
+    [self.sizeTracker changeFileAtPath:dataPath
+                              fromSize:previousSize
+                                toSize:data.length
+                            usingBlock:^BOOL {
+                              return [data writeToFile:dataPath
+                                               options:NSDataWritingAtomic
+                                                 error:&error];
+                            }];
     if (onComplete) {
       onComplete(error);
     }
@@ -364,15 +486,19 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 - (void)removeLibraryDataForKey:(nonnull NSString *)key
                      onComplete:(nonnull void (^)(NSError *_Nullable error))onComplete {
   dispatch_async(_storageQueue, ^{
-    NSError *error;
+    __block NSError *error;
     NSString *dataPath = [[[self class] libraryDataStoragePath] stringByAppendingPathComponent:key];
     GDTCORStorageSizeBytes fileSize =
         [self.sizeTracker fileSizeAtURL:[NSURL fileURLWithPath:dataPath]];
 
     if ([[NSFileManager defaultManager] fileExistsAtPath:dataPath]) {
-      if ([[NSFileManager defaultManager] removeItemAtPath:dataPath error:&error]) {
-        [self.sizeTracker fileWasRemovedAtPath:dataPath withSize:fileSize];
-      }
+      [self.sizeTracker changeFileAtPath:dataPath
+                                fromSize:fileSize
+                                  toSize:0
+                              usingBlock:^BOOL {
+                                return [[NSFileManager defaultManager] removeItemAtPath:dataPath
+                                                                                  error:&error];
+                              }];
       if (onComplete) {
         onComplete(error);
       }
@@ -382,15 +508,8 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
 
 - (void)hasEventsForTarget:(GDTCORTarget)target onComplete:(void (^)(BOOL hasEvents))onComplete {
   dispatch_async(_storageQueue, ^{
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSString *targetPath = [NSString
-        stringWithFormat:@"%@/%ld", [GDTCORFlatFileStorage eventDataStoragePath], (long)target];
-    [fileManager createDirectoryAtPath:targetPath
-           withIntermediateDirectories:YES
-                            attributes:nil
-                                 error:nil];
-    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:targetPath];
-    BOOL hasEventAtLeastOneEvent = [enumerator nextObject] != nil;
+    [self syncThreadUnsafeCommitPendingEvents];
+    BOOL hasEventAtLeastOneEvent = [self.eventIndex hasEntriesForTarget:target];
     if (onComplete) {
       onComplete(hasEventAtLeastOneEvent);
     }
@@ -401,85 +520,49 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   dispatch_async(_storageQueue, ^{
     GDTCORLogDebug(@"%@", @"Checking for expired events and batches");
     NSTimeInterval now = [NSDate date].timeIntervalSince1970;
-    NSFileManager *fileManager = [NSFileManager defaultManager];
 
     // TODO: Storage may not have enough context to remove batches because a batch may be being
     // uploaded but the storage has not context of it.
 
-    // Find expired batches and move their events back to the main storage.
+    // Make sure the events and batches have been loaded, and the pending events appended.
+    GDTCOREventLog *eventLog = self.eventLog;
+    [self syncThreadUnsafeCommitPendingEvents];
+
+    // Find expired batches and return their events to the main storage.
     // If a batch contains expired events they are expected to be removed further in the method
     // together with other expired events in the main storage.
-    NSString *batchDataPath = [GDTCORFlatFileStorage batchDataStoragePath];
-    NSArray<NSString *> *batchDataPaths = [fileManager contentsOfDirectoryAtPath:batchDataPath
-                                                                           error:nil];
-    for (NSString *path in batchDataPaths) {
-      @autoreleasepool {
-        NSString *fileName = [path lastPathComponent];
-        NSDictionary<NSString *, id> *batchComponents = [self batchComponentsFromFilename:fileName];
-        NSDate *expirationDate = batchComponents[kGDTCORBatchComponentsExpirationKey];
-        NSNumber *batchID = batchComponents[kGDTCORBatchComponentsBatchIDKey];
-        if (expirationDate != nil && expirationDate.timeIntervalSince1970 < now && batchID != nil) {
-          NSNumber *batchID = batchComponents[kGDTCORBatchComponentsBatchIDKey];
-          // Move all events from the expired batch back to the main storage.
-          [self syncThreadUnsafeRemoveBatchWithID:batchID deleteEvents:NO];
-        }
+    for (GDTCORFlatFileStorageBatch *batch in self.batches.allValues) {
+      if (batch.expirationDate.timeIntervalSince1970 < now) {
+        [self syncThreadUnsafeRemoveBatchWithID:batch.batchID deleteEvents:NO];
       }
     }
 
-    // Find expired events and remove them from the storage.
-    NSMutableSet<GDTCOREvent *> *expiredEvents = [NSMutableSet set];
-    NSString *eventDataPath = [GDTCORFlatFileStorage eventDataStoragePath];
-    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:eventDataPath];
-    NSString *path;
-
-    while (YES) {
-      @autoreleasepool {
-        // Call `[enumerator nextObject]` under autorelease pool to make sure all autoreleased
-        // objects created under the hood are released on each iteration end to avoid unnecessary
-        // memory growth.
-        path = [enumerator nextObject];
-        if (path == nil) {
-          break;
-        }
-
-        NSString *fileName = [path lastPathComponent];
-        NSDictionary<NSString *, id> *eventComponents = [self eventComponentsFromFilename:fileName];
-        NSDate *expirationDate = eventComponents[kGDTCOREventComponentsExpirationKey];
-        if (expirationDate != nil && expirationDate.timeIntervalSince1970 < now) {
-          NSString *pathToDelete = [eventDataPath stringByAppendingPathComponent:path];
-
-          // Decode the expired event from the path to be deleted.
-          NSError *decodeError;
-          GDTCOREvent *event = (GDTCOREvent *)GDTCORDecodeArchiveAtPath([GDTCOREvent class],
-                                                                        pathToDelete, &decodeError);
-          if (event == nil || decodeError) {
-            GDTCORLogDebug(@"Error deserializing event while checking for expired events: %@",
-                           decodeError);
-            event = nil;
-          }
-
-          // Remove the path to be deleted, adding the decoded event to the
-          // event set if the removal was successful.
-          NSError *removeError;
-          [fileManager removeItemAtPath:pathToDelete error:&removeError];
-          if (removeError != nil) {
-            GDTCORLogDebug(@"There was an error deleting an expired item: %@", removeError);
-          } else {
-            GDTCORLogDebug(@"Item deleted because it expired: %@", pathToDelete);
-            if (event) {
-              [expiredEvents addObject:event];
-            }
-          }
-        }
+    // Find expired events and remove them from the storage. The index only visits the events that
+    // are due, and the delegate is told about them from their metadata, so nothing is read back.
+    NSArray<GDTCOREventLogEntry *> *expiredEntries =
+        [self.eventIndex removeEntriesExpiredAtTime:(int64_t)now];
+    NSMutableSet<GDTCOREvent *> *expiredEvents =
+        [NSMutableSet setWithCapacity:expiredEntries.count];
+    for (GDTCOREventLogEntry *entry in expiredEntries) {
+      GDTCOREvent *event = [GDTCORFlatFileStorage eventWithMetadataOfEntry:entry];
+      if (event) {
+        [expiredEvents addObject:event];
       }
     }
 
+    if (expiredEntries.count > 0) {
+      GDTCORLogDebug(@"%@ events deleted because they expired", @(expiredEntries.count));
+      [eventLog removeEntries:expiredEntries];
+    }
+
     if (self.delegate != nil && [expiredEvents count] > 0) {
       GDTCORLogDebug(@"Delegate notified that %@ events were dropped.", @(expiredEvents.count));
       [self.delegate storage:self didRemoveExpiredEvents:[expiredEvents copy]];
     }
 
-    [self.sizeTracker resetCachedSize];
+    // Every removal above was reported to the size tracker, so there is no need to walk the
+    // storage again here, beyond the occasional reconciliation.
+    [self.sizeTracker reconcileIfNeededOnQueue:self.storageQueue];
   });
 }
 
@@ -489,163 +572,419 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   }
 
   dispatch_async(_storageQueue, ^{
+    [self syncThreadUnsafeCommitPendingEvents];
     onComplete([self.sizeTracker directoryContentSize]);
   });
 }
 
 #pragma mark - Private not thread safe methods
-/** Looks for directory paths containing events for a batch with the specified ID.
- * @param batchID A batch ID.
- * @param outError A pointer to `NSError *` to assign as possible error to.
- * @return An array of an array of paths to directories for event batches with a specified batch ID
- * or `nil` in the case of an error. Usually returns a single path but potentially return more in
- * cases when the app is terminated while uploading a batch.
+
+/** Encodes an event to be stored, with the target's uploader if it can, or as an archive otherwise.
+ *
+ * @param event The event to encode.
+ * @param payloadFormat Set to the format the event was encoded in.
+ * @param error Set if the event couldn't be encoded.
+ * @return The encoded event, or nil if it couldn't be encoded.
  */
-- (nullable NSArray<NSString *> *)batchDirPathsForBatchID:(NSNumber *)batchID
-                                                    error:(NSError **_Nonnull)outError {
-  NSFileManager *fileManager = [NSFileManager defaultManager];
+- (nullable NSData *)syncThreadUnsafeEncodeEvent:(GDTCOREvent *)event
+                                   payloadFormat:(GDTCOREventLogPayloadFormat *)payloadFormat
+                                           error:(NSError **)error {
+  id<GDTCORUploader> uploader = [GDTCORRegistrar sharedInstance].targetToUploader[@(event.target)];
+  if ([uploader respondsToSelector:@selector(encodedPayloadForEvent:)]) {
+    NSData *encodedPayload = [uploader encodedPayloadForEvent:event];
+    if (encodedPayload) {
+      *payloadFormat = GDTCOREventLogPayloadFormatUploaderEncoded;
+      return encodedPayload;
+    }
+  }
+
+  *payloadFormat = GDTCOREventLogPayloadFormatArchive;
+  return GDTCOREncodeArchive(event, nil, error);
+}
+
+/** Appends the pending events to the event log with a single write, then calls their completions
+ * and triggers uploads for any fast events.
+ */
+- (void)syncThreadUnsafeCommitPendingEvents {
+  if (self.pendingEvents.count == 0) {
+    return;
+  }
+  NSArray<GDTCORFlatFileStoragePendingEvent *> *pendingEvents = [self.pendingEvents copy];
+  [self.pendingEvents removeAllObjects];
+  self.pendingEventsSize = 0;
+
+  NSMutableArray<GDTCOREventLogEntry *> *entries =
+      [NSMutableArray arrayWithCapacity:pendingEvents.count];
+  NSMutableArray<NSData *> *payloads = [NSMutableArray arrayWithCapacity:pendingEvents.count];
+  for (GDTCORFlatFileStoragePendingEvent *pendingEvent in pendingEvents) {
+    [entries addObject:pendingEvent.entry];
+    [payloads addObject:pendingEvent.payload];
+  }
+
+  // The log notifies the size tracker.
   NSError *error;
-  NSArray<NSString *> *batches =
-      [fileManager contentsOfDirectoryAtPath:[GDTCORFlatFileStorage batchDataStoragePath]
-                                       error:&error];
-  if (batches == nil) {
-    *outError = error;
-    GDTCORLogDebug(@"Failed to find event file paths for batchID: %@, error: %@", batchID, error);
-    return nil;
+  BOOL wasWritten = [self syncThreadUnsafeAppendEntries:entries payloads:payloads error:&error];
+  if (wasWritten) {
+    GDTCORLogDebug(@"Appending %lu events succeeded", (unsigned long)pendingEvents.count);
+  } else {
+    GDTCORLogDebug(@"Attempt to append %lu events failed: %@", (unsigned long)pendingEvents.count,
+                   error);
   }
 
-  NSMutableArray<NSString *> *batchDirPaths = [NSMutableArray array];
-  for (NSString *path in batches) {
-    NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:path];
-    NSNumber *pathBatchID = components[kGDTCORBatchComponentsBatchIDKey];
-    if ([pathBatchID isEqual:batchID]) {
-      NSString *batchDirPath =
-          [[GDTCORFlatFileStorage batchDataStoragePath] stringByAppendingPathComponent:path];
-      [batchDirPaths addObject:batchDirPath];
+  NSMutableSet<NSNumber *> *fastTargets = [NSMutableSet set];
+  for (GDTCORFlatFileStoragePendingEvent *pendingEvent in pendingEvents) {
+    pendingEvent.completion(wasWritten, wasWritten ? nil : error);
+    if (wasWritten && pendingEvent.event.qosTier == GDTCOREventQoSFast) {
+      [fastTargets addObject:@(pendingEvent.event.target)];
     }
   }
 
-  return [batchDirPaths copy];
-}
+  // Check the QoS, if it's high priority, notify the target that it has a high priority event.
+  for (NSNumber *target in fastTargets) {
+    // TODO: Remove a direct dependency on the upload coordinator.
+    [self.uploadCoordinator forceUploadForTarget:target.integerValue];
+  }
 
-/** Makes a copy of the contents of a directory to a directory at the specified path.*/
-- (BOOL)moveContentsOfDirectoryAtPath:(NSString *)sourcePath
-                                   to:(NSString *)destinationPath
-                                error:(NSError **_Nonnull)outError {
-  NSFileManager *fileManager = [NSFileManager defaultManager];
+  for (GDTCORFlatFileStoragePendingEvent *pendingEvent in pendingEvents) {
+    pendingEvent.endBackgroundTask();
+  }
+}
 
-  NSError *error;
-  NSArray<NSString *> *contentsPaths = [fileManager contentsOfDirectoryAtPath:sourcePath
-                                                                        error:&error];
-  if (contentsPaths == nil) {
-    *outError = error;
+/** Appends events to the event log, and adds them to the index if they were appended. */
+- (BOOL)syncThreadUnsafeAppendEntries:(NSArray<GDTCOREventLogEntry *> *)entries
+                             payloads:(NSArray<NSData *> *)payloads
+                                error:(NSError **)error {
+  if (![self.eventLog appendEntries:entries payloads:payloads error:error]) {
     return NO;
   }
+  for (GDTCOREventLogEntry *entry in entries) {
+    [self.eventIndex addEntry:entry];
+  }
+  return YES;
+}
 
-  NSMutableArray<NSError *> *errors = [NSMutableArray array];
-  for (NSString *path in contentsPaths) {
-    NSString *contentDestinationPath = [destinationPath stringByAppendingPathComponent:path];
-    NSString *contentSourcePath = [sourcePath stringByAppendingPathComponent:path];
+/** Removes events from the event log and the index. */
+- (void)syncThreadUnsafeRemoveEntries:(NSArray<GDTCOREventLogEntry *> *)entries {
+  [self.eventLog removeEntries:entries];
+  for (GDTCOREventLogEntry *entry in entries) {
+    [self.eventIndex removeEntryWithEventID:entry.eventID];
+  }
+}
 
-    NSError *moveError;
-    if (![fileManager moveItemAtPath:contentSourcePath
-                              toPath:contentDestinationPath
-                               error:&moveError] &&
-        moveError) {
-      [errors addObject:moveError];
-    }
+/** Persists a new batch, and excludes its events from queries. */
+- (void)syncThreadUnsafeAddBatch:(GDTCORFlatFileStorageBatch *)batch {
+  NSData *contents = [[batch.eventIDs.allObjects componentsJoinedByString:kBatchEventIDSeparator]
+      dataUsingEncoding:NSUTF8StringEncoding];
+  __block NSError *error;
+  BOOL written = [self.sizeTracker changeFileAtPath:batch.path
+                                           fromSize:0
+                                             toSize:contents.length
+                                         usingBlock:^BOOL {
+                                           return [contents writeToFile:batch.path
+                                                                options:NSDataWritingAtomic
+                                                                  error:&error];
+                                         }];
+  if (!written) {
+    // The batch still applies for the rest of this run.
+    GDTCORLogDebug(@"A batch file couldn't be written: %@", error);
   }
 
-  if (errors.count == 0) {
-    return YES;
-  } else {
-    NSError *combinedError = [NSError errorWithDomain:@"GDTCORFlatFileStorage"
-                                                 code:-1
-                                             userInfo:@{NSUnderlyingErrorKey : errors}];
-    *outError = combinedError;
-    return NO;
+  self.batches[batch.batchID] = batch;
+  [self.batchedEventIDs unionSet:batch.eventIDs];
+  for (NSString *eventID in batch.eventIDs) {
+    [self.eventIndex removeEntryWithEventID:eventID];
+  }
+}
+
+/** Restores the batches that were persisted by a previous run. */
+- (void)syncThreadUnsafeLoadBatches {
+  NSString *batchDataPath = [GDTCORFlatFileStorage batchDataStoragePath];
+  NSArray<NSString *> *batchFileNames =
+      [[NSFileManager defaultManager] contentsOfDirectoryAtPath:batchDataPath error:nil];
+  for (NSString *fileName in batchFileNames) {
+    @autoreleasepool {
+      NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:fileName];
+      NSString *path = [batchDataPath stringByAppendingPathComponent:fileName];
+      NSString *contents = [NSString stringWithContentsOfFile:path
+                                                     encoding:NSUTF8StringEncoding
+                                                        error:nil];
+      if (components == nil || contents == nil) {
+        continue;
+      }
+
+      GDTCORFlatFileStorageBatch *batch = [[GDTCORFlatFileStorageBatch alloc] init];
+      batch.batchID = components[kGDTCORBatchComponentsBatchIDKey];
+      batch.target = [components[kGDTCORBatchComponentsTargetKey] integerValue];
+      batch.expirationDate = components[kGDTCORBatchComponentsExpirationKey];
+      batch.eventIDs =
+          [NSSet setWithArray:[contents componentsSeparatedByString:kBatchEventIDSeparator]];
+      batch.path = path;
+
+      self.batches[batch.batchID] = batch;
+      [self.batchedEventIDs unionSet:batch.eventIDs];
+    }
   }
 }
 
 - (void)syncThreadUnsafeRemoveBatchWithID:(nonnull NSNumber *)batchID
                              deleteEvents:(BOOL)deleteEvents {
-  NSError *error;
-  NSArray<NSString *> *batchDirPaths = [self batchDirPathsForBatchID:batchID error:&error];
-
-  if (batchDirPaths == nil) {
+  // Make sure the events and batches have been loaded.
+  GDTCOREventLog *eventLog = self.eventLog;
+  GDTCORFlatFileStorageBatch *batch = self.batches[batchID];
+  if (batch == nil) {
     return;
   }
 
-  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSMutableArray<GDTCOREventLogEntry *> *entries = [NSMutableArray array];
+  for (NSString *eventID in batch.eventIDs) {
+    GDTCOREventLogEntry *entry = eventLog.entries[eventID];
+    if (entry) {
+      [entries addObject:entry];
+    }
+  }
+  if (deleteEvents) {
+    [self syncThreadUnsafeRemoveEntries:entries];
+  }
 
-  void (^removeBatchDir)(NSString *batchDirPath) = ^(NSString *batchDirPath) {
-    NSError *error;
-    if ([fileManager removeItemAtPath:batchDirPath error:&error]) {
-      GDTCORLogDebug(@"Batch removed at path: %@", batchDirPath);
-    } else {
-      GDTCORLogDebug(@"Failed to remove batch at path: %@", batchDirPath);
+  GDTCORStorageSizeBytes fileSize =
+      [self.sizeTracker fileSizeAtURL:[NSURL fileURLWithPath:batch.path]];
+  __block NSError *error;
+  BOOL removed = [self.sizeTracker changeFileAtPath:batch.path
+                                           fromSize:fileSize
+                                             toSize:0
+                                         usingBlock:^BOOL {
+                                           return [[NSFileManager defaultManager]
+                                               removeItemAtPath:batch.path
+                                                          error:&error];
+                                         }];
+  if (removed) {
+    GDTCORLogDebug(@"Batch removed at path: %@", batch.path);
+  } else {
+    GDTCORLogDebug(@"Failed to remove batch at path: %@", batch.path);
+  }
+
+  [self.batches removeObjectForKey:batchID];
+  [self.batchedEventIDs minusSet:batch.eventIDs];
+  if (!deleteEvents) {
+    // Return the events to the main storage.
+    for (GDTCOREventLogEntry *entry in entries) {
+      [self.eventIndex addEntry:entry];
     }
-  };
+  }
+}
 
-  for (NSString *batchDirPath in batchDirPaths) {
-    @autoreleasepool {
-      if (deleteEvents) {
-        removeBatchDir(batchDirPath);
-      } else {
-        NSString *batchDirName = [batchDirPath lastPathComponent];
-        NSDictionary<NSString *, id> *components = [self batchComponentsFromFilename:batchDirName];
-        NSString *targetValue = [components[kGDTCORBatchComponentsTargetKey] stringValue];
-        NSString *destinationPath;
-        if (targetValue) {
-          destinationPath = [[GDTCORFlatFileStorage eventDataStoragePath]
-              stringByAppendingPathComponent:targetValue];
+/** Moves the events stored one file each by earlier versions into the event log. Events that were
+ * in a batch are returned to the main storage, the same as when a batch expires. Each file is
+ * deleted once its event is appended, and a legacy directory is only deleted if all of its events
+ * were, so that events that couldn't be appended are migrated on a later launch.
+ */
+- (void)syncThreadUnsafeMigrateLegacyEvents {
+  NSFileManager *fileManager = [NSFileManager defaultManager];
+  NSArray<NSString *> *legacyPaths = @[
+    [GDTCORFlatFileStorage legacyEventDataStoragePath],
+    [GDTCORFlatFileStorage legacyBatchDataStoragePath]
+  ];
+
+  for (NSString *legacyPath in legacyPaths) {
+    if (![fileManager fileExistsAtPath:legacyPath]) {
+      continue;
+    }
+
+    NSMutableArray<GDTCOREventLogEntry *> *entries = [NSMutableArray array];
+    NSMutableArray<NSData *> *payloads = [NSMutableArray array];
+    NSMutableArray<NSString *> *filePaths = [NSMutableArray array];
+    NSUInteger payloadsLength = 0;
+    BOOL didFailToAppend = NO;
+    NSDirectoryEnumerator *enumerator = [fileManager enumeratorAtPath:legacyPath];
+    NSString *path;
+
+    while (YES) {
+      @autoreleasepool {
+        path = [enumerator nextObject];
+        if (path != nil) {
+          NSString *filePath = [legacyPath stringByAppendingPathComponent:path];
+          NSData *data = [NSData dataWithContentsOfFile:filePath];
+          NSError *error;
+          GDTCOREvent *event =
+              data ? (GDTCOREvent *)GDTCORDecodeArchive([GDTCOREvent class], data, &error) : nil;
+          if (event != nil && error == nil) {
+            [entries addObject:[GDTCORFlatFileStorage
+                                   logEntryForEvent:event
+                                      payloadFormat:GDTCOREventLogPayloadFormatArchive]];
+            [payloads addObject:data];
+            [filePaths addObject:filePath];
+            payloadsLength += data.length;
+          }
         }
 
-        // `- [NSFileManager moveItemAtPath:toPath:error:]` method fails if an item by the
-        // destination path already exists (which usually is the case for the current method). Move
-        // the events one by one instead.
-        if (destinationPath && [self moveContentsOfDirectoryAtPath:batchDirPath
-                                                                to:destinationPath
-                                                             error:&error]) {
-          GDTCORLogDebug(@"Batched events at path: %@ moved back to the storage: %@", batchDirPath,
-                         destinationPath);
-        } else {
-          GDTCORLogDebug(@"Error encountered whilst moving events back: %@", error);
+        if (entries.count > 0 && (path == nil || payloadsLength >= kLegacyMigrationAppendSize)) {
+          NSError *error;
+          if ([self syncThreadUnsafeAppendEntries:entries payloads:payloads error:&error]) {
+            for (NSUInteger i = 0; i < filePaths.count; i++) {
+              [self.sizeTracker changeFileAtPath:filePaths[i]
+                                        fromSize:payloads[i].length
+                                          toSize:0
+                                      usingBlock:^BOOL {
+                                        return [fileManager removeItemAtPath:filePaths[i]
+                                                                       error:nil];
+                                      }];
+            }
+          } else {
+            GDTCORLogDebug(@"Unable to migrate %@ events: %@", @(entries.count), error);
+            didFailToAppend = YES;
+          }
+          [entries removeAllObjects];
+          [payloads removeAllObjects];
+          [filePaths removeAllObjects];
+          payloadsLength = 0;
         }
 
-        // Even if not all events where moved back to the storage, there is not much can be done at
-        // this point, so cleanup batch directory now to avoid cluttering.
-        removeBatchDir(batchDirPath);
+        if (path == nil) {
+          break;
+        }
       }
     }
-  }
 
-  [self.sizeTracker resetCachedSize];
+    if (didFailToAppend) {
+      continue;
+    }
+    GDTCORStorageSizeBytes legacySize = [self.sizeTracker contentSizeOfDirectoryAtPath:legacyPath];
+    [self.sizeTracker changeFileAtPath:legacyPath
+                              fromSize:legacySize
+                                toSize:0
+                            usingBlock:^BOOL {
+                              return [fileManager removeItemAtPath:legacyPath error:nil];
+                            }];
+  }
 }
 
 #pragma mark - Private helper methods
 
-+ (NSString *)eventDataStoragePath {
-  static NSString *eventDataPath;
+/** Creates the event that was stored with the given metadata and payload.
+ *
+ * @param entry The metadata of the event.
+ * @param payload The payload of the event.
+ * @return The event, or nil if the payload couldn't be read.
+ */
++ (nullable GDTCOREvent *)eventForEntry:(GDTCOREventLogEntry *)entry
+                                payload:(nullable NSData *)payload {
+  if (payload == nil) {
+    GDTCORLogDebug(@"The payload of event %@ couldn't be read", entry.eventID);
+    return nil;
+  }
+
+  switch (entry.payloadFormat) {
+    case GDTCOREventLogPayloadFormatArchive: {
+      NSError *error;
+      GDTCOREvent *event = (GDTCOREvent *)GDTCORDecodeArchive([GDTCOREvent class], payload, &error);
+      if (event == nil || error) {
+        GDTCORLogDebug(@"Error deserializing event: %@", error);
+        return nil;
+      }
+      event.storedPayloadLength = payload.length;
+      return event;
+    }
+
+    case GDTCOREventLogPayloadFormatUploaderEncoded: {
+      GDTCOREvent *event = [self eventWithMetadataOfEntry:entry];
+      event.encodedPayload = payload;
+      event.storedPayloadLength = payload.length;
+      return event;
+    }
+  }
+
+  GDTCORLogDebug(@"Event %@ has an unknown payload format: %d", entry.eventID,
+                 (int)entry.payloadFormat);
+  return nil;
+}
+
+/** Creates an event that carries the metadata of a stored event, without reading back its data.
+ * Returns nil for events without a mapping ID, which can't be created again.
+ */
++ (nullable GDTCOREvent *)eventWithMetadataOfEntry:(GDTCOREventLogEntry *)entry {
+  if (entry.mappingID.length == 0) {
+    return nil;
+  }
+  GDTCOREvent *event = [[GDTCOREvent alloc] initWithMappingID:entry.mappingID target:entry.target];
+  event.eventID = entry.eventID;
+  event.qosTier = entry.qosTier;
+  event.expirationDate = [NSDate dateWithTimeIntervalSince1970:entry.expiration];
+  return event;
+}
+
+/** Returns the events to batch when their payloads can only add up to a limited number of bytes:
+ * fast events first, then the ones expiring soonest, so that fewer events expire while they wait.
+ *
+ * @param entries The matching events.
+ * @param maxPayloadBytes The most bytes of payload the returned events may add up to.
+ * @return The events that fit, but at least one.
+ */
++ (NSArray<GDTCOREventLogEntry *> *)entries:(NSArray<GDTCOREventLogEntry *> *)entries
+                      limitedToPayloadBytes:(GDTCORStorageSizeBytes)maxPayloadBytes {
+  GDTCORStorageSizeBytes totalPayloadBytes = 0;
+  for (GDTCOREventLogEntry *entry in entries) {
+    totalPayloadBytes += entry.payloadLength;
+  }
+  if (totalPayloadBytes <= maxPayloadBytes) {
+    return entries;
+  }
+
+  NSArray<GDTCOREventLogEntry *> *sortedEntries = [entries
+      sortedArrayUsingComparator:^NSComparisonResult(GDTCOREventLogEntry *entry1,
+                                                     GDTCOREventLogEntry *entry2) {
+        BOOL isFast1 = entry1.qosTier == GDTCOREventQoSFast;
+        BOOL isFast2 = entry2.qosTier == GDTCOREventQoSFast;
+        if (isFast1 != isFast2) {
+          return isFast1 ? NSOrderedAscending : NSOrderedDescending;
+        }
+        if (entry1.expiration != entry2.expiration) {
+          return entry1.expiration < entry2.expiration ? NSOrderedAscending : NSOrderedDescending;
+        }
+        return NSOrderedSame;
+      }];
+
+  NSMutableArray<GDTCOREventLogEntry *> *limitedEntries = [NSMutableArray array];
+  GDTCORStorageSizeBytes payloadBytes = 0;
+  for (GDTCOREventLogEntry *entry in sortedEntries) {
+    if (limitedEntries.count > 0 && payloadBytes + entry.payloadLength > maxPayloadBytes) {
+      break;
+    }
+    payloadBytes += entry.payloadLength;
+    [limitedEntries addObject:entry];
+  }
+  GDTCORLogDebug(@"Batching %lu of %lu events to keep the batch under %llu bytes",
+                 (unsigned long)limitedEntries.count, (unsigned long)entries.count,
+                 maxPayloadBytes);
+  return limitedEntries;
+}
+
++ (GDTCOREventLogEntry *)logEntryForEvent:(GDTCOREvent *)event
+                            payloadFormat:(GDTCOREventLogPayloadFormat)payloadFormat {
+  return [[GDTCOREventLogEntry alloc]
+      initWithEventID:event.eventID
+            mappingID:event.mappingID ?: @""
+               target:event.target
+              qosTier:event.qosTier
+           expiration:(int64_t)event.expirationDate.timeIntervalSince1970
+        payloadFormat:payloadFormat];
+}
+
++ (NSString *)eventLogStoragePath {
+  static NSString *eventLogPath;
   static dispatch_once_t onceToken;
   dispatch_once(&onceToken, ^{
-    eventDataPath = [NSString stringWithFormat:@"%@/%@/gdt_event_data", GDTCORRootDirectory().path,
-                                               NSStringFromClass([self class])];
+    eventLogPath = [NSString stringWithFormat:@"%@/%@/gdt_event_log", GDTCORRootDirectory().path,
+                                              NSStringFromClass([self class])];
   });
-  NSError *error;
-  [[NSFileManager defaultManager] createDirectoryAtPath:eventDataPath
-                            withIntermediateDirectories:YES
-                                             attributes:0
-                                                  error:&error];
-  GDTCORAssert(error == nil, @"Creating the library data path failed: %@", error);
-  return eventDataPath;
+  return eventLogPath;
 }
 
 + (NSString *)batchDataStoragePath {
   static NSString *batchDataPath;
   static dispatch_once_t onceToken;
   dispatch_once(&onceToken, ^{
-    batchDataPath = [NSString stringWithFormat:@"%@/%@/gdt_batch_data", GDTCORRootDirectory().path,
+    batchDataPath = [NSString stringWithFormat:@"%@/%@/gdt_event_batches",
+                                               GDTCORRootDirectory().path,
                                                NSStringFromClass([self class])];
   });
   NSError *error;
@@ -657,6 +996,18 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
   return batchDataPath;
 }
 
+/** The directory earlier versions stored one file per event in. */
++ (NSString *)legacyEventDataStoragePath {
+  return [NSString stringWithFormat:@"%@/%@/gdt_event_data", GDTCORRootDirectory().path,
+                                    NSStringFromClass([self class])];
+}
+
+/** The directory earlier versions moved the files of batched events to. */
++ (NSString *)legacyBatchDataStoragePath {
+  return [NSString stringWithFormat:@"%@/%@/gdt_batch_data", GDTCORRootDirectory().path,
+                                    NSStringFromClass([self class])];
+}
+
 + (NSString *)libraryDataStoragePath {
   static NSString *libraryDataPath;
   static dispatch_once_t onceToken;
@@ -683,80 +1034,24 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                                  ((uint64_t)expirationDate.timeIntervalSince1970)];
 }
 
-+ (NSString *)pathForTarget:(GDTCORTarget)target
-                    eventID:(NSString *)eventID
-                    qosTier:(NSNumber *)qosTier
-             expirationDate:(NSDate *)expirationDate
-                  mappingID:(NSString *)mappingID {
-  NSMutableCharacterSet *allowedChars = [[NSCharacterSet alphanumericCharacterSet] mutableCopy];
-  [allowedChars addCharactersInString:kMetadataSeparator];
-  mappingID = [mappingID stringByAddingPercentEncodingWithAllowedCharacters:allowedChars];
-  return [NSString stringWithFormat:@"%@/%ld/%@%@%@%@%llu%@%@",
-                                    [GDTCORFlatFileStorage eventDataStoragePath], (long)target,
-                                    eventID, kMetadataSeparator, qosTier, kMetadataSeparator,
-                                    ((uint64_t)expirationDate.timeIntervalSince1970),
-                                    kMetadataSeparator, mappingID];
-}
-
-- (void)pathsForTarget:(GDTCORTarget)target
-              eventIDs:(nullable NSSet<NSString *> *)eventIDs
-              qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
-            mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
-            onComplete:(void (^)(NSSet<NSString *> *paths))onComplete {
-  void (^completion)(NSSet<NSString *> *) = onComplete == nil ? ^(NSSet<NSString *> *paths){} : onComplete;
+- (void)eventIDsForTarget:(GDTCORTarget)target
+                 eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                 qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+               mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+               onComplete:(void (^)(NSSet<NSString *> *eventIDs))onComplete {
   dispatch_async(_storageQueue, ^{
-    NSMutableSet<NSString *> *paths = [[NSMutableSet alloc] init];
-    NSFileManager *fileManager = [NSFileManager defaultManager];
-    NSString *targetPath = [NSString
-        stringWithFormat:@"%@/%ld", [GDTCORFlatFileStorage eventDataStoragePath], (long)target];
-    [fileManager createDirectoryAtPath:targetPath
-           withIntermediateDirectories:YES
-                            attributes:nil
-                                 error:nil];
-    NSError *error;
-    NSArray<NSString *> *dirPaths = [fileManager contentsOfDirectoryAtPath:targetPath error:&error];
-    if (error) {
-      GDTCORLogDebug(@"There was an error reading the contents of the target path: %@", error);
-      completion(paths);
-      return;
+    [self syncThreadUnsafeCommitPendingEvents];
+    NSArray<GDTCOREventLogEntry *> *entries = [self.eventIndex entriesForTarget:target
+                                                                       eventIDs:eventIDs
+                                                                       qosTiers:qosTiers
+                                                                     mappingIDs:mappingIDs];
+    NSMutableSet<NSString *> *matchingEventIDs = [NSMutableSet setWithCapacity:entries.count];
+    for (GDTCOREventLogEntry *entry in entries) {
+      [matchingEventIDs addObject:entry.eventID];
     }
-    BOOL checkingIDs = eventIDs.count > 0;
-    BOOL checkingQosTiers = qosTiers.count > 0;
-    BOOL checkingMappingIDs = mappingIDs.count > 0;
-    BOOL checkingAnything = checkingIDs == NO && checkingQosTiers == NO && checkingMappingIDs == NO;
-    for (NSString *path in dirPaths) {
-      // Skip hidden files that are created as part of atomic file creation.
-      if ([path hasPrefix:@"."]) {
-        continue;
-      }
-      NSString *filePath = [targetPath stringByAppendingPathComponent:path];
-      if (checkingAnything) {
-        [paths addObject:filePath];
-        continue;
-      }
-      NSString *filename = [path lastPathComponent];
-      NSDictionary<NSString *, id> *eventComponents = [self eventComponentsFromFilename:filename];
-      if (!eventComponents) {
-        GDTCORLogDebug(@"There was an error reading the filename components: %@", eventComponents);
-        continue;
-      }
-      NSString *eventID = eventComponents[kGDTCOREventComponentsEventIDKey];
-      NSNumber *qosTier = eventComponents[kGDTCOREventComponentsQoSTierKey];
-      NSString *mappingID = eventComponents[kGDTCOREventComponentsMappingIDKey];
-
-      NSNumber *eventIDMatch = checkingIDs ? @([eventIDs containsObject:eventID]) : nil;
-      NSNumber *qosTierMatch = checkingQosTiers ? @([qosTiers containsObject:qosTier]) : nil;
-      NSNumber *mappingIDMatch =
-          checkingMappingIDs
-              ? @([mappingIDs containsObject:[mappingID stringByRemovingPercentEncoding]])
-              : nil;
-      if ((eventIDMatch == nil || eventIDMatch.boolValue) &&
-          (qosTierMatch == nil || qosTierMatch.boolValue) &&
-          (mappingIDMatch == nil || mappingIDMatch.boolValue)) {
-        [paths addObject:filePath];
-      }
+    if (onComplete) {
+      onComplete(matchingEventIDs);
     }
-    completion(paths);
   });
 }
 
@@ -783,29 +1078,6 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
       }];
 }
 
-- (nullable NSDictionary<NSString *, id> *)eventComponentsFromFilename:(NSString *)fileName {
-  NSArray<NSString *> *components = [fileName componentsSeparatedByString:kMetadataSeparator];
-  if (components.count >= 4) {
-    NSString *eventID = components[0];
-    NSNumber *qosTier = @(components[1].integerValue);
-    NSDate *expirationDate = [NSDate dateWithTimeIntervalSince1970:components[2].longLongValue];
-    NSString *mappingID = [[components subarrayWithRange:NSMakeRange(3, components.count - 3)]
-        componentsJoinedByString:kMetadataSeparator];
-    if (eventID == nil || qosTier == nil || mappingID == nil || expirationDate == nil) {
-      GDTCORLogDebug(@"There was an error parsing the event filename components: %@", components);
-      return nil;
-    }
-    return @{
-      kGDTCOREventComponentsEventIDKey : eventID,
-      kGDTCOREventComponentsQoSTierKey : qosTier,
-      kGDTCOREventComponentsExpirationKey : expirationDate,
-      kGDTCOREventComponentsMappingIDKey : mappingID
-    };
-  }
-  GDTCORLogDebug(@"The event filename could not be split: %@", fileName);
-  return nil;
-}
-
 - (nullable NSDictionary<NSString *, id> *)batchComponentsFromFilename:(NSString *)fileName {
   NSArray<NSString *> *components = [fileName componentsSeparatedByString:kMetadataSeparator];
   if (components.count == 3) {
@@ -838,6 +1110,8 @@ const uint64_t kGDTCORFlatFileStorageSizeLimit = 20 * 1000 * 1000;  // 20 MB.
                          [app endBackgroundTask:bgID];
                          bgID = GDTCORBackgroundIdentifierInvalid;
                        }];
+    // Don't leave stored events waiting while the app may be suspended.
+    [self syncThreadUnsafeCommitPendingEvents];
     // End the background task if it's still valid.
     [app endBackgroundTask:bgID];
     bgID = GDTCORBackgroundIdentifierInvalid;
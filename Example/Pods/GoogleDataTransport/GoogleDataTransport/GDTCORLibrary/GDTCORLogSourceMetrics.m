@@ -37,6 +37,11 @@ typedef NSDictionary<NSNumber *, NSNumber *> GDTCORDroppedEventCounter;
   return [[self alloc] initWithDroppedEventCounterByLogSource:@{}];
 }
 
++ (instancetype)metricsWithDroppedEventCounterByLogSource:
+    (NSDictionary<NSString *, GDTCORDroppedEventCounter *> *)droppedEventCounterByLogSource {
+  return [[self alloc] initWithDroppedEventCounterByLogSource:droppedEventCounterByLogSource];
+}
+
 + (instancetype)metricsWithEvents:(NSArray<GDTCOREvent *> *)events
                  droppedForReason:(GDTCOREventDropReason)reason {
   NSMutableDictionary<NSString *, GDTCORDroppedEventCounter *> *eventCounterByLogSource =
@@ -25,6 +25,7 @@
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORConsoleLogger.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCOREvent.h"
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORPlatform.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORRegistrar.h"
 #import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageProtocol.h"
 
@@ -34,10 +35,78 @@
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORMetricsMetadata.h"
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORStorageMetadata.h"
 
+#import <pthread.h>
+
+/// The number of shards dropped events are counted in. Threads are spread over the shards, so that
+/// threads dropping events at the same time rarely wait for each other.
+static const NSUInteger kGDTCORMetricsControllerCounterShardCount = 8;
+
+/// How long dropped event counts are kept in memory before they are persisted to storage.
+static const int64_t kGDTCORMetricsControllerPersistDelay = 5 * NSEC_PER_SEC;
+
+/// How long the app is held up on termination while the dropped event counts are persisted.
+static const int64_t kGDTCORMetricsControllerTerminationPersistTimeout = 1 * NSEC_PER_SEC;
+
+/// Counts of dropped events, by log source and drop reason, for the threads that map to the shard.
+/// Guarded by @synchronized on the shard. Counts taken out of the shards to be persisted are held
+/// in the same form.
+@interface GDTCORDroppedEventCounterShard : NSObject
+
+/// The number of events dropped for each reason, by log source.
+@property(nonatomic, readonly)
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSNumber *, NSNumber *> *> *counters;
+
+/// When the first of the counted events was dropped, or `nil` if none are counted.
+@property(nonatomic, nullable) NSDate *collectionStartDate;
+
+/// Adds the counts of another shard to this one's.
+/// @param shard The shard to add the counts of.
+- (void)addCountsOfShard:(GDTCORDroppedEventCounterShard *)shard;
+
+@end
+
+@implementation GDTCORDroppedEventCounterShard
+
+- (instancetype)init {
+  self = [super init];
+  if (self) {
+    _counters = [NSMutableDictionary dictionary];
+  }
+  return self;
+}
+
+- (void)addCountsOfShard:(GDTCORDroppedEventCounterShard *)shard {
+  [shard.counters enumerateKeysAndObjectsUsingBlock:^(
+                      NSString *logSource, NSMutableDictionary<NSNumber *, NSNumber *> *counter,
+                      BOOL *stop) {
+    NSMutableDictionary<NSNumber *, NSNumber *> *eventCounter = self.counters[logSource];
+    if (eventCounter == nil) {
+      eventCounter = [NSMutableDictionary dictionary];
+      self.counters[logSource] = eventCounter;
+    }
+    [counter enumerateKeysAndObjectsUsingBlock:^(NSNumber *reason, NSNumber *count, BOOL *stop) {
+      eventCounter[reason] = @([eventCounter[reason] integerValue] + [count integerValue]);
+    }];
+  }];
+  if (self.collectionStartDate == nil ||
+      [shard.collectionStartDate compare:self.collectionStartDate] == NSOrderedAscending) {
+    self.collectionStartDate = shard.collectionStartDate;
+  }
+}
+
+@end
+
 @interface GDTCORMetricsController ()
 /// The underlying storage object where metrics are stored.
 @property(nonatomic) id<GDTCORStoragePromiseProtocol> storage;
 
+/// The counts of dropped events that haven't been persisted to storage yet.
+@property(nonatomic, readonly) NSArray<GDTCORDroppedEventCounterShard *> *counterShards;
+
+/// YES if persisting the counts of dropped events has been scheduled. Guarded by @synchronized on
+/// the controller.
+@property(nonatomic) BOOL isPersistScheduled;
+
 @end
 
 @implementation GDTCORMetricsController
@@ -67,10 +136,30 @@
   self = [super init];
   if (self) {
     _storage = storage;
+    NSMutableArray<GDTCORDroppedEventCounterShard *> *counterShards = [NSMutableArray array];
+    for (NSUInteger i = 0; i < kGDTCORMetricsControllerCounterShardCount; i++) {
+      [counterShards addObject:[[GDTCORDroppedEventCounterShard alloc] init]];
+    }
+    _counterShards = [counterShards copy];
+
+    // Counts still in memory would be lost if the app were suspended and killed, or terminated.
+    NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
+    [notificationCenter addObserver:self
+                           selector:@selector(applicationDidEnterBackgroundNotification:)
+                               name:kGDTCORApplicationDidEnterBackgroundNotification
+                             object:nil];
+    [notificationCenter addObserver:self
+                           selector:@selector(applicationWillTerminateNotification:)
+                               name:kGDTCORApplicationWillTerminateNotification
+                             object:nil];
   }
   return self;
 }
 
+- (void)dealloc {
+  [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
 - (nonnull FBLPromise<NSNull *> *)logEventsDroppedForReason:(GDTCOREventDropReason)reason
                                                      events:(nonnull NSSet<GDTCOREvent *> *)events {
   // No-op if there are no events to log.
@@ -78,36 +167,47 @@
     return [FBLPromise resolvedWith:nil];
   }
 
-  __auto_type handler = ^GDTCORMetricsMetadata *(GDTCORMetricsMetadata *_Nullable metricsMetadata,
-                                                 NSError *_Nullable fetchError) {
-    GDTCORLogSourceMetrics *logSourceMetrics =
-        [GDTCORLogSourceMetrics metricsWithEvents:[events allObjects] droppedForReason:reason];
-
-    if (metricsMetadata) {
-      GDTCORLogSourceMetrics *updatedLogSourceMetrics = [metricsMetadata.logSourceMetrics
-          logSourceMetricsByMergingWithLogSourceMetrics:logSourceMetrics];
-
-      return [GDTCORMetricsMetadata
-          metadataWithCollectionStartDate:[metricsMetadata collectionStartDate]
-                         logSourceMetrics:updatedLogSourceMetrics];
-    } else {
-      // There was an error (e.g. empty storage); `metricsMetadata` is nil.
-      GDTCORLogDebug(@"Error fetching metrics metadata: %@", fetchError);
-      return [GDTCORMetricsMetadata metadataWithCollectionStartDate:[NSDate date]
-                                                   logSourceMetrics:logSourceMetrics];
+  // Count the events in memory. The counts are merged into the stored metrics when they are
+  // persisted a few seconds later, or when the metrics are next fetched, whichever is first.
+  GDTCORDroppedEventCounterShard *shard = [self counterShardForCurrentThread];
+  BOOL wasEmpty;
+  @synchronized(shard) {
+    wasEmpty = shard.counters.count == 0;
+    for (GDTCOREvent *event in events) {
+      // Dropped events with a `nil` or empty mapping ID (log source) are not recorded.
+      if (event.mappingID.length == 0) {
+        continue;
+      }
+      NSMutableDictionary<NSNumber *, NSNumber *> *eventCounter = shard.counters[event.mappingID];
+      if (eventCounter == nil) {
+        eventCounter = [NSMutableDictionary dictionary];
+        shard.counters[event.mappingID] = eventCounter;
+      }
+      eventCounter[@(reason)] = @([eventCounter[@(reason)] integerValue] + 1);
     }
-  };
+    if (wasEmpty && shard.counters.count > 0) {
+      shard.collectionStartDate = [NSDate date];
+    }
+  }
 
-  return [_storage fetchAndUpdateMetricsWithHandler:handler];
+  if (wasEmpty) {
+    [self schedulePersistingDroppedEventCounts];
+  }
+  return [FBLPromise resolvedWith:nil];
 }
 
 - (nonnull FBLPromise<GDTCORMetrics *> *)getAndResetMetrics {
   __block GDTCORMetricsMetadata *_Nullable snapshottedMetricsMetadata = nil;
+  __block GDTCORDroppedEventCounterShard *_Nullable takenCounts = nil;
 
   __auto_type handler = ^GDTCORMetricsMetadata *(GDTCORMetricsMetadata *_Nullable metricsMetadata,
                                                  NSError *_Nullable fetchError) {
-    if (metricsMetadata) {
-      snapshottedMetricsMetadata = metricsMetadata;
+    // Include the dropped events counted in memory that haven't been persisted yet.
+    takenCounts = [self takeDroppedEventCounts];
+    GDTCORMetricsMetadata *_Nullable mergedMetricsMetadata =
+        [self metricsMetadataByMergingDroppedEventCounts:takenCounts withMetadata:metricsMetadata];
+    if (mergedMetricsMetadata) {
+      snapshottedMetricsMetadata = mergedMetricsMetadata;
     } else {
       GDTCORLogDebug(@"Error fetching metrics metadata: %@", fetchError);
     }
@@ -116,6 +216,10 @@
   };
 
   return [_storage fetchAndUpdateMetricsWithHandler:handler]
+      .catchOn(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(NSError *__unused error) {
+        // The stored metrics weren't reset, so the counts are kept for the next fetch.
+        [self restoreDroppedEventCounts:takenCounts];
+      })
       .validate(^BOOL(NSNull *__unused _) {
         // Break and reject the promise chain when storage contains no metrics
         // metadata.
@@ -185,6 +289,153 @@
   return [_storage fetchAndUpdateMetricsWithHandler:handler];
 }
 
+#pragma mark - Dropped event counting
+
+/// Returns the counter shard for the calling thread.
+- (GDTCORDroppedEventCounterShard *)counterShardForCurrentThread {
+  // Thread pointers are aligned and allocated close together, so their low bits barely vary. A
+  // Fibonacci hash spreads them, and its high bits are the well mixed ones.
+  uint64_t hash = (uint64_t)(uintptr_t)pthread_self() * 0x9E3779B97F4A7C15ull;
+  return self.counterShards[(hash >> 32) % kGDTCORMetricsControllerCounterShardCount];
+}
+
+/// Schedules persisting the dropped event counts to storage, unless it's already scheduled.
+- (void)schedulePersistingDroppedEventCounts {
+  @synchronized(self) {
+    if (self.isPersistScheduled) {
+      return;
+    }
+    self.isPersistScheduled = YES;
+  }
+
+  dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, kGDTCORMetricsControllerPersistDelay);
+  dispatch_after(deadline, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    @synchronized(self) {
+      self.isPersistScheduled = NO;
+    }
+    [self persistDroppedEventCounts];
+  });
+}
+
+/// Merges the dropped event counts into the stored metrics. If the stored metrics can't be
+/// updated, the counts are put back to be persisted later.
+- (FBLPromise<NSNull *> *)persistDroppedEventCounts {
+  __block GDTCORDroppedEventCounterShard *_Nullable takenCounts = nil;
+
+  __auto_type handler = ^GDTCORMetricsMetadata *(GDTCORMetricsMetadata *_Nullable metricsMetadata,
+                                                 NSError *_Nullable fetchError) {
+    if (metricsMetadata == nil) {
+      // There was an error (e.g. empty storage); `metricsMetadata` is nil.
+      GDTCORLogDebug(@"Error fetching metrics metadata: %@", fetchError);
+    }
+    takenCounts = [self takeDroppedEventCounts];
+    GDTCORMetricsMetadata *_Nullable mergedMetricsMetadata =
+        [self metricsMetadataByMergingDroppedEventCounts:takenCounts withMetadata:metricsMetadata];
+    return mergedMetricsMetadata
+               ?: [GDTCORMetricsMetadata metadataWithCollectionStartDate:[NSDate date]
+                                                        logSourceMetrics:[GDTCORLogSourceMetrics
+                                                                             metrics]];
+  };
+
+  return [_storage fetchAndUpdateMetricsWithHandler:handler].catchOn(
+      dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(NSError *error) {
+        GDTCORLogDebug(@"Error persisting dropped event counts: %@", error);
+        [self restoreDroppedEventCounts:takenCounts];
+      });
+}
+
+/// Takes the dropped event counts out of the counter shards.
+/// @return The counts of all the shards, or `nil` if there were none.
+- (nullable GDTCORDroppedEventCounterShard *)takeDroppedEventCounts {
+  GDTCORDroppedEventCounterShard *takenCounts = [[GDTCORDroppedEventCounterShard alloc] init];
+  for (GDTCORDroppedEventCounterShard *shard in self.counterShards) {
+    @synchronized(shard) {
+      if (shard.counters.count == 0) {
+        continue;
+      }
+      [takenCounts addCountsOfShard:shard];
+      [shard.counters removeAllObjects];
+      shard.collectionStartDate = nil;
+    }
+  }
+  return takenCounts.counters.count > 0 ? takenCounts : nil;
+}
+
+/// Puts back counts that were taken out of the counter shards but couldn't be persisted.
+/// @param takenCounts The counts, if any were taken.
+- (void)restoreDroppedEventCounts:(nullable GDTCORDroppedEventCounterShard *)takenCounts {
+  if (takenCounts == nil) {
+    return;
+  }
+  GDTCORDroppedEventCounterShard *shard = [self counterShardForCurrentThread];
+  BOOL wasEmpty;
+  @synchronized(shard) {
+    wasEmpty = shard.counters.count == 0;
+    [shard addCountsOfShard:takenCounts];
+  }
+  if (wasEmpty) {
+    [self schedulePersistingDroppedEventCounts];
+  }
+}
+
+/// Merges dropped event counts with the given metrics metadata.
+/// @param counts The counts to merge, if any.
+/// @param metricsMetadata The metadata to merge with, if any.
+/// @return The merged metadata, or `nil` if there were neither counts nor metadata.
+- (nullable GDTCORMetricsMetadata *)
+    metricsMetadataByMergingDroppedEventCounts:(nullable GDTCORDroppedEventCounterShard *)counts
+                                  withMetadata:(nullable GDTCORMetricsMetadata *)metricsMetadata {
+  if (counts == nil) {
+    return metricsMetadata;
+  }
+
+  GDTCORLogSourceMetrics *countsLogSourceMetrics =
+      [GDTCORLogSourceMetrics metricsWithDroppedEventCounterByLogSource:counts.counters];
+  if (metricsMetadata == nil) {
+    return [GDTCORMetricsMetadata
+        metadataWithCollectionStartDate:counts.collectionStartDate ?: [NSDate date]
+                       logSourceMetrics:countsLogSourceMetrics];
+  }
+
+  NSDate *collectionStartDate = metricsMetadata.collectionStartDate;
+  if ([counts.collectionStartDate compare:collectionStartDate] == NSOrderedAscending) {
+    collectionStartDate = counts.collectionStartDate;
+  }
+  return [GDTCORMetricsMetadata
+      metadataWithCollectionStartDate:collectionStartDate
+                     logSourceMetrics:[metricsMetadata.logSourceMetrics
+                                          logSourceMetricsByMergingWithLogSourceMetrics:
+                                              countsLogSourceMetrics]];
+}
+
+#pragma mark - Application lifecycle
+
+- (void)applicationDidEnterBackgroundNotification:(NSNotification *)notification {
+  GDTCORApplication *app = [GDTCORApplication sharedApplication];
+  __block GDTCORBackgroundIdentifier bgID =
+      [app beginBackgroundTaskWithName:@"GDTMetrics"
+                     expirationHandler:^{
+                       [app endBackgroundTask:bgID];
+                       bgID = GDTCORBackgroundIdentifierInvalid;
+                     }];
+  [self persistDroppedEventCounts].alwaysOn(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    // End the background task if it's still valid.
+    [app endBackgroundTask:bgID];
+    bgID = GDTCORBackgroundIdentifierInvalid;
+  });
+}
+
+- (void)applicationWillTerminateNotification:(NSNotification *)notification {
+  // The app exits once the notification returns, so wait a little for the counts to be written.
+  dispatch_semaphore_t persisted = dispatch_semaphore_create(0);
+  [self persistDroppedEventCounts].alwaysOn(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+    dispatch_semaphore_signal(persisted);
+  });
+  dispatch_time_t timeout =
+      dispatch_time(DISPATCH_TIME_NOW, kGDTCORMetricsControllerTerminationPersistTimeout);
+  dispatch_semaphore_wait(persisted, timeout);
+}
+
 #pragma mark - GDTCORStorageDelegate
 
 - (void)storage:(id<GDTCORStorageProtocol>)storage
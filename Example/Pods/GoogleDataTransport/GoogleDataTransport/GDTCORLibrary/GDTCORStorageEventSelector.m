@@ -26,12 +26,25 @@
                       eventIDs:(nullable NSSet<NSString *> *)eventIDs
                     mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
                       qosTiers:(nullable NSSet<NSNumber *> *)qosTiers {
+  return [self initWithTarget:target
+                     eventIDs:eventIDs
+                   mappingIDs:mappingIDs
+                     qosTiers:qosTiers
+              maxPayloadBytes:0];
+}
+
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                      eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                    mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+                      qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+               maxPayloadBytes:(GDTCORStorageSizeBytes)maxPayloadBytes {
   self = [super init];
   if (self) {
     _selectedTarget = target;
     _selectedEventIDs = eventIDs;
     _selectedMappingIDs = mappingIDs;
     _selectedQosTiers = qosTiers;
+    _maxPayloadBytes = maxPayloadBytes;
   }
   return self;
 }
@@ -23,7 +23,10 @@
 
 #import "GoogleDataTransport/GDTCORLibrary/Private/GDTCORRegistrar_Private.h"
 
-@implementation GDTCORUploadCoordinator
+@implementation GDTCORUploadCoordinator {
+  /** The targets forced to upload since the last forced upload. */
+  NSMutableSet<NSNumber *> *_forcedTargets;
+}
 
 + (instancetype)sharedInstance {
   static GDTCORUploadCoordinator *sharedUploader;
@@ -43,23 +46,38 @@
     _registrar = [GDTCORRegistrar sharedInstance];
     _timerInterval = 30 * NSEC_PER_SEC;
     _timerLeeway = 5 * NSEC_PER_SEC;
+    _forcedUploadDelay = 1 * NSEC_PER_SEC;
+    _forcedTargets = [[NSMutableSet alloc] init];
   }
   return self;
 }
 
 - (void)forceUploadForTarget:(GDTCORTarget)target {
   dispatch_async(_coordinationQueue, ^{
+    BOOL isUploadScheduled = self->_forcedTargets.count > 0;
+    [self->_forcedTargets addObject:@(target)];
+    if (isUploadScheduled) {
+      GDTCORLogDebug(@"Adding target %ld to the forced upload", (long)target);
+      return;
+    }
+
     GDTCORLogDebug(@"Forcing an upload of target %ld", (long)target);
-    GDTCORUploadConditions conditions = [self uploadConditions];
-    conditions |= GDTCORUploadConditionHighPriority;
-    [self uploadTargets:@[ @(target) ] conditions:conditions];
+    dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t)self->_forcedUploadDelay);
+    dispatch_after(deadline, self->_coordinationQueue, ^{
+      NSArray<NSNumber *> *targets = [self->_forcedTargets allObjects];
+      [self->_forcedTargets removeAllObjects];
+      GDTCORUploadConditions conditions = [self uploadConditions];
+      conditions |= GDTCORUploadConditionHighPriority;
+      [self uploadTargets:targets conditions:conditions];
+    });
   });
 }
 
 #pragma mark - Private helper methods
 
-/** Starts a timer that checks whether or not events can be uploaded at regular intervals. It will
- * check the next-upload clocks of all targets to determine if an upload attempt can be made.
+/** Starts a timer that checks whether or not events can be uploaded. It will check the
+ * next-upload clocks of all targets to determine if an upload attempt can be made, and when to
+ * check again.
  */
 - (void)startTimer {
   dispatch_async(_coordinationQueue, ^{
@@ -73,14 +91,17 @@
 
     self->_timer =
         dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self->_coordinationQueue);
-    dispatch_source_set_timer(self->_timer, deadline, self->_timerInterval, self->_timerLeeway);
+    dispatch_source_set_timer(self->_timer, deadline, DISPATCH_TIME_FOREVER, self->_timerLeeway);
 
     dispatch_source_set_event_handler(self->_timer, ^{
+      uint64_t nextFireInterval = self->_timerInterval;
       if (![[GDTCORApplication sharedApplication] isRunningInBackground]) {
-        GDTCORUploadConditions conditions = [self uploadConditions];
         GDTCORLogDebug(@"%@", @"Upload timer fired");
-        [self uploadTargets:[self.registrar.targetToUploader allKeys] conditions:conditions];
+        nextFireInterval = [self uploadReadyTargets];
       }
+      dispatch_time_t nextFire = dispatch_time(DISPATCH_TIME_NOW, (int64_t)nextFireInterval);
+      dispatch_source_set_timer(self->_timer, nextFire, DISPATCH_TIME_FOREVER,
+                                self->_timerLeeway);
     });
     GDTCORLogDebug(@"%@", @"Upload timer started");
     dispatch_resume(self->_timer);
@@ -95,6 +116,35 @@
   }
 }
 
+/** Triggers the uploads of all the targets that are ready to upload, together.
+ *
+ * @return The time until the soonest of the other targets is ready, at most `timerInterval`.
+ */
+- (uint64_t)uploadReadyTargets {
+  uint64_t nextFireInterval = _timerInterval;
+  NSMutableArray<NSNumber *> *readyTargets = [NSMutableArray array];
+  NSDictionary<NSNumber *, id<GDTCORUploader>> *targetToUploader = _registrar.targetToUploader;
+  for (NSNumber *target in targetToUploader) {
+    id<GDTCORUploader> uploader = targetToUploader[target];
+    NSTimeInterval wait = 0;
+    if ([uploader respondsToSelector:@selector(timeIntervalUntilNextUploadForTarget:)]) {
+      wait = [uploader timeIntervalUntilNextUploadForTarget:target.intValue];
+    }
+    if (wait <= 0) {
+      [readyTargets addObject:target];
+    } else {
+      // The timer is re-armed for when the target is ready. Its leeway can only make it fire
+      // later, never before the target's wait is over.
+      GDTCORLogDebug(@"Target %@ can't upload for another %.1f seconds", target, wait);
+      nextFireInterval = MIN(nextFireInterval, (uint64_t)(wait * NSEC_PER_SEC));
+    }
+  }
+  if (readyTargets.count > 0) {
+    [self uploadTargets:readyTargets conditions:[self uploadConditions]];
+  }
+  return nextFireInterval;
+}
+
 /** Triggers the uploader implementations for the given targets to upload.
  *
  * @param targets An array of targets to trigger.
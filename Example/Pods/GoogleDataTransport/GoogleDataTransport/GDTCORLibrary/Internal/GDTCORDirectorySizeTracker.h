@@ -22,6 +22,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 /** The class calculates and caches the specified directory content size and uses add/remove signals
  *  from client the client to keep the size up to date without accessing file system.
+ *  When initialized with a ledger path, the size is also persisted there with each change, so the
+ *  directory only needs to be walked again to reconcile it, which happens once a day.
  *  This is an internal class designed to be used by `GDTCORFlatFileStorage`.
  *  NOTE: The class is not thread-safe. The client must take care of synchronization.
  */
@@ -34,6 +36,14 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (instancetype)initWithDirectoryPath:(NSString *)path;
 
+/** Initializes the object with a directory path and a file to persist the size in.
+ * @param path The directory path to track content size.
+ * @param ledgerPath The file to persist the size in. It should be a hidden file, so that it is not
+ * counted itself if it is inside the tracked directory.
+ */
+- (instancetype)initWithDirectoryPath:(NSString *)path
+                           ledgerPath:(nullable NSString *)ledgerPath NS_DESIGNATED_INITIALIZER;
+
 /** Returns a cached or calculates (if there is no cached) directory content size.
  * @return The directory content size in bytes calculated based on `NSURLFileSizeKey`.
  */
@@ -55,9 +65,35 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)fileWasRemovedAtPath:(NSString *)path withSize:(GDTCORStorageSizeBytes)fileSize;
 
+/** Makes a change to a file or directory in the tracked directory and updates the size for it.
+ * The change is recorded in the ledger, in the same write as the resulting size, before it is
+ * made. If it is interrupted, the size is corrected from the file as it was left when the ledger
+ * is next read, rather than by the next reconciliation.
+ * @param path The file or directory that is changed.
+ * @param oldSize The size of the file or directory before the change, 0 if it is added.
+ * @param newSize The size of the file or directory after the change, 0 if it is removed.
+ * @param change Makes the change and returns YES, or returns NO if it was not made. It must not
+ * call the tracker.
+ * @return The result of `change`.
+ */
+- (BOOL)changeFileAtPath:(NSString *)path
+                fromSize:(GDTCORStorageSizeBytes)oldSize
+                  toSize:(GDTCORStorageSizeBytes)newSize
+              usingBlock:(BOOL (^)(void))change;
+
 /** Invalidates cached directory size. */
 - (void)resetCachedSize;
 
+/** Recalculates the directory content size if it has not been done for a while, to correct for
+ * changes the client did not report.
+ * @param queue The queue the client synchronizes access on. Must be called on this queue. The
+ * directory is walked later on it, so that no change is made while it is.
+ */
+- (void)reconcileIfNeededOnQueue:(dispatch_queue_t)queue;
+
+/** Walks a directory and returns the combined size of the regular files in it. */
+- (GDTCORStorageSizeBytes)contentSizeOfDirectoryAtPath:(NSString *)path;
+
 /** Returns URL resource value for `NSURLFileSizeKey` key for the specified URL. */
 - (GDTCORStorageSizeBytes)fileSizeAtURL:(NSURL *)fileURL;
 
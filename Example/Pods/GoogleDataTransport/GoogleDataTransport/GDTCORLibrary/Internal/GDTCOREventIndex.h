@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+@class GDTCOREventLogEntry;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** An inverted index of events from (target, qosTier, mappingID) to the events with those values,
+ * so that selecting events only visits the events that can match. The events are also kept in a
+ * `GDTCORExpiryWheel`, so that finding the expired ones only visits the ones that are due.
+ *
+ * The index holds no state of its own that needs persisting: it is built from the metadata the
+ * event log keeps on disk when the log is opened, and kept up to date as events are added and
+ * removed.
+ *
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCOREventIndex : NSObject
+
+/** Adds an event to the index, replacing any event with the same event ID. */
+- (void)addEntry:(GDTCOREventLogEntry *)entry;
+
+/** Removes the event with the given event ID from the index, if it's there. */
+- (void)removeEntryWithEventID:(NSString *)eventID;
+
+/** Returns the event with the given event ID, if it's in the index. */
+- (nullable GDTCOREventLogEntry *)entryWithEventID:(NSString *)eventID;
+
+/** Returns the events in the index that match all of the given parameters.
+ *
+ * @param target The target.
+ * @param eventIDs The list of eventIDs to look for, or nil for any.
+ * @param qosTiers The list of qosTiers to look for, or nil for any.
+ * @param mappingIDs The list of mappingIDs to look for, or nil for any.
+ * @return The matching events.
+ */
+- (NSArray<GDTCOREventLogEntry *> *)entriesForTarget:(GDTCORTarget)target
+                                            eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                                            qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+                                          mappingIDs:(nullable NSSet<NSString *> *)mappingIDs;
+
+/** Returns YES if the index holds any event for the target. */
+- (BOOL)hasEntriesForTarget:(GDTCORTarget)target;
+
+/** Removes and returns the events that expired by the given time.
+ *
+ * @param time The current time, in seconds since 1970.
+ * @return The events whose expiration is at or before the given time.
+ */
+- (NSArray<GDTCOREventLogEntry *> *)removeEntriesExpiredAtTime:(int64_t)time;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBytes.h"
+#import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
+
+@class GDTCORDirectorySizeTracker;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** How the payload of an event log record was encoded. */
+typedef NS_ENUM(uint8_t, GDTCOREventLogPayloadFormat) {
+  /** The payload is a keyed archive of a `GDTCOREvent`. */
+  GDTCOREventLogPayloadFormatArchive = 1,
+
+  /** The payload is what the target's uploader encoded the event into, see
+   * `-[GDTCORUploader encodedPayloadForEvent:]`.
+   */
+  GDTCOREventLogPayloadFormatUploaderEncoded = 2,
+};
+
+/** The metadata of an event stored in a `GDTCOREventLog`, without its payload. */
+@interface GDTCOREventLogEntry : NSObject
+
+/** The event ID. */
+@property(nonatomic, readonly) NSString *eventID;
+
+/** The mapping ID. */
+@property(nonatomic, readonly) NSString *mappingID;
+
+/** The target. */
+@property(nonatomic, readonly) GDTCORTarget target;
+
+/** The QoS tier. */
+@property(nonatomic, readonly) NSInteger qosTier;
+
+/** The expiration date, in seconds since 1970. */
+@property(nonatomic, readonly) int64_t expiration;
+
+/** How the payload was encoded. */
+@property(nonatomic, readonly) GDTCOREventLogPayloadFormat payloadFormat;
+
+/** The number of the segment the event was appended to. Only valid once appended. */
+@property(nonatomic, readonly) uint64_t segmentNumber;
+
+/** The offset of the event's record in its segment. Only valid once appended. */
+@property(nonatomic, readonly) uint64_t offset;
+
+/** The length of the payload. Only valid once appended. */
+@property(nonatomic, readonly) uint32_t payloadLength;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+- (instancetype)initWithEventID:(NSString *)eventID
+                      mappingID:(NSString *)mappingID
+                         target:(GDTCORTarget)target
+                        qosTier:(NSInteger)qosTier
+                     expiration:(int64_t)expiration
+                  payloadFormat:(GDTCOREventLogPayloadFormat)payloadFormat
+    NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/** An append-only log of events, stored as a directory of segment files.
+ *
+ * Each record is a fixed header followed by the event ID, the mapping ID and the payload. Removing
+ * events appends a record of the removal, rather than changing the segment the events are in, and
+ * a segment file is deleted once none of its events are live and its own removal records no longer
+ * matter. A sealed segment that is mostly removed events has its live events appended again, so
+ * that it can be deleted. Once a segment is full it is sealed by appending an index block, which
+ * holds the metadata of each of its records, so that opening the log only reads the index of each
+ * sealed segment and the headers of the one still being appended to.
+ *
+ * This is an internal class designed to be used by `GDTCORFlatFileStorage`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCOREventLog : NSObject
+
+/** The live events, by event ID. */
+@property(nonatomic, readonly) NSDictionary<NSString *, GDTCOREventLogEntry *> *entries;
+
+/** The bytes of the segment files that don't hold live events: removed events, removal records
+ * and index blocks. They are reclaimed as segments are compacted or deleted.
+ */
+@property(nonatomic, readonly) GDTCORStorageSizeBytes reclaimableSize;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Opens the log in a directory, creating it if needed.
+ *
+ * @param path The directory the segment files are kept in.
+ * @param sizeTracker If not nil, notified of the bytes the log adds and removes.
+ */
+- (instancetype)initWithDirectoryPath:(NSString *)path
+                          sizeTracker:(nullable GDTCORDirectorySizeTracker *)sizeTracker
+    NS_DESIGNATED_INITIALIZER;
+
+/** Returns how many bytes appending an event with the given metadata and payload would take. */
++ (GDTCORStorageSizeBytes)recordLengthForEntry:(GDTCOREventLogEntry *)entry
+                                 payloadLength:(NSUInteger)payloadLength;
+
+/** Appends events with a single write, and synchronizes the segment to disk once.
+ *
+ * @param entries The metadata of the events. Their location is filled in when the call succeeds.
+ * @param payloads The payloads of the events, in the same order.
+ * @param error Set if nothing could be appended.
+ * @return YES if all of the events were appended, NO if none were.
+ */
+- (BOOL)appendEntries:(NSArray<GDTCOREventLogEntry *> *)entries
+             payloads:(NSArray<NSData *> *)payloads
+                error:(NSError **)error;
+
+/** Reads the payloads of the given events, opening each segment once.
+ *
+ * @return The payloads by event ID. Events whose payload can't be read are left out.
+ */
+- (NSDictionary<NSString *, NSData *> *)payloadsForEntries:
+    (NSArray<GDTCOREventLogEntry *> *)entries;
+
+/** Removes events from the log. Events that are not live are ignored. */
+- (void)removeEntries:(NSArray<GDTCOREventLogEntry *> *)entries;
+
+@end
+
+NS_ASSUME_NONNULL_END
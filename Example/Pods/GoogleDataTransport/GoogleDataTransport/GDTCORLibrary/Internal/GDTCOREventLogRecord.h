@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** The file format of event log segments, and the reads and writes that recovering a segment
+ * depends on. It is plain C, so that it can be tested on the build host.
+ */
+
+/** Marks the start of each record. */
+static const uint32_t kGDTCOREventLogRecordMagic = 0x52544447;  // "GDTR"
+
+/** Marks the trailer of a sealed segment. */
+static const uint32_t kGDTCOREventLogTrailerMagic = 0x49544447;  // "GDTI"
+
+/** The kinds of record in a segment. */
+enum {
+  /** An event. The body is the event ID, the mapping ID and the payload. */
+  GDTCOREventLogRecordKindEvent = 1,
+  /** A removal. The payload lists the removed event IDs, each prefixed by a 16-bit length. */
+  GDTCOREventLogRecordKindRemoval = 2,
+  /** The index block of a sealed segment. The payload lists the segment's records, each as a
+   * 64-bit offset followed by the record, with the payload only included for removals. */
+  GDTCOREventLogRecordKindIndex = 3,
+};
+
+/** The fixed header of each record. */
+typedef struct {
+  uint32_t magic;
+  /** The CRC-32 of the record's body, which is everything after the header. */
+  uint32_t checksum;
+  uint8_t kind;
+  uint8_t payloadFormat;
+  uint16_t eventIDLength;
+  uint16_t mappingIDLength;
+  uint16_t reserved;
+  int32_t target;
+  int32_t qosTier;
+  uint32_t payloadLength;
+  uint32_t reserved2;
+  int64_t expiration;
+} GDTCOREventLogRecordHeader;
+
+_Static_assert(sizeof(GDTCOREventLogRecordHeader) == 40, "The record header layout is persisted");
+
+/** Ends a sealed segment, and points back to its index block. */
+typedef struct {
+  uint64_t indexOffset;
+  uint32_t magic;
+  uint32_t reserved;
+} GDTCOREventLogTrailer;
+
+/** Returns the length of a record's body. */
+uint64_t GDTCOREventLogBodyLength(const GDTCOREventLogRecordHeader *header);
+
+/** Returns the CRC-32 of the bytes, continuing from checksum, which is 0 for the first bytes. */
+uint32_t GDTCOREventLogChecksum(uint32_t checksum, const void *bytes, uint64_t length);
+
+/** Reads the header of the record at offset, and checks that the whole record fits within length.
+ *
+ * @return The length of the record, or 0 if there isn't a valid one at offset.
+ */
+uint64_t GDTCOREventLogReadRecord(const uint8_t *bytes,
+                                  uint64_t length,
+                                  uint64_t offset,
+                                  bool verifyChecksum,
+                                  GDTCOREventLogRecordHeader *header);
+
+/** Returns the length of the complete, valid records at the start of a segment. Anything after
+ * them is from an append that was interrupted, or is corrupt, and the segment is appended to from
+ * there.
+ */
+uint64_t GDTCOREventLogValidLength(const uint8_t *bytes, uint64_t length);
+
+/** Reads the trailer of a sealed segment, and the header of the index block it points to.
+ *
+ * @return The offset of the index block, or UINT64_MAX if the segment isn't sealed, or its trailer
+ * or index block is corrupt.
+ */
+uint64_t GDTCOREventLogReadIndex(const uint8_t *bytes,
+                                 uint64_t length,
+                                 GDTCOREventLogRecordHeader *header);
+
+/** Writes records at offset, the end of a segment, and synchronizes the segment. If either fails,
+ * the segment is truncated back to offset, so a partial record isn't followed by the next append,
+ * and records that may not be durable aren't reported as appended.
+ *
+ * @return 0, or the error that the write or the synchronization failed with.
+ */
+int GDTCOREventLogAppend(int fd, const void *records, uint64_t length, uint64_t offset);
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class GDTCOREventLogEntry;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** A hierarchical timing wheel of events, keyed by their expiration second.
+ *
+ * The wheel has levels of 64 slots each. A slot on the first level holds the events expiring in one
+ * second, and a slot on each level above spans 64 slots of the level below. Events are placed on
+ * the lowest level whose slots can tell their expiration apart from the wheel's current time, and
+ * move down a level each time the wheel reaches their slot, so advancing the wheel only visits the
+ * slots that come due, and skips over levels that are empty.
+ *
+ * This is an internal class designed to be used by `GDTCOREventIndex`.
+ * NOTE: The class is not thread-safe. The client must take care of synchronization.
+ */
+@interface GDTCORExpiryWheel : NSObject
+
+/** The time the wheel has been advanced to, in seconds since 1970. */
+@property(nonatomic, readonly) int64_t time;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Creates an empty wheel.
+ *
+ * @param time The time to start the wheel at, in seconds since 1970.
+ */
+- (instancetype)initWithTime:(int64_t)time NS_DESIGNATED_INITIALIZER;
+
+/** Adds an event, replacing any event with the same event ID. An event that has already expired
+ * is returned by the next call to `advanceToTime:`.
+ */
+- (void)addEntry:(GDTCOREventLogEntry *)entry;
+
+/** Removes the event with the given event ID, if it's in the wheel. */
+- (void)removeEntryWithEventID:(NSString *)eventID;
+
+/** Advances the wheel, and removes and returns the events that expired by then.
+ *
+ * @param time The time to advance to, in seconds since 1970. The wheel never goes back in time.
+ * @return The events whose expiration is at or before the given time.
+ */
+- (NSArray<GDTCOREventLogEntry *> *)advanceToTime:(int64_t)time;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -16,6 +16,7 @@
 
 #import <Foundation/Foundation.h>
 
+#import "GoogleDataTransport/GDTCORLibrary/Internal/GDTCORStorageSizeBytes.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
 
 NS_ASSUME_NONNULL_BEGIN
@@ -36,6 +37,12 @@ NS_ASSUME_NONNULL_BEGIN
 /** Finds all events matching the qosTiers in this list. */
 @property(nullable, readonly, nonatomic) NSSet<NSNumber *> *selectedQosTiers;
 
+/** The most bytes of stored payload the found events may add up to, or 0 for no limit. When the
+ * matching events don't fit, fast events are found first, then the ones expiring soonest. At least
+ * one event is found even if it alone is over the limit.
+ */
+@property(readonly, nonatomic) GDTCORStorageSizeBytes maxPayloadBytes;
+
 /** Initializes an event selector that will find all events for the given target.
  *
  * @param target The selected target.
@@ -56,6 +63,21 @@ NS_ASSUME_NONNULL_BEGIN
                     mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
                       qosTiers:(nullable NSSet<NSNumber *> *)qosTiers;
 
+/** Instantiates an event selector that limits how much payload the found events add up to.
+ *
+ * @param target The selected target.
+ * @param eventIDs Optional param to find an event matching this eventID.
+ * @param mappingIDs Optional param to find events matching this mappingID.
+ * @param qosTiers Optional param to find events matching the given QoS tiers.
+ * @param maxPayloadBytes The most bytes of stored payload to find, or 0 for no limit.
+ * @return An immutable event selector instance.
+ */
+- (instancetype)initWithTarget:(GDTCORTarget)target
+                      eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                    mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+                      qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+               maxPayloadBytes:(GDTCORStorageSizeBytes)maxPayloadBytes;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -195,7 +195,8 @@ id<GDTCORStoragePromiseProtocol> _Nullable GDTCORStoragePromiseInstanceForTarget
 
 /// Tells the delegate that the storage instance has removed a set of expired events.
 /// @param storage The storage instance informing the delegate of this impending event.
-/// @param events A set of events that were removed from storage due to their expiration.
+/// @param events A set of events that were removed from storage due to their expiration. The
+/// events carry their metadata, such as their mapping ID, but not their data.
 - (void)storage:(id<GDTCORStorageProtocol>)storage
     didRemoveExpiredEvents:(NSSet<GDTCOREvent *> *)events;
 
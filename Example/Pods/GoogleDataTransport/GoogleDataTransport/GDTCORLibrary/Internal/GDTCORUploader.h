@@ -20,6 +20,8 @@
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORClock.h"
 #import "GoogleDataTransport/GDTCORLibrary/Public/GoogleDataTransport/GDTCORTargets.h"
 
+@class GDTCOREvent;
+
 NS_ASSUME_NONNULL_BEGIN
 
 /** Options that define a set of upload conditions. This is used to help minimize end user data
@@ -54,6 +56,29 @@ typedef NS_OPTIONS(NSInteger, GDTCORUploadConditions) {
  */
 - (void)uploadTarget:(GDTCORTarget)target withConditions:(GDTCORUploadConditions)conditions;
 
+@optional
+
+/** Encodes an event into the bytes this backend sends for it. When implemented, storage keeps these
+ * bytes instead of an archive of the event, so the event is encoded once, when it is stored, rather
+ * than on every upload attempt. The events storage returns then carry the bytes in
+ * `encodedPayload`, along with their metadata, but not their data object.
+ *
+ * @note Called on the storage queue, so it must be thread-safe.
+ * @param event The event to encode.
+ * @return The encoded event, or nil if the event should be archived instead.
+ */
+- (nullable NSData *)encodedPayloadForEvent:(GDTCOREvent *)event;
+
+/** Returns how long to wait before the target can next be uploaded, e.g. because the backend
+ * asked to wait. The upload coordinator doesn't trigger an upload of the target before then, and
+ * schedules its next check for when the soonest target is ready. When not implemented, the target
+ * is checked on every timer interval.
+ *
+ * @param target The target.
+ * @return The time to wait, or 0 if the target can be uploaded now.
+ */
+- (NSTimeInterval)timeIntervalUntilNextUploadForTarget:(GDTCORTarget)target;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -25,6 +25,17 @@ NS_ASSUME_NONNULL_BEGIN
 /** The unique ID of the event. This property is for testing only. */
 @property(nonatomic, readwrite) NSString *eventID;
 
+/** The bytes the target's uploader encoded the event into when it was stored, if it did. Events
+ * read back from storage with these bytes don't have a data object.
+ */
+@property(nonatomic, nullable) NSData *encodedPayload;
+
+/** The length of the payload the event was stored with, or 0 if it wasn't read back from storage.
+ * Batches are limited in these bytes, which for archived events are much more than the bytes the
+ * uploader sends.
+ */
+@property(nonatomic) NSUInteger storedPayloadLength;
+
 /** Generates a unique event ID. */
 + (NSString *)nextEventID;
 
@@ -25,18 +25,6 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-/** The event components eventID dictionary key. */
-FOUNDATION_EXPORT NSString *const kGDTCOREventComponentsEventIDKey;
-
-/** The event components qosTier dictionary key. */
-FOUNDATION_EXPORT NSString *const kGDTCOREventComponentsQoSTierKey;
-
-/** The event components mappingID dictionary key. */
-FOUNDATION_EXPORT NSString *const kGDTCOREventComponentsMappingIDKey;
-
-/** The event components expirationDate dictionary key. */
-FOUNDATION_EXPORT NSString *const kGDTCOREventComponentsExpirationKey;
-
 /** The batch components target dictionary key. */
 FOUNDATION_EXPORT NSString *const kGDTCORBatchComponentsTargetKey;
 
@@ -57,15 +45,19 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
 
 /** Manages the storage of events. This class is thread-safe.
  *
- * Event files will be stored as follows:
- * <app cache>/google-sdk-events/<classname>/gdt_event_data/<target>/<eventID>.<qosTier>.<mappingID>
+ * Events will be stored in the segment files of a `GDTCOREventLog`:
+ * <app cache>/google-sdk-events/<classname>/gdt_event_log/<segmentNumber>.gdtseg
+ * Events stored within a few milliseconds of each other are appended with a single write, and their
+ * completions are called once the write is done.
  *
  * Library data will be stored as follows:
  * <app cache>/google-sdk-events/<classname>/gdt_library_data/<libraryDataKey>
  *
- * Batch data will be stored as follows:
- * <app
- * cache>/google-sdk-events/<classname>/gdt_batch_data/<target>.<batchID>/<eventID>.<qosTier>.<mappingID>
+ * Batches will be stored as files listing the IDs of their events, one per line:
+ * <app cache>/google-sdk-events/<classname>/gdt_event_batches/<target>-<batchID>-<expiration>
+ *
+ * Events and batches stored by earlier versions under gdt_event_data and gdt_batch_data are moved
+ * into the event log the first time it is opened.
  */
 @interface GDTCORFlatFileStorage : NSObject <GDTCORStorageProtocol, GDTCORLifecycleProtocol>
 
@@ -81,11 +73,11 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
  */
 + (instancetype)sharedInstance;
 
-/** Returns the base directory under which all events will be stored.
+/** Returns the directory the segment files of the event log are stored in.
  *
- * @return The base directory under which all events will be stored.
+ * @return The directory the segment files of the event log are stored in.
  */
-+ (NSString *)eventDataStoragePath;
++ (NSString *)eventLogStoragePath;
 
 /** Returns the base directory under which all library data will be stored.
  *
@@ -93,44 +85,36 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
  */
 + (NSString *)libraryDataStoragePath;
 
-/** Returns the base directory under which all batch data will be stored.
+/** Returns the directory under which all batch files will be stored.
  *
- * @return The base directory under which all batch data will be stored.
+ * @return The directory under which all batch files will be stored.
  */
 + (NSString *)batchDataStoragePath;
 
-/** */
+/** Returns the path of the file listing the event IDs of a batch. This path may not exist.
+ *
+ * @param target The target of the batch.
+ * @param batchID The batch ID.
+ * @param expirationDate The date after which the batch's events are no longer considered batched.
+ * @return The path of the batch file.
+ */
 + (NSString *)batchPathForTarget:(GDTCORTarget)target
                          batchID:(NSNumber *)batchID
                   expirationDate:(NSDate *)expirationDate;
 
-/** Returns a constructed storage path based on the given values. This path may not exist.
- *
- * @param target The target, which is necessary to be given a path.
- * @param eventID The eventID.
- * @param qosTier The qosTier.
- * @param expirationDate The expirationDate as a 1970-relative time interval.
- * @param mappingID The mappingID.
- * @return The path representing the combination of the given parameters.
- */
-+ (NSString *)pathForTarget:(GDTCORTarget)target
-                    eventID:(NSString *)eventID
-                    qosTier:(NSNumber *)qosTier
-             expirationDate:(NSDate *)expirationDate
-                  mappingID:(NSString *)mappingID;
-
-/** Returns extant paths that match all of the given parameters.
+/** Returns the IDs of stored events that match all of the given parameters.
  *
+ * @param target The target of the events.
  * @param eventIDs The list of eventIDs to look for, or nil for any.
  * @param qosTiers The list of qosTiers to look for, or nil for any.
  * @param mappingIDs The list of mappingIDs to look for, or nil for any.
- * @param onComplete The completion to call once the paths have been discovered.
+ * @param onComplete The completion to call once the events have been found.
  */
-- (void)pathsForTarget:(GDTCORTarget)target
-              eventIDs:(nullable NSSet<NSString *> *)eventIDs
-              qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
-            mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
-            onComplete:(void (^)(NSSet<NSString *> *paths))onComplete;
+- (void)eventIDsForTarget:(GDTCORTarget)target
+                 eventIDs:(nullable NSSet<NSString *> *)eventIDs
+                 qosTiers:(nullable NSSet<NSNumber *> *)qosTiers
+               mappingIDs:(nullable NSSet<NSString *> *)mappingIDs
+               onComplete:(void (^)(NSSet<NSString *> *eventIDs))onComplete;
 
 /** Fetches the current batchID counter value from library storage, increments it, and sets the new
  * value. Returns nil if a batchID was not able to be created for some reason.
@@ -139,16 +123,9 @@ typedef NS_ENUM(NSInteger, GDTCORFlatFileStorageError) {
  */
 - (void)nextBatchID:(void (^)(NSNumber *_Nullable batchID))onComplete;
 
-/** Constructs a dictionary of event filename components.
- *
- * @param fileName The event filename to split.
- * @return The dictionary of event component keys to their values.
- */
-- (nullable NSDictionary<NSString *, id> *)eventComponentsFromFilename:(NSString *)fileName;
-
 /** Constructs a dictionary of batch filename components.
  *
- * @param fileName The batch folder name to split.
+ * @param fileName The batch filename to split.
  * @return The dictionary of batch component keys to their values.
  */
 - (nullable NSDictionary<NSString *, id> *)batchComponentsFromFilename:(NSString *)fileName;
@@ -20,6 +20,8 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// Tracks metrics about dropped events. Dropped events are counted in memory, sharded by thread,
+/// and merged into the metrics in storage a few seconds later, or when the metrics are fetched.
 @interface GDTCORMetricsController : NSObject <GDTCORMetricsControllerProtocol>
 
 /// Returns the event metrics controller singleton.
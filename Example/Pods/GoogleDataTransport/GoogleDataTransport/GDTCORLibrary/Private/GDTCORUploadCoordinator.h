@@ -38,20 +38,27 @@ NS_ASSUME_NONNULL_BEGIN
 /** The queue on which all upload coordination will occur. */
 @property(nonatomic, readonly) dispatch_queue_t coordinationQueue;
 
-/** A timer that will causes regular checks for events to upload. */
+/** A timer that will causes regular checks for events to upload. Each time it fires, it's set to
+ * fire again when the soonest target that isn't ready yet will be, or after `timerInterval`.
+ */
 @property(nonatomic, readonly, nullable) dispatch_source_t timer;
 
-/** The interval the timer will fire. */
+/** The longest interval between two fires of the timer. */
 @property(nonatomic, readonly) uint64_t timerInterval;
 
 /** Some leeway given to libdispatch for the timer interval event. */
 @property(nonatomic, readonly) uint64_t timerLeeway;
 
+/** How long a forced upload waits for other forced uploads, so that they're done together. */
+@property(nonatomic, readonly) uint64_t forcedUploadDelay;
+
 /** The registrar object the coordinator will use. Generally used for testing. */
 @property(nonatomic) GDTCORRegistrar *registrar;
 
 /** Forces the backend specified by the target to upload the provided set of events. This should
- * only ever happen when the QoS tier of an event requires it.
+ * only ever happen when the QoS tier of an event requires it. The upload happens after
+ * `forcedUploadDelay`, together with any other upload forced in the meantime, so that a burst of
+ * fast events causes one upload rather than one per event.
  *
  * @param target The target that should force an upload.
  */
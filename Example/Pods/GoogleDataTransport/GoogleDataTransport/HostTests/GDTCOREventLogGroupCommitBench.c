@@ -0,0 +1,308 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** Stores events through a single storage thread, the way GDTCORFlatFileStorage does on its
+ * storage queue, and compares appending and synchronizing each event as it arrives against
+ * GDTCORFlatFileStorage's group commit, which holds events for up to 5 ms or until 64 KB of them
+ * are pending and appends them together. A burst of events from several threads measures
+ * throughput; a steady trickle from one thread measures the latency that holding events adds.
+ *
+ * Each run's segment is read back and recovered, and must hold every event exactly once.
+ */
+
+#include "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLogRecord.h"
+
+#include "GDTCORHostTest.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** The group commit policy of GDTCORFlatFileStorage. */
+#define GDTCORBenchGroupCommitDelay (0.005)
+#define GDTCORBenchGroupCommitSize (64 * 1024)
+
+#define GDTCORBenchPayloadLength (320)
+#define GDTCORBenchBurstProducers (4)
+#define GDTCORBenchBurstEvents (2500)
+#define GDTCORBenchTrickleEvents (400)
+#define GDTCORBenchTrickleInterval (0.001)
+#define GDTCORBenchMaxEvents (GDTCORBenchBurstProducers * GDTCORBenchBurstEvents)
+
+typedef struct {
+  uint32_t number;
+  double submittedAt;
+} GDTCORBenchEvent;
+
+/** The storage queue: producers enqueue events, and one thread stores them. */
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t submitted;
+  GDTCORBenchEvent events[GDTCORBenchMaxEvents];
+  uint32_t submittedCount;
+  uint32_t expectedCount;
+  bool groupCommit;
+
+  int fd;
+  uint64_t size;
+  uint32_t appendCount;
+  double latencies[GDTCORBenchMaxEvents];
+  uint8_t records[GDTCORBenchGroupCommitSize + 4096];
+} GDTCORBenchStorage;
+
+static GDTCORBenchStorage GDTCORBenchStore;
+
+static void GDTCORBenchSubmit(GDTCORBenchStorage *storage, uint32_t number) {
+  pthread_mutex_lock(&storage->lock);
+  storage->events[storage->submittedCount++] =
+      (GDTCORBenchEvent){.number = number, .submittedAt = GDTCORHostTestSeconds()};
+  pthread_cond_signal(&storage->submitted);
+  pthread_mutex_unlock(&storage->lock);
+}
+
+/** Encodes an event's record the way GDTCOREventLog does, returning its length. */
+static uint64_t GDTCORBenchEncode(uint8_t *record, uint32_t number) {
+  char eventID[16];
+  int eventIDLength = snprintf(eventID, sizeof(eventID), "%u", number);
+  GDTCOREventLogRecordHeader header = {
+      .magic = kGDTCOREventLogRecordMagic,
+      .kind = GDTCOREventLogRecordKindEvent,
+      .eventIDLength = (uint16_t)eventIDLength,
+      .mappingIDLength = 4,
+      .target = 1000,
+      .qosTier = 2,
+      .payloadLength = GDTCORBenchPayloadLength,
+  };
+  uint8_t *body = record + sizeof(header);
+  memcpy(body, eventID, (size_t)eventIDLength);
+  memcpy(body + eventIDLength, "1018", 4);
+  memset(body + eventIDLength + 4, (int)(number & 0xff), GDTCORBenchPayloadLength);
+  header.checksum = GDTCOREventLogChecksum(0, body, GDTCOREventLogBodyLength(&header));
+  memcpy(record, &header, sizeof(header));
+  return sizeof(header) + GDTCOREventLogBodyLength(&header);
+}
+
+/** Appends the events in [first, end) with one append, and records how long each waited. */
+static void GDTCORBenchCommit(GDTCORBenchStorage *storage, uint32_t first, uint32_t end) {
+  uint64_t length = 0;
+  for (uint32_t i = first; i < end; i++) {
+    length += GDTCORBenchEncode(storage->records + length, storage->events[i].number);
+  }
+  if (GDTCOREventLogAppend(storage->fd, storage->records, length, storage->size) != 0) {
+    fprintf(stderr, "append failed\n");
+    exit(EXIT_FAILURE);
+  }
+  storage->size += length;
+  storage->appendCount++;
+
+  double committedAt = GDTCORHostTestSeconds();
+  for (uint32_t i = first; i < end; i++) {
+    storage->latencies[i] = committedAt - storage->events[i].submittedAt;
+  }
+}
+
+static void *GDTCORBenchStoreEvents(void *context) {
+  GDTCORBenchStorage *storage = context;
+  uint32_t committed = 0;
+
+  pthread_mutex_lock(&storage->lock);
+  while (committed < storage->expectedCount) {
+    uint32_t submitted = storage->submittedCount;
+    if (!storage->groupCommit) {
+      if (committed == submitted) {
+        pthread_cond_wait(&storage->submitted, &storage->lock);
+        continue;
+      }
+      pthread_mutex_unlock(&storage->lock);
+      GDTCORBenchCommit(storage, committed, committed + 1);
+      committed++;
+      pthread_mutex_lock(&storage->lock);
+      continue;
+    }
+
+    // Events are held until enough are pending, or the first of them has waited long enough.
+    // Event IDs are counted at their longest, so a group's records always fit.
+    uint32_t end = committed;
+    uint64_t pendingSize = 0;
+    while (end < submitted && pendingSize < GDTCORBenchGroupCommitSize) {
+      pendingSize += sizeof(GDTCOREventLogRecordHeader) + 16 + GDTCORBenchPayloadLength;
+      end++;
+    }
+    if (end == committed) {
+      pthread_cond_wait(&storage->submitted, &storage->lock);
+      continue;
+    }
+    double deadline = storage->events[committed].submittedAt + GDTCORBenchGroupCommitDelay;
+    double now = GDTCORHostTestSeconds();
+    if (pendingSize < GDTCORBenchGroupCommitSize && now < deadline) {
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      double wait = deadline - now;
+      until.tv_sec += (time_t)wait;
+      until.tv_nsec += (long)((wait - (double)(time_t)wait) * 1e9);
+      if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&storage->submitted, &storage->lock, &until);
+      continue;
+    }
+    pthread_mutex_unlock(&storage->lock);
+    GDTCORBenchCommit(storage, committed, end);
+    committed = end;
+    pthread_mutex_lock(&storage->lock);
+  }
+  pthread_mutex_unlock(&storage->lock);
+  return NULL;
+}
+
+typedef struct {
+  uint32_t firstNumber;
+  uint32_t count;
+  double interval;
+} GDTCORBenchProducer;
+
+static void *GDTCORBenchProduceEvents(void *context) {
+  GDTCORBenchProducer *producer = context;
+  double start = GDTCORHostTestSeconds();
+  for (uint32_t i = 0; i < producer->count; i++) {
+    if (producer->interval > 0) {
+      double next = start + producer->interval * i;
+      while (GDTCORHostTestSeconds() < next) {
+        usleep(50);
+      }
+    }
+    GDTCORBenchSubmit(&GDTCORBenchStore, producer->firstNumber + i);
+  }
+  return NULL;
+}
+
+static int GDTCORBenchCompareDoubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+/** Reads the segment back, recovers it, and checks that it holds every event exactly once. */
+static bool GDTCORBenchVerify(const char *path, uint32_t eventCount) {
+  struct stat status;
+  if (stat(path, &status) != 0) {
+    return false;
+  }
+  uint8_t *bytes = malloc((size_t)status.st_size + 1);
+  bool *seen = calloc(eventCount, sizeof(bool));
+  int fd = open(path, O_RDONLY);
+  bool valid = read(fd, bytes, (size_t)status.st_size) == status.st_size &&
+               GDTCOREventLogValidLength(bytes, (uint64_t)status.st_size) ==
+                   (uint64_t)status.st_size;
+  close(fd);
+
+  uint32_t recordCount = 0;
+  uint64_t offset = 0;
+  while (valid && offset < (uint64_t)status.st_size) {
+    GDTCOREventLogRecordHeader header;
+    uint64_t recordLength =
+        GDTCOREventLogReadRecord(bytes, (uint64_t)status.st_size, offset, false, &header);
+    char eventID[16] = {0};
+    memcpy(eventID, bytes + offset + sizeof(header),
+           header.eventIDLength < sizeof(eventID) ? header.eventIDLength : sizeof(eventID) - 1);
+    uint32_t number = (uint32_t)strtoul(eventID, NULL, 10);
+    valid = number < eventCount && !seen[number];
+    if (valid) {
+      seen[number] = true;
+    }
+    recordCount++;
+    offset += recordLength;
+  }
+
+  free(seen);
+  free(bytes);
+  return valid && recordCount == eventCount;
+}
+
+static void GDTCORBenchRun(const char *directory,
+                           const char *workload,
+                           bool groupCommit,
+                           uint32_t producerCount,
+                           uint32_t eventsPerProducer,
+                           double interval) {
+  GDTCORBenchStorage *storage = &GDTCORBenchStore;
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/GDTCOREventLogGroupCommitBench.gdtseg", directory);
+  storage->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (storage->fd < 0) {
+    fprintf(stderr, "unable to create %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  storage->size = 0;
+  storage->appendCount = 0;
+  storage->submittedCount = 0;
+  storage->expectedCount = producerCount * eventsPerProducer;
+  storage->groupCommit = groupCommit;
+
+  GDTCORBenchProducer producers[GDTCORBenchBurstProducers];
+  pthread_t producerThreads[GDTCORBenchBurstProducers];
+  pthread_t storeThread;
+  double start = GDTCORHostTestSeconds();
+  pthread_create(&storeThread, NULL, GDTCORBenchStoreEvents, storage);
+  for (uint32_t i = 0; i < producerCount; i++) {
+    producers[i] = (GDTCORBenchProducer){
+        .firstNumber = i * eventsPerProducer,
+        .count = eventsPerProducer,
+        .interval = interval,
+    };
+    pthread_create(&producerThreads[i], NULL, GDTCORBenchProduceEvents, &producers[i]);
+  }
+  for (uint32_t i = 0; i < producerCount; i++) {
+    pthread_join(producerThreads[i], NULL);
+  }
+  pthread_join(storeThread, NULL);
+  double elapsed = GDTCORHostTestSeconds() - start;
+  close(storage->fd);
+
+  uint32_t count = storage->expectedCount;
+  qsort(storage->latencies, count, sizeof(double), GDTCORBenchCompareDoubles);
+  printf("%s, %s: %u events in %.3f s, %.0f events/s, %u appends, latency p50 %.2f ms, "
+         "p99 %.2f ms\n",
+         workload, groupCommit ? "group commit" : "append each", count, elapsed,
+         count / elapsed, storage->appendCount, storage->latencies[count / 2] * 1e3,
+         storage->latencies[count * 99 / 100] * 1e3);
+
+  GDTCORHostTestAssert(GDTCORBenchVerify(path, count));
+  unlink(path);
+}
+
+int main(int argc, char **argv) {
+  const char *directory = argc > 1 ? argv[1] : getenv("TMPDIR");
+  if (directory == NULL) {
+    directory = "/tmp";
+  }
+  pthread_mutex_init(&GDTCORBenchStore.lock, NULL);
+  pthread_cond_init(&GDTCORBenchStore.submitted, NULL);
+
+  for (int groupCommit = 0; groupCommit <= 1; groupCommit++) {
+    GDTCORBenchRun(directory, "burst", groupCommit, GDTCORBenchBurstProducers,
+                   GDTCORBenchBurstEvents, 0);
+    GDTCORBenchRun(directory, "trickle", groupCommit, 1, GDTCORBenchTrickleEvents,
+                   GDTCORBenchTrickleInterval);
+  }
+  return GDTCORHostTestFinish();
+}
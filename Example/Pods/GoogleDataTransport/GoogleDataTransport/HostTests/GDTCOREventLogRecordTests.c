@@ -0,0 +1,427 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GoogleDataTransport/GDTCORLibrary/Internal/GDTCOREventLogRecord.h"
+
+#include "GDTCORHostTest.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GDTCORTestRecordCount (12)
+
+/** A segment built in memory, with the offset at which each of its records ends. */
+typedef struct {
+  uint8_t bytes[16 * 1024];
+  uint64_t length;
+  uint64_t recordEnds[GDTCORTestRecordCount + 1];
+  uint32_t recordCount;
+} GDTCORTestSegment;
+
+/** Appends a record the way GDTCOREventLog encodes them. */
+static void GDTCORTestAppendRecord(GDTCORTestSegment *segment,
+                                   uint8_t kind,
+                                   const char *eventID,
+                                   const char *mappingID,
+                                   const void *payload,
+                                   uint32_t payloadLength) {
+  GDTCOREventLogRecordHeader header = {
+      .magic = kGDTCOREventLogRecordMagic,
+      .kind = kind,
+      .eventIDLength = (uint16_t)strlen(eventID),
+      .mappingIDLength = (uint16_t)strlen(mappingID),
+      .target = 1000,
+      .qosTier = 2,
+      .payloadLength = payloadLength,
+      .expiration = 1234567890,
+  };
+  uint8_t *record = segment->bytes + segment->length;
+  uint8_t *body = record + sizeof(header);
+  memcpy(body, eventID, header.eventIDLength);
+  memcpy(body + header.eventIDLength, mappingID, header.mappingIDLength);
+  memcpy(body + header.eventIDLength + header.mappingIDLength, payload, payloadLength);
+  header.checksum = GDTCOREventLogChecksum(0, body, GDTCOREventLogBodyLength(&header));
+  memcpy(record, &header, sizeof(header));
+
+  segment->length += sizeof(header) + GDTCOREventLogBodyLength(&header);
+  segment->recordEnds[segment->recordCount++] = segment->length;
+}
+
+/** Builds a segment of events with payloads of varying length, including an empty one. */
+static void GDTCORTestBuildSegment(GDTCORTestSegment *segment) {
+  memset(segment, 0, sizeof(*segment));
+  for (uint32_t i = 0; i < GDTCORTestRecordCount; i++) {
+    char eventID[16];
+    uint8_t payload[512];
+    uint32_t payloadLength = (i * 97) % sizeof(payload);
+    snprintf(eventID, sizeof(eventID), "%u", i);
+    for (uint32_t j = 0; j < payloadLength; j++) {
+      payload[j] = (uint8_t)(i * 31 + j);
+    }
+    GDTCORTestAppendRecord(segment, GDTCOREventLogRecordKindEvent, eventID, "1018", payload,
+                           payloadLength);
+  }
+}
+
+/** Seals a segment with an index record and a trailer that points back to it. */
+static uint64_t GDTCORTestSealSegment(GDTCORTestSegment *segment) {
+  uint64_t indexOffset = segment->length;
+  uint64_t offsets[GDTCORTestRecordCount];
+  for (uint32_t i = 0; i < GDTCORTestRecordCount; i++) {
+    offsets[i] = i == 0 ? 0 : segment->recordEnds[i - 1];
+  }
+  GDTCORTestAppendRecord(segment, GDTCOREventLogRecordKindIndex, "", "", offsets,
+                         sizeof(offsets));
+  GDTCOREventLogTrailer trailer = {
+      .indexOffset = indexOffset,
+      .magic = kGDTCOREventLogTrailerMagic,
+  };
+  memcpy(segment->bytes + segment->length, &trailer, sizeof(trailer));
+  segment->length += sizeof(trailer);
+  return indexOffset;
+}
+
+/** Returns the end of the last record that ends at or before length. */
+static uint64_t GDTCORTestLastBoundary(const GDTCORTestSegment *segment, uint64_t length) {
+  uint64_t boundary = 0;
+  for (uint32_t i = 0; i < segment->recordCount; i++) {
+    if (segment->recordEnds[i] <= length) {
+      boundary = segment->recordEnds[i];
+    }
+  }
+  return boundary;
+}
+
+static void testReadsEveryRecord(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < segment.recordCount; i++) {
+    GDTCOREventLogRecordHeader header;
+    uint64_t recordLength =
+        GDTCOREventLogReadRecord(segment.bytes, segment.length, offset, true, &header);
+    GDTCORHostTestAssert(recordLength > 0);
+    GDTCORHostTestAssert(offset + recordLength == segment.recordEnds[i]);
+    GDTCORHostTestAssert(header.kind == GDTCOREventLogRecordKindEvent);
+    GDTCORHostTestAssert(header.payloadLength == (i * 97) % 512);
+    GDTCORHostTestAssert(header.target == 1000 && header.qosTier == 2);
+    GDTCORHostTestAssert(header.expiration == 1234567890);
+    offset += recordLength;
+  }
+  GDTCORHostTestAssert(offset == segment.length);
+
+  GDTCOREventLogRecordHeader header;
+  GDTCORHostTestAssert(
+      GDTCOREventLogReadRecord(segment.bytes, segment.length, segment.length, true, &header) ==
+      0);
+  GDTCORHostTestAssert(
+      GDTCOREventLogReadRecord(segment.bytes, segment.length, segment.length + 1, true, &header) ==
+      0);
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == segment.length);
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, 0) == 0);
+}
+
+static void testTruncationRecoversToLastRecord(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+
+  // Every length an interrupted append could leave behind recovers to the record before it.
+  for (uint64_t length = 0; length <= segment.length; length++) {
+    uint64_t validLength = GDTCOREventLogValidLength(segment.bytes, length);
+    if (validLength != GDTCORTestLastBoundary(&segment, length)) {
+      GDTCORHostTestAssert(validLength == GDTCORTestLastBoundary(&segment, length));
+      break;
+    }
+  }
+}
+
+static void testChecksumMismatchStopsAtRecord(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+
+  // Flipping any byte of a record's body or checksum invalidates it, and everything after it.
+  for (uint32_t i = 1; i < segment.recordCount; i++) {
+    uint64_t start = segment.recordEnds[i - 1];
+    uint64_t checksumOffset = start + offsetof(GDTCOREventLogRecordHeader, checksum);
+    uint64_t positions[] = {checksumOffset, start + sizeof(GDTCOREventLogRecordHeader),
+                            segment.recordEnds[i] - 1};
+    for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+      segment.bytes[positions[p]] ^= 0x40;
+      GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == start);
+
+      // Without verifying the checksum the record is still framed, so a load that trusts an index
+      // doesn't pay for it.
+      GDTCOREventLogRecordHeader header;
+      if (positions[p] != checksumOffset) {
+        GDTCORHostTestAssert(GDTCOREventLogReadRecord(segment.bytes, segment.length, start, false,
+                                                      &header) == segment.recordEnds[i] - start);
+      }
+      segment.bytes[positions[p]] ^= 0x40;
+    }
+  }
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == segment.length);
+}
+
+static void testBadMagicStopsAtRecord(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+
+  uint64_t start = segment.recordEnds[4];
+  segment.bytes[start] ^= 0x01;
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == start);
+
+  // A segment of zeros, as left by a crash after the file was extended but before it was written,
+  // has no valid records.
+  uint8_t zeros[256] = {0};
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(zeros, sizeof(zeros)) == 0);
+}
+
+static void testHugeLengthsDoNotOverflow(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+
+  GDTCOREventLogRecordHeader header;
+  uint64_t start = segment.recordEnds[2];
+  memcpy(&header, segment.bytes + start, sizeof(header));
+  header.eventIDLength = UINT16_MAX;
+  header.mappingIDLength = UINT16_MAX;
+  header.payloadLength = UINT32_MAX;
+  memcpy(segment.bytes + start, &header, sizeof(header));
+
+  GDTCORHostTestAssert(GDTCOREventLogBodyLength(&header) ==
+                       (uint64_t)UINT32_MAX + 2 * (uint64_t)UINT16_MAX);
+  GDTCORHostTestAssert(GDTCOREventLogReadRecord(segment.bytes, segment.length, start, false,
+                                                &header) == 0);
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == start);
+
+  // An offset near the top of the range doesn't wrap around either.
+  GDTCORHostTestAssert(GDTCOREventLogReadRecord(segment.bytes, segment.length, UINT64_MAX - 8,
+                                                false, &header) == 0);
+}
+
+static void testReadsSealedIndex(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+  uint64_t indexOffset = GDTCORTestSealSegment(&segment);
+
+  GDTCOREventLogRecordHeader header;
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       indexOffset);
+  GDTCORHostTestAssert(header.kind == GDTCOREventLogRecordKindIndex);
+  GDTCORHostTestAssert(header.payloadLength == GDTCORTestRecordCount * sizeof(uint64_t));
+
+  // The records before the index are all still valid, so a sealed segment whose index is lost can
+  // be read record by record instead.
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, indexOffset) == indexOffset);
+}
+
+static void testUnsealedOrCorruptIndexIsRejected(void) {
+  GDTCORTestSegment segment;
+  GDTCOREventLogRecordHeader header;
+
+  GDTCORTestBuildSegment(&segment);
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       UINT64_MAX);
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, 8, &header) == UINT64_MAX);
+
+  // A torn trailer.
+  GDTCORTestBuildSegment(&segment);
+  GDTCORTestSealSegment(&segment);
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length - 1, &header) ==
+                       UINT64_MAX);
+
+  // A trailer that points past the end of the segment, or into the middle of a record.
+  GDTCOREventLogTrailer *trailer =
+      (GDTCOREventLogTrailer *)(segment.bytes + segment.length - sizeof(GDTCOREventLogTrailer));
+  uint64_t indexOffset = trailer->indexOffset;
+  trailer->indexOffset = UINT64_MAX - 4;
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       UINT64_MAX);
+  trailer->indexOffset = indexOffset + 1;
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       UINT64_MAX);
+
+  // A trailer that points at an event rather than an index.
+  trailer->indexOffset = 0;
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       UINT64_MAX);
+
+  // An index whose checksum doesn't match.
+  trailer->indexOffset = indexOffset;
+  segment.bytes[indexOffset + sizeof(GDTCOREventLogRecordHeader)] ^= 0x01;
+  GDTCORHostTestAssert(GDTCOREventLogReadIndex(segment.bytes, segment.length, &header) ==
+                       UINT64_MAX);
+}
+
+/** Returns whether a byte of a record's header is covered by neither its framing nor its
+ * checksum, which only covers the body.
+ */
+static bool GDTCORTestIsUncheckedHeaderByte(uint64_t offsetInRecord) {
+  if (offsetInRecord >= sizeof(GDTCOREventLogRecordHeader)) {
+    return false;
+  }
+  return !(offsetInRecord < offsetof(GDTCOREventLogRecordHeader, kind) ||
+           (offsetInRecord >= offsetof(GDTCOREventLogRecordHeader, eventIDLength) &&
+            offsetInRecord < offsetof(GDTCOREventLogRecordHeader, reserved)) ||
+           (offsetInRecord >= offsetof(GDTCOREventLogRecordHeader, payloadLength) &&
+            offsetInRecord < offsetof(GDTCOREventLogRecordHeader, reserved2)));
+}
+
+static void testRandomCorruptionOfFramingOrBodyIsCaught(void) {
+  GDTCORTestSegment original;
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&original);
+  srand(49);
+
+  for (int round = 0; round < 5000; round++) {
+    segment = original;
+    uint64_t position = (uint64_t)rand() % segment.length;
+    uint8_t flip = (uint8_t)(1 + rand() % 255);
+    segment.bytes[position] ^= flip;
+
+    // Recovery keeps exactly the records before the one that was changed, unless the change was
+    // to a header field that doesn't affect where records start and end.
+    uint64_t recordStart = GDTCORTestLastBoundary(&original, position);
+    uint64_t expected = GDTCORTestIsUncheckedHeaderByte(position - recordStart) ? segment.length
+                                                                                 : recordStart;
+    if (GDTCOREventLogValidLength(segment.bytes, segment.length) != expected) {
+      GDTCORHostTestAssert(GDTCOREventLogValidLength(segment.bytes, segment.length) == expected);
+      fprintf(stderr, "flipped 0x%02x at %llu\n", flip, (unsigned long long)position);
+      break;
+    }
+  }
+}
+
+/** Returns a descriptor for a new, empty file in the temporary directory. */
+static int GDTCORTestOpenTemporaryFile(char *path, size_t pathLength) {
+  const char *directory = getenv("TMPDIR");
+  snprintf(path, pathLength, "%s/GDTCOREventLogRecordTests.XXXXXX",
+           directory != NULL ? directory : "/tmp");
+  return mkstemp(path);
+}
+
+/** Reads a whole file, returning its length. */
+static uint64_t GDTCORTestReadFile(const char *path, uint8_t *bytes, size_t capacity) {
+  int fd = open(path, O_RDONLY);
+  ssize_t length = read(fd, bytes, capacity);
+  close(fd);
+  return length < 0 ? 0 : (uint64_t)length;
+}
+
+static void testAppendWritesAtOffset(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+  char path[1024];
+  int fd = GDTCORTestOpenTemporaryFile(path, sizeof(path));
+  GDTCORHostTestAssert(fd >= 0);
+
+  // Appending in groups of records produces the same file as one write.
+  uint64_t offset = 0;
+  for (uint32_t i = 2; i < segment.recordCount; i += 3) {
+    uint64_t end = segment.recordEnds[i];
+    GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes + offset, end - offset, offset) ==
+                         0);
+    offset = end;
+  }
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes + offset, segment.length - offset,
+                                            offset) == 0);
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes, 0, segment.length) == 0);
+
+  static uint8_t contents[sizeof(segment.bytes) + 1];
+  uint64_t length = GDTCORTestReadFile(path, contents, sizeof(contents));
+  GDTCORHostTestAssert(length == segment.length);
+  GDTCORHostTestAssert(memcmp(contents, segment.bytes, segment.length) == 0);
+
+  close(fd);
+  unlink(path);
+}
+
+static void testFailedAppendLeavesSegmentUnchanged(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+  char path[1024];
+  int fd = GDTCORTestOpenTemporaryFile(path, sizeof(path));
+  uint64_t firstEnd = segment.recordEnds[0];
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes, firstEnd, 0) == 0);
+  close(fd);
+
+  // A descriptor that can't be written to fails with the write's error.
+  fd = open(path, O_RDONLY);
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes + firstEnd,
+                                            segment.recordEnds[1] - firstEnd, firstEnd) == EBADF);
+  close(fd);
+
+  struct stat status;
+  GDTCORHostTestAssert(stat(path, &status) == 0 && (uint64_t)status.st_size == firstEnd);
+  unlink(path);
+}
+
+static void testTornAppendIsRecoveredAndAppendedAfter(void) {
+  GDTCORTestSegment segment;
+  GDTCORTestBuildSegment(&segment);
+  char path[1024];
+  int fd = GDTCORTestOpenTemporaryFile(path, sizeof(path));
+
+  // The first four records are appended, then a crash tears the fifth partway through its body.
+  uint64_t committed = segment.recordEnds[3];
+  uint64_t torn = segment.recordEnds[4] - 7;
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes, committed, 0) == 0);
+  GDTCORHostTestAssert(pwrite(fd, segment.bytes + committed, torn - committed,
+                              (off_t)committed) == (ssize_t)(torn - committed));
+  close(fd);
+
+  // Loading finds where the valid records end, truncates there, and appends the rest.
+  static uint8_t contents[sizeof(segment.bytes) + 1];
+  uint64_t length = GDTCORTestReadFile(path, contents, sizeof(contents));
+  GDTCORHostTestAssert(length == torn);
+  uint64_t validLength = GDTCOREventLogValidLength(contents, length);
+  GDTCORHostTestAssert(validLength == committed);
+  GDTCORHostTestAssert(truncate(path, (off_t)validLength) == 0);
+
+  fd = open(path, O_RDWR);
+  GDTCORHostTestAssert(GDTCOREventLogAppend(fd, segment.bytes + validLength,
+                                            segment.length - validLength, validLength) == 0);
+  close(fd);
+
+  length = GDTCORTestReadFile(path, contents, sizeof(contents));
+  GDTCORHostTestAssert(length == segment.length);
+  GDTCORHostTestAssert(memcmp(contents, segment.bytes, segment.length) == 0);
+  GDTCORHostTestAssert(GDTCOREventLogValidLength(contents, length) == segment.length);
+  unlink(path);
+}
+
+int main(void) {
+  GDTCORHostTestRun(testReadsEveryRecord);
+  GDTCORHostTestRun(testTruncationRecoversToLastRecord);
+  GDTCORHostTestRun(testChecksumMismatchStopsAtRecord);
+  GDTCORHostTestRun(testBadMagicStopsAtRecord);
+  GDTCORHostTestRun(testHugeLengthsDoNotOverflow);
+  GDTCORHostTestRun(testReadsSealedIndex);
+  GDTCORHostTestRun(testUnsealedOrCorruptIndexIsRejected);
+  GDTCORHostTestRun(testRandomCorruptionOfFramingOrBodyIsCaught);
+  GDTCORHostTestRun(testAppendWritesAtOffset);
+  GDTCORHostTestRun(testFailedAppendLeavesSegmentUnchanged);
+  GDTCORHostTestRun(testTornAppendIsRecoveredAndAppendedAfter);
+  return GDTCORHostTestFinish();
+}
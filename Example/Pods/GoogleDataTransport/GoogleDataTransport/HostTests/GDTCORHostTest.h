@@ -0,0 +1,56 @@
+/*
+ * Copyright 2026 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/** A minimal harness for the tests and benches in this directory, which run on the build host
+ * rather than on device. Failed assertions are counted, so that one run reports all of them.
+ */
+
+static int GDTCORHostTestFailures = 0;
+
+#define GDTCORHostTestAssert(condition)                                                 \
+  do {                                                                                  \
+    if (!(condition)) {                                                                 \
+      fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+      GDTCORHostTestFailures++;                                                         \
+    }                                                                                   \
+  } while (0)
+
+#define GDTCORHostTestRun(test)                                                           \
+  do {                                                                                    \
+    const int failuresBefore = GDTCORHostTestFailures;                                    \
+    test();                                                                               \
+    printf("%s %s\n", GDTCORHostTestFailures == failuresBefore ? "PASS" : "FAIL", #test); \
+  } while (0)
+
+static inline int GDTCORHostTestFinish(void) {
+  if (GDTCORHostTestFailures > 0) {
+    fprintf(stderr, "%d assertion(s) failed\n", GDTCORHostTestFailures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static inline double GDTCORHostTestSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}